@@ -0,0 +1,306 @@
+/**
+ * @file display_bench.c
+ * @brief Host benchmark: hashrate lost to display refreshes on the hash
+ *        path, against the same refreshes in a stats thread
+ *
+ * The firmware's OLED sits on a 100 kHz I2C bus, and the driver blocks the
+ * calling task for each whole transfer (main/ssd1306.c). Here a refresh
+ * is modeled as that blocking time: every page written is three command
+ * transactions and one 128-byte data transaction. Two refresh styles are
+ * timed:
+ *
+ * - full: what the display code did on every refresh before, a
+ *   full-screen clear, the contrast and seven text lines;
+ * - changed lines: what update_display() does now, rewriting only the
+ *   lines whose text changed (hashrate, total and share count).
+ *
+ * For each style and rate (1, 2 and 10 Hz), one worker scans nonces with
+ * the "reject" backend for a fixed time, in two setups:
+ *
+ * - inline: the worker itself samples the counters, formats the lines and
+ *   blocks for the transfer when a refresh is due, as the single mining
+ *   task used to;
+ * - stats thread: the worker only scans and bumps its counters, and a
+ *   second thread samples, formats and blocks, as the firmware's stats
+ *   task does.
+ *
+ * It reports both hashrates (best of RUN_REPEATS runs, with the spread of
+ * the runs) and the gain of the stats thread. When the process may run on
+ * two CPUs or more, the worker and the stats thread are pinned to separate
+ * ones; on a single CPU they share it, and the spread shows how much the
+ * numbers can be trusted.
+ *
+ * Usage: display_bench [ms per run]
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mining/miner_core.h"
+
+#define DEFAULT_RUN_MS      2000u
+
+// I2C model: 9 clocks per byte plus start and stop, and the driver's
+// per-transaction setup (command link, interrupts); the setup is an estimate
+#define I2C_HZ              100000u
+#define I2C_TXN_SETUP_US    50u
+#define DISPLAY_WIDTH       128u
+#define DISPLAY_PAGES       8u
+
+// Nonces between time checks of the worker
+#define SCAN_BATCH          1024u
+
+// Runs per setup; the best one counts, which filters out other load
+#define RUN_REPEATS         3
+
+// CPUs of the worker and the stats thread, when pinning (-1: not pinned)
+static int worker_cpu = -1;
+static int stats_cpu = -1;
+
+typedef struct {
+    const char *name;
+    uint32_t pages;                     ///< Pages written per refresh
+    uint32_t commands;                  ///< Extra command transactions per refresh
+} refresh_style_t;
+
+static const refresh_style_t styles[] = {
+    { "full",          DISPLAY_PAGES + 7, 2 },  // clear, contrast, seven lines
+    { "changed lines", 3,                 0 },  // hashrate, total, shares
+};
+
+static const uint32_t rates_hz[] = { 1, 2, 10 };
+
+typedef struct {
+    miner_worker_t worker;
+    const hash_backend_t *backend;
+    miner_stats_reader_t reader;
+    uint32_t refresh_us;                ///< Modeled blocking time of one refresh
+    uint64_t period_ns;                 ///< Refresh period (0: no display)
+    uint64_t last_ns;                   ///< Start of the previous refresh
+    uint32_t refreshes;
+    bool stop;                          ///< Ends the stats thread (atomic access)
+} bench_run_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    nanosleep(&ts, NULL);
+}
+
+// Blocking time of one I2C write transaction of len bytes after the address
+static uint32_t i2c_txn_us(uint32_t len)
+{
+    return (uint32_t)(((len + 1) * 9u + 2u) * 1000000ull / I2C_HZ) + I2C_TXN_SETUP_US;
+}
+
+static uint32_t refresh_us(const refresh_style_t *style)
+{
+    uint32_t page = 3 * i2c_txn_us(2) + i2c_txn_us(DISPLAY_WIDTH + 1);
+
+    return style->pages * page + style->commands * i2c_txn_us(2);
+}
+
+// Pin the calling thread to a CPU (-1: leave it alone)
+static void pin_cpu(int cpu)
+{
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        return;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Pick the first two CPUs the process may run on, if it has two
+static void choose_cpus(void)
+{
+    cpu_set_t set;
+    int found = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE && found < 2; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            if (found++ == 0) {
+                worker_cpu = cpu;
+            } else {
+                stats_cpu = cpu;
+            }
+        }
+    }
+    if (stats_cpu < 0) {
+        worker_cpu = -1;
+    }
+}
+
+// One refresh: sample the counters, format the lines, block for the transfer
+static void refresh(bench_run_t *run)
+{
+    char lines[4][32];
+    uint64_t now = now_ns();
+    uint64_t hashes = miner_stats_collect(&run->reader, &run->worker, 1);
+    float hashrate = hashes / ((now - run->last_ns) / 1e9f);
+
+    snprintf(lines[0], sizeof(lines[0]), "Rate: %.1f H/s", hashrate);
+    snprintf(lines[1], sizeof(lines[1]), "Total: %llu", (unsigned long long)run->reader.total_hashes);
+    snprintf(lines[2], sizeof(lines[2]), "Best: %.4g diff", run->reader.best_difficulty);
+    snprintf(lines[3], sizeof(lines[3]), "Shares: %lu", (unsigned long)run->reader.shares);
+    sleep_ns((uint64_t)run->refresh_us * 1000u);
+    run->last_ns = now;
+    run->refreshes++;
+}
+
+static void stats_thread(void *arg)
+{
+    bench_run_t *run = (bench_run_t *)arg;
+
+    pin_cpu(stats_cpu);
+    while (!__atomic_load_n(&run->stop, __ATOMIC_RELAXED)) {
+        uint64_t due = run->last_ns + run->period_ns;
+        uint64_t now = now_ns();
+
+        if (now < due) {
+            // Short naps, so the thread notices the end of the run
+            sleep_ns(due - now < 10000000u ? due - now : 10000000u);
+            continue;
+        }
+        refresh(run);
+    }
+}
+
+// Scan for run_ms; returns the worker's hashrate
+static double run_worker(bench_run_t *run, uint32_t run_ms, bool inline_refresh)
+{
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)run_ms * 1000000u;
+    uint64_t hashes = 0;
+    uint32_t nonce = 0;
+    uint32_t mask;
+    uint64_t now;
+
+    // The stats thread owns last_ns while it runs; bench_once() set it
+    while ((now = now_ns()) < end) {
+        for (uint32_t i = 0; i < SCAN_BATCH; i += MINER_WORKER_CHUNK) {
+            miner_worker_scan(&run->worker, run->backend, nonce, MINER_WORKER_CHUNK, 0, &mask);
+            nonce += MINER_WORKER_CHUNK;
+        }
+        hashes += SCAN_BATCH;
+        if (inline_refresh && run->period_ns != 0 && now - run->last_ns >= run->period_ns) {
+            refresh(run);
+        }
+    }
+    return hashes / ((now_ns() - start) / 1e9);
+}
+
+static double bench_once(const uint8_t *header, uint32_t run_ms, uint32_t period_ms, uint32_t blocking_us,
+                         bool inline_refresh)
+{
+    static bench_run_t run;
+    sha256d_ctx_t engine;
+    miner_thread_t thread;
+    bool threaded = !inline_refresh && period_ms != 0;
+    double hashrate;
+
+    memset(&run, 0, sizeof(run));
+    run.backend = hash_backend_find("reject");
+    run.refresh_us = blocking_us;
+    run.period_ns = (uint64_t)period_ms * 1000000u;
+    miner_worker_init(&run.worker, 0);
+    sha256d_init(&engine, header);
+    miner_worker_load(&run.worker, 1, &engine);
+    miner_stats_reset(&run.reader, &run.worker, 1);
+    run.last_ns = now_ns();
+
+    if (threaded && !miner_thread_start(&thread, stats_thread, &run, "stats", 0)) {
+        return 0;
+    }
+    hashrate = run_worker(&run, run_ms, inline_refresh);
+    if (threaded) {
+        __atomic_store_n(&run.stop, true, __ATOMIC_RELAXED);
+        miner_thread_join(&thread);
+    }
+    return hashrate;
+}
+
+// Best hashrate of RUN_REPEATS runs; *spread gets (best - worst) / best in percent
+static double bench_run(const uint8_t *header, uint32_t run_ms, uint32_t period_ms, uint32_t blocking_us,
+                        bool inline_refresh, double *spread)
+{
+    double best = 0;
+    double worst = 0;
+
+    for (int i = 0; i < RUN_REPEATS; i++) {
+        double hashrate = bench_once(header, run_ms, period_ms, blocking_us, inline_refresh);
+        if (hashrate > best) {
+            best = hashrate;
+        }
+        if (i == 0 || hashrate < worst) {
+            worst = hashrate;
+        }
+    }
+    *spread = best > 0 ? (best - worst) / best * 100 : 0;
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t run_ms = DEFAULT_RUN_MS;
+    uint8_t header[BLOCK_HEADER_SIZE];
+    double base, base_spread;
+
+    if (argc > 1) {
+        run_ms = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (run_ms == 0) {
+            fprintf(stderr, "usage: %s [ms per run]\n", argv[0]);
+            return 2;
+        }
+    }
+    for (int i = 0; i < BLOCK_HEADER_SIZE; i++) {
+        header[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    choose_cpus();
+    pin_cpu(worker_cpu);
+    printf("display_bench: %u ms per run, one worker, I2C at %u kHz\n", run_ms, I2C_HZ / 1000);
+    if (worker_cpu >= 0) {
+        printf("worker on CPU %d, stats thread on CPU %d\n\n", worker_cpu, stats_cpu);
+    } else {
+        printf("one CPU: worker and stats thread share it, mind the spread\n\n");
+    }
+    base = bench_run(header, run_ms, 0, 0, true, &base_spread);
+    printf("%-22s %11s %12s %7s %16s %7s %7s\n", "display", "ms/refresh", "inline H/s", "spread", "stats thread H/s",
+           "spread", "gain");
+    printf("%-22s %11s %12.0f %6.0f%% %16.0f %6.0f%%\n", "none", "-", base, base_spread, base, base_spread);
+
+    for (size_t s = 0; s < sizeof(styles) / sizeof(styles[0]); s++) {
+        uint32_t blocking_us = refresh_us(&styles[s]);
+
+        for (size_t r = 0; r < sizeof(rates_hz) / sizeof(rates_hz[0]); r++) {
+            uint32_t period_ms = 1000 / rates_hz[r];
+            double inline_spread, thread_spread;
+            double inline_rate = bench_run(header, run_ms, period_ms, blocking_us, true, &inline_spread);
+            double thread_rate = bench_run(header, run_ms, period_ms, blocking_us, false, &thread_spread);
+            char name[32];
+
+            snprintf(name, sizeof(name), "%s, %lu Hz", styles[s].name, (unsigned long)rates_hz[r]);
+            printf("%-22s %11.1f %12.0f %6.0f%% %16.0f %6.0f%% %6.0f%%\n", name, blocking_us / 1000.0, inline_rate,
+                   inline_spread, thread_rate, thread_spread,
+                   inline_rate > 0 ? (thread_rate / inline_rate - 1) * 100 : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,324 @@
+/**
+ * @file gbt_bench.c
+ * @brief Host benchmark for the streaming merkle builder and the
+ *        getblocktemplate parser on large templates
+ *
+ * Merkle: for templates of 5,000 to 65,535 transactions, times the
+ * coinbase branch built by merkle_add()/merkle_finish() against the same
+ * branch computed over whole levels, which needs every txid in memory.
+ * The two branches must match. Memory is the builder state against the
+ * txid array.
+ *
+ * Parser: generates getblocktemplate responses of 5,000+ transactions
+ * and streams them through gbt_parser_feed() in GBT_IO_CHUNK pieces, as
+ * the client receives them, then builds the work. One template has
+ * transactions small enough for all of them to be kept, so the whole
+ * tree is folded while parsing; the other has typical sizes, so only a
+ * prefix fits in GBT_TX_DATA_MAX. Memory is the parser and template
+ * state and the stack high-water mark of a pass, measured on a thread
+ * whose stack is pre-filled with a pattern.
+ *
+ * Usage: gbt_bench [passes]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mining/miner_core.h"
+
+#define DEFAULT_PASSES  20u
+#define STACK_SIZE      (64 * 1024)
+#define STACK_PATTERN   0xA5
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Transaction i's id: distinct, not a real hash
+static void make_txid(uint32_t i, uint8_t *txid)
+{
+    memset(txid, (int)(i * 131 + 17), 32);
+    block_header_write_le32(txid, i);
+}
+
+static void hash_pair(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+    uint8_t pair[64];
+
+    memcpy(pair, left, 32);
+    memcpy(pair + 32, right, 32);
+    double_sha256(pair, sizeof(pair), out);
+}
+
+// Branch over whole levels: every txid in memory, hashed level by level
+static uint32_t level_branch(uint8_t (*level)[32], uint32_t txs, uint8_t (*branch)[32])
+{
+    uint32_t count = txs + 1;
+    uint32_t depth = 0;
+
+    for (uint32_t i = 0; i < txs; i++) {
+        make_txid(i, level[1 + i]);
+    }
+    while (count > 1) {
+        memcpy(branch[depth++], level[1], 32);
+        if (count % 2 != 0) {
+            memcpy(level[count], level[count - 1], 32);
+            count++;
+        }
+        // Entry 0 stands for the coinbase side
+        for (uint32_t i = 1; i < count / 2; i++) {
+            hash_pair(level[2 * i], level[2 * i + 1], level[i]);
+        }
+        count /= 2;
+    }
+    return depth;
+}
+
+static uint32_t stream_branch(merkle_builder_t *merkle, uint32_t txs)
+{
+    uint8_t txid[32];
+
+    merkle_init(merkle);
+    for (uint32_t i = 0; i < txs; i++) {
+        make_txid(i, txid);
+        merkle_add(merkle, txid);
+    }
+    return merkle_finish(merkle);
+}
+
+static int bench_merkle(uint32_t passes)
+{
+    static const uint32_t sizes[] = { 5000, 20000, MERKLE_LEAVES_MAX - 1 };
+    static merkle_builder_t merkle;
+    static uint8_t branch[MERKLE_DEPTH_MAX][32];
+    uint8_t (*level)[32] = malloc((size_t)(MERKLE_LEAVES_MAX + 1) * 32);
+    int failures = 0;
+
+    if (level == NULL) {
+        return 1;
+    }
+    printf("%-22s %7s %12s %12s %12s %12s\n", "merkle branch", "levels", "stream ms", "levels ms",
+           "stream B", "levels B");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t txs = sizes[s];
+        uint32_t depth = 0;
+        uint64_t start = now_ns();
+
+        for (uint32_t i = 0; i < passes; i++) {
+            depth = stream_branch(&merkle, txs);
+        }
+        double stream_ns = (double)(now_ns() - start);
+
+        start = now_ns();
+        for (uint32_t i = 0; i < passes; i++) {
+            level_branch(level, txs, branch);
+        }
+        double level_ns = (double)(now_ns() - start);
+
+        if (level_branch(level, txs, branch) != depth || memcmp(branch, merkle.branch, depth * 32) != 0) {
+            printf("%-22s %7s\n", "", "MISMATCH");
+            failures++;
+            continue;
+        }
+        printf("%6u transactions     %7u %12.3f %12.3f %12zu %12zu\n", txs, depth, stream_ns / passes / 1e6,
+               level_ns / passes / 1e6, sizeof(merkle_builder_t), (size_t)(txs + 2) * 32);
+    }
+    free(level);
+    return failures;
+}
+
+typedef struct {
+    const char *name;
+    uint32_t txs;
+    size_t tx_size;                     ///< Raw bytes per transaction
+    char *json;
+    size_t len;
+    uint32_t kept;                      ///< Transactions the parser kept
+    uint32_t branch_len;
+    bool ok;
+} bench_template_t;
+
+static char *append(char *at, const char *text)
+{
+    size_t len = strlen(text);
+    memcpy(at, text, len);
+    return at + len;
+}
+
+static char *append_hex(char *at, const uint8_t *data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < len; i++) {
+        *at++ = digits[data[i] >> 4];
+        *at++ = digits[data[i] & 15];
+    }
+    return at;
+}
+
+// A getblocktemplate response as bitcoind formats it
+static bool make_template(bench_template_t *t)
+{
+    uint8_t *data = calloc(1, t->tx_size);
+    size_t max = 1024 + (size_t)t->txs * (2 * t->tx_size + 256);
+    char *at = malloc(max);
+    char text[128];
+
+    t->json = at;
+    if (data == NULL || at == NULL) {
+        free(data);
+        return false;
+    }
+    at = append(at, "{\"result\":{\"capabilities\":[\"proposal\"],\"version\":536870912,\"rules\":[\"csv\","
+                "\"!segwit\",\"taproot\"],\"previousblockhash\":"
+                "\"00000000000000000001d2ee67bb2b4e3e4f7d1b9ee8bb0bcb2db8aa1c5a2e6f\",\"transactions\":[");
+    for (uint32_t i = 0; i < t->txs; i++) {
+        uint8_t hash[32];
+
+        at = append(at, i > 0 ? ",{\"data\":\"" : "{\"data\":\"");
+        for (size_t k = 0; k < t->tx_size && k < 4; k++) {
+            data[k] = (uint8_t)(i >> (8 * k));
+        }
+        at = append_hex(at, data, t->tx_size);
+        at = append(at, "\",\"txid\":\"");
+        make_txid(i, hash);
+        at = append_hex(at, hash, 32);
+        at = append(at, "\",\"hash\":\"");
+        hash[31] ^= 0xff;
+        at = append_hex(at, hash, 32);
+        snprintf(text, sizeof(text), "\",\"depends\":[],\"fee\":%u,\"sigops\":1,\"weight\":%zu}",
+                 (unsigned)(1000 + i), 4 * t->tx_size);
+        at = append(at, text);
+    }
+    at = append(at, "],\"coinbaseaux\":{},\"coinbasevalue\":400000000,\"longpollid\":\"x\",\"curtime\":1700000000,"
+                "\"bits\":\"17034219\",\"height\":840000,\"default_witness_commitment\":"
+                "\"6a24aa21a9ede2f61c3f71d1defd3fa999dfa36953755c690689799962b48bebd836974e8cf9\"},"
+                "\"error\":null,\"id\":1}\n");
+    t->len = (size_t)(at - t->json);
+    free(data);
+    return true;
+}
+
+// Parse a template as the client receives it, then build the work
+static void parse_template(bench_template_t *t)
+{
+    static const uint8_t script[22] = { 0x00, 0x14 };
+    static gbt_parser_t parser;
+    static gbt_template_t tmpl;
+    static work_template_t work;
+    gbt_parse_t result = GBT_PARSE_MORE;
+
+    gbt_parser_init(&parser, &tmpl);
+    for (size_t at = 0; at < t->len && result == GBT_PARSE_MORE; at += GBT_IO_CHUNK) {
+        result = gbt_parser_feed(&parser, t->json + at, t->len - at < GBT_IO_CHUNK ? t->len - at : GBT_IO_CHUNK);
+    }
+    t->ok = result == GBT_PARSE_DONE && gbt_build_work(&tmpl, script, sizeof(script), &work);
+    t->kept = tmpl.tx_count;
+    t->branch_len = tmpl.branch_len;
+}
+
+static void *stack_thread(void *arg)
+{
+    parse_template((bench_template_t *)arg);
+    return NULL;
+}
+
+// Deepest stack use of a pass, from the untouched end of a pattern-filled stack
+static bool bench_stack(bench_template_t *t, size_t *used)
+{
+    uint8_t *stack = malloc(STACK_SIZE);
+    pthread_attr_t attr;
+    pthread_t thread;
+    size_t untouched = 0;
+
+    if (stack == NULL) {
+        return false;
+    }
+    memset(stack, STACK_PATTERN, STACK_SIZE);
+    pthread_attr_init(&attr);
+    if (pthread_attr_setstack(&attr, stack, STACK_SIZE) != 0 ||
+        pthread_create(&thread, &attr, stack_thread, t) != 0) {
+        pthread_attr_destroy(&attr);
+        free(stack);
+        return false;
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    // The stack grows down from the top of the buffer
+    while (untouched < STACK_SIZE && stack[untouched] == STACK_PATTERN) {
+        untouched++;
+    }
+    free(stack);
+    *used = STACK_SIZE - untouched;
+    return t->ok;
+}
+
+static int bench_parser(uint32_t passes)
+{
+    static bench_template_t templates[] = {
+        { "5000 x 2 B (all kept)", 5000, 2, NULL, 0, 0, 0, false },
+        { "6000 x 250 B (prefix)", 6000, 250, NULL, 0, 0, 0, false },
+    };
+    int failures = 0;
+
+    printf("\n%-22s %9s %7s %7s %10s %8s %10s\n", "template", "KB", "kept", "levels", "ms", "MB/s", "stack B");
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+        bench_template_t *t = &templates[i];
+        size_t stack_used = 0;
+
+        if (!make_template(t)) {
+            failures++;
+            continue;
+        }
+        uint64_t start = now_ns();
+        for (uint32_t p = 0; p < passes && (p == 0 || t->ok); p++) {
+            parse_template(t);
+        }
+        double ns = (double)(now_ns() - start);
+
+        if (!bench_stack(t, &stack_used) || (t->tx_size * t->txs <= GBT_TX_DATA_MAX && t->kept != t->txs)) {
+            printf("%-22s %9s\n", t->name, "FAILED");
+            failures++;
+        } else {
+            printf("%-22s %9.1f %7u %7u %10.3f %8.1f %10zu\n", t->name, t->len / 1024.0, t->kept, t->branch_len,
+                   ns / passes / 1e6, 1e3 * (double)t->len * passes / ns, stack_used);
+        }
+        free(t->json);
+    }
+
+    printf("\n%-30s %10s\n", "memory", "bytes");
+    printf("%-30s %10zu\n", "parser state (both builders)", sizeof(gbt_parser_t));
+    printf("%-30s %10zu\n", "template (branch, tx data)", sizeof(gbt_template_t));
+    printf("%-30s %10zu\n", "merkle builder", sizeof(merkle_builder_t));
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t passes = DEFAULT_PASSES;
+    int failures = 0;
+
+    if (argc > 1) {
+        passes = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (passes == 0) {
+            fprintf(stderr, "usage: %s [passes]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("gbt_bench: %u passes\n\n", passes);
+    failures += bench_merkle(passes);
+    failures += bench_parser(passes);
+
+    if (failures != 0) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,540 @@
+/**
+ * @file miner_bench.c
+ * @brief Host benchmark for the mining core hash kernels
+ *
+ * Runs every kernel variant over the same header and nonce range and reports
+ * hashes per second and nanoseconds per hash. Before timing, each variant is
+ * checked against the generic double_sha256() reference so a fast but wrong
+ * kernel is reported instead of benchmarked.
+ *
+ * The batch section compares each supported SIMD lane width of
+ * sha256d_batch() with its scalar fallback on identical headers, and the
+ * interleave section compares the 2-way and 4-way scalar kernels with the
+ * single-nonce one. The worker section runs a miner_ctx_t with 1..N worker
+ * threads (work-stealing scheduler, per-worker counters) over a fixed nonce
+ * range and reports the aggregate rate, scaling over one worker and the
+ * number of steals. The roll section times the switch to the next header
+ * variant when a nonce range is exhausted: a BIP320 version step, an ntime
+ * roll and an extranonce2 bump with a 200-byte coinbase and a 12-level
+ * merkle branch, with and without the cached coinbase prefix. The job switch section publishes new jobs to two running
+ * workers and reports the build time (spent on the publishing thread) and
+ * the longest pickup delay, for plain jobs (next chunk boundary) and clean
+ * jobs (next scan batch).
+ *
+ * Usage: miner_bench [hashes_per_kernel]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mining/miner_core.h"
+
+#define DEFAULT_HASHES  2000000u
+
+/**
+ * @brief Hash one nonce with a particular kernel
+ *
+ * @param ctx Engine state prepared for the benchmark header
+ * @param header Serialized header (for the generic reference path)
+ * @param nonce Nonce to hash
+ * @param hash Output digest
+ */
+typedef void (*bench_kernel_fn)(sha256d_ctx_t *ctx, uint8_t *header, uint32_t nonce, uint8_t *hash);
+
+typedef struct {
+    const char *name;
+    bench_kernel_fn fn;
+} bench_kernel_t;
+
+static void kernel_generic(sha256d_ctx_t *ctx, uint8_t *header, uint32_t nonce, uint8_t *hash)
+{
+    (void)ctx;
+    block_header_write_le32(&header[BLOCK_HEADER_NONCE_OFFSET], nonce);
+    double_sha256(header, BLOCK_HEADER_SIZE, hash);
+}
+
+static void kernel_unrolled(sha256d_ctx_t *ctx, uint8_t *header, uint32_t nonce, uint8_t *hash)
+{
+    (void)header;
+    sha256d_set_nonce(ctx, nonce);
+    sha256d_hash(ctx, hash);
+}
+
+static void kernel_midstate(sha256d_ctx_t *ctx, uint8_t *header, uint32_t nonce, uint8_t *hash)
+{
+    (void)header;
+    sha256d_set_nonce(ctx, nonce);
+    sha256d_hash_midstate(ctx, hash);
+}
+
+static void kernel_precomputed(sha256d_ctx_t *ctx, uint8_t *header, uint32_t nonce, uint8_t *hash)
+{
+    (void)header;
+    sha256d_hash_nonce(ctx, nonce, hash);
+}
+
+static void kernel_early_reject(sha256d_ctx_t *ctx, uint8_t *header, uint32_t nonce, uint8_t *hash)
+{
+    (void)header;
+    // Realistic pool share targets need at least 32 leading zero bits
+    if (!sha256d_check_nonce(ctx, nonce, 0, hash)) {
+        hash[31] = 0xFF;
+    }
+}
+
+static const bench_kernel_t kernels[] = {
+    { "double_sha256 (generic)",      kernel_generic },
+    { "sha256d_hash (unrolled)",      kernel_unrolled },
+    { "sha256d_hash_midstate",        kernel_midstate },
+    { "sha256d_hash_nonce (precomp)", kernel_precomputed },
+    { "sha256d_check_nonce (reject)", kernel_early_reject },
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Deterministic, non-trivial benchmark header
+static void bench_header(uint8_t *header)
+{
+    block_header_t fields;
+
+    memset(&fields, 0, sizeof(fields));
+    fields.version = 0x20000000;
+    for (int i = 0; i < 32; i++) {
+        fields.prev_hash[i] = (uint8_t)(i * 13 + 1);
+        fields.merkle_root[i] = (uint8_t)(i * 29 + 7);
+    }
+    fields.timestamp = 1700000000;
+    fields.bits = 0x1d00ffff;
+    block_header_serialize(&fields, header);
+}
+
+// Compare a kernel with the reference; early-reject is checked on the
+// nonces it accepts with the loosest limit
+static int verify_kernel(const bench_kernel_t *kernel, const uint8_t *header)
+{
+    uint8_t ref_header[BLOCK_HEADER_SIZE];
+    uint8_t work_header[BLOCK_HEADER_SIZE];
+    uint8_t expected[32];
+    uint8_t hash[32];
+    sha256d_ctx_t ctx;
+
+    memcpy(ref_header, header, BLOCK_HEADER_SIZE);
+    memcpy(work_header, header, BLOCK_HEADER_SIZE);
+    sha256d_init(&ctx, header);
+
+    for (uint32_t nonce = 0; nonce < 256; nonce++) {
+        block_header_write_le32(&ref_header[BLOCK_HEADER_NONCE_OFFSET], nonce);
+        double_sha256(ref_header, BLOCK_HEADER_SIZE, expected);
+
+        if (kernel->fn == kernel_early_reject) {
+            if (!sha256d_check_nonce(&ctx, nonce, 0xFFFFFFFF, hash)) {
+                return -1;
+            }
+        } else {
+            kernel->fn(&ctx, work_header, nonce, hash);
+        }
+        if (memcmp(expected, hash, 32) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int bench_kernels(uint32_t hashes, const uint8_t *header)
+{
+    int failures = 0;
+
+    printf("%-30s %14s %10s\n", "kernel", "H/s", "ns/hash");
+
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        const bench_kernel_t *kernel = &kernels[k];
+        uint8_t work_header[BLOCK_HEADER_SIZE];
+        uint8_t hash[32];
+        uint8_t sink = 0;
+        sha256d_ctx_t ctx;
+
+        if (verify_kernel(kernel, header) != 0) {
+            printf("%-30s %14s %10s\n", kernel->name, "MISMATCH", "-");
+            failures++;
+            continue;
+        }
+
+        memcpy(work_header, header, BLOCK_HEADER_SIZE);
+        sha256d_init(&ctx, header);
+
+        uint64_t start = now_ns();
+        for (uint32_t nonce = 0; nonce < hashes; nonce++) {
+            kernel->fn(&ctx, work_header, nonce, hash);
+            sink ^= hash[31];
+        }
+        uint64_t elapsed = now_ns() - start;
+
+        double ns_per_hash = (double)elapsed / hashes;
+        printf("%-30s %14.0f %10.1f\n", kernel->name, 1e9 / ns_per_hash, ns_per_hash);
+
+        // Keep the results observable so the loop cannot be optimized away
+        __asm__ volatile("" : : "r"(sink));
+    }
+
+    return failures;
+}
+
+static int bench_batch(uint32_t hashes, const uint8_t *header)
+{
+    static const sha256d_batch_lanes_t variants[] = {
+        SHA256D_BATCH_SCALAR, SHA256D_BATCH_SSE41, SHA256D_BATCH_AVX2, SHA256D_BATCH_AVX512
+    };
+    // Chunked so the candidate bitmap stays small; 4096 nonces per call
+    enum { CHUNK = 4096 };
+    uint32_t reference[SHA256D_BATCH_MASK_WORDS(CHUNK)];
+    uint32_t mask[SHA256D_BATCH_MASK_WORDS(CHUNK)];
+    sha256d_batch_job_t job;
+    double scalar_ns = 0;
+    int failures = 0;
+
+    sha256d_init(&job.ctx, header);
+    job.max_top_word = 0x00FFFFFF;  // 8 leading zero bits, so candidates are exercised
+
+    printf("\n%-30s %14s %10s %8s\n", "sha256d_batch", "H/s", "ns/hash", "speedup");
+
+    uint32_t want = sha256d_batch_with(&job, SHA256D_BATCH_SCALAR, 0, CHUNK, reference);
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        const char *name = sha256d_batch_name(variants[v]);
+        uint64_t candidates = 0;
+
+        if (!sha256d_batch_supported(variants[v])) {
+            printf("%-30s %14s %10s %8s\n", name, "unsupported", "-", "-");
+            continue;
+        }
+
+        uint32_t got = sha256d_batch_with(&job, variants[v], 0, CHUNK, mask);
+        if (got != want || memcmp(reference, mask, sizeof(mask)) != 0) {
+            printf("%-30s %14s %10s %8s\n", name, "MISMATCH", "-", "-");
+            failures++;
+            continue;
+        }
+
+        uint64_t start = now_ns();
+        for (uint32_t done = 0; done < hashes; done += CHUNK) {
+            uint32_t count = hashes - done < CHUNK ? hashes - done : CHUNK;
+            candidates += sha256d_batch_with(&job, variants[v], done, count, mask);
+        }
+        uint64_t elapsed = now_ns() - start;
+
+        double ns_per_hash = (double)elapsed / hashes;
+        if (variants[v] == SHA256D_BATCH_SCALAR) {
+            scalar_ns = ns_per_hash;
+        }
+        printf("%-30s %14.0f %10.1f %7.2fx\n", name, 1e9 / ns_per_hash, ns_per_hash,
+               scalar_ns > 0 ? scalar_ns / ns_per_hash : 0.0);
+        __asm__ volatile("" : : "r"(candidates));
+    }
+    printf("auto-selected: %s\n", sha256d_batch_name(sha256d_batch_detect()));
+
+    return failures;
+}
+
+typedef uint32_t (*bench_nway_fn)(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word);
+
+static uint32_t nway_x1(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+    return sha256d_check_nonce(ctx, nonce, max_top_word, hash) ? 1u : 0u;
+}
+
+static int bench_interleave(uint32_t hashes, const uint8_t *header)
+{
+    static const struct {
+        const char *name;
+        bench_nway_fn fn;
+        uint32_t lanes;
+    } widths[] = {
+        { "x1", nway_x1, 1 },
+        { "x2", sha256d_check_nonce_x2, 2 },
+        { "x4", sha256d_check_nonce_x4, 4 },
+    };
+    const uint32_t limit = 0x00FFFFFF;
+    sha256d_ctx_t ctx;
+    double x1_ns = 0;
+    int failures = 0;
+
+    sha256d_init(&ctx, header);
+
+    printf("\n%-30s %14s %10s %8s\n", "interleave", "H/s", "ns/hash", "speedup");
+
+    for (size_t v = 0; v < sizeof(widths) / sizeof(widths[0]); v++) {
+        uint32_t lanes = widths[v].lanes;
+        uint32_t sink = 0;
+        char name[40];
+        bool ok = true;
+
+        snprintf(name, sizeof(name), "%s%s", widths[v].name,
+                 lanes == SHA256D_INTERLEAVE ? " (nway)" : "");
+
+        for (uint32_t nonce = 0; nonce < 1024 && ok; nonce += lanes) {
+            uint32_t want = 0;
+            for (uint32_t l = 0; l < lanes; l++) {
+                want |= nway_x1(&ctx, nonce + l, limit) << l;
+            }
+            ok = widths[v].fn(&ctx, nonce, limit) == want;
+        }
+        if (!ok) {
+            printf("%-30s %14s %10s %8s\n", name, "MISMATCH", "-", "-");
+            failures++;
+            continue;
+        }
+
+        uint64_t start = now_ns();
+        for (uint32_t nonce = 0; nonce < hashes; nonce += lanes) {
+            sink ^= widths[v].fn(&ctx, nonce, limit);
+        }
+        uint64_t elapsed = now_ns() - start;
+
+        double ns_per_hash = (double)elapsed / hashes;
+        if (lanes == 1) {
+            x1_ns = ns_per_hash;
+        }
+        printf("%-30s %14.0f %10.1f %7.2fx\n", name, 1e9 / ns_per_hash, ns_per_hash,
+               x1_ns > 0 ? x1_ns / ns_per_hash : 0.0);
+        __asm__ volatile("" : : "r"(sink));
+    }
+
+    return failures;
+}
+
+static int bench_workers(uint32_t hashes, const uint8_t *header)
+{
+    static miner_ctx_t miner;
+    const hash_backend_t *backend = hash_backend_find("reject");
+    uint32_t cpus = miner_cpu_count();
+    uint32_t max_workers = cpus < 2 ? 2 : (cpus > MINER_MAX_WORKERS ? MINER_MAX_WORKERS : cpus);
+    double single_rate = 0;
+    int failures = 0;
+
+    printf("\n%-30s %14s %10s %8s %7s\n", "workers (reject backend)", "H/s", "ns/hash", "scaling", "steals");
+
+    for (uint32_t n = 1; n <= max_workers; n++) {
+        char name[32];
+
+        miner_ctx_init(&miner, backend, n);
+        miner_ctx_set_job(&miner, header);
+        miner_ctx_set_range(&miner, 0, hashes, MINER_SCHED_CHUNK);
+
+        uint64_t start = now_ns();
+        if (!miner_ctx_start(&miner)) {
+            printf("%u workers: thread start failed\n", n);
+            return failures + 1;
+        }
+        miner_ctx_wait(&miner);
+        uint64_t elapsed = now_ns() - start;
+
+        snprintf(name, sizeof(name), "%u worker%s", n, n > 1 ? "s" : "");
+        uint64_t total = miner_ctx_collect(&miner);
+        if (total != hashes) {
+            printf("%-30s %14s %10s %8s %7s\n", name, "MISCOUNT", "-", "-", "-");
+            failures++;
+            continue;
+        }
+
+        double rate = (double)total * 1e9 / (double)elapsed;
+        if (n == 1) {
+            single_rate = rate;
+        }
+        printf("%-30s %14.0f %10.1f %7.2fx %7u\n", name, rate, 1e9 / rate, rate / single_rate,
+               miner_ctx_job(&miner)->sched.steals);
+    }
+    printf("online CPUs: %u\n", cpus);
+
+    return failures;
+}
+
+// Template with a pool-sized coinbase and merkle branch around the bench header
+static void bench_work(const uint8_t *header, work_template_t *work)
+{
+    uint8_t coinbase1[100];
+    uint8_t coinbase2[92];
+    uint8_t extranonce1[4] = { 0xde, 0xad, 0xbe, 0xef };
+    uint8_t branch[32];
+    block_header_t fields;
+
+    block_header_parse(header, &fields);
+    work_init(work, &fields, WORK_NTIME_ROLL_DEFAULT);
+    work->version_mask = VERSION_ROLLING_BIP320_MASK;
+    for (size_t i = 0; i < sizeof(coinbase1); i++) {
+        coinbase1[i] = (uint8_t)(i * 7);
+    }
+    for (size_t i = 0; i < sizeof(coinbase2); i++) {
+        coinbase2[i] = (uint8_t)(i * 11 + 3);
+    }
+    work_set_coinbase(work, coinbase1, sizeof(coinbase1), extranonce1, sizeof(extranonce1), 4,
+                      coinbase2, sizeof(coinbase2));
+    for (int level = 0; level < 12; level++) {
+        for (int i = 0; i < 32; i++) {
+            branch[i] = (uint8_t)(level * 31 + i);
+        }
+        work_add_branch(work, branch);
+    }
+}
+
+static int bench_rolls(uint32_t hashes, const uint8_t *header)
+{
+    static work_template_t work;
+    const uint32_t versions = version_rolling_count(VERSION_ROLLING_BIP320_MASK);
+    const uint32_t span = (WORK_NTIME_ROLL_DEFAULT + 1) * versions;
+    const struct {
+        const char *name;
+        uint32_t other;
+        bool uncached;
+    } kinds[] = {
+        { "version step", 1, false },
+        { "ntime roll", versions, false },
+        { "extranonce2 bump", span, false },
+        { "extranonce2, no prefix cache", span, true },
+    };
+    uint32_t switches = hashes / 1000 < 100 ? 100 : hashes / 1000;
+    uint8_t rolled[BLOCK_HEADER_SIZE];
+    sha256d_ctx_t expected;
+    sha256d_ctx_t ctx;
+    int failures = 0;
+
+    bench_work(header, &work);
+    printf("\n%-30s %14s %10s\n", "roll switch", "switches/s", "us/switch");
+
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        uint32_t other = kinds[k].other;
+
+        // Without the cached coinbase prefix, every bump hashes the whole coinbase
+        if (kinds[k].uncached) {
+            memset(&work.coinbase_prefix, 0, sizeof(work.coinbase_prefix));
+        }
+
+        // Switching in place must match building the rolled header from scratch
+        work_header(&work, 0, rolled);
+        sha256d_init(&ctx, rolled);
+        work_apply_roll(&work, &ctx, 0, other);
+        work_header(&work, other, rolled);
+        sha256d_init(&expected, rolled);
+        if (memcmp(&ctx, &expected, sizeof(ctx)) != 0) {
+            printf("%-30s %14s %10s\n", kinds[k].name, "MISMATCH", "-");
+            failures++;
+            continue;
+        }
+
+        uint64_t start = now_ns();
+        for (uint32_t i = 0; i < switches; i++) {
+            // Alternate so every call is a real switch of this kind
+            work_apply_roll(&work, &ctx, (i & 1) ? 0 : other, (i & 1) ? other : 0);
+        }
+        uint64_t elapsed = now_ns() - start;
+        double us = (double)elapsed / 1e3 / switches;
+        printf("%-30s %14.0f %10.2f\n", kinds[k].name, 1e6 / us, us);
+    }
+
+    return failures;
+}
+
+// Publish jobs to running workers, waiting for both to pick each one up
+static int bench_switch_kind(const char *name, const uint8_t *header, bool clean, uint32_t jobs)
+{
+    static miner_ctx_t miner;
+    static work_template_t work;
+    uint64_t build_ns = 0;
+    int failures = 0;
+
+    bench_work(header, &work);
+    miner_ctx_init(&miner, hash_backend_find("reject"), 2);
+    miner_ctx_set_work(&miner, &work);
+    if (!miner_ctx_start(&miner)) {
+        printf("%-30s thread start failed\n", name);
+        return 1;
+    }
+    // A worker that starts after a publication never sees the switch
+    for (uint32_t i = 0; i < miner.worker_count; i++) {
+        while (__atomic_load_n(&miner.workers[i].counters.hashes, __ATOMIC_RELAXED) == 0) {
+            miner_yield();
+        }
+    }
+
+    for (uint32_t i = 0; i < jobs && failures == 0; i++) {
+        uint64_t deadline = now_ns() + 5000000000ull;
+        miner_job_t *job;
+
+        while ((job = miner_ctx_prepare(&miner)) == NULL) {
+            miner_yield();
+        }
+        work.header.timestamp++;
+        uint64_t start = now_ns();
+        miner_ctx_build(&miner, job, &work, 0);
+        build_ns += now_ns() - start;
+        miner_ctx_publish(&miner, job, clean);
+
+        do {
+            miner_yield();
+            miner_ctx_collect(&miner);
+        } while (miner.stats.job_switches < (i + 1) * miner.worker_count && now_ns() < deadline);
+        failures += miner.stats.job_switches < (i + 1) * miner.worker_count;
+    }
+    miner_ctx_stop(&miner);
+    miner_ctx_wait(&miner);
+
+    if (failures != 0) {
+        printf("%-30s %10s %14s\n", name, "TIMEOUT", "-");
+        return failures;
+    }
+    printf("%-30s %10.2f %14lu\n", name, (double)build_ns / 1e3 / jobs,
+           (unsigned long)(clean ? miner.stats.clean_switch_us_max : miner.stats.job_switch_us_max));
+    return 0;
+}
+
+static int bench_switches(uint32_t hashes, const uint8_t *header)
+{
+    uint32_t jobs = hashes / 100000 < 20 ? 20 : hashes / 100000;
+    int failures = 0;
+
+    printf("\n%-30s %10s %14s\n", "job switch (2 workers)", "us/build", "us max pickup");
+    failures += bench_switch_kind("plain job", header, false, jobs);
+    failures += bench_switch_kind("clean job", header, true, jobs);
+    if (miner_cpu_count() < 3) {
+        printf("fewer than 3 online CPUs: pickup delays include OS time slices\n");
+    }
+
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t hashes = DEFAULT_HASHES;
+    uint8_t header[BLOCK_HEADER_SIZE];
+    int failures = 0;
+
+    if (argc > 1) {
+        hashes = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (hashes == 0) {
+            fprintf(stderr, "usage: %s [hashes_per_kernel]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bench_header(header);
+
+    printf("miner_bench: %u hashes per kernel\n\n", hashes);
+
+    failures += bench_kernels(hashes, header);
+    failures += bench_batch(hashes, header);
+    failures += bench_interleave(hashes, header);
+    failures += bench_workers(hashes, header);
+    failures += bench_rolls(hashes, header);
+    failures += bench_switches(hashes, header);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file stratum_bench.c
+ * @brief Host benchmark for the streaming Stratum v1 parser
+ *
+ * Replays a pool session (bench/pool_traffic.jsonl: handshake responses,
+ * difficulty changes, mining.notify with a 12-level merkle branch and
+ * share verdicts, in both key orders) through stratum_parser_feed() in
+ * recv()-sized chunks and one byte at a time, and reports messages and
+ * megabytes per second. Every pass checks the message counts by type, so
+ * a parser that drops or misreads a message fails instead of reporting a
+ * rate.
+ *
+ * Memory is reported as the parser state (the only buffer it needs: no
+ * line buffer and no heap), the stack high-water mark of a pass, measured
+ * on a thread whose stack is pre-filled with a pattern, and the longest
+ * line of the session, which is what a line-buffered parser would have to
+ * hold.
+ *
+ * Usage: stratum_bench [passes]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mining/miner_core.h"
+
+#define DEFAULT_PASSES  2000u
+#define RECV_CHUNK      POOL_CONN_RX_CHUNK
+#define STACK_SIZE      (64 * 1024)
+#define STACK_PATTERN   0xA5
+
+// Messages of each type in the recorded session
+typedef struct {
+    uint32_t types[STRATUM_MSG_OTHER + 1];
+    uint32_t messages;
+} bench_counts_t;
+
+static const bench_counts_t expected = {
+    .types = {
+        [STRATUM_MSG_INVALID] = 0,
+        [STRATUM_MSG_RESPONSE] = 147,
+        [STRATUM_MSG_NOTIFY] = 48,
+        [STRATUM_MSG_SET_DIFFICULTY] = 2,
+        [STRATUM_MSG_SET_VERSION_MASK] = 0,
+        [STRATUM_MSG_OTHER] = 1,
+    },
+    .messages = 198,
+};
+
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t chunk;
+    bench_counts_t counts;
+} bench_pass_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Parse the session once, as the client would: the subscribe result sets the coinbase layout
+static void bench_session(bench_pass_t *pass)
+{
+    static stratum_parser_t parser;
+    volatile uint32_t sink = 0;
+
+    memset(&pass->counts, 0, sizeof(pass->counts));
+    stratum_parser_init(&parser);
+    for (size_t at = 0; at < pass->len; at += pass->chunk) {
+        size_t n = pass->len - at < pass->chunk ? pass->len - at : pass->chunk;
+        size_t done = 0;
+
+        while (done < n) {
+            const stratum_msg_t *msg;
+            done += stratum_parser_feed(&parser, pass->data + at + done, n - done, &msg);
+            if (msg == NULL) {
+                continue;
+            }
+            pass->counts.types[msg->type]++;
+            pass->counts.messages++;
+            if (msg->type == STRATUM_MSG_RESPONSE && msg->id == 2) {
+                stratum_parser_set_extranonce(&parser, msg->extranonce1, msg->extranonce1_len,
+                                              msg->extranonce2_size);
+            } else if (msg->type == STRATUM_MSG_NOTIFY) {
+                sink += msg->job.work.header.timestamp;
+            }
+        }
+    }
+    (void)sink;
+}
+
+static bool counts_match(const bench_counts_t *counts)
+{
+    return memcmp(counts, &expected, sizeof(expected)) == 0;
+}
+
+static int bench_rates(const char *data, size_t len, uint32_t passes)
+{
+    static const struct {
+        const char *name;
+        size_t chunk;
+    } feeds[] = {
+        { "recv chunks (512 B)", RECV_CHUNK },
+        { "whole session", 0 },
+        { "byte at a time", 1 },
+    };
+    int failures = 0;
+
+    printf("%-30s %14s %10s %10s\n", "feed", "msgs/s", "MB/s", "ns/byte");
+    for (size_t f = 0; f < sizeof(feeds) / sizeof(feeds[0]); f++) {
+        bench_pass_t pass = { data, len, feeds[f].chunk != 0 ? feeds[f].chunk : len, { { 0 }, 0 } };
+        uint64_t start = now_ns();
+
+        for (uint32_t i = 0; i < passes; i++) {
+            bench_session(&pass);
+            if (!counts_match(&pass.counts)) {
+                break;
+            }
+        }
+        double ns = (double)(now_ns() - start);
+        if (!counts_match(&pass.counts)) {
+            printf("%-30s %14s %10s %10s\n", feeds[f].name, "MISCOUNT", "-", "-");
+            failures++;
+            continue;
+        }
+        printf("%-30s %14.0f %10.1f %10.2f\n", feeds[f].name, 1e9 * expected.messages * passes / ns,
+               1e3 * (double)len * passes / ns, ns / ((double)len * passes));
+    }
+    return failures;
+}
+
+static void *stack_thread(void *arg)
+{
+    bench_session((bench_pass_t *)arg);
+    return NULL;
+}
+
+// Deepest stack use of a pass, from the untouched end of a pattern-filled stack
+static int bench_stack(const char *data, size_t len, size_t *used)
+{
+    bench_pass_t pass = { data, len, RECV_CHUNK, { { 0 }, 0 } };
+    uint8_t *stack = malloc(STACK_SIZE);
+    pthread_attr_t attr;
+    pthread_t thread;
+    size_t untouched = 0;
+
+    if (stack == NULL) {
+        return 1;
+    }
+    memset(stack, STACK_PATTERN, STACK_SIZE);
+    pthread_attr_init(&attr);
+    if (pthread_attr_setstack(&attr, stack, STACK_SIZE) != 0 ||
+        pthread_create(&thread, &attr, stack_thread, &pass) != 0) {
+        pthread_attr_destroy(&attr);
+        free(stack);
+        return 1;
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    // The stack grows down from the top of the buffer
+    while (untouched < STACK_SIZE && stack[untouched] == STACK_PATTERN) {
+        untouched++;
+    }
+    free(stack);
+    *used = STACK_SIZE - untouched;
+    return counts_match(&pass.counts) ? 0 : 1;
+}
+
+static size_t longest_line(const char *data, size_t len)
+{
+    size_t longest = 0;
+    size_t start = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            longest = i + 1 - start > longest ? i + 1 - start : longest;
+            start = i + 1;
+        }
+    }
+    return longest;
+}
+
+static char *load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    char *data = NULL;
+    long size;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0 &&
+        (data = malloc((size_t)size)) != NULL && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = data != NULL ? (size_t)size : 0;
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t passes = DEFAULT_PASSES;
+    size_t len;
+    size_t stack_used = 0;
+    int failures = 0;
+
+    if (argc > 1) {
+        passes = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (passes == 0) {
+            fprintf(stderr, "usage: %s [passes]\n", argv[0]);
+            return 2;
+        }
+    }
+    char *data = load(STRATUM_BENCH_TRAFFIC, &len);
+    if (data == NULL) {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], STRATUM_BENCH_TRAFFIC);
+        return 2;
+    }
+
+    printf("stratum_bench: %u passes over %zu bytes, %u messages\n\n", passes, len, expected.messages);
+    failures += bench_rates(data, len, passes);
+
+    failures += bench_stack(data, len, &stack_used);
+    printf("\n%-30s %10s\n", "memory", "bytes");
+    printf("%-30s %10zu\n", "parser state", sizeof(stratum_parser_t));
+    printf("%-30s %10zu\n", "stack high-water (thread+pass)", stack_used);
+    printf("%-30s %10zu\n", "longest line (line buffer)", longest_line(data, len));
+
+    free(data);
+    if (failures != 0) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file sv2_bench.c
+ * @brief Host benchmark: per-job cost of Stratum v1 jobs against Stratum V2
+ *        header-only jobs
+ *
+ * Takes the mining.notify messages of the recorded pool session
+ * (bench/pool_traffic.jsonl, 12-level merkle branch) and, for each, the
+ * same job as a standard-channel pool would send it: NewMiningJob with the
+ * merkle root the pool computed, plus SetNewPrevHash when the previous
+ * block changes. For both it reports, per job:
+ *
+ * - bytes on the wire;
+ * - CPU time from received bytes to a ready work_template_t and the
+ *   first header: v1 parses the hex JSON and hashes the coinbase and the
+ *   branch; V2 decodes binary frames and copies the header fields;
+ * - the cost of each later extranonce2 bump, which V2 does not have (its
+ *   roll space is ntime x version).
+ *
+ * Every V2 job must produce the same 76 header bytes as the v1 job at
+ * extranonce2 0, so the comparison is for identical work. Share
+ * submission bytes and the decoder and client state sizes are reported
+ * too.
+ *
+ * Usage: sv2_bench [passes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mining/miner_core.h"
+
+#define DEFAULT_PASSES  200u
+#define JOBS_MAX        64
+#define BUMPS           64
+
+typedef struct {
+    const char *line;                   ///< mining.notify line
+    size_t len;
+    uint8_t frames[160];                ///< Same job as NewMiningJob + SetNewPrevHash
+    size_t job_len;                     ///< NewMiningJob bytes
+    size_t frames_len;                  ///< Both frames
+    uint8_t header[BLOCK_HEADER_SIZE];  ///< First header of the v1 job
+} bench_job_t;
+
+static bench_job_t jobs[JOBS_MAX];
+static size_t job_count;
+static stratum_parser_t parser;
+static sv2_decoder_t decoder;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static char *load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    char *data = NULL;
+    long size;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0 &&
+        (data = malloc((size_t)size)) != NULL && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = data != NULL ? (size_t)size : 0;
+    return data;
+}
+
+// Parse one line; returns the message if the line completed one
+static const stratum_msg_t *parse_line(const char *line, size_t len)
+{
+    const stratum_msg_t *last = NULL;
+    size_t done = 0;
+
+    while (done < len) {
+        const stratum_msg_t *msg;
+        done += stratum_parser_feed(&parser, line + done, len - done, &msg);
+        if (msg != NULL) {
+            last = msg;
+        }
+    }
+    return last;
+}
+
+// The V2 frames a pool would send for the same job
+static void make_frames(bench_job_t *job, const work_template_t *work, uint32_t id)
+{
+    sv2_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_NEW_MINING_JOB;
+    msg.channel_id = 1;
+    msg.job_id = id;
+    msg.future = true;
+    msg.version = work->header.version;
+    work_merkle_root(work, 0, msg.hash);
+    job->job_len = sv2_encode(&msg, job->frames, sizeof(job->frames));
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SET_NEW_PREV_HASH;
+    msg.channel_id = 1;
+    msg.job_id = id;
+    memcpy(msg.hash, work->header.prev_hash, 32);
+    msg.ntime = work->header.timestamp;
+    msg.nbits = work->header.bits;
+    job->frames_len = job->job_len + sv2_encode(&msg, job->frames + job->job_len,
+                                                sizeof(job->frames) - job->job_len);
+}
+
+// Collect the session's jobs, their v1 headers and their V2 frames
+static bool collect(const char *data, size_t len)
+{
+    size_t start = 0;
+
+    stratum_parser_init(&parser);
+    for (size_t i = 0; i < len && job_count < JOBS_MAX; i++) {
+        if (data[i] != '\n') {
+            continue;
+        }
+        const stratum_msg_t *msg = parse_line(data + start, i + 1 - start);
+        if (msg != NULL && msg->type == STRATUM_MSG_RESPONSE && msg->id == 2) {
+            stratum_parser_set_extranonce(&parser, msg->extranonce1, msg->extranonce1_len, msg->extranonce2_size);
+        } else if (msg != NULL && msg->type == STRATUM_MSG_NOTIFY) {
+            bench_job_t *job = &jobs[job_count];
+            job->line = data + start;
+            job->len = i + 1 - start;
+            work_header(&msg->job.work, 0, job->header);
+            make_frames(job, &msg->job.work, (uint32_t)job_count + 1);
+            if (job->frames_len <= job->job_len) {
+                return false;
+            }
+            job_count++;
+        }
+        start = i + 1;
+    }
+    return job_count > 0;
+}
+
+// v1: notify line to template, then the first header (coinbase and branch hashed)
+static bool v1_job(const bench_job_t *job, uint8_t *header)
+{
+    const stratum_msg_t *msg = parse_line(job->line, job->len);
+
+    if (msg == NULL || msg->type != STRATUM_MSG_NOTIFY) {
+        return false;
+    }
+    work_header(&msg->job.work, 0, header);
+    return true;
+}
+
+// V2: frames to header-only work, as sv2_client_poll() builds it, then the first header
+static bool v2_job(const bench_job_t *job, uint8_t *header)
+{
+    static work_template_t work;
+    block_header_t fields;
+    bool have_job = false;
+    size_t done = 0;
+
+    memset(&fields, 0, sizeof(fields));
+    while (done < job->frames_len) {
+        const sv2_msg_t *msg;
+        done += sv2_decoder_feed(&decoder, job->frames + done, job->frames_len - done, &msg);
+        if (msg == NULL || !msg->decoded) {
+            continue;
+        }
+        if (msg->type == SV2_NEW_MINING_JOB) {
+            fields.version = msg->version;
+            memcpy(fields.merkle_root, msg->hash, 32);
+            have_job = true;
+        } else if (msg->type == SV2_SET_NEW_PREV_HASH && have_job) {
+            memcpy(fields.prev_hash, msg->hash, 32);
+            fields.timestamp = msg->ntime;
+            fields.bits = msg->nbits;
+            work_init(&work, &fields, WORK_NTIME_ROLL_DEFAULT);
+            work.version_mask = VERSION_ROLLING_BIP320_MASK;
+            work_header(&work, 0, header);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int bench_jobs(uint32_t passes)
+{
+    uint8_t header[BLOCK_HEADER_SIZE];
+    size_t v1_bytes = 0;
+    size_t v2_bytes = 0;
+    size_t v2_job_bytes = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < job_count; i++) {
+        v1_bytes += jobs[i].len;
+        v2_bytes += jobs[i].frames_len;
+        v2_job_bytes += jobs[i].job_len;
+        if (!v1_job(&jobs[i], header) || memcmp(header, jobs[i].header, 76) != 0 ||
+            !v2_job(&jobs[i], header) || memcmp(header, jobs[i].header, 76) != 0) {
+            printf("job %zu: v1 and V2 headers differ\n", i + 1);
+            failures++;
+        }
+    }
+
+    uint64_t start = now_ns();
+    for (uint32_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < job_count; i++) {
+            v1_job(&jobs[i], header);
+        }
+    }
+    double v1_ns = (double)(now_ns() - start) / passes / job_count;
+
+    start = now_ns();
+    for (uint32_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < job_count; i++) {
+            v2_job(&jobs[i], header);
+        }
+    }
+    double v2_ns = (double)(now_ns() - start) / passes / job_count;
+
+    // Extranonce2 bumps of the last v1 job: coinbase tail and branch
+    const stratum_msg_t *msg = parse_line(jobs[job_count - 1].line, jobs[job_count - 1].len);
+    uint8_t root[32];
+    start = now_ns();
+    for (uint32_t p = 0; p < passes; p++) {
+        for (uint64_t e = 1; e <= BUMPS; e++) {
+            work_merkle_root(&msg->job.work, e, root);
+        }
+    }
+    double bump_ns = (double)(now_ns() - start) / passes / BUMPS;
+
+    printf("%zu jobs, %zu-level branch, %zu-byte coinbase\n\n", job_count, msg->job.work.merkle_count,
+           msg->job.work.coinbase_len);
+    printf("%-34s %12s %12s\n", "per job", "v1 notify", "V2 frames");
+    printf("%-34s %12.0f %12.0f\n", "bytes (new previous block)", (double)v1_bytes / job_count,
+           (double)v2_bytes / job_count);
+    printf("%-34s %12.0f %12.0f\n", "bytes (same previous block)", (double)v1_bytes / job_count,
+           (double)v2_job_bytes / job_count);
+    printf("%-34s %12.2f %12.2f\n", "us to template and first header", v1_ns / 1e3, v2_ns / 1e3);
+    printf("%-34s %12.2f %12s\n", "us per extranonce2 bump", bump_ns / 1e3, "-");
+    return failures;
+}
+
+static void bench_shares(void)
+{
+    char line[256];
+    int v1 = snprintf(line, sizeof(line),
+                      "{\"id\":%lu,\"method\":\"mining.submit\",\"params\":[\"%s\",\"%s\",\"%016llx\","
+                      "\"%08lx\",\"%08lx\",\"%08lx\"]}\n", 1234ul, "bc1qexampleexampleexampleexampleexample.esp32",
+                      "1a2b00", 0x0123456789abcdefull, 0x65a1b2c3ul, 0x7c2bac1dul, 0x1fffe000ul);
+
+    printf("\n%-34s %12d %12d\n", "bytes per share", v1, SV2_HEADER_SIZE + 24);
+    printf("\n%-34s %12s\n", "memory", "bytes");
+    printf("%-34s %12zu\n", "stratum_parser_t", sizeof(stratum_parser_t));
+    printf("%-34s %12zu\n", "sv2_decoder_t", sizeof(sv2_decoder_t));
+    printf("%-34s %12zu\n", "stratum_client_t", sizeof(stratum_client_t));
+    printf("%-34s %12zu\n", "sv2_client_t", sizeof(sv2_client_t));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t passes = DEFAULT_PASSES;
+    const char *path = SV2_BENCH_TRAFFIC;
+    size_t len;
+    char *data;
+    int failures;
+
+    if (argc > 1) {
+        passes = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (passes == 0) {
+            fprintf(stderr, "usage: %s [passes]\n", argv[0]);
+            return 2;
+        }
+    }
+    data = load(path, &len);
+    if (data == NULL || !collect(data, len)) {
+        fprintf(stderr, "cannot load jobs from %s\n", path);
+        free(data);
+        return 1;
+    }
+
+    printf("sv2_bench: %u passes\n\n", passes);
+    failures = bench_jobs(passes);
+    bench_shares();
+    free(data);
+
+    if (failures != 0) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -11,10 +11,10 @@
 #include "nvs_flash.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
-#include "mbedtls/md.h"
 #include "driver/i2c.h"
 #include "driver/gpio.h"
 #include "ssd1306.h"
+#include "mining/miner_core.h"
 #include "driver/i2c_master.h"
 #include "config.h"
 
@@ -24,19 +24,83 @@
 #define I2C_MASTER_NUM       I2C_NUM_0
 #define I2C_MASTER_FREQ_HZ   100000
 
-// Bitcoin Mining Configuration
+// Bitcoin Mining Configuration; solo mining pays block rewards here
+#ifndef BTC_ADDRESS
 #define BTC_ADDRESS "1CW2jT4gwqyWmbAZ8HjmTLBaVg8biUiWW7"
+#endif
 
 static const char *TAG = "BTC_MINER";
 
-// Mining statistics
-static uint64_t total_hashes = 0;
-static uint32_t best_difficulty = 0;
-static uint32_t nonce = 0;
-static uint8_t block_header[80];
+// Number of mining workers; one per core by default
+#ifndef MINER_WORKERS
+#define MINER_WORKERS miner_cpu_count()
+#endif
+
+// Mine templates from our own node when one is configured (solo), header-only
+// jobs from a Stratum V2 proxy when one is, Stratum v1 pool jobs when a pool
+// is, a mock job otherwise
+#if defined(WIFI_SSID) && defined(GBT_HOST)
+#define MINER_SOLO
+#elif defined(WIFI_SSID) && defined(SV2_HOST)
+#define MINER_SV2
+#elif defined(WIFI_SSID) && defined(POOL_HOST)
+#define MINER_POOL
+#endif
+
+#if defined(MINER_POOL) || defined(MINER_SV2) || defined(MINER_SOLO)
+#define MINER_REMOTE_JOBS
+#endif
+
+// Stratum and node event loop wait; bounds how long a found share waits in its ring
+#define POOL_POLL_MS 20
+
+// Display refresh period. A refresh only rewrites the lines whose text
+// changed; each line is about 13 ms of I2C at 100 kHz (bench/display_bench).
+#ifndef DISPLAY_REFRESH_MS
+#define DISPLAY_REFRESH_MS 2000
+#endif
+
+// Stats log period, and how often the stats task wakes up to check both
+#define STATS_LOG_MS 2000
+#define STATS_TICK_MS 100
 
-// OLED device handle
+// The stats task runs below the workers (MINER_THREAD_PRIORITY), on core 0
+// with WiFi and the pool task: it only gets the time the workers yield
+#define STATS_TASK_PRIORITY 1
+// Room for the copy of a worker's share histogram miner_ctx_collect() takes
+#define STATS_TASK_STACK 6144
+
+// Mining state: the job slots, workers, schedulers and counters. The
+// stats reader inside is only used by the stats task.
+static stratum_job_t job;
+static miner_ctx_t miner;
+static volatile bool block_found;
+
+#ifdef MINER_REMOTE_JOBS
+// Pool or node client, driven by its own task on core 0. jobs[] keeps the
+// last JOB_HISTORY published jobs by miner job id, so a share taken from
+// the share rings finds the job id it was mined for, even after its slot
+// was rebuilt. Only that task touches jobs[] and job_ids[].
+#ifdef MINER_POOL
+static stratum_client_t pool;
+#elif defined(MINER_SV2)
+static sv2_client_t sv2;
+#else
+static gbt_client_t node;
+#endif
+static miner_thread_t pool_thread;
+#define JOB_HISTORY 4
+static stratum_job_t jobs[JOB_HISTORY];
+static uint32_t job_ids[JOB_HISTORY];
+static stratum_job_t next_job;
+static uint32_t next_seq;
+#endif
+
+// OLED device handle, and the text on each page: a refresh only rewrites
+// the lines that changed. Both are only touched by the stats task once
+// mining has started.
 static SSD1306_t dev;
+static char shown[8][24];
 
 // WiFi code is only compiled when WIFI_SSID is defined (i.e., when config.h exists)
 // This allows CI/CD builds to succeed without WiFi credentials
@@ -96,171 +160,522 @@ void wifi_init(void)
 
 #endif // WIFI_SSID
 
-// Double SHA256 hash
-void double_sha256(const uint8_t* data, size_t len, uint8_t* hash)
+// Initialize the job with mock data
+void init_work(void)
 {
-    mbedtls_md_context_t ctx;
-    mbedtls_md_type_t md_type = MBEDTLS_MD_SHA256;
+    // Mock coinbase around the extranonces - would come from the pool
+    static const uint8_t coinbase1[] = { 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 };
+    static const uint8_t coinbase2[] = { 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    static const uint8_t extranonce1[] = { 0x00, 0x00, 0x00, 0x01 };
+    block_header_t header;
+    memset(&header, 0, sizeof(header));
+    
+    // Version
+    header.version = 0x20000000;
+    
+    // Previous block hash - would be real data; merkle root comes from the coinbase
+    
+    // Timestamp
+    header.timestamp = (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS / 1000);
+    
+    // Bits/Difficulty target
+    header.bits = 0x1d00ffff; // Easier target for testing
     
-    mbedtls_md_init(&ctx);
-    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(md_type), 0);
+    // Nonce - handed out in chunks by the scheduler
+    header.nonce = 0;
     
-    // First SHA256
-    uint8_t temp[32];
-    mbedtls_md_starts(&ctx);
-    mbedtls_md_update(&ctx, data, len);
-    mbedtls_md_finish(&ctx, temp);
+    // Exhausted nonce ranges continue with the next version, a rolled ntime
+    // or the next extranonce2. Without a pool to negotiate with (mining.configure),
+    // the BIP320 general-purpose bits are ours to roll.
+    work_init(&job.work, &header, WORK_NTIME_ROLL_DEFAULT);
+    job.work.version_mask = VERSION_ROLLING_BIP320_MASK;
+    work_set_coinbase(&job.work, coinbase1, sizeof(coinbase1), extranonce1, sizeof(extranonce1), 4,
+                      coinbase2, sizeof(coinbase2));
     
-    // Second SHA256
-    mbedtls_md_starts(&ctx);
-    mbedtls_md_update(&ctx, temp, 32);
-    mbedtls_md_finish(&ctx, hash);
+    strcpy(job.id, "mock");
+    job.difficulty = 0;
     
-    mbedtls_md_free(&ctx);
+    ESP_LOGI(TAG, "Work initialized");
 }
 
-// Count leading zero bits in hash
-uint32_t count_leading_zeros(const uint8_t* hash)
+#ifdef MINER_REMOTE_JOBS
+// The pool's or node's job a share was mined in; NULL once JOB_HISTORY newer
+// jobs have been published
+static const stratum_job_t *share_job(const miner_share_t *share)
 {
-    uint32_t zeros = 0;
-    for(int i = 31; i >= 0; i--) {
-        if(hash[i] == 0) {
-            zeros += 8;
-        } else {
-            uint8_t byte = hash[i];
-            while((byte & 0x80) == 0) {
-                zeros++;
-                byte <<= 1;
-            }
-            break;
-        }
-    }
-    return zeros;
+    uint32_t i = share->job_id % JOB_HISTORY;
+    
+    return job_ids[i] == share->job_id ? &jobs[i] : NULL;
 }
+#endif
 
-// Initialize block header with mock data
-void init_block_header(void)
+// Handle a share the workers found; runs in the task that drains the share
+// rings (the pool or node task, or the supervisor), never on a worker
+static void handle_share(const miner_share_t *share)
 {
-    memset(block_header, 0, 80);
+    const uint8_t *hash = share->hash;
     
-    // Version (bytes 0-3)
-    uint32_t version = 0x20000000;
-    memcpy(&block_header[0], &version, 4);
+    ESP_LOGI(TAG, "Worker %lu %s: difficulty %.3f (nonce %08lx, version %08lx, ntime %08lx, extranonce2 %08llx)",
+             share->worker, share->meets_share ? "share" : "new best", share->difficulty, share->nonce,
+             share->version, share->ntime, share->extranonce2);
     
-    // Previous block hash (bytes 4-35) - would be real data
-    // Merkle root (bytes 36-67) - would be real data
+    // Print hash
+    ESP_LOGI(TAG, "Hash: %02x%02x%02x%02x...%02x%02x%02x%02x",
+             hash[31], hash[30], hash[29], hash[28],
+             hash[3], hash[2], hash[1], hash[0]);
     
-    // Timestamp (bytes 68-71)
-    uint32_t timestamp = (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS / 1000);
-    memcpy(&block_header[68], &timestamp, 4);
+    // Check against the full target expanded from the header's nBits
+    if (share->meets_block) {
+        ESP_LOGI(TAG, "!!! BLOCK FOUND !!!");
+        block_found = true;
+    }
     
-    // Bits/Difficulty target (bytes 72-75)
-    uint32_t bits = 0x1d00ffff; // Easier target for testing
-    memcpy(&block_header[72], &bits, 4);
+#ifdef MINER_REMOTE_JOBS
+#ifdef MINER_SOLO
+    // Only a block is worth sending to the node
+    bool wanted = share->meets_block;
+#else
+    bool wanted = share->meets_share;
+#endif
+    if (!wanted) {
+        return;
+    }
+    const stratum_job_t *found_in = share_job(share);
+    if (found_in == NULL) {
+        ESP_LOGW(TAG, "Share of job %lu dropped: job no longer known", share->job_id);
+        return;
+    }
+    stratum_share_t submit;
+    strcpy(submit.job_id, found_in->id);
+    submit.extranonce2 = share->extranonce2;
+    submit.ntime = share->ntime;
+    submit.nonce = share->nonce;
+    submit.version = share->version;
+#ifdef MINER_POOL
+    if (!stratum_client_submit(&pool, &submit)) {
+        ESP_LOGW(TAG, "Share dropped: pool queue full or not connected");
+    }
+#elif defined(MINER_SV2)
+    // Header-only work: extranonce2 is always 0 and not sent
+    if (!sv2_client_submit(&sv2, &submit)) {
+        ESP_LOGW(TAG, "Share dropped: channel queue full or not open");
+    }
+#else
+    if (!gbt_client_submit(&node, &submit)) {
+        ESP_LOGW(TAG, "Block dropped: template no longer kept or submit queue full");
+    }
+#endif
+#endif // MINER_REMOTE_JOBS
+}
+
+// Consumer side of the workers' share rings: the workers only pushed
+static void drain_shares(void)
+{
+    miner_share_t share;
     
-    // Nonce (bytes 76-79) - will be incremented
-    nonce = 0;
-    memcpy(&block_header[76], &nonce, 4);
+    while (miner_ctx_take_share(&miner, &share)) {
+        handle_share(&share);
+    }
+}
+
+#ifdef MINER_REMOTE_JOBS
+
+// Build a pool or node job in the miner's spare slot and switch the workers to it.
+// Returns false while a worker is still on the spare slot's job.
+static bool publish_job(const stratum_job_t *next)
+{
+    miner_job_t *slot = miner_ctx_prepare(&miner);
     
-    ESP_LOGI(TAG, "Block header initialized");
+    if (slot == NULL) {
+        return false;
+    }
+    miner_ctx_build(&miner, slot, &next->work, next->difficulty);
+    miner_ctx_publish(&miner, slot, next->clean);
+    // The id is assigned at publication; shares are only taken by this task
+    jobs[slot->id % JOB_HISTORY] = *next;
+    job_ids[slot->id % JOB_HISTORY] = slot->id;
+    ESP_LOGI(TAG, "Job %lu (%s) published%s", slot->id, next->id, next->clean ? ", clean" : "");
+    return true;
 }
 
-// Update OLED display
-void update_display(float hashrate)
+#ifdef MINER_POOL
+
+// Stratum event loop: the only task that touches the pool socket, and the
+// consumer of the workers' share rings. New jobs are prepared here, off the
+// mining cores, while the workers keep hashing.
+static void pool_task(void *arg)
 {
-    char line[32];
+    stratum_client_t *client = (stratum_client_t *)arg;
+    bool pending = false;
     
-    ssd1306_clear_screen(&dev, false);
-    ssd1306_contrast(&dev, 0xff);
+    while (1) {
+        bool clean = pending && next_job.clean;
+        
+        drain_shares();
+        stratum_client_poll(client, POOL_POLL_MS);
+        if (stratum_client_take_job(client, &next_seq, &next_job)) {
+            // A clean job that never reached the workers still retires their work
+            next_job.clean |= clean;
+            pending = true;
+        }
+        if (pending && publish_job(&next_job)) {
+            pending = false;
+        }
+    }
+}
+
+static const char *pool_state_name(stratum_state_t state)
+{
+    switch (state) {
+    case STRATUM_CONNECTING:
+        return "connecting";
+    case STRATUM_SUBSCRIBING:
+        return "subscribing";
+    case STRATUM_MINING:
+        return "mining";
+    default:
+        return "disconnected";
+    }
+}
+
+#elif defined(MINER_SV2)
+
+// Stratum V2 event loop: same role as pool_task. Jobs are header-only, so
+// publishing one hashes nothing but the header.
+static void sv2_task(void *arg)
+{
+    sv2_client_t *client = (sv2_client_t *)arg;
+    bool pending = false;
+    
+    while (1) {
+        bool clean = pending && next_job.clean;
+        
+        drain_shares();
+        sv2_client_poll(client, POOL_POLL_MS);
+        if (sv2_client_take_job(client, &next_seq, &next_job)) {
+            next_job.clean |= clean;
+            pending = true;
+        }
+        if (pending && publish_job(&next_job)) {
+            pending = false;
+        }
+    }
+}
+
+static const char *sv2_state_name(sv2_state_t state)
+{
+    switch (state) {
+    case SV2_CONNECTING:
+        return "connecting";
+    case SV2_SETTING_UP:
+        return "setting up";
+    case SV2_OPENING:
+        return "opening channel";
+    case SV2_MINING:
+        return "mining";
+    default:
+        return "disconnected";
+    }
+}
+
+#else
+
+// Node event loop: fetches templates and submits blocks. Its RPCs block,
+// which is why it gets a task of its own, away from the mining cores.
+static void solo_task(void *arg)
+{
+    gbt_client_t *client = (gbt_client_t *)arg;
+    bool pending = false;
+    
+    while (1) {
+        bool clean = pending && next_job.clean;
+        
+        drain_shares();
+        gbt_client_poll(client, POOL_POLL_MS);
+        if (gbt_client_take_job(client, &next_seq, &next_job)) {
+            next_job.clean |= clean;
+            pending = true;
+        }
+        if (pending && publish_job(&next_job)) {
+            pending = false;
+        }
+    }
+}
+
+#endif // MINER_POOL
+
+#endif // MINER_REMOTE_JOBS
+
+// Write a display line unless it already shows that text
+static void display_line(int page, const char *text)
+{
+    if (strcmp(shown[page], text) == 0) {
+        return;
+    }
+    snprintf(shown[page], sizeof(shown[page]), "%s", text);
+    ssd1306_display_text(&dev, page, shown[page], strlen(shown[page]), false);
+}
+
+// Update OLED display. Every line is written across the full width, so no
+// clear is needed; unchanged lines cost nothing.
+void update_display(void)
+{
+    uint64_t tenths = miner_rate_tenths(miner.rates.average[MINER_RATE_10S]);
+    char line[32];
     
     // Title
-    ssd1306_display_text(&dev, 0, "ESP32-S3 BTC Miner", 18, false);
-    ssd1306_display_text(&dev, 1, "------------------", 18, false);
+    display_line(0, "ESP32-S3 BTC Miner");
+    display_line(1, "------------------");
     
     // Hashrate
-    snprintf(line, sizeof(line), "Rate: %.1f H/s", hashrate);
-    ssd1306_display_text(&dev, 2, line, strlen(line), false);
+    if (block_found) {
+        snprintf(line, sizeof(line), "*** BLOCK FOUND ***");
+    } else {
+        snprintf(line, sizeof(line), "Rate: %llu.%llu H/s", tenths / 10, tenths % 10);
+    }
+    display_line(2, line);
     
     // Total hashes
-    snprintf(line, sizeof(line), "Total: %llu", total_hashes);
-    ssd1306_display_text(&dev, 3, line, strlen(line), false);
+    snprintf(line, sizeof(line), "Total: %llu", miner.stats.total_hashes);
+    display_line(3, line);
     
     // Best difficulty
-    snprintf(line, sizeof(line), "Best: %lu zeros", best_difficulty);
-    ssd1306_display_text(&dev, 4, line, strlen(line), false);
+    snprintf(line, sizeof(line), "Best: %.4g diff", miner.stats.best_difficulty);
+    display_line(4, line);
+    
+    // Current job and worker count
+    snprintf(line, sizeof(line), "Job %lu, %lu cores", miner_ctx_job(&miner)->id, miner.worker_count);
+    display_line(5, line);
     
-    // Current nonce
-    snprintf(line, sizeof(line), "Nonce: %lu", nonce);
-    ssd1306_display_text(&dev, 5, line, strlen(line), false);
+#ifdef MINER_POOL
+    // Pool shares
+    stratum_status_t status;
+    stratum_client_status(&pool, &status);
+    snprintf(line, sizeof(line), "Shares: %lu/%lu", status.conn.accepted,
+             status.conn.accepted + status.conn.rejected);
+    display_line(6, line);
+#elif defined(MINER_SV2)
+    // Channel shares
+    sv2_status_t status;
+    sv2_client_status(&sv2, &status);
+    snprintf(line, sizeof(line), "Shares: %lu/%lu", status.conn.accepted,
+             status.conn.accepted + status.conn.rejected);
+    display_line(6, line);
+#elif defined(MINER_SOLO)
+    // Blocks the node accepted
+    gbt_status_t status;
+    gbt_client_status(&node, &status);
+    snprintf(line, sizeof(line), "Blocks: %lu/%lu", status.accepted, status.submitted);
+    display_line(6, line);
+#endif
 }
 
-// Mining task
-void mining_task(void *pvParameters)
+// Self-test and time every hash backend, returning the fastest correct one
+static const hash_backend_t *select_hash_backend(void)
 {
-    uint8_t hash[32];
-    uint64_t hash_count = 0;
-    int64_t start_time = esp_timer_get_time();
-    int64_t last_update = start_time;
+    hash_backend_report_t report[HASH_BACKEND_MAX];
+    const hash_backend_t *backend = hash_backend_select(report, HASH_BACKEND_BENCH_NONCES);
     
-    ESP_LOGI(TAG, "Mining task started on core %d", xPortGetCoreID());
+    for (size_t i = 0; i < hash_backend_count(); i++) {
+        if (!report[i].available) {
+            ESP_LOGI(TAG, "Hash backend %-10s unavailable", report[i].backend->name);
+        } else if (!report[i].passed) {
+            ESP_LOGE(TAG, "Hash backend %-10s FAILED self-test, disabled", report[i].backend->name);
+        } else {
+            ESP_LOGI(TAG, "Hash backend %-10s %8lu H/s", report[i].backend->name,
+                     (unsigned long)report[i].hashrate);
+        }
+    }
+    
+    if (backend != NULL) {
+        ESP_LOGI(TAG, "Selected hash backend: %s", backend->name);
+    }
+    return backend;
+}
+
+// Make sure the current job has work left: wait for the pool's or node's
+// next job (its task publishes it), or load a fresh mock job
+static void load_job(void)
+{
+    if (miner_sched_remaining(&miner_ctx_job(&miner)->sched) != 0) {
+        return;
+    }
+#ifdef MINER_REMOTE_JOBS
+    ESP_LOGI(TAG, "Waiting for a job...");
+    while (miner_sched_remaining(&miner_ctx_job(&miner)->sched) == 0) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+#else
+    init_work();
+    miner_ctx_set_share_difficulty(&miner, job.difficulty);
+    miner_ctx_set_work(&miner, &job.work);
+#endif
+}
+
+// Hashrate the shares imply against the counted one: a kernel that skips
+// or misjudges nonces shows up as "too few shares"
+static void log_share_check(void)
+{
+    const miner_rates_t *rates = &miner.rates;
+    const share_hist_t *hist = &miner.stats.share_hist;
+    double seconds = (rates->last_us - rates->start_us) / 1e6;
+    share_estimate_t estimate;
     
-    init_block_header();
+    if (seconds <= 0) {
+        return;
+    }
+    share_hist_estimate_all(hist, &estimate);
+    ESP_LOGI(TAG, "Shares: %lu above the floors, effective %.1f H/s (%.1f to %.1f) against %.1f H/s hashed: %s",
+             estimate.shares, estimate.hashes / seconds, estimate.low / seconds, estimate.high / seconds,
+             rates->total_hashes / seconds,
+             share_check_name(share_estimate_check(&estimate, rates->total_hashes)));
+    if (hist->job_id == rates->job_id) {
+        share_hist_estimate_job(hist, &estimate);
+        ESP_LOGI(TAG, "Job %lu shares: %lu, %.0f hashes (%.0f to %.0f) against %llu hashed: %s",
+                 hist->job_id, estimate.shares, estimate.hashes, estimate.low, estimate.high,
+                 rates->job_hashes, share_check_name(share_estimate_check(&estimate, rates->job_hashes)));
+    }
+}
+
+// Log the hashrate estimates, the merged counters and the client's status
+static void log_stats(void)
+{
+    const miner_rates_t *rates = &miner.rates;
+    uint64_t now = miner_rate_tenths(rates->rate);
+    uint64_t avg_10s = miner_rate_tenths(rates->average[MINER_RATE_10S]);
+    uint64_t avg_1m = miner_rate_tenths(rates->average[MINER_RATE_1MIN]);
+    uint64_t avg_15m = miner_rate_tenths(rates->average[MINER_RATE_15MIN]);
     
-    while(1) {
-        // Mine with current nonce
-        double_sha256(block_header, 80, hash);
-        
-        hash_count++;
-        total_hashes++;
-        
-        // Check difficulty
-        uint32_t difficulty = count_leading_zeros(hash);
-        
-        if (difficulty > best_difficulty) {
-            best_difficulty = difficulty;
-            ESP_LOGI(TAG, "New best difficulty: %lu leading zeros", best_difficulty);
-            
-            // Print hash
-            ESP_LOGI(TAG, "Hash: %02x%02x%02x%02x...%02x%02x%02x%02x",
-                     hash[31], hash[30], hash[29], hash[28],
-                     hash[3], hash[2], hash[1], hash[0]);
+    ESP_LOGI(TAG, "Hashrate: %llu.%llu H/s now, %llu.%llu 10s, %llu.%llu 1m, %llu.%llu 15m (%lu workers)",
+             now / 10, now % 10, avg_10s / 10, avg_10s % 10, avg_1m / 10, avg_1m % 10,
+             avg_15m / 10, avg_15m % 10, miner.worker_count);
+    for (uint32_t i = 0; i < miner.worker_count; i++) {
+        uint64_t rate = miner_rate_tenths(rates->worker_rate[i]);
+        uint64_t cycles = miner_rate_tenths(rates->cycles_per_hash[i]);
+        ESP_LOGI(TAG, "Worker %lu: %llu.%llu H/s, %llu.%llu cycles/hash", i, rate / 10, rate % 10,
+                 cycles / 10, cycles % 10);
+    }
+    ESP_LOGI(TAG, "Total: %llu, Job %lu: %llu hashes, Best: %.3f, Steals: %lu",
+             rates->total_hashes, rates->job_id, rates->job_hashes, miner.stats.best_difficulty,
+             miner_ctx_job(&miner)->sched.steals);
+    ESP_LOGI(TAG, "Rolls: %lu version, %lu ntime, %lu extranonce2, %llu us total, %lu us max",
+             miner.stats.version_rolls, miner.stats.ntime_rolls, miner.stats.extranonce_rolls,
+             miner.stats.roll_us, miner.stats.roll_us_max);
+    ESP_LOGI(TAG, "Job switches: %lu, %lu us max pickup, %lu us max clean abort",
+             miner.stats.job_switches, miner.stats.job_switch_us_max, miner.stats.clean_switch_us_max);
+    ESP_LOGI(TAG, "Share rings: %lu reported, %lu dropped", miner.stats.shares,
+             miner.stats.shares_dropped);
+    log_share_check();
+#ifdef MINER_POOL
+    stratum_status_t status;
+    stratum_client_status(&pool, &status);
+    ESP_LOGI(TAG, "Pool: %s, difficulty %.4g, %lu accepted, %lu rejected, %lu dropped, "
+             "%lu pending, %lu us max response",
+             pool_state_name(status.conn.state), status.conn.difficulty, status.conn.accepted,
+             status.conn.rejected, status.conn.dropped, status.pending, status.response_us_max);
+#elif defined(MINER_SV2)
+    sv2_status_t status;
+    sv2_client_status(&sv2, &status);
+    ESP_LOGI(TAG, "SV2: %s, difficulty %.4g, %lu accepted, %lu rejected, %lu dropped, "
+             "%llu B in, %llu B out",
+             sv2_state_name(status.conn.state), status.conn.difficulty, status.conn.accepted,
+             status.conn.rejected, status.conn.dropped, status.conn.rx_bytes, status.conn.tx_bytes);
+#elif defined(MINER_SOLO)
+    gbt_status_t status;
+    gbt_client_status(&node, &status);
+    ESP_LOGI(TAG, "Node: height %lu, %lu txs (%lu left out), %lu blocks submitted, %lu accepted, "
+             "%lu rejected%s%s, %lu stale, %lu errors",
+             status.height, status.tx_count, status.tx_dropped, status.submitted, status.accepted,
+             status.rejected, status.rejected ? " " : "", status.reject_reason, status.stale,
+             status.errors);
+#endif
+}
+
+#if MINER_PROFILE
+static void print_profile_line(const char *line, void *arg)
+{
+    (void)arg;
+    printf("%s\n", line);
+}
+
+// Serial console commands of a profiling build: 'p' dumps the per-stage
+// cycle histograms, 'r' clears them. The console does not block on reads.
+static void poll_profile_console(void)
+{
+    int c;
+    
+    while ((c = getchar()) != EOF) {
+        if (c == 'p') {
+            miner_profile_dump(print_profile_line, NULL);
+        } else if (c == 'r') {
+            miner_profile_reset();
+            ESP_LOGI(TAG, "Profile cleared");
         }
+    }
+}
+#endif
+
+// Stats task: merges the workers' counters, updates the hashrate estimates
+// and drives the display and the logs. The workers only bump their
+// counters; the blocking I2C transfers and the formatting all happen here.
+static void stats_task(void *arg)
+{
+    int64_t last_display = esp_timer_get_time();
+    int64_t last_log = last_display;
+    (void)arg;
+    
+#if MINER_PROFILE
+    ESP_LOGI(TAG, "Profiling build: 'p' on the console dumps the stage cycles, 'r' clears them");
+#endif
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(STATS_TICK_MS));
+#ifndef MINER_REMOTE_JOBS
+        // No pool or node task: this task drains the share rings
+        drain_shares();
+#endif
+#if MINER_PROFILE
+        poll_profile_console();
+#endif
         
-        // Check if we found a valid block (need ~70 zeros for real Bitcoin)
-        if (difficulty >= 70) {
-            ESP_LOGI(TAG, "!!! BLOCK FOUND !!!");
-            ssd1306_clear_screen(&dev, false);
-            ssd1306_display_text(&dev, 2, "*** BLOCK FOUND ***", 19, false);
-            vTaskDelay(pdMS_TO_TICKS(10000));
+        int64_t now = esp_timer_get_time();
+        bool refresh = now - last_display >= DISPLAY_REFRESH_MS * 1000LL;
+        bool log = now - last_log >= STATS_LOG_MS * 1000LL;
+        if (!refresh && !log) {
+            continue;
         }
+        miner_ctx_collect(&miner);
+        miner_ctx_update_rates(&miner);
         
-        // Increment nonce
-        nonce++;
-        memcpy(&block_header[76], &nonce, 4);
-        
-        // Update display every 2 seconds
-        int64_t current_time = esp_timer_get_time();
-        if ((current_time - last_update) >= 2000000) {
-            float elapsed_sec = (current_time - start_time) / 1000000.0f;
-            float hashrate = hash_count / (elapsed_sec > 0 ? elapsed_sec : 1);
-            
-            update_display(hashrate);
-            
-            last_update = current_time;
-            hash_count = 0;
-            start_time = current_time;
-            
-            ESP_LOGI(TAG, "Hashrate: %.1f H/s, Total: %llu, Best: %lu",
-                     hashrate, total_hashes, best_difficulty);
+        if (refresh) {
+            update_display();
+            last_display = now;
         }
-        
-        // Small delay to prevent watchdog timeout
-        if (nonce % 1000 == 0) {
-            vTaskDelay(1);
+        if (log) {
+            log_stats();
+            last_log = now;
         }
     }
 }
 
+// Run jobs forever. Newer pool jobs reach the running workers without a
+// restart; the workers only stop when every roll of the newest job is
+// exhausted. Counters, the display and the logs belong to the stats task.
+static void supervise_mining(void)
+{
+    while (1) {
+        load_job();
+        if (!miner_ctx_start(&miner)) {
+            ESP_LOGE(TAG, "Could not start mining tasks");
+            return;
+        }
+        ESP_LOGI(TAG, "Job %lu started on %lu workers", miner_ctx_job(&miner)->id, miner.worker_count);
+        
+        // Every roll of the newest job exhausted
+        miner_ctx_wait(&miner);
+        ESP_LOGI(TAG, "Job %lu done", miner_ctx_job(&miner)->id);
+    }
+}
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "ESP32-S3 Bitcoin Miner Starting...");
@@ -303,6 +718,14 @@ void app_main(void)
     ssd1306_display_text(&dev, 0, "ESP32-S3 Miner", 14, false);
     ssd1306_display_text(&dev, 2, "Initializing...", 15, false);
     
+    // Pick the hash backend before WiFi adds load to core 0
+    const hash_backend_t *hash_backend = select_hash_backend();
+    if (hash_backend == NULL) {
+        ESP_LOGE(TAG, "No hash backend passed its self-test, not mining");
+        ssd1306_display_text(&dev, 4, "Self-test FAILED", 16, false);
+        return;
+    }
+    
 #ifdef WIFI_SSID
     // Initialize WiFi
     ESP_LOGI(TAG, "Initializing WiFi...");
@@ -315,16 +738,64 @@ void app_main(void)
     ssd1306_display_text(&dev, 4, "Starting mining!", 16, false);
     vTaskDelay(pdMS_TO_TICKS(2000));
     
-    // Create mining task on Core 1 for maximum performance
-    xTaskCreatePinnedToCore(
-        mining_task,
-        "mining_task",
-        8192,
-        NULL,
-        5,
-        NULL,
-        1  // Pin to Core 1
-    );
-    
-    ESP_LOGI(TAG, "Mining task created");
+    // One worker per core; workers take nonce chunks from the scheduler
+    // and steal from each other, so WiFi load on core 0 costs no idle time
+    miner_ctx_init(&miner, hash_backend, MINER_WORKERS);
+    
+#ifdef MINER_POOL
+    // The pool client gets core 0, next to WiFi; it never waits on a worker
+    static const stratum_config_t pool_config = {
+        .host = POOL_HOST,
+        .port = POOL_PORT,
+        .user = POOL_USER,
+        .password = POOL_PASS,
+        .version_mask = VERSION_ROLLING_BIP320_MASK,
+    };
+    stratum_client_init(&pool, &pool_config);
+    if (!miner_thread_start(&pool_thread, pool_task, &pool, "stratum", 0)) {
+        ESP_LOGE(TAG, "Could not start the pool task");
+        return;
+    }
+#elif defined(MINER_SV2)
+    // Same place as the Stratum v1 client: core 0, never waiting on a worker
+    static const sv2_config_t sv2_config = {
+        .host = SV2_HOST,
+        .port = SV2_PORT,
+        .user = SV2_USER,
+        .hashrate = SV2_HASHRATE,
+        .version_mask = VERSION_ROLLING_BIP320_MASK,
+    };
+    sv2_client_init(&sv2, &sv2_config);
+    if (!miner_thread_start(&pool_thread, sv2_task, &sv2, "sv2", 0)) {
+        ESP_LOGE(TAG, "Could not start the SV2 task");
+        return;
+    }
+#elif defined(MINER_SOLO)
+    // The node client gets core 0 too; its RPCs block only this task
+    static const gbt_config_t node_config = {
+        .host = GBT_HOST,
+        .port = GBT_PORT,
+        .user = GBT_USER,
+        .password = GBT_PASS,
+        .address = BTC_ADDRESS,
+        .version_mask = VERSION_ROLLING_BIP320_MASK,
+    };
+    if (!gbt_client_init(&node, &node_config)) {
+        ESP_LOGE(TAG, "Invalid payout address %s or RPC credentials", BTC_ADDRESS);
+        return;
+    }
+    if (!miner_thread_start(&pool_thread, solo_task, &node, "gbt", 0)) {
+        ESP_LOGE(TAG, "Could not start the node task");
+        return;
+    }
+#endif
+    
+    // Display and logs from now on: core 0, below the workers
+    if (xTaskCreatePinnedToCore(stats_task, "stats", STATS_TASK_STACK, NULL, STATS_TASK_PRIORITY, NULL, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Could not start the stats task");
+        return;
+    }
+    
+    // app_main keeps running as the mining supervisor
+    supervise_mining();
 }
\ No newline at end of file
@@ -0,0 +1,180 @@
+/**
+ * @file address.c
+ * @brief Bitcoin address decoding into coinbase output scripts
+ */
+
+#include "address.h"
+#include <stdbool.h>
+#include <string.h>
+#include "sha256.h"
+
+#define BASE58_SIZE     25              // Version, 20-byte hash, 4-byte checksum
+#define BECH32_MAX      90
+#define BECH32_CONST    1u
+#define BECH32M_CONST   0x2bc830a3u
+
+static const char base58_alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+static const char bech32_charset[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+// Base58Check: 0x00/0x6f P2PKH, 0x05/0xc4 P2SH
+static size_t base58_to_script(const char *address, uint8_t *script)
+{
+    uint8_t raw[BASE58_SIZE];
+    uint8_t check[32];
+    size_t zeros = 0;
+    size_t ones = 0;
+
+    memset(raw, 0, sizeof(raw));
+    for (const char *c = address; *c != '\0'; c++) {
+        const char *digit = strchr(base58_alphabet, *c);
+        uint32_t carry;
+
+        if (digit == NULL) {
+            return 0;
+        }
+        carry = (uint32_t)(digit - base58_alphabet);
+        for (int i = BASE58_SIZE - 1; i >= 0; i--) {
+            carry += 58u * raw[i];
+            raw[i] = (uint8_t)carry;
+            carry >>= 8;
+        }
+        if (carry != 0) {
+            return 0;
+        }
+    }
+    // Each leading '1' stands for exactly one leading zero byte
+    while (address[ones] == '1') {
+        ones++;
+    }
+    while (zeros < BASE58_SIZE && raw[zeros] == 0) {
+        zeros++;
+    }
+    if (ones != zeros) {
+        return 0;
+    }
+
+    double_sha256(raw, BASE58_SIZE - 4, check);
+    if (memcmp(check, raw + BASE58_SIZE - 4, 4) != 0) {
+        return 0;
+    }
+    if (raw[0] == 0x00 || raw[0] == 0x6f) {
+        script[0] = 0x76;                                   // OP_DUP OP_HASH160 <20> OP_EQUALVERIFY OP_CHECKSIG
+        script[1] = 0xa9;
+        script[2] = 20;
+        memcpy(script + 3, raw + 1, 20);
+        script[23] = 0x88;
+        script[24] = 0xac;
+        return 25;
+    }
+    if (raw[0] == 0x05 || raw[0] == 0xc4) {
+        script[0] = 0xa9;                                   // OP_HASH160 <20> OP_EQUAL
+        script[1] = 20;
+        memcpy(script + 2, raw + 1, 20);
+        script[22] = 0x87;
+        return 23;
+    }
+    return 0;
+}
+
+static uint32_t bech32_polymod_step(uint32_t chk, uint8_t value)
+{
+    static const uint32_t gen[5] = { 0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3 };
+    uint32_t top = chk >> 25;
+
+    chk = (chk & 0x1ffffff) << 5 ^ value;
+    for (int i = 0; i < 5; i++) {
+        chk ^= ((top >> i) & 1) ? gen[i] : 0;
+    }
+    return chk;
+}
+
+// Segwit: human-readable part bc, tb or bcrt, witness version, program
+static size_t bech32_to_script(const char *address, uint8_t *script)
+{
+    const char *sep = strrchr(address, '1');
+    size_t len = strlen(address);
+    size_t hrp_len;
+    char hrp[5];
+    uint8_t values[BECH32_MAX];
+    size_t count = 0;
+    uint32_t chk = 1;
+    bool lower = false;
+    bool upper = false;
+
+    if (sep == NULL || len > BECH32_MAX) {
+        return 0;
+    }
+    hrp_len = (size_t)(sep - address);
+    for (size_t i = 0; i < len; i++) {
+        lower |= address[i] >= 'a' && address[i] <= 'z';
+        upper |= address[i] >= 'A' && address[i] <= 'Z';
+    }
+    if ((lower && upper) || hrp_len >= sizeof(hrp)) {
+        return 0;
+    }
+    for (size_t i = 0; i < hrp_len; i++) {
+        hrp[i] = (char)(address[i] | 0x20);
+    }
+    hrp[hrp_len] = '\0';
+    if (strcmp(hrp, "bc") != 0 && strcmp(hrp, "tb") != 0 && strcmp(hrp, "bcrt") != 0) {
+        return 0;
+    }
+
+    // Checksum over the expanded prefix and the data values
+    for (size_t i = 0; i < hrp_len; i++) {
+        chk = bech32_polymod_step(chk, (uint8_t)(hrp[i] >> 5));
+    }
+    chk = bech32_polymod_step(chk, 0);
+    for (size_t i = 0; i < hrp_len; i++) {
+        chk = bech32_polymod_step(chk, (uint8_t)(hrp[i] & 31));
+    }
+    for (const char *c = sep + 1; *c != '\0'; c++) {
+        const char *digit = strchr(bech32_charset, *c | 0x20);
+        if (digit == NULL) {
+            return 0;
+        }
+        values[count] = (uint8_t)(digit - bech32_charset);
+        chk = bech32_polymod_step(chk, values[count++]);
+    }
+    if (count < 7) {
+        return 0;
+    }
+
+    // Version 0 uses bech32, later versions bech32m (BIP350)
+    uint8_t version = values[0];
+    if (version > 16 || chk != (version == 0 ? BECH32_CONST : BECH32M_CONST)) {
+        return 0;
+    }
+
+    // 5-bit groups back to bytes; the padding must be under 5 zero bits
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t program = 0;
+    for (size_t i = 1; i < count - 6; i++) {
+        acc = (acc << 5 | values[i]) & 0xfff;
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            if (program >= ADDRESS_SCRIPT_MAX - 2) {
+                return 0;
+            }
+            script[2 + program++] = (uint8_t)(acc >> bits);
+        }
+    }
+    if (bits >= 5 || (acc & ((1u << bits) - 1)) != 0) {
+        return 0;
+    }
+    if (program < 2 || program > 40 || (version == 0 && program != 20 && program != 32)) {
+        return 0;
+    }
+    script[0] = version == 0 ? 0x00 : (uint8_t)(0x50 + version);   // OP_0 or OP_1..OP_16
+    script[1] = (uint8_t)program;
+    return program + 2;
+}
+
+size_t address_to_script(const char *address, uint8_t *script)
+{
+    size_t len = bech32_to_script(address, script);
+
+    return len != 0 ? len : base58_to_script(address, script);
+}
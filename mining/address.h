@@ -0,0 +1,44 @@
+/**
+ * @file address.h
+ * @brief Bitcoin address decoding into coinbase output scripts
+ *
+ * Solo mining pays the block reward to an address, so the coinbase needs
+ * the output script it stands for. Supported forms:
+ *
+ * - Base58Check P2PKH and P2SH (mainnet 1.../3..., testnet and regtest
+ *   m.../n.../2...);
+ * - bech32 segwit v0 (P2WPKH, P2WSH) and bech32m v1+ (P2TR) with the
+ *   bc, tb and bcrt prefixes.
+ *
+ * The network is not checked against the node's; an address of the
+ * wrong network still decodes to a valid script.
+ */
+
+#ifndef __ADDRESS_H__
+#define __ADDRESS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest output script: a 40-byte witness program */
+#define ADDRESS_SCRIPT_MAX  42
+
+/**
+ * @brief Decode an address into the output script that pays it
+ *
+ * @param address Address string
+ * @param script Output buffer of ADDRESS_SCRIPT_MAX bytes
+ * @return Script length, or 0 if the address is malformed or its checksum
+ *         does not match
+ */
+size_t address_to_script(const char *address, uint8_t *script);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ADDRESS_H__
@@ -0,0 +1,27 @@
+/**
+ * @file block_header.c
+ * @brief Bitcoin block header construction and serialization
+ */
+
+#include "block_header.h"
+#include <string.h>
+
+void block_header_serialize(const block_header_t *header, uint8_t *out)
+{
+    block_header_write_le32(&out[BLOCK_HEADER_VERSION_OFFSET], header->version);
+    memcpy(&out[BLOCK_HEADER_PREV_HASH_OFFSET], header->prev_hash, 32);
+    memcpy(&out[BLOCK_HEADER_MERKLE_OFFSET], header->merkle_root, 32);
+    block_header_write_le32(&out[BLOCK_HEADER_TIME_OFFSET], header->timestamp);
+    block_header_write_le32(&out[BLOCK_HEADER_BITS_OFFSET], header->bits);
+    block_header_write_le32(&out[BLOCK_HEADER_NONCE_OFFSET], header->nonce);
+}
+
+void block_header_parse(const uint8_t *data, block_header_t *header)
+{
+    header->version = block_header_read_le32(&data[BLOCK_HEADER_VERSION_OFFSET]);
+    memcpy(header->prev_hash, &data[BLOCK_HEADER_PREV_HASH_OFFSET], 32);
+    memcpy(header->merkle_root, &data[BLOCK_HEADER_MERKLE_OFFSET], 32);
+    header->timestamp = block_header_read_le32(&data[BLOCK_HEADER_TIME_OFFSET]);
+    header->bits = block_header_read_le32(&data[BLOCK_HEADER_BITS_OFFSET]);
+    header->nonce = block_header_read_le32(&data[BLOCK_HEADER_NONCE_OFFSET]);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file block_header.h
+ * @brief Bitcoin block header construction and serialization
+ *
+ * All multi-byte integer fields are serialized little-endian; hashes are
+ * kept in internal (serialized) byte order, i.e. reversed with respect to
+ * how block explorers display them.
+ */
+
+#ifndef __BLOCK_HEADER_H__
+#define __BLOCK_HEADER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of a serialized block header in bytes */
+#define BLOCK_HEADER_SIZE       80
+
+/** Byte offsets of the header fields */
+#define BLOCK_HEADER_VERSION_OFFSET     0
+#define BLOCK_HEADER_PREV_HASH_OFFSET   4
+#define BLOCK_HEADER_MERKLE_OFFSET      36
+#define BLOCK_HEADER_TIME_OFFSET        68
+#define BLOCK_HEADER_BITS_OFFSET        72
+#define BLOCK_HEADER_NONCE_OFFSET       76
+
+/**
+ * @brief Block header fields
+ */
+typedef struct {
+    uint32_t version;           /**< Block version (BIP9 bits) */
+    uint8_t prev_hash[32];      /**< Previous block hash, internal byte order */
+    uint8_t merkle_root[32];    /**< Merkle root, internal byte order */
+    uint32_t timestamp;         /**< Block time (Unix seconds) */
+    uint32_t bits;              /**< Compact difficulty target (nBits) */
+    uint32_t nonce;             /**< Nonce */
+} block_header_t;
+
+/**
+ * @brief Serialize a header into its 80-byte wire format
+ *
+ * @param header Header fields
+ * @param out Output buffer (80 bytes)
+ */
+void block_header_serialize(const block_header_t *header, uint8_t *out);
+
+/**
+ * @brief Parse an 80-byte serialized header
+ *
+ * @param data Serialized header (80 bytes)
+ * @param header Output header fields
+ */
+void block_header_parse(const uint8_t *data, block_header_t *header);
+
+/**
+ * @brief Read a little-endian 32-bit value
+ */
+static inline uint32_t block_header_read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Write a little-endian 32-bit value
+ */
+static inline void block_header_write_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BLOCK_HEADER_H__
@@ -0,0 +1,609 @@
+/**
+ * @file gbt.c
+ * @brief Solo mining against a node: getblocktemplate and submitblock
+ */
+
+#include "gbt.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "block_header.h"
+#include "sha256.h"
+#include "target.h"
+
+#ifdef ESP_PLATFORM
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#else
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+// lwIP never raises SIGPIPE; Linux does unless asked not to
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Witness commitment output script header: OP_RETURN, push 36, 0xaa21a9ed
+static const uint8_t commitment_header[6] = { 0x6a, 0x24, 0xaa, 0x21, 0xa9, 0xed };
+
+static const char getblocktemplate_request[] =
+    "{\"jsonrpc\":\"1.0\",\"id\":1,\"method\":\"getblocktemplate\",\"params\":[{\"rules\":[\"segwit\"]}]}";
+static const char submitblock_prefix[] = "{\"jsonrpc\":\"1.0\",\"id\":2,\"method\":\"submitblock\",\"params\":[\"";
+static const char submitblock_suffix[] = "\"]}";
+
+// BIP34 height as Bitcoin Core's CScript() << height encodes it
+static size_t height_push(uint32_t height, uint8_t *out)
+{
+    size_t len = 0;
+
+    if (height == 0) {
+        out[0] = 0x00;                                      // OP_0
+        return 1;
+    }
+    if (height <= 16) {
+        out[0] = (uint8_t)(0x50 + height);                  // OP_1..OP_16
+        return 1;
+    }
+    while (height > 0) {
+        out[1 + len++] = (uint8_t)height;
+        height >>= 8;
+    }
+    if (out[len] & 0x80) {
+        out[1 + len++] = 0x00;                              // Keep it positive
+    }
+    out[0] = (uint8_t)len;
+    return len + 1;
+}
+
+// Branch of the coinbase, folded by the parser
+static bool merkle_branch(const gbt_template_t *tmpl, work_template_t *work)
+{
+    for (uint32_t i = 0; i < tmpl->branch_len; i++) {
+        if (!work_add_branch(work, tmpl->branch[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void write_le64(uint8_t *p, uint64_t value)
+{
+    block_header_write_le32(p, (uint32_t)value);
+    block_header_write_le32(p + 4, (uint32_t)(value >> 32));
+}
+
+bool gbt_build_work(const gbt_template_t *tmpl, const uint8_t *script, size_t script_len, work_template_t *work)
+{
+    static const char tag[] = GBT_COINBASE_TAG;
+    uint8_t coinbase1[64];
+    uint8_t coinbase2[WORK_COINBASE_MAX];
+    uint8_t height[6];
+    size_t height_len = height_push(tmpl->height, height);
+    size_t len1 = 0;
+    size_t len2 = 0;
+    block_header_t header;
+
+    memset(&header, 0, sizeof(header));
+    header.version = tmpl->version;
+    memcpy(header.prev_hash, tmpl->prev_hash, 32);
+    header.timestamp = tmpl->curtime;
+    header.bits = tmpl->bits;
+    work_init(work, &header, WORK_NTIME_ROLL_DEFAULT);
+    if (script_len > ADDRESS_SCRIPT_MAX) {
+        return false;
+    }
+
+    // Version 2, one input spending nothing
+    block_header_write_le32(coinbase1, 2);
+    coinbase1[4] = 1;
+    memset(coinbase1 + 5, 0, 32);
+    block_header_write_le32(coinbase1 + 37, 0xFFFFFFFF);
+    len1 = 41;
+    // scriptSig: height, push of extranonce2, tag
+    coinbase1[len1++] = (uint8_t)(height_len + 1 + GBT_EXTRANONCE2_SIZE + 1 + sizeof(tag) - 1);
+    memcpy(coinbase1 + len1, height, height_len);
+    len1 += height_len;
+    coinbase1[len1++] = GBT_EXTRANONCE2_SIZE;
+
+    coinbase2[len2++] = (uint8_t)(sizeof(tag) - 1);
+    memcpy(coinbase2 + len2, tag, sizeof(tag) - 1);
+    len2 += sizeof(tag) - 1;
+    block_header_write_le32(coinbase2 + len2, 0xFFFFFFFF);  // Sequence
+    len2 += 4;
+
+    // Outputs: the payout, then the witness commitment
+    coinbase2[len2++] = tmpl->segwit ? 2 : 1;
+    write_le64(coinbase2 + len2, tmpl->coinbase_value);
+    len2 += 8;
+    coinbase2[len2++] = (uint8_t)script_len;
+    memcpy(coinbase2 + len2, script, script_len);
+    len2 += script_len;
+    if (tmpl->segwit) {
+        // Recomputed: the node's default covers transactions that may be left out
+        uint8_t reserved_root[64] = { 0 };
+
+        memcpy(reserved_root, tmpl->witness_root, 32);
+        write_le64(coinbase2 + len2, 0);
+        len2 += 8;
+        coinbase2[len2++] = GBT_COMMITMENT_SIZE;
+        memcpy(coinbase2 + len2, commitment_header, sizeof(commitment_header));
+        double_sha256(reserved_root, sizeof(reserved_root), coinbase2 + len2 + sizeof(commitment_header));
+        len2 += GBT_COMMITMENT_SIZE;
+    }
+    block_header_write_le32(coinbase2 + len2, 0);          // Lock time
+    len2 += 4;
+
+    return work_set_coinbase(work, coinbase1, len1, coinbase1, 0, GBT_EXTRANONCE2_SIZE, coinbase2, len2) &&
+           merkle_branch(tmpl, work);
+}
+
+typedef struct {
+    gbt_sink_t sink;
+    void *arg;
+    size_t size;
+} block_out_t;
+
+static void block_emit(block_out_t *out, const uint8_t *data, size_t len)
+{
+    if (out->sink != NULL) {
+        out->sink(data, len, out->arg);
+    }
+    out->size += len;
+}
+
+size_t gbt_block_serialize(const gbt_template_t *tmpl, const work_template_t *work, const stratum_share_t *share,
+                           gbt_sink_t sink, void *arg)
+{
+    // Witness of the coinbase input: one 32-byte reserved value of zeros
+    static const uint8_t witness[34] = { 1, 32 };
+    static const uint8_t marker[2] = { 0x00, 0x01 };
+    block_out_t out = { sink, arg, 0 };
+    block_header_t header = work->header;
+    uint8_t bytes[BLOCK_HEADER_SIZE];
+    uint8_t coinbase[WORK_COINBASE_MAX];
+    uint8_t count[3];
+    uint32_t txs = tmpl->tx_count + 1;
+    size_t len = work->coinbase_len;
+
+    header.version = share->version;
+    header.timestamp = share->ntime;
+    header.nonce = share->nonce;
+    work_merkle_root(work, share->extranonce2, header.merkle_root);
+    block_header_serialize(&header, bytes);
+    block_emit(&out, bytes, sizeof(bytes));
+
+    if (txs < 0xfd) {
+        count[0] = (uint8_t)txs;
+        block_emit(&out, count, 1);
+    } else {
+        count[0] = 0xfd;
+        count[1] = (uint8_t)txs;
+        count[2] = (uint8_t)(txs >> 8);
+        block_emit(&out, count, 3);
+    }
+
+    memcpy(coinbase, work->coinbase, len);
+    for (size_t i = 0; i < work->extranonce2_size; i++) {
+        coinbase[work->extranonce2_offset + i] = (uint8_t)(share->extranonce2 >> (8 * i));
+    }
+    if (tmpl->segwit) {
+        block_emit(&out, coinbase, 4);
+        block_emit(&out, marker, sizeof(marker));
+        block_emit(&out, coinbase + 4, len - 8);
+        block_emit(&out, witness, sizeof(witness));
+        block_emit(&out, coinbase + len - 4, 4);
+    } else {
+        block_emit(&out, coinbase, len);
+    }
+
+    block_emit(&out, tmpl->tx_data, tmpl->tx_data_len);
+    return out.size;
+}
+
+static size_t base64(const uint8_t *in, size_t len, char *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        v |= i + 1 < len ? (uint32_t)in[i + 1] << 8 : 0;
+        v |= i + 2 < len ? in[i + 2] : 0;
+        out[n++] = alphabet[(v >> 18) & 63];
+        out[n++] = alphabet[(v >> 12) & 63];
+        out[n++] = i + 1 < len ? alphabet[(v >> 6) & 63] : '=';
+        out[n++] = i + 2 < len ? alphabet[v & 63] : '=';
+    }
+    out[n] = '\0';
+    return n;
+}
+
+bool gbt_client_init(gbt_client_t *client, const gbt_config_t *config)
+{
+    char credentials[GBT_CREDENTIALS_MAX + 1];
+    int len;
+
+    memset(client, 0, sizeof(*client));
+    client->config = *config;
+    client->fd = -1;
+    miner_lock_init(&client->lock);
+
+    len = snprintf(credentials, sizeof(credentials), "%s:%s", config->user ? config->user : "",
+                   config->password ? config->password : "");
+    if (len < 0 || (size_t)len >= sizeof(credentials)) {
+        return false;
+    }
+    base64((const uint8_t *)credentials, (size_t)len, client->auth);
+    client->script_len = address_to_script(config->address, client->script);
+    return client->script_len != 0;
+}
+
+static void gbt_close(gbt_client_t *client)
+{
+    if (client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+    }
+}
+
+static bool gbt_connect(gbt_client_t *client)
+{
+    struct timeval tv = { .tv_sec = GBT_TIMEOUT_MS / 1000, .tv_usec = (GBT_TIMEOUT_MS % 1000) * 1000 };
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char port[8];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%u", (unsigned)client->config.port);
+    if (getaddrinfo(client->config.host, port, &hints, &res) != 0 || res == NULL) {
+        return false;
+    }
+    client->fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (client->fd >= 0) {
+        setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(client->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        if (connect(client->fd, res->ai_addr, res->ai_addrlen) != 0) {
+            gbt_close(client);
+        }
+    }
+    freeaddrinfo(res);
+    client->io_len = 0;
+    return client->fd >= 0;
+}
+
+// Send the buffered output; a failure closes the connection
+static void gbt_flush(gbt_client_t *client)
+{
+    size_t sent = 0;
+
+    while (client->fd >= 0 && sent < client->io_len) {
+        ssize_t n = send(client->fd, client->io + sent, client->io_len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            gbt_close(client);
+        } else {
+            sent += (size_t)n;
+        }
+    }
+    client->io_len = 0;
+}
+
+static void gbt_write(gbt_client_t *client, const char *data, size_t len)
+{
+    while (len > 0) {
+        size_t room = sizeof(client->io) - client->io_len;
+        size_t n = len < room ? len : room;
+
+        memcpy(client->io + client->io_len, data, n);
+        client->io_len += n;
+        data += n;
+        len -= n;
+        if (client->io_len == sizeof(client->io)) {
+            gbt_flush(client);
+        }
+    }
+}
+
+// Block bytes go out as hex, straight from the serializer
+static void gbt_write_hex(const uint8_t *data, size_t len, void *arg)
+{
+    static const char digits[] = "0123456789abcdef";
+    gbt_client_t *client = (gbt_client_t *)arg;
+
+    for (size_t i = 0; i < len; i++) {
+        if (sizeof(client->io) - client->io_len < 2) {
+            gbt_flush(client);
+        }
+        client->io[client->io_len++] = digits[data[i] >> 4];
+        client->io[client->io_len++] = digits[data[i] & 15];
+    }
+}
+
+// Connect and send the head of a JSON-RPC POST; the caller writes the body
+static bool gbt_request(gbt_client_t *client, size_t body_len)
+{
+    int len;
+
+    if (!gbt_connect(client)) {
+        return false;
+    }
+    len = snprintf(client->io, sizeof(client->io),
+                   "POST / HTTP/1.1\r\nHost: %s:%u\r\nAuthorization: Basic %s\r\n"
+                   "Content-Type: application/json\r\nContent-Length: %lu\r\nConnection: close\r\n\r\n",
+                   client->config.host, (unsigned)client->config.port, client->auth, (unsigned long)body_len);
+    if (len < 0 || (size_t)len >= sizeof(client->io)) {
+        gbt_close(client);
+        return false;
+    }
+    client->io_len = (size_t)len;
+    return true;
+}
+
+/** Consumes a piece of the response body; false gives up on the response */
+typedef bool (*gbt_body_t)(gbt_client_t *client, const char *data, size_t len);
+
+// Read the response until the node closes the connection. Returns the HTTP
+// status, or 0 if the connection failed or the body was refused.
+static int gbt_response(gbt_client_t *client, gbt_body_t body)
+{
+    char status[13];
+    size_t status_len = 0;
+    uint32_t last = 0;
+    bool in_body = false;
+
+    gbt_flush(client);
+    while (client->fd >= 0) {
+        ssize_t n = recv(client->fd, client->io, sizeof(client->io), 0);
+        size_t i = 0;
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            gbt_close(client);
+            return 0;
+        }
+        if (n == 0) {
+            break;
+        }
+        // Status line, then skip the headers up to the blank line
+        while (!in_body && i < (size_t)n) {
+            char c = client->io[i++];
+            if (status_len < sizeof(status) - 1) {
+                status[status_len++] = c;
+            }
+            last = last << 8 | (uint8_t)c;
+            in_body = last == 0x0d0a0d0a;
+        }
+        if (in_body && i < (size_t)n && !body(client, client->io + i, (size_t)n - i)) {
+            gbt_close(client);
+            return 0;
+        }
+    }
+    gbt_close(client);
+    status[status_len] = '\0';
+    if (!in_body || strncmp(status, "HTTP/1.", 7) != 0) {
+        return 0;
+    }
+    return atoi(status + 9);
+}
+
+static bool gbt_template_body(gbt_client_t *client, const char *data, size_t len)
+{
+    return gbt_parser_feed(&client->parser, data, len) != GBT_PARSE_INVALID;
+}
+
+// Fetch a template into the older slot and publish it as a job
+static void gbt_refresh(gbt_client_t *client)
+{
+    uint32_t next = client->status.templates == 0 ? client->current : client->current ^ 1;
+    gbt_template_t *tmpl = &client->templates[next];
+    stratum_job_t *job = &client->jobs[next];
+    target_t target;
+    bool clean;
+    bool ok = false;
+
+    // Solutions for the template being replaced can no longer be submitted
+    job->id[0] = '\0';
+    gbt_parser_init(&client->parser, tmpl);
+    if (gbt_request(client, sizeof(getblocktemplate_request) - 1)) {
+        gbt_write(client, getblocktemplate_request, sizeof(getblocktemplate_request) - 1);
+        ok = gbt_response(client, gbt_template_body) == 200 &&
+             gbt_parser_feed(&client->parser, NULL, 0) == GBT_PARSE_DONE &&
+             target_from_bits(tmpl->bits, &target) &&
+             gbt_build_work(tmpl, client->script, client->script_len, &job->work);
+    }
+    if (!ok) {
+        miner_lock(&client->lock);
+        client->status.errors++;
+        miner_unlock(&client->lock);
+        client->refresh_us = miner_time_us() + GBT_RETRY_US;
+        return;
+    }
+
+    clean = client->status.templates == 0 ||
+            memcmp(tmpl->prev_hash, client->templates[client->current].prev_hash, 32) != 0;
+    job->work.version_mask = client->config.version_mask;
+    job->difficulty = target_difficulty(&target);
+    job->clean = clean;
+
+    miner_lock(&client->lock);
+    job->seq = ++client->status.templates;
+    snprintf(job->id, sizeof(job->id), "%lu", (unsigned long)job->seq);
+    client->job = *job;
+    client->status.height = tmpl->height;
+    client->status.tx_count = tmpl->tx_count;
+    client->status.tx_dropped = tmpl->tx_dropped;
+    miner_unlock(&client->lock);
+
+    client->current = next;
+    client->refresh_us = miner_time_us() + GBT_REFRESH_US;
+}
+
+// Keep the start of the submitblock response; it is a few dozen bytes
+static bool gbt_reply_body(gbt_client_t *client, const char *data, size_t len)
+{
+    size_t room = sizeof(client->reply) - 1 - client->reply_len;
+    size_t n = len < room ? len : room;
+
+    memcpy(client->reply + client->reply_len, data, n);
+    client->reply_len += n;
+    return true;
+}
+
+// submitblock returns null for an accepted block, or a reason string
+static bool gbt_reply_accepted(gbt_client_t *client, char *reason)
+{
+    const char *p;
+    size_t len = 0;
+
+    client->reply[client->reply_len] = '\0';
+    p = strstr(client->reply, "\"result\"");
+    if (p == NULL) {
+        snprintf(reason, GBT_REASON_MAX, "no result");
+        return false;
+    }
+    p += strlen("\"result\"");
+    while (*p == ' ' || *p == ':') {
+        p++;
+    }
+    if (strncmp(p, "null", 4) == 0) {
+        return true;
+    }
+    if (*p == '"') {
+        p++;
+    }
+    while (p[len] != '\0' && p[len] != '"' && len < GBT_REASON_MAX - 1) {
+        len++;
+    }
+    memcpy(reason, p, len);
+    reason[len] = '\0';
+    return false;
+}
+
+static void gbt_submit_block(gbt_client_t *client, const stratum_share_t *share)
+{
+    char reason[GBT_REASON_MAX];
+    int status = 0;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (client->jobs[i].id[0] != '\0' && strcmp(client->jobs[i].id, share->job_id) == 0) {
+            break;
+        }
+    }
+    if (i == 2) {
+        miner_lock(&client->lock);
+        client->status.stale++;
+        miner_unlock(&client->lock);
+        return;
+    }
+
+    const gbt_template_t *tmpl = &client->templates[i];
+    const work_template_t *work = &client->jobs[i].work;
+    size_t size = gbt_block_serialize(tmpl, work, share, NULL, NULL);
+
+    client->reply_len = 0;
+    if (gbt_request(client, sizeof(submitblock_prefix) - 1 + 2 * size + sizeof(submitblock_suffix) - 1)) {
+        gbt_write(client, submitblock_prefix, sizeof(submitblock_prefix) - 1);
+        gbt_block_serialize(tmpl, work, share, gbt_write_hex, client);
+        gbt_write(client, submitblock_suffix, sizeof(submitblock_suffix) - 1);
+        status = gbt_response(client, gbt_reply_body);
+    }
+
+    miner_lock(&client->lock);
+    if (status == 0) {
+        client->status.errors++;
+    } else {
+        client->status.submitted++;
+        if (status == 200 && gbt_reply_accepted(client, reason)) {
+            client->status.accepted++;
+        } else {
+            if (status != 200) {
+                snprintf(reason, sizeof(reason), "HTTP %d", status);
+            }
+            client->status.rejected++;
+            memcpy(client->status.reject_reason, reason, sizeof(reason));
+        }
+    }
+    miner_unlock(&client->lock);
+
+    // Whatever the outcome, the next template should follow right away
+    client->refresh_us = miner_time_us();
+}
+
+void gbt_client_poll(gbt_client_t *client, uint32_t timeout_ms)
+{
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    bool idle = true;
+
+    // Blocks first: a fresh template is worth nothing next to them
+    for (;;) {
+        stratum_share_t share;
+
+        miner_lock(&client->lock);
+        bool empty = client->queue_head == client->queue_tail;
+        if (!empty) {
+            share = client->queue[client->queue_head++ % GBT_SUBMIT_QUEUE];
+        }
+        miner_unlock(&client->lock);
+        if (empty) {
+            break;
+        }
+        gbt_submit_block(client, &share);
+        idle = false;
+    }
+
+    if (miner_time_us() >= client->refresh_us) {
+        gbt_refresh(client);
+        idle = false;
+    }
+    if (idle) {
+        select(0, NULL, NULL, NULL, &tv);
+    }
+}
+
+bool gbt_client_take_job(gbt_client_t *client, uint32_t *seq, stratum_job_t *job)
+{
+    bool fresh;
+
+    miner_lock(&client->lock);
+    fresh = client->job.seq != *seq;
+    if (fresh) {
+        *job = client->job;
+        *seq = job->seq;
+    }
+    miner_unlock(&client->lock);
+    return fresh;
+}
+
+bool gbt_client_submit(gbt_client_t *client, const stratum_share_t *share)
+{
+    bool queued;
+
+    miner_lock(&client->lock);
+    queued = client->queue_tail - client->queue_head < GBT_SUBMIT_QUEUE;
+    if (queued) {
+        client->queue[client->queue_tail++ % GBT_SUBMIT_QUEUE] = *share;
+    } else {
+        client->status.stale++;
+    }
+    miner_unlock(&client->lock);
+    return queued;
+}
+
+void gbt_client_status(gbt_client_t *client, gbt_status_t *status)
+{
+    miner_lock(&client->lock);
+    *status = client->status;
+    miner_unlock(&client->lock);
+}
@@ -0,0 +1,199 @@
+/**
+ * @file gbt.h
+ * @brief Solo mining against a node: getblocktemplate and submitblock
+ *
+ * Instead of a pool, the miner can work directly on block templates from
+ * a Bitcoin node's JSON-RPC interface (bitcoind with -server):
+ *
+ * - getblocktemplate (with the segwit rule) is streamed through
+ *   gbt_parser.h into a gbt_template_t;
+ * - gbt_build_work() turns it into an ordinary work_template_t: a coinbase
+ *   with the BIP34 height, a 4-byte extranonce2 and a tag in its scriptSig,
+ *   paying the whole coinbase value to the configured address, plus the
+ *   witness commitment (BIP141) over the kept transactions. The merkle
+ *   branch comes folded from the parser, so extranonce2, ntime and version
+ *   rolling work exactly as for pool jobs;
+ * - a nonce that meets the full target from nBits is handed to
+ *   gbt_client_submit(); the client serializes the block (header, coinbase
+ *   with its witness, kept transactions) and streams it to submitblock.
+ *
+ * Each template is published as a stratum_job_t, so the mining supervisor
+ * treats the node like a pool. A template on a new previous block is a
+ * clean job. Templates are fetched every GBT_REFRESH_US and right after a
+ * submitted block; longpoll is not used.
+ *
+ * Every RPC is one blocking HTTP/1.1 request on its own connection with
+ * socket timeouts, so gbt_client_poll() belongs in a task of its own (on
+ * the board, core 0 next to WiFi). Requests ask for Connection: close and
+ * responses are read until the node closes the connection; chunked
+ * transfer encoding is not supported.
+ */
+
+#ifndef __GBT_H__
+#define __GBT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "address.h"
+#include "gbt_parser.h"
+#include "miner_port.h"
+#include "stratum.h"
+#include "work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Extranonce2 bytes in the coinbase scriptSig */
+#define GBT_EXTRANONCE2_SIZE    4
+
+/** Coinbase scriptSig tag */
+#define GBT_COINBASE_TAG        "/esp32-btc-miner/"
+
+/** Template refresh period */
+#ifndef GBT_REFRESH_US
+#define GBT_REFRESH_US          10000000
+#endif
+
+/** Delay before retrying a failed request */
+#ifndef GBT_RETRY_US
+#define GBT_RETRY_US            5000000
+#endif
+
+/** Socket send and receive timeout */
+#define GBT_TIMEOUT_MS          10000
+
+/** Receive and transmit chunk */
+#define GBT_IO_CHUNK            1024
+
+/** Solutions that can wait for the client task */
+#define GBT_SUBMIT_QUEUE        4
+
+/** Longest "rpcuser:rpcpassword" */
+#define GBT_CREDENTIALS_MAX     96
+
+/** Longest submitblock reject reason kept */
+#define GBT_REASON_MAX          32
+
+typedef struct {
+    const char *host;                   ///< Node host name or address
+    uint16_t port;                      ///< RPC port (8332 mainnet, 18443 regtest)
+    const char *user;                   ///< rpcuser
+    const char *password;               ///< rpcpassword
+    const char *address;                ///< Payout address
+    uint32_t version_mask;              ///< Version bits the miner may roll
+} gbt_config_t;
+
+/** Counters */
+typedef struct {
+    uint32_t templates;                 ///< Templates fetched and published
+    uint32_t height;                    ///< Height of the latest template
+    uint32_t tx_count;                  ///< Transactions it includes
+    uint32_t tx_dropped;                ///< Transactions it left out
+    uint32_t submitted;                 ///< Blocks sent to submitblock
+    uint32_t accepted;                  ///< Blocks the node accepted
+    uint32_t rejected;                  ///< Blocks the node rejected
+    uint32_t stale;                     ///< Solutions for templates no longer kept, or a full queue
+    uint32_t errors;                    ///< Failed requests
+    char reject_reason[GBT_REASON_MAX]; ///< Node's reason for the last rejection
+} gbt_status_t;
+
+typedef struct {
+    gbt_config_t config;
+    uint8_t script[ADDRESS_SCRIPT_MAX]; ///< Payout script
+    size_t script_len;                  ///< 0: the address did not decode
+    char auth[(GBT_CREDENTIALS_MAX + 2) / 3 * 4 + 1]; ///< Base64 credentials for Basic authentication
+    uint64_t refresh_us;                ///< When to fetch the next template
+
+    // Only touched by the client task
+    int fd;
+    char io[GBT_IO_CHUNK];
+    size_t io_len;
+    gbt_parser_t parser;
+    gbt_template_t templates[2];        ///< Latest template and the one before
+    stratum_job_t jobs[2];              ///< Their jobs
+    uint32_t current;                   ///< Index of the latest
+    char reply[128];                    ///< Start of a submitblock response
+    size_t reply_len;
+
+    // Shared with the miners, under lock
+    miner_lock_t lock;
+    stratum_job_t job;                  ///< Latest published job
+    stratum_share_t queue[GBT_SUBMIT_QUEUE];
+    uint32_t queue_head;
+    uint32_t queue_tail;
+    gbt_status_t status;
+} gbt_client_t;
+
+/** Receives serialized block bytes */
+typedef void (*gbt_sink_t)(const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief Build work paying the template's coinbase value to a script
+ *
+ * @param tmpl Template
+ * @param script Payout output script
+ * @param script_len Its size
+ * @param work Output work (version_mask 0, extranonce2 from 0)
+ * @return false if the coinbase does not fit in WORK_COINBASE_MAX
+ */
+bool gbt_build_work(const gbt_template_t *tmpl, const uint8_t *script, size_t script_len, work_template_t *work);
+
+/**
+ * @brief Serialize the block of a solution
+ *
+ * @param tmpl Template the work was built from
+ * @param work Work of the solution
+ * @param share Rolled version, ntime, extranonce2 and nonce
+ * @param sink Output, called with consecutive pieces (NULL: only count)
+ * @param arg Passed to sink
+ * @return Block size in bytes
+ */
+size_t gbt_block_serialize(const gbt_template_t *tmpl, const work_template_t *work, const stratum_share_t *share,
+                           gbt_sink_t sink, void *arg);
+
+/**
+ * @brief Initialize a client; it fetches a template on the first poll
+ *
+ * @param client Client to initialize
+ * @param config Node settings (the strings must outlive the client)
+ * @return false if the payout address does not decode
+ */
+bool gbt_client_init(gbt_client_t *client, const gbt_config_t *config);
+
+/**
+ * @brief Submit queued blocks, then fetch a template when one is due
+ *
+ * Blocks for up to GBT_TIMEOUT_MS per request; sleeps up to timeout_ms
+ * when there is nothing to do.
+ */
+void gbt_client_poll(gbt_client_t *client, uint32_t timeout_ms);
+
+/**
+ * @brief Copy the latest job if it is newer than the one the caller has
+ *
+ * @param client Client
+ * @param seq Sequence number of the caller's job (0 for none); updated
+ * @param job Output job
+ * @return true if a newer job was copied
+ */
+bool gbt_client_take_job(gbt_client_t *client, uint32_t *seq, stratum_job_t *job);
+
+/**
+ * @brief Queue a solution meeting the block target (safe from any worker)
+ *
+ * @return false if the queue is full; the solution is counted as stale
+ */
+bool gbt_client_submit(gbt_client_t *client, const stratum_share_t *share);
+
+/**
+ * @brief Snapshot of the counters
+ */
+void gbt_client_status(gbt_client_t *client, gbt_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GBT_H__
@@ -0,0 +1,599 @@
+/**
+ * @file gbt_parser.c
+ * @brief Streaming, allocation-free parser for getblocktemplate results
+ */
+
+#include "gbt_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// JSON states
+enum {
+    PS_VALUE,                           // Expecting a value (or ']' of an empty array)
+    PS_KEY,                             // Expecting a key (or '}' of an empty object)
+    PS_KEY_STRING,                      // Inside a key
+    PS_COLON,                           // After a key
+    PS_STRING,                          // Inside a string value
+    PS_ESCAPE,                          // After a backslash in a string value
+    PS_PRIMITIVE,                       // Inside a number or literal
+    PS_AFTER,                           // After a value: ',' or a closing bracket
+    PS_DONE,                            // Response object complete
+};
+
+// Keys we route on
+enum {
+    KEY_OTHER,
+    KEY_RESULT,
+    KEY_ERROR,
+    KEY_VERSION,
+    KEY_PREVHASH,
+    KEY_TRANSACTIONS,
+    KEY_COINBASEVALUE,
+    KEY_CURTIME,
+    KEY_BITS,
+    KEY_HEIGHT,
+    KEY_COMMITMENT,
+    KEY_DATA,
+    KEY_TXID,
+    KEY_HASH,
+    KEY_FEE,
+};
+
+// Destinations of values
+enum {
+    SLOT_NONE,
+    SLOT_RESULT,
+    SLOT_ERROR,
+    SLOT_VERSION,
+    SLOT_PREVHASH,
+    SLOT_COINBASEVALUE,
+    SLOT_CURTIME,
+    SLOT_BITS,
+    SLOT_HEIGHT,
+    SLOT_COMMITMENT,
+    SLOT_TX_DATA,
+    SLOT_TXID,
+    SLOT_WTXID,
+    SLOT_FEE,
+};
+
+// Template fields seen
+#define SEEN_VERSION        (1u << 0)
+#define SEEN_PREVHASH       (1u << 1)
+#define SEEN_COINBASEVALUE  (1u << 2)
+#define SEEN_CURTIME        (1u << 3)
+#define SEEN_BITS           (1u << 4)
+#define SEEN_HEIGHT         (1u << 5)
+#define SEEN_TRANSACTIONS   (1u << 6)
+#define SEEN_TEMPLATE       (SEEN_VERSION | SEEN_PREVHASH | SEEN_COINBASEVALUE | SEEN_CURTIME | SEEN_BITS | \
+                             SEEN_HEIGHT | SEEN_TRANSACTIONS)
+
+// Transaction fields seen
+#define TX_DATA             (1u << 0)
+#define TX_TXID             (1u << 1)
+#define TX_WTXID            (1u << 2)
+#define TX_FEE              (1u << 3)
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool text_is(const gbt_parser_t *p, const char *s)
+{
+    size_t len = strlen(s);
+    return p->text_len == len && memcmp(p->text, s, len) == 0;
+}
+
+// RPC hashes are shown most significant byte first; headers store them reversed
+static void reverse32(uint8_t *out, const uint8_t *in)
+{
+    for (int i = 0; i < 32; i++) {
+        out[i] = in[31 - i];
+    }
+}
+
+void gbt_parser_init(gbt_parser_t *parser, gbt_template_t *tmpl)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->tmpl = tmpl;
+    parser->state = PS_VALUE;
+
+    tmpl->segwit = false;
+    tmpl->tx_count = 0;
+    tmpl->tx_dropped = 0;
+    tmpl->dropped_fees = 0;
+    tmpl->tx_data_len = 0;
+    merkle_init(&parser->txids);
+    merkle_init(&parser->wtxids);
+}
+
+static bool container_is_object(const gbt_parser_t *p, uint8_t level)
+{
+    return (p->object >> level) & 1;
+}
+
+// Inside result.transactions[i]
+static bool in_transaction(const gbt_parser_t *p)
+{
+    return p->depth == 4 && p->keys[0] == KEY_RESULT && p->keys[1] == KEY_TRANSACTIONS &&
+           container_is_object(p, 1) && !container_is_object(p, 2) && container_is_object(p, 3);
+}
+
+// Destination of a value starting inside the innermost open container
+static uint8_t parser_slot(const gbt_parser_t *p)
+{
+    static const uint8_t result_slots[] = {
+        [KEY_VERSION] = SLOT_VERSION,
+        [KEY_PREVHASH] = SLOT_PREVHASH,
+        [KEY_COINBASEVALUE] = SLOT_COINBASEVALUE,
+        [KEY_CURTIME] = SLOT_CURTIME,
+        [KEY_BITS] = SLOT_BITS,
+        [KEY_HEIGHT] = SLOT_HEIGHT,
+        [KEY_COMMITMENT] = SLOT_COMMITMENT,
+    };
+    static const uint8_t tx_slots[] = {
+        [KEY_DATA] = SLOT_TX_DATA,
+        [KEY_TXID] = SLOT_TXID,
+        [KEY_HASH] = SLOT_WTXID,
+        [KEY_FEE] = SLOT_FEE,
+    };
+
+    if (p->depth == 1 && container_is_object(p, 0)) {
+        return p->keys[0] == KEY_RESULT ? SLOT_RESULT : p->keys[0] == KEY_ERROR ? SLOT_ERROR : SLOT_NONE;
+    }
+    if (p->depth == 2 && p->keys[0] == KEY_RESULT && container_is_object(p, 1)) {
+        return p->keys[1] < sizeof(result_slots) ? result_slots[p->keys[1]] : SLOT_NONE;
+    }
+    if (in_transaction(p)) {
+        return p->keys[3] < sizeof(tx_slots) ? tx_slots[p->keys[3]] : SLOT_NONE;
+    }
+    return SLOT_NONE;
+}
+
+static bool slot_is_hex(uint8_t slot)
+{
+    return slot == SLOT_PREVHASH || slot == SLOT_COMMITMENT || slot == SLOT_TX_DATA || slot == SLOT_TXID ||
+           slot == SLOT_WTXID;
+}
+
+// Point the hex decoder at the destination of a hex slot
+static void parser_start_hex(gbt_parser_t *p)
+{
+    gbt_template_t *t = p->tmpl;
+
+    p->hex_digits = 0;
+    p->hex = NULL;
+    p->hex_max = 0;
+    switch (p->slot) {
+    case SLOT_PREVHASH:
+        p->hex = t->prev_hash;
+        p->hex_max = 32;
+        break;
+    case SLOT_COMMITMENT:
+        p->hex = t->default_commitment;
+        p->hex_max = GBT_COMMITMENT_SIZE;
+        break;
+    case SLOT_TX_DATA:
+        // Once one transaction is left out, so is every later one. The
+        // block's transaction count is serialized in at most 3 bytes.
+        if (p->tx_fits && t->tx_dropped == 0 && p->txids.count < MERKLE_LEAVES_MAX - 1) {
+            p->hex = t->tx_data + t->tx_data_len;
+            p->hex_max = GBT_TX_DATA_MAX - t->tx_data_len;
+        } else {
+            p->tx_fits = false;
+        }
+        break;
+    case SLOT_TXID:
+        p->hex = p->txid;
+        p->hex_max = 32;
+        break;
+    case SLOT_WTXID:
+        p->hex = p->wtxid;
+        p->hex_max = 32;
+        break;
+    default:
+        break;
+    }
+}
+
+// A hex value ended: check its length and record it
+static void parser_end_hex(gbt_parser_t *p)
+{
+    gbt_template_t *t = p->tmpl;
+    size_t bytes = p->hex_digits / 2;
+    uint8_t hash[32];
+
+    if (p->hex_digits % 2 != 0) {
+        p->bad = true;
+        return;
+    }
+    switch (p->slot) {
+    case SLOT_PREVHASH:
+        if (bytes != 32) {
+            p->bad = true;
+            return;
+        }
+        memcpy(hash, t->prev_hash, 32);
+        reverse32(t->prev_hash, hash);
+        p->seen |= SEEN_PREVHASH;
+        break;
+    case SLOT_COMMITMENT:
+        t->segwit = bytes == GBT_COMMITMENT_SIZE;
+        break;
+    case SLOT_TX_DATA:
+        if (bytes == 0) {
+            p->bad = true;
+            return;
+        }
+        if (p->tx_fits && !(p->tx_seen & TX_DATA)) {
+            t->tx_data_len += bytes;                        // Committed when the object closes
+        }
+        p->tx_seen |= TX_DATA;
+        break;
+    case SLOT_TXID:
+    case SLOT_WTXID:
+        if (bytes != 32) {
+            p->bad = true;
+            return;
+        }
+        p->tx_seen |= p->slot == SLOT_TXID ? TX_TXID : TX_WTXID;
+        break;
+    default:
+        break;
+    }
+}
+
+// A short value ended: store it
+static void parser_end_text(gbt_parser_t *p, bool string)
+{
+    gbt_template_t *t = p->tmpl;
+    uint64_t value;
+    char *end;
+
+    p->text[p->text_len < GBT_PARSER_TEXT_MAX ? p->text_len : GBT_PARSER_TEXT_MAX - 1] = '\0';
+    switch (p->slot) {
+    case SLOT_RESULT:
+        p->bad = true;                                      // null or not an object
+        return;
+    case SLOT_ERROR:
+        p->bad |= string || !text_is(p, "null");
+        return;
+    case SLOT_BITS:
+        value = strtoull(p->text, &end, 16);
+        if (!string || p->text_len != 8 || *end != '\0') {
+            p->bad = true;
+            return;
+        }
+        t->bits = (uint32_t)value;
+        p->seen |= SEEN_BITS;
+        return;
+    case SLOT_VERSION:
+    case SLOT_COINBASEVALUE:
+    case SLOT_CURTIME:
+    case SLOT_HEIGHT:
+    case SLOT_FEE:
+        value = strtoull(p->text, &end, 10);
+        if (string || p->text_len == 0 || p->text_len >= GBT_PARSER_TEXT_MAX || *end != '\0' ||
+            (p->slot != SLOT_COINBASEVALUE && p->slot != SLOT_FEE && value > 0xFFFFFFFFu)) {
+            p->bad = true;
+            return;
+        }
+        break;
+    default:
+        return;
+    }
+
+    switch (p->slot) {
+    case SLOT_VERSION:
+        t->version = (uint32_t)value;
+        p->seen |= SEEN_VERSION;
+        break;
+    case SLOT_COINBASEVALUE:
+        t->coinbase_value = value;
+        p->seen |= SEEN_COINBASEVALUE;
+        break;
+    case SLOT_CURTIME:
+        t->curtime = (uint32_t)value;
+        p->seen |= SEEN_CURTIME;
+        break;
+    case SLOT_HEIGHT:
+        t->height = (uint32_t)value;
+        p->seen |= SEEN_HEIGHT;
+        break;
+    default:
+        p->fee = value;
+        p->tx_seen |= TX_FEE;
+        break;
+    }
+}
+
+// A value begins: work out where it goes
+static void parser_begin_value(gbt_parser_t *p, bool string)
+{
+    p->slot = p->depth > 0 ? parser_slot(p) : SLOT_NONE;
+    p->text_len = 0;
+    p->empty = false;
+    if (string && slot_is_hex(p->slot)) {
+        parser_start_hex(p);
+    } else if (!string && slot_is_hex(p->slot)) {
+        p->bad = true;
+    }
+}
+
+static void parser_begin_tx(gbt_parser_t *p)
+{
+    p->tx_seen = 0;
+    p->fee = 0;
+    p->tx_fits = true;
+}
+
+// result.transactions[i] closed: keep it, or leave it out and take its fee back
+static void parser_end_tx(gbt_parser_t *p)
+{
+    gbt_template_t *t = p->tmpl;
+    uint8_t hash[32];
+
+    if ((p->tx_seen & (TX_DATA | TX_TXID)) != (TX_DATA | TX_TXID)) {
+        p->bad = true;
+        return;
+    }
+    if (p->tx_fits) {
+        reverse32(hash, p->txid);
+        merkle_add(&p->txids, hash);
+        reverse32(hash, (p->tx_seen & TX_WTXID) ? p->wtxid : p->txid);
+        merkle_add(&p->wtxids, hash);
+        t->tx_count++;
+        return;
+    }
+    if (!(p->tx_seen & TX_FEE)) {
+        p->bad = true;                                      // Cannot take an unknown fee back
+        return;
+    }
+    t->tx_dropped++;
+    t->dropped_fees += p->fee;
+}
+
+static void parser_end_value(gbt_parser_t *p, bool string)
+{
+    if (slot_is_hex(p->slot)) {
+        parser_end_hex(p);
+    } else {
+        parser_end_text(p, string);
+    }
+}
+
+static uint8_t key_id(const gbt_parser_t *p)
+{
+    static const struct {
+        const char *name;
+        uint8_t id;
+    } keys[] = {
+        { "result", KEY_RESULT },
+        { "error", KEY_ERROR },
+        { "version", KEY_VERSION },
+        { "previousblockhash", KEY_PREVHASH },
+        { "transactions", KEY_TRANSACTIONS },
+        { "coinbasevalue", KEY_COINBASEVALUE },
+        { "curtime", KEY_CURTIME },
+        { "bits", KEY_BITS },
+        { "height", KEY_HEIGHT },
+        { "default_witness_commitment", KEY_COMMITMENT },
+        { "data", KEY_DATA },
+        { "txid", KEY_TXID },
+        { "hash", KEY_HASH },
+        { "fee", KEY_FEE },
+    };
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (text_is(p, keys[i].name)) {
+            return keys[i].id;
+        }
+    }
+    return KEY_OTHER;
+}
+
+static void parser_push(gbt_parser_t *p, bool object)
+{
+    uint8_t slot = p->depth > 0 ? parser_slot(p) : SLOT_NONE;
+
+    if (p->depth >= GBT_PARSER_DEPTH || slot == SLOT_ERROR || (slot == SLOT_RESULT && !object) ||
+        slot_is_hex(slot)) {
+        p->bad = true;                                      // An RPC error, or a field of the wrong type
+        return;
+    }
+    if (p->depth == 2 && p->keys[0] == KEY_RESULT && p->keys[1] == KEY_TRANSACTIONS && !object) {
+        p->seen |= SEEN_TRANSACTIONS;
+    }
+    p->object = (uint8_t)((p->object & ~(1u << p->depth)) | ((object ? 1u : 0u) << p->depth));
+    p->keys[p->depth] = KEY_OTHER;
+    p->depth++;
+    p->empty = true;
+    p->state = object ? PS_KEY : PS_VALUE;
+    if (in_transaction(p)) {
+        parser_begin_tx(p);
+    }
+}
+
+static void parser_pop(gbt_parser_t *p)
+{
+    if (in_transaction(p)) {
+        parser_end_tx(p);
+    }
+    p->depth--;
+    p->empty = false;
+    p->state = p->depth == 0 ? PS_DONE : PS_AFTER;
+}
+
+static void parser_value_done(gbt_parser_t *p)
+{
+    p->state = p->depth == 0 ? PS_DONE : PS_AFTER;
+}
+
+// Append one character to a short field; overlong fields stay marked as such
+static void parser_text(gbt_parser_t *p, char c)
+{
+    if (p->text_len < GBT_PARSER_TEXT_MAX - 1) {
+        p->text[p->text_len++] = c;
+    } else {
+        p->text_len = GBT_PARSER_TEXT_MAX;
+    }
+}
+
+static void parser_char(gbt_parser_t *p, char c)
+{
+    bool in_object = p->depth > 0 && container_is_object(p, p->depth - 1);
+
+    switch (p->state) {
+    case PS_STRING:
+        if (c == '"') {
+            parser_end_value(p, true);
+            parser_value_done(p);
+        } else if (slot_is_hex(p->slot)) {
+            int d = hex_digit(c);
+            size_t byte = p->hex_digits / 2;
+            if (d < 0 || (byte >= p->hex_max && p->slot != SLOT_TX_DATA)) {
+                p->bad = true;
+                return;
+            }
+            if (byte >= p->hex_max) {
+                p->tx_fits = false;                         // Too big: still checked, not stored
+                p->hex = NULL;
+            }
+            if (p->hex != NULL) {
+                if (p->hex_digits % 2 == 0) {
+                    p->hex[byte] = (uint8_t)(d << 4);
+                } else {
+                    p->hex[byte] |= (uint8_t)d;
+                }
+            }
+            p->hex_digits++;
+        } else if (c == '\\') {
+            p->state = PS_ESCAPE;
+        } else {
+            parser_text(p, c);
+        }
+        return;
+    case PS_ESCAPE:
+        parser_text(p, c);
+        p->state = PS_STRING;
+        return;
+    case PS_KEY_STRING:
+        if (c == '"') {
+            p->keys[p->depth - 1] = p->text_len < GBT_PARSER_TEXT_MAX ? key_id(p) : KEY_OTHER;
+            p->state = PS_COLON;
+        } else {
+            parser_text(p, c);
+        }
+        return;
+    default:
+        break;
+    }
+
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        if (p->state == PS_PRIMITIVE) {
+            parser_end_value(p, false);
+            parser_value_done(p);
+        }
+        return;
+    }
+
+    switch (p->state) {
+    case PS_PRIMITIVE:
+        if (c != ',' && c != ']' && c != '}') {
+            parser_text(p, c);
+            return;
+        }
+        parser_end_value(p, false);
+        parser_value_done(p);
+        break;                                              // The delimiter is handled below
+    case PS_KEY:
+        if (c == '"') {
+            p->text_len = 0;
+            p->empty = false;
+            p->state = PS_KEY_STRING;
+        } else if (c == '}' && p->empty) {
+            parser_pop(p);
+        } else {
+            p->bad = true;
+        }
+        return;
+    case PS_COLON:
+        if (c == ':') {
+            p->state = PS_VALUE;
+        } else {
+            p->bad = true;
+        }
+        return;
+    case PS_VALUE:
+        if (c == '{' || c == '[') {
+            parser_push(p, c == '{');
+        } else if (c == ']' && p->depth > 0 && !in_object && p->empty) {
+            parser_pop(p);
+        } else if (c == '"') {
+            parser_begin_value(p, true);
+            p->state = PS_STRING;
+        } else if (c == ',' || c == ']' || c == '}' || c == ':' || p->depth == 0) {
+            p->bad = true;
+        } else {
+            parser_begin_value(p, false);
+            parser_text(p, c);
+            p->state = PS_PRIMITIVE;
+        }
+        return;
+    default:
+        break;
+    }
+
+    // PS_AFTER
+    if (c == ',') {
+        p->state = in_object ? PS_KEY : PS_VALUE;
+        p->text_len = 0;
+    } else if ((c == '}' && in_object) || (c == ']' && !in_object)) {
+        parser_pop(p);
+    } else {
+        p->bad = true;
+    }
+}
+
+// The response object closed: check the template is complete and close
+// the merkle trees
+static bool parser_finish(gbt_parser_t *p)
+{
+    static const uint8_t coinbase_wtxid[32] = { 0 };
+    gbt_template_t *t = p->tmpl;
+
+    if ((p->seen & SEEN_TEMPLATE) != SEEN_TEMPLATE || t->dropped_fees > t->coinbase_value) {
+        return false;
+    }
+    t->coinbase_value -= t->dropped_fees;
+
+    t->branch_len = merkle_finish(&p->txids);
+    memcpy(t->branch, p->txids.branch, t->branch_len * 32);
+    merkle_finish(&p->wtxids);
+    merkle_root(&p->wtxids, coinbase_wtxid, t->witness_root);
+    return true;
+}
+
+gbt_parse_t gbt_parser_feed(gbt_parser_t *parser, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && !parser->bad && parser->state != PS_DONE; i++) {
+        parser_char(parser, data[i]);
+        if (parser->state == PS_DONE && !parser->bad && !parser_finish(parser)) {
+            parser->bad = true;
+        }
+    }
+    if (parser->bad) {
+        return GBT_PARSE_INVALID;
+    }
+    return parser->state == PS_DONE ? GBT_PARSE_DONE : GBT_PARSE_MORE;
+}
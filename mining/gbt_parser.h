@@ -0,0 +1,125 @@
+/**
+ * @file gbt_parser.h
+ * @brief Streaming, allocation-free parser for getblocktemplate results
+ *
+ * A block template carries every mempool transaction the node selected,
+ * which is far more than an ESP32 can hold. The parser works like the
+ * Stratum one (stratum_parser.h): a byte-at-a-time JSON state machine fed
+ * with whatever recv() returns, routing each value by its position into
+ * a fixed gbt_template_t. Transactions are kept in template order while
+ * their data fits in GBT_TX_DATA_MAX bytes; the first one that does not
+ * fit is left out with every one after it, and their fees are taken off
+ * the coinbase value. Since a transaction only depends on earlier ones,
+ * the kept prefix is always a valid block body.
+ *
+ * Transaction ids are not stored: as each kept transaction closes, its
+ * txid and wtxid go into two streaming merkle builders (merkle.h), so the
+ * template ends up with the coinbase branch and the witness root, and the
+ * number of transactions costs no memory.
+ */
+
+#ifndef __GBT_PARSER_H__
+#define __GBT_PARSER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "merkle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Raw transaction bytes kept per template */
+#ifndef GBT_TX_DATA_MAX
+#define GBT_TX_DATA_MAX         16384
+#endif
+
+/** Size of a witness commitment output script (OP_RETURN, push, header, hash) */
+#define GBT_COMMITMENT_SIZE     38
+
+/** Deepest container nesting accepted */
+#define GBT_PARSER_DEPTH        8
+
+/** Longest short field (key, number, literal, hex word) */
+#define GBT_PARSER_TEXT_MAX     64
+
+/** The parts of a block template the miner needs */
+typedef struct {
+    uint32_t version;                       ///< Block version
+    uint8_t prev_hash[32];                  ///< Previous block hash, internal byte order
+    uint32_t bits;                          ///< Compact target
+    uint32_t curtime;                       ///< Time to put in the header
+    uint32_t height;                        ///< Height of the block (BIP34)
+    uint64_t coinbase_value;                ///< Reward plus the fees of the kept transactions
+    bool segwit;                            ///< The node sent a default witness commitment
+    uint8_t default_commitment[GBT_COMMITMENT_SIZE]; ///< That commitment, for all transactions
+
+    uint32_t tx_count;                      ///< Transactions kept
+    uint32_t tx_dropped;                    ///< Transactions left out
+    uint64_t dropped_fees;                  ///< Their fees (already off coinbase_value)
+    uint8_t branch[MERKLE_DEPTH_MAX][32];   ///< Coinbase merkle branch over the kept txids
+    uint32_t branch_len;
+    uint8_t witness_root[32];               ///< Merkle root of the kept wtxids, the coinbase's being zero
+    uint8_t tx_data[GBT_TX_DATA_MAX];       ///< Their serializations, back to back
+    size_t tx_data_len;
+} gbt_template_t;
+
+typedef enum {
+    GBT_PARSE_MORE,                         ///< Feed more data
+    GBT_PARSE_DONE,                         ///< A complete template was decoded
+    GBT_PARSE_INVALID,                      ///< Malformed JSON, an RPC error or a missing field
+} gbt_parse_t;
+
+typedef struct {
+    gbt_template_t *tmpl;                   ///< Destination
+
+    // JSON state
+    uint8_t state;
+    uint8_t depth;                          ///< Open containers
+    uint8_t object;                         ///< Bit d set: container d is an object
+    uint8_t keys[GBT_PARSER_DEPTH];         ///< Current key of each object
+    uint8_t slot;                           ///< Where the current value goes
+    bool empty;                             ///< Nothing in the innermost container yet
+    bool bad;
+
+    // Current value
+    char text[GBT_PARSER_TEXT_MAX];
+    uint8_t text_len;
+    uint8_t *hex;                           ///< Destination of a hex field (NULL: check only)
+    size_t hex_max;
+    size_t hex_digits;
+
+    // Current transaction
+    uint8_t txid[32];
+    uint8_t wtxid[32];
+    uint64_t fee;
+    uint16_t tx_seen;
+    bool tx_fits;
+    merkle_builder_t txids;                 ///< Kept txids, folded as they come
+    merkle_builder_t wtxids;                ///< Kept wtxids
+
+    uint16_t seen;                          ///< Template fields seen
+} gbt_parser_t;
+
+/**
+ * @brief Start parsing a getblocktemplate response into a template
+ */
+void gbt_parser_init(gbt_parser_t *parser, gbt_template_t *tmpl);
+
+/**
+ * @brief Parse the next part of the response body
+ *
+ * @param parser Parser
+ * @param data Received bytes
+ * @param len Number of bytes
+ * @return GBT_PARSE_DONE once the response object is closed and the
+ *         template is complete; later data is ignored
+ */
+gbt_parse_t gbt_parser_feed(gbt_parser_t *parser, const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GBT_PARSER_H__
@@ -0,0 +1,371 @@
+/**
+ * @file hash_backend.c
+ * @brief SHA-256d backend table, boot-time self-test and benchmark
+ */
+
+#include "hash_backend.h"
+#include <string.h>
+#include "block_header.h"
+#include "miner_port.h"
+#include "miner_profile.h"
+#include "sha256.h"
+#include "sha256d_nway.h"
+
+#ifdef ESP_PLATFORM
+#include "mbedtls/sha256.h"
+#endif
+
+// Bitcoin genesis block header (block 0) and its winning nonce
+static const uint8_t genesis_header[BLOCK_HEADER_SIZE] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+#define GENESIS_NONCE       2083236893u
+
+// Nonces checked per scan call in the benchmark (and the self-test window)
+#define BACKEND_CHUNK       256
+
+// Rebuild the 80 serialized header bytes from the engine's words
+static void backend_header_bytes(const sha256d_ctx_t *ctx, uint8_t *header)
+{
+    for (int i = 0; i < SHA256D_HEADER_SIZE / 4; i++) {
+        header[i * 4] = (uint8_t)(ctx->words[i] >> 24);
+        header[i * 4 + 1] = (uint8_t)(ctx->words[i] >> 16);
+        header[i * 4 + 2] = (uint8_t)(ctx->words[i] >> 8);
+        header[i * 4 + 3] = (uint8_t)ctx->words[i];
+    }
+}
+
+// Candidate decision on a full digest: bytes 31..28 read as a number
+static inline bool backend_hash_passes(const uint8_t *hash, uint32_t max_top_word)
+{
+    return block_header_read_le32(&hash[28]) <= max_top_word;
+}
+
+/**
+ * @brief Per-nonce check used by the single-lane backends
+ */
+typedef bool (*backend_nonce_fn)(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word);
+
+static uint32_t backend_scan_each(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                                  uint32_t max_top_word, uint32_t *out_mask, backend_nonce_fn check)
+{
+    uint32_t candidates = 0;
+
+    memset(out_mask, 0, SHA256D_BATCH_MASK_WORDS(count) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        if (check(ctx, nonce_start + i, max_top_word)) {
+            out_mask[i / 32] |= 1u << (i % 32);
+            candidates++;
+        }
+    }
+    return candidates;
+}
+
+static bool nonce_reference(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t header[BLOCK_HEADER_SIZE];
+    uint8_t hash[32];
+
+    backend_header_bytes(ctx, header);
+    block_header_write_le32(&header[BLOCK_HEADER_NONCE_OFFSET], nonce);
+    double_sha256(header, BLOCK_HEADER_SIZE, hash);
+    return backend_hash_passes(hash, max_top_word);
+}
+
+#ifdef ESP_PLATFORM
+static bool nonce_mbedtls(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t header[BLOCK_HEADER_SIZE];
+    uint8_t first[32];
+    uint8_t hash[32];
+
+    backend_header_bytes(ctx, header);
+    block_header_write_le32(&header[BLOCK_HEADER_NONCE_OFFSET], nonce);
+    if (mbedtls_sha256(header, BLOCK_HEADER_SIZE, first, 0) != 0 ||
+        mbedtls_sha256(first, sizeof(first), hash, 0) != 0) {
+        return false;
+    }
+    return backend_hash_passes(hash, max_top_word);
+}
+#endif
+
+static bool nonce_unrolled(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+
+    sha256d_set_nonce(ctx, nonce);
+    sha256d_hash(ctx, hash);
+    return backend_hash_passes(hash, max_top_word);
+}
+
+static bool nonce_midstate(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+
+    sha256d_set_nonce(ctx, nonce);
+    sha256d_hash_midstate(ctx, hash);
+    return backend_hash_passes(hash, max_top_word);
+}
+
+static bool nonce_precomp(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+
+    sha256d_hash_nonce(ctx, nonce, hash);
+    return backend_hash_passes(hash, max_top_word);
+}
+
+static bool nonce_reject(sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+
+    return sha256d_check_nonce(ctx, nonce, max_top_word, hash);
+}
+
+static uint32_t scan_reference(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                               uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_each(ctx, nonce_start, count, max_top_word, out_mask, nonce_reference);
+}
+
+#ifdef ESP_PLATFORM
+static uint32_t scan_mbedtls(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                             uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_each(ctx, nonce_start, count, max_top_word, out_mask, nonce_mbedtls);
+}
+#endif
+
+static uint32_t scan_unrolled(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                              uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_each(ctx, nonce_start, count, max_top_word, out_mask, nonce_unrolled);
+}
+
+static uint32_t scan_midstate(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                              uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_each(ctx, nonce_start, count, max_top_word, out_mask, nonce_midstate);
+}
+
+static uint32_t scan_precomp(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                             uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_each(ctx, nonce_start, count, max_top_word, out_mask, nonce_precomp);
+}
+
+static uint32_t scan_reject(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                            uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_each(ctx, nonce_start, count, max_top_word, out_mask, nonce_reject);
+}
+
+// Interleaved kernels: whole groups first, then the scalar check for the rest
+static uint32_t backend_scan_groups(const sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                                    uint32_t max_top_word, uint32_t *out_mask, uint32_t lanes,
+                                    uint32_t (*group)(const sha256d_ctx_t *, uint32_t, uint32_t))
+{
+    uint8_t hash[32];
+    uint32_t candidates = 0;
+    uint32_t i = 0;
+
+    memset(out_mask, 0, SHA256D_BATCH_MASK_WORDS(count) * sizeof(uint32_t));
+    for (; i + lanes <= count; i += lanes) {
+        uint32_t bits = group(ctx, nonce_start + i, max_top_word);
+        while (bits) {
+            uint32_t n = i + (uint32_t)__builtin_ctz(bits);
+            bits &= bits - 1;
+            out_mask[n / 32] |= 1u << (n % 32);
+            candidates++;
+        }
+    }
+    for (; i < count; i++) {
+        if (sha256d_check_nonce(ctx, nonce_start + i, max_top_word, hash)) {
+            out_mask[i / 32] |= 1u << (i % 32);
+            candidates++;
+        }
+    }
+    return candidates;
+}
+
+static uint32_t scan_x2(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                        uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_groups(ctx, nonce_start, count, max_top_word, out_mask, 2, sha256d_check_nonce_x2);
+}
+
+static uint32_t scan_x4(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                        uint32_t max_top_word, uint32_t *out_mask)
+{
+    return backend_scan_groups(ctx, nonce_start, count, max_top_word, out_mask, 4, sha256d_check_nonce_x4);
+}
+
+static uint32_t scan_simd(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                          uint32_t max_top_word, uint32_t *out_mask)
+{
+    sha256d_batch_job_t job;
+
+    job.ctx = *ctx;
+    job.max_top_word = max_top_word;
+    return sha256d_batch(&job, nonce_start, count, out_mask);
+}
+
+static bool simd_available(void)
+{
+    return sha256d_batch_detect() != SHA256D_BATCH_SCALAR;
+}
+
+static const hash_backend_t backends[] = {
+    { "reference", scan_reference, NULL },
+#ifdef ESP_PLATFORM
+    { "mbedtls",   scan_mbedtls,   NULL },
+#endif
+    { "unrolled",  scan_unrolled,  NULL },
+    { "midstate",  scan_midstate,  NULL },
+    { "precomp",   scan_precomp,   NULL },
+    { "reject",    scan_reject,    NULL },
+    { "x2",        scan_x2,        NULL },
+    { "x4",        scan_x4,        NULL },
+    { "simd",      scan_simd,      simd_available },
+};
+
+#define BACKEND_COUNT (sizeof(backends) / sizeof(backends[0]))
+
+_Static_assert(BACKEND_COUNT <= HASH_BACKEND_MAX, "raise HASH_BACKEND_MAX");
+
+size_t hash_backend_count(void)
+{
+    return BACKEND_COUNT;
+}
+
+const hash_backend_t *hash_backend_get(size_t index)
+{
+    return index < BACKEND_COUNT ? &backends[index] : NULL;
+}
+
+const hash_backend_t *hash_backend_find(const char *name)
+{
+    for (size_t i = 0; i < BACKEND_COUNT; i++) {
+        if (strcmp(backends[i].name, name) == 0) {
+            return &backends[i];
+        }
+    }
+    return NULL;
+}
+
+// Deterministic non-trivial header for the cross-check and benchmark
+static void backend_test_header(uint8_t *header)
+{
+    for (int i = 0; i < BLOCK_HEADER_SIZE; i++) {
+        header[i] = (uint8_t)(i * 37 + 11);
+    }
+}
+
+bool hash_backend_self_test(const hash_backend_t *backend)
+{
+    uint32_t mask[SHA256D_BATCH_MASK_WORDS(BACKEND_CHUNK)];
+    uint32_t expected[SHA256D_BATCH_MASK_WORDS(BACKEND_CHUNK)];
+    uint8_t header[BLOCK_HEADER_SIZE];
+    uint8_t hash[32];
+    sha256d_ctx_t ctx;
+    uint32_t want = 0;
+
+    // Genesis: exactly the winning nonce, at an odd offset so grouped
+    // kernels see it in a non-zero lane
+    sha256d_init(&ctx, genesis_header);
+    if (backend->scan(&ctx, GENESIS_NONCE - 37, 64, sha256d_top_word_limit(32), mask) != 1 ||
+        mask[0] != 0 || mask[1] != 1u << 5) {
+        return false;
+    }
+    // Single nonce (remainder path only)
+    if (backend->scan(&ctx, GENESIS_NONCE, 1, sha256d_top_word_limit(32), mask) != 1 || mask[0] != 1) {
+        return false;
+    }
+
+    // Cross-check against the generic double_sha256() on an uneven count
+    backend_test_header(header);
+    memset(expected, 0, sizeof(expected));
+    for (uint32_t i = 0; i < BACKEND_CHUNK - 3; i++) {
+        block_header_write_le32(&header[BLOCK_HEADER_NONCE_OFFSET], 1000 + i);
+        double_sha256(header, BLOCK_HEADER_SIZE, hash);
+        if (backend_hash_passes(hash, 0x0FFFFFFF)) {
+            expected[i / 32] |= 1u << (i % 32);
+            want++;
+        }
+    }
+    sha256d_init(&ctx, header);
+    if (backend->scan(&ctx, 1000, BACKEND_CHUNK - 3, 0x0FFFFFFF, mask) != want ||
+        memcmp(mask, expected, sizeof(mask)) != 0) {
+        return false;
+    }
+
+    // Every nonce passes the loosest limit
+    if (backend->scan(&ctx, 0xFFFFFFF0, 32, 0xFFFFFFFF, mask) != 32 || mask[0] != 0xFFFFFFFF) {
+        return false;
+    }
+    return true;
+}
+
+uint32_t hash_backend_measure(const hash_backend_t *backend, uint32_t nonces)
+{
+    uint32_t mask[SHA256D_BATCH_MASK_WORDS(BACKEND_CHUNK)];
+    uint8_t header[BLOCK_HEADER_SIZE];
+    sha256d_ctx_t ctx;
+
+    backend_test_header(header);
+    sha256d_init(&ctx, header);
+
+    MINER_PROFILE_BACKEND(backend);
+    uint64_t start = miner_time_us();
+    for (uint32_t done = 0; done < nonces; done += BACKEND_CHUNK) {
+        uint32_t count = nonces - done < BACKEND_CHUNK ? nonces - done : BACKEND_CHUNK;
+        MINER_PROFILE_START(t);
+        // Realistic share targets: (almost) everything is rejected
+        backend->scan(&ctx, done, count, 0, mask);
+        MINER_PROFILE_STOP(MINER_STAGE_SCAN, t, count);
+    }
+    uint64_t elapsed = miner_time_us() - start;
+
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+    return (uint32_t)((uint64_t)nonces * 1000000u / elapsed);
+}
+
+const hash_backend_t *hash_backend_select_from(const hash_backend_t *table, size_t count,
+                                               hash_backend_report_t *report, uint32_t bench_nonces)
+{
+    const hash_backend_t *best = NULL;
+    uint32_t best_rate = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const hash_backend_t *backend = &table[i];
+        hash_backend_report_t result = { backend, false, false, 0 };
+
+        result.available = backend->available == NULL || backend->available();
+        if (result.available) {
+            result.passed = hash_backend_self_test(backend);
+        }
+        if (result.passed) {
+            result.hashrate = hash_backend_measure(backend, bench_nonces);
+            if (best == NULL || result.hashrate > best_rate) {
+                best = backend;
+                best_rate = result.hashrate;
+            }
+        }
+        if (report != NULL) {
+            report[i] = result;
+        }
+    }
+    return best;
+}
+
+const hash_backend_t *hash_backend_select(hash_backend_report_t *report, uint32_t bench_nonces)
+{
+    return hash_backend_select_from(backends, BACKEND_COUNT, report, bench_nonces);
+}
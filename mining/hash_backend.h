@@ -0,0 +1,121 @@
+/**
+ * @file hash_backend.h
+ * @brief Registry of interchangeable SHA-256d hash backends
+ *
+ * Every kernel the miner can hash with is wrapped in the same "scan"
+ * interface: check a run of consecutive nonces against a top-word limit and
+ * report candidates as a bitmap. At boot, hash_backend_select() runs each
+ * available backend through known-answer self-tests (the genesis block and
+ * a cross-check against the generic double_sha256() reference), times the
+ * ones that pass and returns the fastest. A backend that fails its
+ * self-test is never returned.
+ */
+
+#ifndef __HASH_BACKEND_H__
+#define __HASH_BACKEND_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sha256d.h"
+#include "sha256d_batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Upper bound on hash_backend_count(), for sizing report arrays */
+#define HASH_BACKEND_MAX            12
+
+/** Default number of nonces each backend hashes in the boot benchmark */
+#define HASH_BACKEND_BENCH_NONCES   4096
+
+/**
+ * @brief Check a run of consecutive nonces
+ *
+ * The decision per nonce is the one made by sha256d_check_nonce(). Bit
+ * (i % 32) of out_mask[i / 32] is set if nonce_start + i is a candidate;
+ * out_mask must hold SHA256D_BATCH_MASK_WORDS(count) words and is fully
+ * written. The context may be modified (nonce word) but stays valid for
+ * the same job.
+ *
+ * @return Number of candidates
+ */
+typedef uint32_t (*hash_backend_scan_fn)(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                                         uint32_t max_top_word, uint32_t *out_mask);
+
+typedef struct {
+    const char *name;                   ///< Short name for logs
+    hash_backend_scan_fn scan;          ///< Nonce range checker
+    bool (*available)(void);            ///< Runtime availability, NULL if always available
+} hash_backend_t;
+
+typedef struct {
+    const hash_backend_t *backend;
+    bool available;                     ///< Usable on this CPU/build
+    bool passed;                        ///< Self-test passed
+    uint32_t hashrate;                  ///< Benchmark result in H/s (0 if not run)
+} hash_backend_report_t;
+
+/**
+ * @brief Number of registered backends
+ */
+size_t hash_backend_count(void);
+
+/**
+ * @brief Registered backend by index (0 is the generic reference)
+ *
+ * @return Backend, or NULL if index is out of range
+ */
+const hash_backend_t *hash_backend_get(size_t index);
+
+/**
+ * @brief Find a registered backend by name
+ *
+ * @return Backend, or NULL if there is none with that name
+ */
+const hash_backend_t *hash_backend_find(const char *name);
+
+/**
+ * @brief Run the known-answer self-tests on one backend
+ *
+ * @return true if every test passed
+ */
+bool hash_backend_self_test(const hash_backend_t *backend);
+
+/**
+ * @brief Measure a backend's hashrate on a fixed header
+ *
+ * @param backend Backend to time
+ * @param nonces Number of nonces to hash
+ * @return Hashrate in H/s
+ */
+uint32_t hash_backend_measure(const hash_backend_t *backend, uint32_t nonces);
+
+/**
+ * @brief Self-test and benchmark every backend, returning the fastest correct one
+ *
+ * @param report Optional array of hash_backend_count() entries filled with
+ *               per-backend results (for logging), or NULL
+ * @param bench_nonces Nonces per backend benchmark (HASH_BACKEND_BENCH_NONCES)
+ * @return Selected backend, or NULL if none passed its self-test
+ */
+const hash_backend_t *hash_backend_select(hash_backend_report_t *report, uint32_t bench_nonces);
+
+/**
+ * @brief hash_backend_select() over a caller-provided table
+ *
+ * @param table Backends to consider
+ * @param count Number of entries in table
+ * @param report Optional array of count entries, or NULL
+ * @param bench_nonces Nonces per backend benchmark
+ * @return Fastest backend that passed its self-test, or NULL
+ */
+const hash_backend_t *hash_backend_select_from(const hash_backend_t *table, size_t count,
+                                               hash_backend_report_t *report, uint32_t bench_nonces);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HASH_BACKEND_H__
@@ -0,0 +1,95 @@
+/**
+ * @file merkle.c
+ * @brief Streaming merkle tree builder for the coinbase branch
+ */
+
+#include "merkle.h"
+#include <string.h>
+#include "sha256.h"
+
+// SHA-256d of two nodes; out may be either of them
+static void hash_pair(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+    uint8_t pair[64];
+
+    memcpy(pair, left, 32);
+    memcpy(pair + 32, right, 32);
+    double_sha256(pair, sizeof(pair), out);
+}
+
+// Merge a complete subtree into the waiting left subtree of its level.
+// With count leaves covered once it is merged, the left one is the
+// coinbase side when nothing precedes it.
+static void merge(merkle_builder_t *merkle, uint32_t level, uint32_t count, uint8_t *node)
+{
+    if (count == 2u << level) {
+        memcpy(merkle->branch[level], node, 32);
+    } else {
+        hash_pair(merkle->pending[level], node, node);
+    }
+}
+
+void merkle_init(merkle_builder_t *merkle)
+{
+    merkle->count = 1;
+    merkle->depth = 0;
+}
+
+bool merkle_add(merkle_builder_t *merkle, const uint8_t *hash)
+{
+    uint32_t count = merkle->count;
+    uint32_t level = 0;
+    uint8_t node[32];
+
+    if (count >= MERKLE_LEAVES_MAX) {
+        return false;
+    }
+    memcpy(node, hash, 32);
+    merkle->count = count + 1;
+
+    // Bit n of count set: a complete subtree of 2^n leaves waits at level n
+    while ((count >> level) & 1) {
+        merge(merkle, level, count + 1, node);
+        if (count + 1 == 2u << level) {
+            return true;                                    // Nothing above the coinbase side is hashed
+        }
+        level++;
+    }
+    memcpy(merkle->pending[level], node, 32);
+    return true;
+}
+
+uint32_t merkle_finish(merkle_builder_t *merkle)
+{
+    uint32_t count = merkle->count;
+    uint32_t level = 0;
+    uint8_t node[32];
+
+    while (!((count >> level) & 1)) {
+        level++;
+    }
+    if (count != 1u << level) {
+        // Pair the last node of each odd level with itself until the
+        // rightmost subtree meets the coinbase side
+        memcpy(node, merkle->pending[level], 32);
+        while (count != 1u << level) {
+            hash_pair(node, node, node);
+            count += 1u << level;
+            level++;
+            while (!((count >> level) & 1)) {
+                merge(merkle, level, count, node);
+                level++;
+            }
+        }
+    }
+    merkle->depth = level;
+    return level;
+}
+
+void merkle_root(const merkle_builder_t *merkle, const uint8_t *leaf, uint8_t *root)
+{
+    memcpy(root, leaf, 32);
+    for (uint32_t i = 0; i < merkle->depth; i++) {
+        hash_pair(root, merkle->branch[i], root);
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * @file merkle.h
+ * @brief Streaming merkle tree builder for the coinbase branch
+ *
+ * A block's merkle root covers the coinbase and every transaction, but
+ * the miner only needs the coinbase's branch: the sibling at each level
+ * of the leftmost path. The builder takes the transaction hashes in
+ * block order, as a template parser meets them, and never holds the
+ * list:
+ *
+ * - each level keeps at most one pending hash, the left subtree waiting
+ *   for its right sibling; two equal subtrees are hashed together as
+ *   soon as the right one is complete;
+ * - a subtree that completes the coinbase side of a level is its branch
+ *   entry. The coinbase is not known yet (it holds the extranonce), so
+ *   nothing above it is hashed.
+ *
+ * The state is two hashes per level, about 1 KB for MERKLE_LEAVES_MAX
+ * leaves whatever the transaction count. merkle_finish() applies
+ * Bitcoin's rule for odd levels (the last node is paired with itself).
+ * The same builder fed wtxids gives the witness root with
+ * merkle_root(), the coinbase's wtxid being zero.
+ */
+
+#ifndef __MERKLE_H__
+#define __MERKLE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Deepest tree (branch length); matches WORK_MERKLE_MAX */
+#define MERKLE_DEPTH_MAX    16
+
+/** Most leaves, the coinbase included */
+#define MERKLE_LEAVES_MAX   (1u << MERKLE_DEPTH_MAX)
+
+typedef struct {
+    uint8_t pending[MERKLE_DEPTH_MAX][32];  ///< Left subtree waiting for its sibling, per level
+    uint8_t branch[MERKLE_DEPTH_MAX][32];   ///< Coinbase branch, lowest level first
+    uint32_t count;                         ///< Leaves so far, the coinbase included
+    uint32_t depth;                         ///< Branch length, once finished
+} merkle_builder_t;
+
+/**
+ * @brief Start a tree whose first leaf is the coinbase
+ */
+void merkle_init(merkle_builder_t *merkle);
+
+/**
+ * @brief Append the next transaction hash (internal byte order)
+ *
+ * @return false if the tree already has MERKLE_LEAVES_MAX leaves
+ */
+bool merkle_add(merkle_builder_t *merkle, const uint8_t *hash);
+
+/**
+ * @brief Complete the branch once every transaction was added
+ *
+ * @return Branch length: 0 for a coinbase alone, else ceil(log2(leaves))
+ */
+uint32_t merkle_finish(merkle_builder_t *merkle);
+
+/**
+ * @brief Merkle root for a given first leaf, from a finished builder
+ *
+ * @param merkle Finished builder
+ * @param leaf Coinbase hash (txid, or zero for the witness tree)
+ * @param root Output root, internal byte order
+ */
+void merkle_root(const merkle_builder_t *merkle, const uint8_t *leaf, uint8_t *root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MERKLE_H__
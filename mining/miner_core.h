@@ -0,0 +1,41 @@
+/**
+ * @file miner_core.h
+ * @brief Public header of the portable mining core
+ *
+ * The mining core has no ESP-IDF, FreeRTOS or driver dependencies: it is
+ * compiled into the firmware by main/CMakeLists.txt and builds as a plain
+ * static library on Linux (see mining/CMakeLists.txt) for host tests and
+ * benchmarks.
+ */
+
+#ifndef __MINER_CORE_H__
+#define __MINER_CORE_H__
+
+#include "address.h"
+#include "block_header.h"
+#include "gbt.h"
+#include "gbt_parser.h"
+#include "hash_backend.h"
+#include "merkle.h"
+#include "miner_ctx.h"
+#include "miner_port.h"
+#include "miner_profile.h"
+#include "miner_rates.h"
+#include "miner_sched.h"
+#include "miner_worker.h"
+#include "pool_conn.h"
+#include "sha256.h"
+#include "sha256d.h"
+#include "sha256d_batch.h"
+#include "sha256d_nway.h"
+#include "share_hist.h"
+#include "share_ring.h"
+#include "stratum.h"
+#include "stratum_parser.h"
+#include "sv2.h"
+#include "sv2_codec.h"
+#include "target.h"
+#include "version_rolling.h"
+#include "work.h"
+
+#endif // __MINER_CORE_H__
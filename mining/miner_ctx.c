@@ -0,0 +1,312 @@
+/**
+ * @file miner_ctx.c
+ * @brief Reentrant miner: one job, its workers, scheduler and counters
+ */
+
+#include "miner_ctx.h"
+#include <stdio.h>
+#include <string.h>
+#include "block_header.h"
+#include "miner_profile.h"
+#include "target.h"
+
+// Nonces between cooperative yields of a worker
+#define MINER_YIELD_NONCES  1024
+
+void miner_ctx_init(miner_ctx_t *miner, const hash_backend_t *backend, uint32_t workers)
+{
+    memset(miner, 0, sizeof(*miner));
+    if (workers < 1) {
+        workers = 1;
+    }
+    if (workers > MINER_MAX_WORKERS) {
+        workers = MINER_MAX_WORKERS;
+    }
+    miner->backend = backend;
+    miner->worker_count = workers;
+    for (uint32_t i = 0; i < workers; i++) {
+        miner_worker_init(&miner->workers[i], i);
+        share_ring_init(&miner->shares[i]);
+    }
+    for (uint32_t i = 0; i < MINER_JOB_SLOTS; i++) {
+        miner->jobs[i].slot = i;
+        miner_sched_init(&miner->jobs[i].sched);
+    }
+    // No job yet: an empty one that workers finish at once
+    miner->current = &miner->jobs[0];
+    miner_stats_reset(&miner->stats, miner->workers, workers);
+    miner_rates_init(&miner->rates, miner->workers, workers, miner_time_us());
+}
+
+void miner_ctx_set_share_callback(miner_ctx_t *miner, miner_share_cb cb, void *arg)
+{
+    miner->on_share = cb;
+    miner->share_arg = arg;
+}
+
+// Share target of a job from its block target and a share difficulty
+static void miner_update_share_target(miner_job_t *job, double difficulty)
+{
+    if (difficulty > 0) {
+        target_from_difficulty(difficulty, &job->share_target);
+    } else {
+        job->share_target = job->block_target;
+    }
+    job->share_floor = share_hist_floor(target_difficulty(&job->share_target));
+}
+
+void miner_ctx_set_share_difficulty(miner_ctx_t *miner, double difficulty)
+{
+    miner->share_difficulty = difficulty;
+    miner_update_share_target(miner_ctx_job(miner), difficulty);
+}
+
+miner_job_t *miner_ctx_prepare(miner_ctx_t *miner)
+{
+    miner_job_t *current = __atomic_load_n(&miner->current, __ATOMIC_SEQ_CST);
+    miner_job_t *spare = &miner->jobs[(current->slot + 1) % MINER_JOB_SLOTS];
+
+    for (uint32_t i = 0; i < miner->worker_count; i++) {
+        if (__atomic_load_n(&miner->held[i], __ATOMIC_SEQ_CST) == spare) {
+            return NULL;
+        }
+    }
+    return spare;
+}
+
+void miner_ctx_build(miner_ctx_t *miner, miner_job_t *job, const work_template_t *work, double share_difficulty)
+{
+    uint8_t header[BLOCK_HEADER_SIZE];
+
+    job->work = *work;
+    job->rolls = work_rolls(work);
+    work_header(work, 0, header);
+    sha256d_init(&job->engine, header);
+    // Invalid nBits leave a zero block target that no hash meets
+    target_from_bits(work->header.bits, &job->block_target);
+    miner_update_share_target(job, share_difficulty);
+    miner_sched_reset(&job->sched, miner->worker_count, MINER_SCHED_CHUNK, 0, (uint64_t)job->rolls << 32);
+}
+
+void miner_ctx_publish(miner_ctx_t *miner, miner_job_t *job, bool clean)
+{
+    job->id = ++miner->job_count;
+    job->clean = clean;
+    job->published_us = miner_time_us();
+    // The job carries its sequence: a worker that takes it before the bump
+    // below must not see the bump as a newer clean job
+    job->clean_seq = miner->clean_seq + (clean ? 1 : 0);
+    __atomic_store_n(&miner->current, job, __ATOMIC_SEQ_CST);
+    if (clean) {
+        // After the job: a worker aborting for it finds it already current
+        __atomic_store_n(&miner->clean_seq, job->clean_seq, __ATOMIC_RELEASE);
+    }
+}
+
+void miner_ctx_set_work(miner_ctx_t *miner, const work_template_t *work)
+{
+    // Stopped: no worker holds the spare slot
+    miner_job_t *job = miner_ctx_prepare(miner);
+
+    miner_ctx_build(miner, job, work, miner->share_difficulty);
+    miner_ctx_publish(miner, job, false);
+}
+
+void miner_ctx_set_job(miner_ctx_t *miner, const uint8_t *header)
+{
+    block_header_t fields;
+    work_template_t work;
+
+    block_header_parse(header, &fields);
+    work_init(&work, &fields, WORK_NTIME_ROLL_DEFAULT);
+    miner_ctx_set_work(miner, &work);
+}
+
+void miner_ctx_set_range(miner_ctx_t *miner, uint64_t start, uint64_t count, uint32_t chunk)
+{
+    miner_sched_reset(&miner_ctx_job(miner)->sched, miner->worker_count, chunk, start, count);
+}
+
+// Full digest for a candidate; report it if it is a share or the worker's best.
+// Reporting is a ring push, so a share never holds the worker up.
+static void miner_check_candidate(miner_ctx_t *miner, const miner_job_t *job, miner_worker_t *worker,
+                                  uint32_t nonce)
+{
+    miner_share_t share;
+    work_roll_t roll;
+    MINER_PROFILE_START(t);
+
+    sha256d_hash_nonce(&worker->ctx, nonce, share.hash);
+    share.meets_share = target_hash_meets(share.hash, &job->share_target);
+    share.new_best = miner_worker_offer_best(worker, share.hash);
+    if (!share.meets_share && !share.new_best) {
+        MINER_PROFILE_STOP(MINER_STAGE_TARGET, t, 1);
+        return;
+    }
+    work_roll(&job->work, worker->roll, &roll);
+    share.worker = worker->id;
+    share.job_id = worker->job_id;
+    share.job_slot = job->slot;
+    share.version = roll.version;
+    share.ntime = roll.ntime;
+    share.extranonce2 = roll.extranonce2;
+    share.nonce = nonce;
+    share.meets_block = target_hash_meets(share.hash, &job->block_target);
+    share.difficulty = target_hash_difficulty(share.hash);
+    // Counted here, not by the consumer: a full ring must not bias the histogram
+    if (share.meets_share) {
+        share_hist_add(&worker->share_hist, share.difficulty);
+    }
+    miner_worker_count_share(worker, share_ring_push(&miner->shares[worker->id], &share));
+    if (miner->on_share != NULL) {
+        miner->on_share(miner, &share, miner->share_arg);
+    }
+    MINER_PROFILE_STOP(MINER_STAGE_TARGET, t, 1);
+}
+
+// Take the current job: announce it, then check it is still current, so
+// miner_ctx_prepare() cannot hand its slot out while we load it
+static miner_job_t *miner_acquire_job(miner_ctx_t *miner, miner_worker_t *worker)
+{
+    miner_job_t *job;
+
+    do {
+        job = __atomic_load_n(&miner->current, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&miner->held[worker->id], job, __ATOMIC_SEQ_CST);
+    } while (job != __atomic_load_n(&miner->current, __ATOMIC_SEQ_CST));
+
+    miner_worker_load(worker, job->id, &job->engine);
+    share_hist_start_job(&worker->share_hist, job->id, job->share_floor);
+    return job;
+}
+
+IRAM_ATTR void miner_ctx_run_worker(miner_ctx_t *miner, uint32_t id)
+{
+    miner_worker_t *worker = &miner->workers[id];
+    miner_job_t *job = miner_acquire_job(miner, worker);
+    uint32_t share_top = target_top_word(&job->share_target);
+    uint32_t since_yield = 0;
+    uint64_t pos;
+    uint32_t count;
+
+    MINER_PROFILE_BACKEND(miner->backend);
+    while (!__atomic_load_n(&miner->stop, __ATOMIC_RELAXED)) {
+        MINER_PROFILE_START(t);
+
+        // A newer job replaces this one at a chunk boundary
+        if (__atomic_load_n(&miner->current, __ATOMIC_ACQUIRE) != job) {
+            job = miner_acquire_job(miner, worker);
+            share_top = target_top_word(&job->share_target);
+            miner_worker_count_switch(worker, (uint32_t)(miner_time_us() - job->published_us), job->clean);
+        }
+        if (!miner_sched_next(&job->sched, id, &pos, &count)) {
+            if (__atomic_load_n(&miner->current, __ATOMIC_ACQUIRE) != job) {
+                continue;
+            }
+            break;
+        }
+        MINER_PROFILE_STOP(MINER_STAGE_BOOKKEEPING, t, 1);
+        uint32_t nonce = (uint32_t)pos;
+
+        // Our range ran into the next header variant, or we stole from one
+        if ((uint32_t)(pos >> 32) != worker->roll) {
+            miner_worker_roll(worker, &job->work, (uint32_t)(pos >> 32));
+        }
+        for (uint32_t done = 0; done < count; done += MINER_WORKER_CHUNK) {
+            uint32_t n = count - done < MINER_WORKER_CHUNK ? count - done : MINER_WORKER_CHUNK;
+            uint32_t best_top = miner_worker_best_top_word(worker);
+            uint32_t limit = best_top > share_top ? best_top : share_top;
+            uint32_t candidates;
+
+            // A newer clean job makes the rest of this chunk stale
+            if ((int32_t)(__atomic_load_n(&miner->clean_seq, __ATOMIC_ACQUIRE) - job->clean_seq) > 0) {
+                break;
+            }
+            miner_worker_scan(worker, miner->backend, nonce + done, n, limit, &candidates);
+            while (candidates) {
+                uint32_t lane = (uint32_t)__builtin_ctz(candidates);
+                candidates &= candidates - 1;
+                miner_check_candidate(miner, job, worker, nonce + done + lane);
+            }
+        }
+
+        since_yield += count;
+        if (since_yield >= MINER_YIELD_NONCES) {
+            since_yield = 0;
+            miner_yield();
+        }
+    }
+    __atomic_store_n(&miner->held[id], NULL, __ATOMIC_SEQ_CST);
+}
+
+static void miner_thread_main(void *param)
+{
+    miner_thread_arg_t *arg = (miner_thread_arg_t *)param;
+
+    miner_ctx_run_worker(arg->miner, arg->worker);
+    __atomic_fetch_sub(&arg->miner->running, 1, __ATOMIC_RELEASE);
+}
+
+bool miner_ctx_start(miner_ctx_t *miner)
+{
+    __atomic_store_n(&miner->stop, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&miner->running, miner->worker_count, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < miner->worker_count; i++) {
+        char name[sizeof("mining_") + 20];
+
+        snprintf(name, sizeof(name), "mining_%lu", (unsigned long)i);
+        miner->thread_args[i].miner = miner;
+        miner->thread_args[i].worker = i;
+        if (!miner_thread_start(&miner->threads[i], miner_thread_main, &miner->thread_args[i], name, i)) {
+            // Roll back: account for the threads that never started
+            __atomic_fetch_sub(&miner->running, miner->worker_count - i, __ATOMIC_RELEASE);
+            miner_ctx_stop(miner);
+            for (uint32_t j = 0; j < i; j++) {
+                miner_thread_join(&miner->threads[j]);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+void miner_ctx_stop(miner_ctx_t *miner)
+{
+    __atomic_store_n(&miner->stop, true, __ATOMIC_RELAXED);
+}
+
+bool miner_ctx_running(const miner_ctx_t *miner)
+{
+    return __atomic_load_n(&miner->running, __ATOMIC_ACQUIRE) != 0;
+}
+
+void miner_ctx_wait(miner_ctx_t *miner)
+{
+    for (uint32_t i = 0; i < miner->worker_count; i++) {
+        miner_thread_join(&miner->threads[i]);
+    }
+}
+
+bool miner_ctx_take_share(miner_ctx_t *miner, miner_share_t *share)
+{
+    for (uint32_t i = 0; i < miner->worker_count; i++) {
+        uint32_t worker = (miner->share_next + i) % miner->worker_count;
+
+        if (share_ring_pop(&miner->shares[worker], share)) {
+            miner->share_next = worker + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t miner_ctx_collect(miner_ctx_t *miner)
+{
+    return miner_stats_collect(&miner->stats, miner->workers, miner->worker_count);
+}
+
+void miner_ctx_update_rates(miner_ctx_t *miner)
+{
+    miner_rates_update(&miner->rates, miner->workers, miner->worker_count, miner_time_us());
+}
@@ -0,0 +1,287 @@
+/**
+ * @file miner_ctx.h
+ * @brief Reentrant miner: one job, its workers, scheduler and counters
+ *
+ * A miner_ctx_t owns everything the mining path needs - the current job
+ * (header and cached midstate), the hash backend, per-worker engine copies
+ * and counters, and the work-stealing scheduler - so several miners can run
+ * side by side (e.g. one per job in tests or host benchmarks). Worker
+ * threads are started through the miner_port.h layer: pinned FreeRTOS
+ * tasks on the board, pthreads on the host.
+ *
+ * Lifecycle: miner_ctx_init() once, then for each job miner_ctx_set_work()
+ * (or miner_ctx_set_job() for a bare header), miner_ctx_start(), and
+ * miner_ctx_wait(). The wait returns when every header variant of the job
+ * is exhausted, or after miner_ctx_stop(). A worker that runs out of nonces
+ * in one variant continues in the next one (version bits, then ntime, then
+ * extranonce2; see work.h) without waiting for the others.
+ *
+ * Jobs can also be replaced while the workers run. Jobs are double-buffered:
+ * workers mine the current slot while another thread (the pool task)
+ * prepares the spare one with miner_ctx_prepare() and miner_ctx_build():
+ * template, coinbase, merkle root, header words, midstate, precomputed
+ * schedule, targets and a fresh scheduler. miner_ctx_publish() then swaps
+ * the current pointer. Workers look at the pointer between scheduler
+ * chunks and move to the new job there. A job published as clean also
+ * aborts the chunk in progress at the next MINER_WORKER_CHUNK boundary.
+ * Every worker records how long after publication it switched, so the
+ * abort latency can be measured (miner_stats_reader_t).
+ *
+ * A slot is never rebuilt while a worker still uses it: each worker
+ * announces the slot it mines (a hazard pointer), and miner_ctx_prepare()
+ * returns NULL until the spare slot is released.
+ *
+ * Shares leave the workers through one lock-free ring per worker
+ * (share_ring.h): reporting a share costs the worker a copy and a store,
+ * and whoever handles it - logging, submitting, the display - runs in the
+ * consumer's task through miner_ctx_take_share().
+ */
+
+#ifndef __MINER_CTX_H__
+#define __MINER_CTX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hash_backend.h"
+#include "miner_port.h"
+#include "miner_rates.h"
+#include "miner_sched.h"
+#include "miner_worker.h"
+#include "sha256d.h"
+#include "share_ring.h"
+#include "target.h"
+#include "work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Job buffers: the one the workers mine and the one being prepared */
+#define MINER_JOB_SLOTS         2
+
+typedef struct miner_ctx miner_ctx_t;
+
+/**
+ * @brief Called from a worker thread for every hash that meets the share
+ *        target or beats the worker's best so far
+ *
+ * Optional, and it runs on the hash path: keep it to a few instructions.
+ * The same shares are pushed to the worker's share ring either way;
+ * anything slower (logging, sockets, the display) belongs to the ring's
+ * consumer (miner_ctx_take_share()).
+ *
+ * @param miner Miner the worker belongs to
+ * @param share The hash and how it compares to the targets
+ * @param arg User argument from miner_ctx_set_share_callback()
+ */
+typedef void (*miner_share_cb)(miner_ctx_t *miner, const miner_share_t *share, void *arg);
+
+typedef struct {
+    uint32_t id;                        ///< Incremented by every publication
+    uint32_t slot;                      ///< Index in miner_ctx_t.jobs
+    work_template_t work;               ///< Header variants of the job
+    uint32_t rolls;                     ///< work_rolls() of the template
+    sha256d_ctx_t engine;               ///< Roll 0: header words, midstate and tail precomputation
+    target_t block_target;              ///< Expanded from the header's nBits
+    target_t share_target;              ///< From the share difficulty, or the block target
+    uint32_t share_floor;               ///< share_hist_floor() of the share target's difficulty
+    bool clean;                         ///< Published with clean_jobs
+    uint32_t clean_seq;                 ///< miner_ctx_t.clean_seq once this job is published
+    uint64_t published_us;              ///< miner_time_us() at publication
+    miner_sched_t sched;                ///< Positions of this job
+} miner_job_t;
+
+typedef struct {
+    miner_ctx_t *miner;
+    uint32_t worker;
+} miner_thread_arg_t;
+
+struct miner_ctx {
+    miner_job_t jobs[MINER_JOB_SLOTS];
+    miner_job_t *current;               ///< Job the workers mine (atomic access)
+    miner_job_t *held[MINER_MAX_WORKERS]; ///< Job each worker uses, NULL when idle (atomic access)
+    uint32_t clean_seq;                 ///< Bumped by every clean publication, after it (atomic access)
+    uint32_t job_count;                 ///< Jobs published
+    const hash_backend_t *backend;
+    uint32_t worker_count;
+    miner_worker_t workers[MINER_MAX_WORKERS];
+    miner_thread_t threads[MINER_MAX_WORKERS];
+    miner_thread_arg_t thread_args[MINER_MAX_WORKERS];
+    miner_stats_reader_t stats;         ///< Owned by the thread calling miner_ctx_collect()
+    miner_rates_t rates;                ///< Owned by the thread calling miner_ctx_update_rates()
+    share_ring_t shares[MINER_MAX_WORKERS]; ///< Found shares, one ring per worker
+    uint32_t share_next;                ///< Ring miner_ctx_take_share() looks at first (consumer only)
+    miner_share_cb on_share;
+    void *share_arg;
+    double share_difficulty;            ///< Pool share difficulty (0: block target)
+    bool stop;                          ///< Stop request (atomic access)
+    uint32_t running;                   ///< Live worker threads (atomic access)
+};
+
+/**
+ * @brief Initialize a miner
+ *
+ * @param miner Miner to initialize
+ * @param backend Hash backend the workers scan with
+ * @param workers Number of workers (clamped to 1 .. MINER_MAX_WORKERS)
+ */
+void miner_ctx_init(miner_ctx_t *miner, const hash_backend_t *backend, uint32_t workers);
+
+/**
+ * @brief Register the share callback (before miner_ctx_start())
+ */
+void miner_ctx_set_share_callback(miner_ctx_t *miner, miner_share_cb cb, void *arg);
+
+/**
+ * @brief Set the pool share difficulty for this and later jobs (while stopped)
+ *
+ * @param miner Miner
+ * @param difficulty Share difficulty; 0 makes the block target the share target
+ */
+void miner_ctx_set_share_difficulty(miner_ctx_t *miner, double difficulty);
+
+/**
+ * @brief Load a new job covering every nonce of every roll (while stopped)
+ *
+ * Expands the header's nBits into the block target and the share
+ * difficulty into the share target, once per job.
+ *
+ * @param miner Miner
+ * @param work Job template (copied)
+ */
+void miner_ctx_set_work(miner_ctx_t *miner, const work_template_t *work);
+
+/**
+ * @brief Load a bare header as a job that rolls ntime by up to
+ *        WORK_NTIME_ROLL_DEFAULT seconds (while stopped)
+ *
+ * @param miner Miner
+ * @param header 80-byte serialized header
+ */
+void miner_ctx_set_job(miner_ctx_t *miner, const uint8_t *header);
+
+/**
+ * @brief The job the workers mine (or were last given)
+ */
+static inline miner_job_t *miner_ctx_job(miner_ctx_t *miner)
+{
+    return __atomic_load_n(&miner->current, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Get the spare job slot to build the next job in (safe while running)
+ *
+ * Only one thread may prepare and publish jobs.
+ *
+ * @param miner Miner
+ * @return The spare slot, or NULL while a worker still mines it (it is
+ *         released at the worker's next chunk; try again later)
+ */
+miner_job_t *miner_ctx_prepare(miner_ctx_t *miner);
+
+/**
+ * @brief Build a job in a prepared slot, off the workers' path
+ *
+ * Copies the template and precomputes everything the workers need:
+ * engine state of roll 0 (coinbase, merkle root, header words, midstate
+ * and tail schedule), block and share targets, and a scheduler over every
+ * nonce of every roll.
+ *
+ * @param miner Miner
+ * @param job Slot from miner_ctx_prepare()
+ * @param work Job template (copied)
+ * @param share_difficulty Share difficulty; 0 makes the block target the share target
+ */
+void miner_ctx_build(miner_ctx_t *miner, miner_job_t *job, const work_template_t *work, double share_difficulty);
+
+/**
+ * @brief Make a built job the current one (safe while running)
+ *
+ * Running workers move to it after their current scheduler chunk, or, for
+ * a clean job, after their current MINER_WORKER_CHUNK nonces.
+ *
+ * @param miner Miner
+ * @param job Slot from miner_ctx_prepare(), built
+ * @param clean Abort work on older jobs as soon as possible
+ */
+void miner_ctx_publish(miner_ctx_t *miner, miner_job_t *job, bool clean);
+
+/**
+ * @brief Restrict the current job to count positions from start (while stopped)
+ *
+ * @param miner Miner
+ * @param start First position (roll << 32 | nonce)
+ * @param count Number of positions
+ * @param chunk Nonces per scheduler chunk
+ */
+void miner_ctx_set_range(miner_ctx_t *miner, uint64_t start, uint64_t count, uint32_t chunk);
+
+/**
+ * @brief Start one thread per worker
+ *
+ * @return false if a thread could not be created (already started ones
+ *         are stopped and joined)
+ */
+bool miner_ctx_start(miner_ctx_t *miner);
+
+/**
+ * @brief Worker body: mine until the job is exhausted or a stop is requested
+ *
+ * Called by the threads miner_ctx_start() creates; may also be called
+ * directly to mine single-threaded.
+ */
+void miner_ctx_run_worker(miner_ctx_t *miner, uint32_t worker);
+
+/**
+ * @brief Ask all workers to return after their current chunk
+ */
+void miner_ctx_stop(miner_ctx_t *miner);
+
+/**
+ * @brief true while any worker thread is still mining
+ */
+bool miner_ctx_running(const miner_ctx_t *miner);
+
+/**
+ * @brief Join all worker threads
+ */
+void miner_ctx_wait(miner_ctx_t *miner);
+
+/**
+ * @brief Take the oldest share of the next worker that has one
+ *
+ * The consumer side of the workers' share rings: call it from one thread
+ * only (the pool, node or supervisor task), as often as shares should be
+ * handled. Workers never wait for it; a ring that fills up drops shares
+ * (miner_stats_reader_t.shares_dropped). Rings are visited round-robin,
+ * so one busy worker cannot starve the others.
+ *
+ * A share can outlive its job's slot: when it matters, check
+ * share->job_id against the job the slot now holds.
+ *
+ * @param miner Miner
+ * @param share Output share
+ * @return false if no worker has a share waiting
+ */
+bool miner_ctx_take_share(miner_ctx_t *miner, miner_share_t *share);
+
+/**
+ * @brief Merge the workers' counters into miner->stats
+ *
+ * @return Hashes since the previous call
+ */
+uint64_t miner_ctx_collect(miner_ctx_t *miner);
+
+/**
+ * @brief Update miner->rates from the workers' totals
+ *
+ * Hashrates over the interval since the previous call and the moving
+ * averages (see miner_rates.h); the averages start at miner_ctx_init().
+ */
+void miner_ctx_update_rates(miner_ctx_t *miner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MINER_CTX_H__
@@ -0,0 +1,79 @@
+/**
+ * @file miner_port.c
+ * @brief FreeRTOS and pthread implementations of the miner thread shims
+ */
+
+#include "miner_port.h"
+#include <stddef.h>
+
+#ifdef ESP_PLATFORM
+
+uint32_t miner_cpu_count(void)
+{
+    return portNUM_PROCESSORS;
+}
+
+static void miner_thread_entry(void *param)
+{
+    miner_thread_t *thread = (miner_thread_t *)param;
+
+    thread->fn(thread->arg);
+    xSemaphoreGive(thread->done);
+    vTaskDelete(NULL);
+}
+
+bool miner_thread_start(miner_thread_t *thread, void (*fn)(void *arg), void *arg, const char *name, uint32_t core)
+{
+    thread->fn = fn;
+    thread->arg = arg;
+    thread->done = xSemaphoreCreateBinary();
+    if (thread->done == NULL) {
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(miner_thread_entry, name, MINER_THREAD_STACK, thread, MINER_THREAD_PRIORITY,
+                                &thread->task, (BaseType_t)(core % portNUM_PROCESSORS)) != pdPASS) {
+        vSemaphoreDelete(thread->done);
+        return false;
+    }
+    return true;
+}
+
+void miner_thread_join(miner_thread_t *thread)
+{
+    xSemaphoreTake(thread->done, portMAX_DELAY);
+    vSemaphoreDelete(thread->done);
+}
+
+#else
+
+#include <unistd.h>
+
+uint32_t miner_cpu_count(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (uint32_t)cpus : 1;
+}
+
+static void *miner_thread_entry(void *param)
+{
+    miner_thread_t *thread = (miner_thread_t *)param;
+
+    thread->fn(thread->arg);
+    return NULL;
+}
+
+bool miner_thread_start(miner_thread_t *thread, void (*fn)(void *arg), void *arg, const char *name, uint32_t core)
+{
+    (void)name;
+    (void)core;
+    thread->fn = fn;
+    thread->arg = arg;
+    return pthread_create(&thread->thread, NULL, miner_thread_entry, thread) == 0;
+}
+
+void miner_thread_join(miner_thread_t *thread)
+{
+    pthread_join(thread->thread, NULL);
+}
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * @file miner_port.h
+ * @brief Platform shims that let the mining core build under ESP-IDF and on a host
+ *
+ * ESP-IDF builds define ESP_PLATFORM; everything else is treated as a
+ * POSIX host (Linux) used for unit tests and benchmarks. Besides memory
+ * placement, time and the CPU cycle counter, this provides the small OS
+ * layer the scheduler needs: a short-hold lock, threads that can be
+ * joined, and a cooperative yield.
+ * On the board these map to FreeRTOS spinlocks and pinned tasks, on the
+ * host to pthreads.
+ */
+
+#ifndef __MINER_PORT_H__
+#define __MINER_PORT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <time.h>
+// Memory placement attributes are meaningless on the host
+#define IRAM_ATTR
+#define DRAM_ATTR
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Stack size of mining threads on FreeRTOS (bytes) */
+#ifndef MINER_THREAD_STACK
+#define MINER_THREAD_STACK      8192
+#endif
+
+/** Priority of mining threads on FreeRTOS */
+#ifndef MINER_THREAD_PRIORITY
+#define MINER_THREAD_PRIORITY   5
+#endif
+
+/**
+ * @brief Monotonic time in microseconds
+ */
+static inline uint64_t miner_time_us(void)
+{
+#ifdef ESP_PLATFORM
+    return (uint64_t)esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+#endif
+}
+
+/**
+ * @brief Free-running CPU cycle counter of the calling core (wrapping)
+ *
+ * CCOUNT on the board; the TSC on x86 hosts, nanoseconds elsewhere. Only
+ * differences over a short interval on one thread are meaningful.
+ */
+static inline uint32_t miner_cycles(void)
+{
+#ifdef ESP_PLATFORM
+    return (uint32_t)esp_cpu_get_cycle_count();
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+/**
+ * @brief Lock for short critical sections shared between cores
+ *
+ * Hold it for a handful of instructions only: on FreeRTOS it is a spinlock
+ * that also masks interrupts on the holding core.
+ */
+#ifdef ESP_PLATFORM
+typedef portMUX_TYPE miner_lock_t;
+#else
+typedef pthread_mutex_t miner_lock_t;
+#endif
+
+static inline void miner_lock_init(miner_lock_t *lock)
+{
+#ifdef ESP_PLATFORM
+    portMUX_INITIALIZE(lock);
+#else
+    pthread_mutex_init(lock, NULL);
+#endif
+}
+
+static inline void miner_lock(miner_lock_t *lock)
+{
+#ifdef ESP_PLATFORM
+    portENTER_CRITICAL(lock);
+#else
+    pthread_mutex_lock(lock);
+#endif
+}
+
+static inline void miner_unlock(miner_lock_t *lock)
+{
+#ifdef ESP_PLATFORM
+    portEXIT_CRITICAL(lock);
+#else
+    pthread_mutex_unlock(lock);
+#endif
+}
+
+/**
+ * @brief Give other tasks on this core a chance to run (feeds the idle
+ * task watchdog on FreeRTOS; no-op on the host)
+ */
+static inline void miner_yield(void)
+{
+#ifdef ESP_PLATFORM
+    vTaskDelay(1);
+#endif
+}
+
+/**
+ * @brief Number of cores available for mining threads
+ */
+uint32_t miner_cpu_count(void);
+
+/**
+ * @brief Joinable thread
+ */
+typedef struct {
+    void (*fn)(void *arg);
+    void *arg;
+#ifdef ESP_PLATFORM
+    TaskHandle_t task;
+    SemaphoreHandle_t done;
+#else
+    pthread_t thread;
+#endif
+} miner_thread_t;
+
+/**
+ * @brief Start a thread running fn(arg)
+ *
+ * @param thread Thread handle (must stay valid until joined)
+ * @param fn Thread body
+ * @param arg Argument passed to fn
+ * @param name Task name (FreeRTOS)
+ * @param core Core to pin to (FreeRTOS; taken modulo the core count)
+ * @return true if the thread was started
+ */
+bool miner_thread_start(miner_thread_t *thread, void (*fn)(void *arg), void *arg, const char *name, uint32_t core);
+
+/**
+ * @brief Wait for a thread started with miner_thread_start() to return
+ */
+void miner_thread_join(miner_thread_t *thread);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MINER_PORT_H__
@@ -0,0 +1,165 @@
+/**
+ * @file miner_profile.c
+ * @brief Opt-in per-stage cycle histograms of the hashing pipeline
+ */
+
+#include "miner_profile.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const stage_names[MINER_STAGE_COUNT] = {
+    "scan", "block2", "digest", "target", "header", "bookkeeping",
+};
+
+const char *miner_profile_stage_name(miner_stage_t stage)
+{
+    return stage < MINER_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+#if MINER_PROFILE
+
+// miner_profile_stage_t with the cycle sum as two 32-bit words
+typedef struct {
+    uint32_t calls;
+    uint32_t items;
+    uint32_t cycles[2];                 ///< Sum of the measurements (low, high word)
+    uint32_t max;
+    uint32_t buckets[MINER_PROFILE_BUCKETS];
+} profile_table_t;
+
+static profile_table_t tables[HASH_BACKEND_MAX][MINER_STAGE_COUNT];
+
+// Backend the calling thread scans with (index in the registry, -1: none)
+static __thread const hash_backend_t *thread_backend;
+static __thread int thread_index = -1;
+
+void miner_profile_set_backend(const hash_backend_t *backend)
+{
+    if (backend == thread_backend) {
+        return;
+    }
+    thread_backend = backend;
+    thread_index = -1;
+    for (size_t i = 0; i < hash_backend_count(); i++) {
+        if (hash_backend_get(i) == backend) {
+            thread_index = (int)i;
+            break;
+        }
+    }
+}
+
+IRAM_ATTR void miner_profile_record(miner_stage_t stage, uint32_t cycles, uint32_t items)
+{
+    profile_table_t *t;
+    uint32_t low;
+    uint32_t max;
+
+    if (thread_index < 0) {
+        return;
+    }
+    t = &tables[thread_index][stage];
+    __atomic_fetch_add(&t->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->items, items, __ATOMIC_RELAXED);
+    low = __atomic_fetch_add(&t->cycles[0], cycles, __ATOMIC_RELAXED);
+    if (low + cycles < low) {
+        __atomic_fetch_add(&t->cycles[1], 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&t->buckets[miner_profile_bucket(cycles)], 1, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&t->max, __ATOMIC_RELAXED);
+    while (cycles > max &&
+           !__atomic_compare_exchange_n(&t->max, &max, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+bool miner_profile_read(size_t backend, miner_stage_t stage, miner_profile_stage_t *out)
+{
+    const profile_table_t *t;
+    uint32_t high;
+
+    if (backend >= HASH_BACKEND_MAX || stage >= MINER_STAGE_COUNT) {
+        return false;
+    }
+    t = &tables[backend][stage];
+    out->calls = __atomic_load_n(&t->calls, __ATOMIC_RELAXED);
+    out->items = __atomic_load_n(&t->items, __ATOMIC_RELAXED);
+    // Retry if a carry lands between the words; a carry still on its way
+    // from another core can only make the sum lag by 2^32 for a moment
+    do {
+        high = __atomic_load_n(&t->cycles[1], __ATOMIC_RELAXED);
+        out->cycles = (uint64_t)high << 32 | __atomic_load_n(&t->cycles[0], __ATOMIC_RELAXED);
+    } while (__atomic_load_n(&t->cycles[1], __ATOMIC_RELAXED) != high);
+    out->max = __atomic_load_n(&t->max, __ATOMIC_RELAXED);
+    for (int i = 0; i < MINER_PROFILE_BUCKETS; i++) {
+        out->buckets[i] = __atomic_load_n(&t->buckets[i], __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+void miner_profile_reset(void)
+{
+    // Word by word, as the probes may be running
+    uint32_t *words = (uint32_t *)tables;
+
+    for (size_t i = 0; i < sizeof(tables) / sizeof(uint32_t); i++) {
+        __atomic_store_n(&words[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+void miner_profile_dump(miner_profile_print_fn print, void *arg)
+{
+    char line[160];
+
+    for (size_t b = 0; b < hash_backend_count() && b < HASH_BACKEND_MAX; b++) {
+        bool header = false;
+
+        for (int s = 0; s < MINER_STAGE_COUNT; s++) {
+            miner_profile_stage_t stage;
+            size_t len;
+
+            miner_profile_read(b, (miner_stage_t)s, &stage);
+            if (stage.calls == 0) {
+                continue;
+            }
+            if (!header) {
+                snprintf(line, sizeof(line), "profile %s: stage calls items cycles/item max | log2(cycles):calls",
+                         hash_backend_get(b)->name);
+                print(line, arg);
+                header = true;
+            }
+            // Tenths of a cycle per item, in integers
+            uint64_t tenths = stage.items != 0 ? stage.cycles * 10 / stage.items : 0;
+            len = (size_t)snprintf(line, sizeof(line), "  %s %lu %lu %llu.%llu %lu |",
+                                   stage_names[s], (unsigned long)stage.calls, (unsigned long)stage.items,
+                                   (unsigned long long)(tenths / 10), (unsigned long long)(tenths % 10),
+                                   (unsigned long)stage.max);
+            for (int i = 0; i < MINER_PROFILE_BUCKETS && len < sizeof(line); i++) {
+                if (stage.buckets[i] != 0) {
+                    len += (size_t)snprintf(line + len, sizeof(line) - len, " %d:%lu", i,
+                                            (unsigned long)stage.buckets[i]);
+                }
+            }
+            print(line, arg);
+        }
+    }
+}
+
+#else
+
+bool miner_profile_read(size_t backend, miner_stage_t stage, miner_profile_stage_t *out)
+{
+    (void)backend;
+    (void)stage;
+    memset(out, 0, sizeof(*out));
+    return false;
+}
+
+void miner_profile_reset(void)
+{
+}
+
+void miner_profile_dump(miner_profile_print_fn print, void *arg)
+{
+    print("profile: not built in (MINER_PROFILE=1)", arg);
+}
+
+#endif // MINER_PROFILE
@@ -0,0 +1,164 @@
+/**
+ * @file miner_profile.h
+ * @brief Opt-in per-stage cycle histograms of the hashing pipeline
+ *
+ * Built with MINER_PROFILE=1 (cmake -DMINER_PROFILE=1, or idf.py
+ * -DMINER_PROFILE=1 build), probes in the pipeline read the CPU cycle
+ * counter (miner_cycles()) around each stage and add the count to a
+ * histogram of the backend the thread scans with:
+ *
+ * - scan: one backend scan call (miner_worker_scan()), every backend;
+ * - block 2: the first SHA-256's second header block, from the midstate;
+ * - digest: the second SHA-256, early reject included;
+ * - target: a candidate's full digest, target and best-share compares and
+ *   share report;
+ * - header: a switch to another header variant (miner_worker_roll()),
+ *   with the first block's compression (midstate) on version rolls;
+ * - bookkeeping: the worker loop's job check and scheduler call per chunk.
+ *
+ * Block 2 and digest are split inside the scalar kernels
+ * (sha256d_check_nonce(), sha256d_hash_nonce()), so they cover the
+ * "precomp" and "reject" backends and the candidate re-hash; the other
+ * backends only show as whole scans. The boot benchmark
+ * (hash_backend_measure()) profiles each backend it times.
+ *
+ * Each histogram has one bucket per power of two of cycles, plus the call
+ * and item (nonce) counts, the cycle sum and the maximum. Updates are
+ * relaxed 32-bit atomics, so workers on both cores can share the tables
+ * without the library locks a 64-bit atomic takes on Xtensa: the cycle sum
+ * is kept as two words, the carry added to the high one.
+ * miner_profile_dump() formats them as text lines for the serial console.
+ *
+ * Built without it (the default), the probes compile to nothing and no
+ * tables exist; miner_profile_read() reports nothing and the dump prints
+ * one line saying so.
+ */
+
+#ifndef __MINER_PROFILE_H__
+#define __MINER_PROFILE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_backend.h"
+#include "miner_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MINER_PROFILE
+#define MINER_PROFILE           0
+#endif
+
+/** Histogram buckets: bucket k counts [2^k, 2^(k+1)) cycles, the last one everything above */
+#define MINER_PROFILE_BUCKETS   24
+
+typedef enum {
+    MINER_STAGE_SCAN,                   ///< Backend scan call
+    MINER_STAGE_BLOCK2,                 ///< First SHA-256, header block 2 (scalar kernels)
+    MINER_STAGE_DIGEST,                 ///< Second SHA-256 (scalar kernels)
+    MINER_STAGE_TARGET,                 ///< Candidate digest, target compares and share report
+    MINER_STAGE_HEADER,                 ///< Header variant switch
+    MINER_STAGE_BOOKKEEPING,            ///< Job check and scheduler per chunk
+    MINER_STAGE_COUNT,
+} miner_stage_t;
+
+typedef struct {
+    uint32_t calls;                     ///< Measurements
+    uint32_t items;                     ///< Nonces (or candidates, rolls, chunks) they covered
+    uint64_t cycles;                    ///< Sum of the measurements
+    uint32_t max;                       ///< Longest measurement
+    uint32_t buckets[MINER_PROFILE_BUCKETS]; ///< Measurements per power of two of cycles
+} miner_profile_stage_t;
+
+/**
+ * @brief Line printer for miner_profile_dump()
+ *
+ * @param line One line of text without a newline
+ * @param arg User argument
+ */
+typedef void (*miner_profile_print_fn)(const char *line, void *arg);
+
+/**
+ * @brief Histogram bucket of a cycle count
+ */
+static inline uint32_t miner_profile_bucket(uint32_t cycles)
+{
+    uint32_t bucket = cycles > 1 ? 31 - (uint32_t)__builtin_clz(cycles) : 0;
+
+    return bucket < MINER_PROFILE_BUCKETS ? bucket : MINER_PROFILE_BUCKETS - 1;
+}
+
+/**
+ * @brief Short name of a stage
+ */
+const char *miner_profile_stage_name(miner_stage_t stage);
+
+/**
+ * @brief Copy one histogram
+ *
+ * @param backend Index of the backend (hash_backend_get())
+ * @param stage Stage
+ * @param out Output histogram
+ * @return false when profiling is not built in, or the indices are out of range
+ */
+bool miner_profile_read(size_t backend, miner_stage_t stage, miner_profile_stage_t *out);
+
+/**
+ * @brief Clear every histogram (any time)
+ *
+ * Every field is cleared with an atomic store, so probes may run meanwhile;
+ * a histogram read during the reset can mix old and new counts.
+ */
+void miner_profile_reset(void);
+
+/**
+ * @brief Format every histogram that has measurements, one backend after
+ *        the other
+ */
+void miner_profile_dump(miner_profile_print_fn print, void *arg);
+
+#if MINER_PROFILE
+
+/**
+ * @brief Attribute the calling thread's measurements to a backend
+ *
+ * Backends that are not in the registry (hash_backend_get()) are not
+ * profiled.
+ */
+void miner_profile_set_backend(const hash_backend_t *backend);
+
+/**
+ * @brief Add one measurement to the calling thread's backend
+ */
+void miner_profile_record(miner_stage_t stage, uint32_t cycles, uint32_t items);
+
+/** Record a stage and restart the measurement for the next one */
+static inline uint32_t miner_profile_lap(miner_stage_t stage, uint32_t start, uint32_t items)
+{
+    miner_profile_record(stage, miner_cycles() - start, items);
+    return miner_cycles();
+}
+
+#define MINER_PROFILE_BACKEND(backend)          miner_profile_set_backend(backend)
+#define MINER_PROFILE_START(var)                uint32_t var = miner_cycles()
+#define MINER_PROFILE_LAP(stage, var, items)    ((var) = miner_profile_lap((stage), (var), (items)))
+#define MINER_PROFILE_STOP(stage, var, items)   miner_profile_record((stage), miner_cycles() - (var), (items))
+#define MINER_PROFILE_RECORD(stage, cycles, items) miner_profile_record((stage), (cycles), (items))
+
+#else
+
+#define MINER_PROFILE_BACKEND(backend)          ((void)0)
+#define MINER_PROFILE_START(var)                ((void)0)
+#define MINER_PROFILE_LAP(stage, var, items)    ((void)0)
+#define MINER_PROFILE_STOP(stage, var, items)   ((void)0)
+#define MINER_PROFILE_RECORD(stage, cycles, items) ((void)0)
+
+#endif // MINER_PROFILE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MINER_PROFILE_H__
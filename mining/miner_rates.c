@@ -0,0 +1,144 @@
+/**
+ * @file miner_rates.c
+ * @brief Windowed hashrate estimates in fixed point
+ */
+
+#include "miner_rates.h"
+#include <string.h>
+
+static const uint32_t window_lengths_s[MINER_RATE_WINDOWS] = { 10, 60, 900 };
+
+// e^(-2^(i - 24)) as fractions of 2^32: one factor per bit of an 8.24
+// fixed-point exponent below 32
+static const uint32_t exp_neg_pow2[29] = {
+    4294967040u, 4294966784u, 4294966272u, 4294965248u,
+    4294963200u, 4294959104u, 4294950912u, 4294934528u,
+    4294901760u, 4294836226u, 4294705160u, 4294443040u,
+    4293918848u, 4292870656u, 4290775039u, 4286586875u,
+    4278222805u, 4261543595u, 4228380000u, 4162825044u,
+    4034748382u, 3790295335u, 3344923893u, 2605029347u,
+    1580030169u, 581260615u, 78665070u, 1440801u,
+    483u,
+};
+
+// value * fraction / 2^32, rounded, for fractions up to 1.0, without a
+// 128-bit product
+static uint64_t mul_fraction(uint64_t value, uint64_t fraction)
+{
+    return (value >> 32) * fraction + (((value & 0xFFFFFFFFu) * fraction + (1u << 31)) >> 32);
+}
+
+uint32_t miner_rate_window_s(miner_rate_window_t window)
+{
+    return window < MINER_RATE_WINDOWS ? window_lengths_s[window] : 0;
+}
+
+uint64_t miner_ewma_decay(uint64_t dt_us, uint32_t window_s)
+{
+    uint64_t window_us = (uint64_t)window_s * 1000000u;
+    uint64_t decay = MINER_DECAY_ONE;
+    uint64_t x;
+
+    if (window_us == 0 || dt_us >= 32 * window_us) {
+        return 0;
+    }
+    // dt / window in 8.24; below 32 windows the shift cannot overflow for
+    // windows up to 9 hours
+    x = ((dt_us << 24) + window_us / 2) / window_us;
+    for (uint32_t i = 0; x != 0; i++, x >>= 1) {
+        if (x & 1) {
+            decay = (decay * exp_neg_pow2[i] + (1u << 31)) >> 32;
+        }
+    }
+    return decay;
+}
+
+uint64_t miner_ewma(uint64_t average, uint64_t sample, uint64_t decay)
+{
+    uint64_t weight;
+
+    if (decay > MINER_DECAY_ONE) {
+        decay = MINER_DECAY_ONE;
+    }
+    // Move by (1 - decay) of the difference: a steady rate stays exact
+    weight = MINER_DECAY_ONE - decay;
+    if (sample >= average) {
+        return average + mul_fraction(sample - average, weight);
+    }
+    return average - mul_fraction(average - sample, weight);
+}
+
+uint64_t miner_rate_fixed(uint64_t count, uint64_t dt_us)
+{
+    uint64_t whole;
+    uint64_t rest;
+
+    if (dt_us == 0) {
+        return 0;
+    }
+    // Keep rest * 10^6 << MINER_RATE_SHIFT within 64 bits (intervals over 19 h)
+    while (dt_us >= (1ull << 36)) {
+        count >>= 1;
+        dt_us >>= 1;
+    }
+    whole = count / dt_us;
+    rest = count % dt_us;
+    return (whole * 1000000u << MINER_RATE_SHIFT) + ((rest * 1000000u << MINER_RATE_SHIFT) / dt_us);
+}
+
+void miner_rates_init(miner_rates_t *rates, const miner_worker_t *workers, size_t count, uint64_t now_us)
+{
+    memset(rates, 0, sizeof(*rates));
+    for (size_t i = 0; i < count && i < MINER_MAX_WORKERS; i++) {
+        miner_worker_totals(&workers[i], &rates->last[i]);
+        rates->total_hashes += rates->last[i].hashes;
+    }
+    rates->start_us = now_us;
+    rates->last_us = now_us;
+}
+
+void miner_rates_update(miner_rates_t *rates, const miner_worker_t *workers, size_t count, uint64_t now_us)
+{
+    uint64_t dt_us = now_us - rates->last_us;
+    uint64_t hashes = 0;
+
+    if (now_us <= rates->last_us) {
+        return;
+    }
+    rates->total_hashes = 0;
+    rates->job_id = 0;
+    rates->job_hashes = 0;
+    for (size_t i = 0; i < count && i < MINER_MAX_WORKERS; i++) {
+        miner_totals_snapshot_t now;
+        miner_totals_snapshot_t *last = &rates->last[i];
+
+        miner_worker_totals(&workers[i], &now);
+        uint64_t worker_hashes = now.hashes - last->hashes;
+        uint64_t cycles = now.cycles - last->cycles;
+
+        rates->worker_rate[i] = miner_rate_fixed(worker_hashes, dt_us);
+        rates->cycles_per_hash[i] = worker_hashes != 0 ?
+                                    (uint32_t)((cycles << MINER_RATE_SHIFT) / worker_hashes) : 0;
+        hashes += worker_hashes;
+        rates->total_hashes += now.hashes;
+
+        // Job ids grow with every publication: the largest is the newest
+        if (now.job_id > rates->job_id) {
+            rates->job_id = now.job_id;
+            rates->job_hashes = 0;
+        }
+        if (now.job_id == rates->job_id) {
+            rates->job_hashes += now.job_hashes;
+        }
+        *last = now;
+    }
+
+    rates->rate = miner_rate_fixed(hashes, dt_us);
+    for (int w = 0; w < MINER_RATE_WINDOWS; w++) {
+        uint64_t decay = miner_ewma_decay(dt_us, window_lengths_s[w]);
+
+        rates->average[w] = rates->primed ? miner_ewma(rates->average[w], rates->rate, decay) : rates->rate;
+    }
+    rates->primed = true;
+    rates->last_us = now_us;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file miner_rates.h
+ * @brief Windowed hashrate estimates in fixed point
+ *
+ * The stats task takes a snapshot of every worker's 64-bit totals
+ * (miner_worker_totals()) and turns the differences since its previous
+ * update into:
+ *
+ * - the hashrate over the last interval, overall and per worker;
+ * - exponentially weighted moving averages over 10 s, 1 min and 15 min,
+ *   like the Unix load averages but with the decay computed from the real
+ *   interval, so updates need not be evenly spaced;
+ * - cycles per hash of each worker, from the CPU cycles its scans took;
+ * - hashes of the newest job over the workers mining it.
+ *
+ * Everything is integer arithmetic. Rates are hashes per second and cycles
+ * per hash with MINER_RATE_SHIFT fractional bits; the decay factors are
+ * 32-bit fractions. Neither the workers nor the stats task need the FPU
+ * for them.
+ */
+
+#ifndef __MINER_RATES_H__
+#define __MINER_RATES_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "miner_worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Fractional bits of fixed-point rates and cycles per hash */
+#define MINER_RATE_SHIFT        8
+
+/** 1.0 as a decay factor */
+#define MINER_DECAY_ONE         (1ull << 32)
+
+typedef enum {
+    MINER_RATE_10S,                     ///< 10 s window
+    MINER_RATE_1MIN,                    ///< 1 min window
+    MINER_RATE_15MIN,                   ///< 15 min window
+    MINER_RATE_WINDOWS,
+} miner_rate_window_t;
+
+typedef struct {
+    miner_totals_snapshot_t last[MINER_MAX_WORKERS]; ///< Snapshots of the previous update
+    uint64_t start_us;                  ///< Time of miner_rates_init()
+    uint64_t last_us;                   ///< Time of the previous update
+    bool primed;                        ///< The averages hold at least one interval
+    uint64_t rate;                      ///< All workers, last interval (H/s, fixed point)
+    uint64_t average[MINER_RATE_WINDOWS]; ///< All workers, moving averages (H/s, fixed point)
+    uint64_t worker_rate[MINER_MAX_WORKERS]; ///< Per worker, last interval (H/s, fixed point)
+    uint32_t cycles_per_hash[MINER_MAX_WORKERS]; ///< Per worker, last interval (fixed point; 0 without hashes)
+    uint64_t total_hashes;              ///< All workers since they were initialized
+    uint32_t job_id;                    ///< Newest job any worker mines
+    uint64_t job_hashes;                ///< Hashes of job_id over the workers mining it
+} miner_rates_t;
+
+/**
+ * @brief Length of a moving-average window in seconds
+ */
+uint32_t miner_rate_window_s(miner_rate_window_t window);
+
+/**
+ * @brief Decay factor e^(-dt / window) as a fraction of MINER_DECAY_ONE
+ *
+ * dt / window is rounded to 2^-24, so the factor is within about 1e-7 of
+ * exp() (relative); 0 for intervals over 32 windows. Windows up to 9 hours.
+ */
+uint64_t miner_ewma_decay(uint64_t dt_us, uint32_t window_s);
+
+/**
+ * @brief Blend a new sample into a moving average
+ *
+ * @param average Previous average
+ * @param sample Value over the new interval
+ * @param decay miner_ewma_decay() of the interval
+ * @return average * decay + sample * (1 - decay)
+ */
+uint64_t miner_ewma(uint64_t average, uint64_t sample, uint64_t decay);
+
+/**
+ * @brief count per second over dt_us, with MINER_RATE_SHIFT fractional bits
+ *
+ * @return 0 if dt_us is 0
+ */
+uint64_t miner_rate_fixed(uint64_t count, uint64_t dt_us);
+
+/**
+ * @brief Start the estimates from the workers' current totals
+ */
+void miner_rates_init(miner_rates_t *rates, const miner_worker_t *workers, size_t count, uint64_t now_us);
+
+/**
+ * @brief Update the estimates with the work done since the previous update
+ *
+ * The first interval seeds every moving average with its rate, so the long
+ * windows do not start from zero. Does nothing if no time has passed.
+ */
+void miner_rates_update(miner_rates_t *rates, const miner_worker_t *workers, size_t count, uint64_t now_us);
+
+/**
+ * @brief A fixed-point rate in tenths, rounded (for "%llu.%llu" output)
+ */
+static inline uint64_t miner_rate_tenths(uint64_t rate)
+{
+    return (rate * 10 + (1u << (MINER_RATE_SHIFT - 1))) >> MINER_RATE_SHIFT;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MINER_RATES_H__
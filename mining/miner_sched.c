@@ -0,0 +1,145 @@
+/**
+ * @file miner_sched.c
+ * @brief Work-stealing nonce-range scheduler
+ */
+
+#include "miner_sched.h"
+
+void miner_partition(uint64_t count, uint32_t worker, uint32_t workers, uint64_t *offset, uint64_t *size)
+{
+    uint64_t base = count / workers;
+    uint64_t extra = count % workers;
+
+    *offset = worker * base + (worker < extra ? worker : extra);
+    *size = base + (worker < extra ? 1 : 0);
+}
+
+void miner_sched_init(miner_sched_t *sched)
+{
+    for (uint32_t i = 0; i < MINER_MAX_WORKERS; i++) {
+        miner_lock_init(&sched->ranges[i].lock);
+        sched->ranges[i].next = 0;
+        sched->ranges[i].end = 0;
+    }
+    sched->workers = 0;
+    sched->chunk = MINER_SCHED_CHUNK;
+    sched->steals = 0;
+}
+
+void miner_sched_reset(miner_sched_t *sched, uint32_t workers, uint32_t chunk, uint64_t start, uint64_t count)
+{
+    sched->workers = workers;
+    sched->chunk = chunk;
+    __atomic_store_n(&sched->steals, 0, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < MINER_MAX_WORKERS; i++) {
+        miner_range_t *range = &sched->ranges[i];
+        uint64_t offset = 0;
+        uint64_t size = 0;
+
+        if (i < workers) {
+            miner_partition(count, i, workers, &offset, &size);
+        }
+        miner_lock(&range->lock);
+        range->next = start + offset;
+        range->end = start + offset + size;
+        miner_unlock(&range->lock);
+    }
+}
+
+// Size of a chunk at pos: at most chunk and left, and never across a roll
+static uint32_t sched_chunk(uint64_t pos, uint64_t left, uint32_t chunk)
+{
+    uint64_t to_roll = (1ull << 32) - (pos & 0xFFFFFFFFu);
+    uint64_t n = left < chunk ? left : chunk;
+
+    return (uint32_t)(n < to_roll ? n : to_roll);
+}
+
+// Take up to one chunk from the front of a range
+static bool sched_take(miner_range_t *range, uint32_t chunk, uint64_t *pos, uint32_t *count)
+{
+    bool taken = false;
+
+    miner_lock(&range->lock);
+    uint64_t left = range->end - range->next;
+    if (left > 0) {
+        uint32_t n = sched_chunk(range->next, left, chunk);
+        *pos = range->next;
+        *count = n;
+        range->next += n;
+        taken = true;
+    }
+    miner_unlock(&range->lock);
+    return taken;
+}
+
+static uint64_t sched_left(miner_range_t *range)
+{
+    miner_lock(&range->lock);
+    uint64_t left = range->end - range->next;
+    miner_unlock(&range->lock);
+    return left;
+}
+
+bool miner_sched_next(miner_sched_t *sched, uint32_t worker, uint64_t *pos, uint32_t *count)
+{
+    miner_range_t *own = &sched->ranges[worker];
+
+    if (sched_take(own, sched->chunk, pos, count)) {
+        return true;
+    }
+
+    for (;;) {
+        // Victim: the range with the most work left
+        miner_range_t *victim = NULL;
+        uint64_t most = 0;
+        for (uint32_t i = 0; i < sched->workers; i++) {
+            uint64_t left = i == worker ? 0 : sched_left(&sched->ranges[i]);
+            if (left > most) {
+                most = left;
+                victim = &sched->ranges[i];
+            }
+        }
+        if (victim == NULL) {
+            return false;
+        }
+
+        // Split off the back half (or everything if less than a chunk is left)
+        uint64_t start;
+        uint64_t end;
+        miner_lock(&victim->lock);
+        uint64_t left = victim->end - victim->next;
+        if (left == 0) {
+            // Drained since we looked; pick again
+            miner_unlock(&victim->lock);
+            continue;
+        }
+        end = victim->end;
+        start = left > sched->chunk ? end - left / 2 : victim->next;
+        victim->end = start;
+        miner_unlock(&victim->lock);
+
+        __atomic_fetch_add(&sched->steals, 1, __ATOMIC_RELAXED);
+
+        // First chunk goes to the caller, the rest becomes our range
+        uint32_t n = sched_chunk(start, end - start, sched->chunk);
+        *pos = start;
+        *count = n;
+        miner_lock(&own->lock);
+        own->next = start + n;
+        own->end = end;
+        miner_unlock(&own->lock);
+        return true;
+    }
+}
+
+uint64_t miner_sched_remaining(miner_sched_t *sched)
+{
+    uint64_t left = 0;
+
+    for (uint32_t i = 0; i < sched->workers; i++) {
+        left += sched_left(&sched->ranges[i]);
+    }
+    return left;
+}
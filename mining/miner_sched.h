@@ -0,0 +1,98 @@
+/**
+ * @file miner_sched.h
+ * @brief Work-stealing nonce-range scheduler
+ *
+ * The nonce range of a job is split into one contiguous range per worker.
+ * Workers take fixed-size chunks from the front of their own range; a
+ * worker whose range is empty steals the back half of the largest range
+ * left, so a slow or preempted worker (e.g. the one sharing core 0 with
+ * WiFi) never leaves the others idle at the end of a job.
+ *
+ * Each range has its own lock, held only for a few instructions per chunk;
+ * no worker ever holds two locks at once.
+ *
+ * Positions are 64-bit: roll << 32 | nonce (see work.h), so one job can
+ * span several header variants. A chunk never crosses a roll boundary.
+ */
+
+#ifndef __MINER_SCHED_H__
+#define __MINER_SCHED_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "miner_port.h"
+#include "miner_worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default nonces handed out per miner_sched_next() call */
+#define MINER_SCHED_CHUNK       1024
+
+typedef struct {
+    miner_lock_t lock;
+    uint64_t next;                      ///< Next position of the range
+    uint64_t end;                       ///< One past the last position
+} __attribute__((aligned(MINER_CACHE_LINE))) miner_range_t;
+
+typedef struct {
+    miner_range_t ranges[MINER_MAX_WORKERS];
+    uint32_t workers;                   ///< Number of ranges in use
+    uint32_t chunk;                     ///< Nonces per chunk
+    uint32_t steals;                    ///< Successful steals (statistics)
+} miner_sched_t;
+
+/**
+ * @brief Compute one worker's share of a range of count nonces
+ *
+ * Shares are contiguous, disjoint and together cover the range; the first
+ * (count % workers) shares are one nonce larger.
+ *
+ * @param count Size of the range
+ * @param worker Worker index (0 .. workers - 1)
+ * @param workers Number of workers (>= 1)
+ * @param offset Offset of the share from the start of the range
+ * @param size Number of nonces in the share
+ */
+void miner_partition(uint64_t count, uint32_t worker, uint32_t workers, uint64_t *offset, uint64_t *size);
+
+/**
+ * @brief Create the scheduler's locks (once, before first use)
+ */
+void miner_sched_init(miner_sched_t *sched);
+
+/**
+ * @brief Split a nonce range between workers and reset the statistics
+ *
+ * Must not be called while workers are taking chunks.
+ *
+ * @param sched Scheduler
+ * @param workers Number of workers (1 .. MINER_MAX_WORKERS)
+ * @param chunk Nonces per chunk (> 0)
+ * @param start First position (roll << 32 | nonce)
+ * @param count Number of positions (start + count must not exceed 2^64)
+ */
+void miner_sched_reset(miner_sched_t *sched, uint32_t workers, uint32_t chunk, uint64_t start, uint64_t count);
+
+/**
+ * @brief Take the next chunk for a worker, stealing if its range is empty
+ *
+ * @param sched Scheduler
+ * @param worker Worker index
+ * @param pos First position of the chunk (roll << 32 | nonce)
+ * @param count Nonces in the chunk (1 .. chunk, all in the same roll)
+ * @return false once every range is exhausted
+ */
+bool miner_sched_next(miner_sched_t *sched, uint32_t worker, uint64_t *pos, uint32_t *count);
+
+/**
+ * @brief Positions not yet handed out (approximate while workers run)
+ */
+uint64_t miner_sched_remaining(miner_sched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MINER_SCHED_H__
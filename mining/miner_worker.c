@@ -0,0 +1,229 @@
+/**
+ * @file miner_worker.c
+ * @brief Per-core mining worker state and lock-free counters
+ */
+
+#include "miner_worker.h"
+#include <string.h>
+#include "miner_port.h"
+#include "miner_profile.h"
+
+_Static_assert(sizeof(miner_counters_t) == MINER_CACHE_LINE, "counters must fill one cache line");
+_Static_assert(sizeof(miner_totals_t) == MINER_CACHE_LINE, "totals must fill one cache line");
+
+// Publish a 64-bit total as two 32-bit words (inside the sequence lock)
+static inline void totals_store(uint32_t *words, uint64_t value)
+{
+    __atomic_store_n(&words[0], (uint32_t)value, __ATOMIC_RELAXED);
+    __atomic_store_n(&words[1], (uint32_t)(value >> 32), __ATOMIC_RELAXED);
+}
+
+static inline uint64_t totals_load(const uint32_t *words)
+{
+    uint32_t low = __atomic_load_n(&words[0], __ATOMIC_RELAXED);
+    uint32_t high = __atomic_load_n(&words[1], __ATOMIC_RELAXED);
+
+    return (uint64_t)high << 32 | low;
+}
+
+void miner_worker_init(miner_worker_t *worker, uint32_t id)
+{
+    memset(worker, 0, sizeof(*worker));
+    memset(worker->best.words, 0xFF, sizeof(worker->best.words));
+    worker->id = id;
+}
+
+void miner_worker_load(miner_worker_t *worker, uint32_t job_id, const sha256d_ctx_t *engine)
+{
+    worker->job_id = job_id;
+    worker->roll = 0;
+    worker->ctx = *engine;
+}
+
+void miner_worker_count_switch(miner_worker_t *worker, uint32_t latency_us, bool clean)
+{
+    miner_counters_t *c = &worker->counters;
+    uint32_t *max = clean ? &c->clean_switch_us_max : &c->job_switch_us_max;
+
+    // Sole writer: plain reads of our own counters are safe
+    __atomic_store_n(&c->job_switches, c->job_switches + 1, __ATOMIC_RELAXED);
+    if (latency_us > *max) {
+        __atomic_store_n(max, latency_us, __ATOMIC_RELAXED);
+    }
+    if (clean && latency_us > c->job_switch_us_max) {
+        __atomic_store_n(&c->job_switch_us_max, latency_us, __ATOMIC_RELAXED);
+    }
+}
+
+void miner_worker_count_share(miner_worker_t *worker, bool queued)
+{
+    miner_counters_t *c = &worker->counters;
+
+    // Sole writer: plain reads of our own counters are safe
+    if (queued) {
+        __atomic_store_n(&c->shares, c->shares + 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&c->shares_dropped, c->shares_dropped + 1, __ATOMIC_RELAXED);
+    }
+}
+
+IRAM_ATTR void miner_worker_add_totals(miner_worker_t *worker, uint32_t hashes, uint32_t cycles)
+{
+    miner_totals_t *t = &worker->totals;
+    uint32_t seq = t->seq;
+    // Sole writer: our own words cannot change under us
+    uint64_t job_hashes = t->job_id == worker->job_id ? totals_load(t->job_hashes) : 0;
+
+    // Odd seq first: a reader that sees any of the new words retries
+    __atomic_store_n(&t->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&t->job_id, worker->job_id, __ATOMIC_RELAXED);
+    totals_store(t->hashes, totals_load(t->hashes) + hashes);
+    totals_store(t->cycles, totals_load(t->cycles) + cycles);
+    totals_store(t->job_hashes, job_hashes + hashes);
+    __atomic_store_n(&t->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void miner_worker_totals(const miner_worker_t *worker, miner_totals_snapshot_t *snapshot)
+{
+    const miner_totals_t *t = &worker->totals;
+
+    while (1) {
+        uint32_t seq = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE);
+
+        snapshot->job_id = __atomic_load_n(&t->job_id, __ATOMIC_RELAXED);
+        snapshot->hashes = totals_load(t->hashes);
+        snapshot->cycles = totals_load(t->cycles);
+        snapshot->job_hashes = totals_load(t->job_hashes);
+        // Keep the copy above the second seq load
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0 && __atomic_load_n(&t->seq, __ATOMIC_RELAXED) == seq) {
+            return;
+        }
+        miner_yield();
+    }
+}
+
+void miner_worker_roll(miner_worker_t *worker, const work_template_t *work, uint32_t roll)
+{
+    miner_counters_t *c = &worker->counters;
+    MINER_PROFILE_START(t);
+    uint64_t start = miner_time_us();
+    work_switch_t kind = work_apply_roll(work, &worker->ctx, worker->roll, roll);
+    uint32_t elapsed = (uint32_t)(miner_time_us() - start);
+    uint32_t *count = kind == WORK_SWITCH_EXTRANONCE ? &c->extranonce_rolls :
+                      kind == WORK_SWITCH_VERSION ? &c->version_rolls : &c->ntime_rolls;
+
+    worker->roll = roll;
+    // Sole writer: plain reads of our own counters are safe
+    __atomic_store_n(count, *count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->roll_us, c->roll_us + elapsed, __ATOMIC_RELAXED);
+    if (elapsed > c->roll_us_max) {
+        __atomic_store_n(&c->roll_us_max, elapsed, __ATOMIC_RELAXED);
+    }
+    MINER_PROFILE_STOP(MINER_STAGE_HEADER, t, 1);
+}
+
+IRAM_ATTR uint32_t miner_worker_scan(miner_worker_t *worker, const hash_backend_t *backend, uint32_t nonce,
+                                     uint32_t count, uint32_t max_top_word, uint32_t *mask)
+{
+    MINER_PROFILE_BACKEND(backend);
+    uint32_t start = miner_cycles();
+    uint32_t candidates = backend->scan(&worker->ctx, nonce, count, max_top_word, mask);
+    uint32_t cycles = miner_cycles() - start;
+
+    MINER_PROFILE_RECORD(MINER_STAGE_SCAN, cycles, count);
+    // Sole writer: a plain read of our own counter is safe
+    __atomic_store_n(&worker->counters.hashes, worker->counters.hashes + count, __ATOMIC_RELAXED);
+    miner_worker_add_totals(worker, count, cycles);
+    return candidates;
+}
+
+bool miner_worker_offer_best(miner_worker_t *worker, const uint8_t *hash)
+{
+    target_t value;
+    float difficulty;
+    uint32_t bits;
+
+    target_from_hash(hash, &value);
+    if (target_compare(&value, &worker->best) >= 0) {
+        return false;
+    }
+    worker->best = value;
+
+    // Rounding to float is monotonic, so the published value never drops
+    difficulty = (float)target_difficulty(&value);
+    memcpy(&bits, &difficulty, sizeof(bits));
+    __atomic_store_n(&worker->counters.best_difficulty, bits, __ATOMIC_RELAXED);
+    return true;
+}
+
+double miner_worker_best(const miner_worker_t *worker)
+{
+    uint32_t bits = __atomic_load_n(&worker->counters.best_difficulty, __ATOMIC_RELAXED);
+    float difficulty;
+
+    memcpy(&difficulty, &bits, sizeof(difficulty));
+    return difficulty;
+}
+
+void miner_stats_reset(miner_stats_reader_t *reader, const miner_worker_t *workers, size_t count)
+{
+    memset(reader, 0, sizeof(*reader));
+    for (size_t i = 0; i < count && i < MINER_MAX_WORKERS; i++) {
+        reader->last_hashes[i] = __atomic_load_n(&workers[i].counters.hashes, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t miner_stats_collect(miner_stats_reader_t *reader, const miner_worker_t *workers, size_t count)
+{
+    uint64_t delta = 0;
+    share_hist_t copy;
+
+    reader->ntime_rolls = 0;
+    reader->version_rolls = 0;
+    reader->extranonce_rolls = 0;
+    reader->roll_us = 0;
+    reader->roll_us_max = 0;
+    reader->job_switches = 0;
+    reader->job_switch_us_max = 0;
+    reader->clean_switch_us_max = 0;
+    reader->shares = 0;
+    reader->shares_dropped = 0;
+    share_hist_init(&reader->share_hist);
+    for (size_t i = 0; i < count && i < MINER_MAX_WORKERS; i++) {
+        const miner_counters_t *c = &workers[i].counters;
+        uint32_t hashes = __atomic_load_n(&c->hashes, __ATOMIC_RELAXED);
+        uint32_t roll_us_max = __atomic_load_n(&c->roll_us_max, __ATOMIC_RELAXED);
+        double best = miner_worker_best(&workers[i]);
+
+        // Unsigned subtraction handles counter wrap between collects
+        delta += (uint32_t)(hashes - reader->last_hashes[i]);
+        reader->last_hashes[i] = hashes;
+        if (best > reader->best_difficulty) {
+            reader->best_difficulty = best;
+        }
+        reader->ntime_rolls += __atomic_load_n(&c->ntime_rolls, __ATOMIC_RELAXED);
+        reader->version_rolls += __atomic_load_n(&c->version_rolls, __ATOMIC_RELAXED);
+        reader->extranonce_rolls += __atomic_load_n(&c->extranonce_rolls, __ATOMIC_RELAXED);
+        reader->roll_us += __atomic_load_n(&c->roll_us, __ATOMIC_RELAXED);
+        if (roll_us_max > reader->roll_us_max) {
+            reader->roll_us_max = roll_us_max;
+        }
+        reader->job_switches += __atomic_load_n(&c->job_switches, __ATOMIC_RELAXED);
+        uint32_t switch_us_max = __atomic_load_n(&c->job_switch_us_max, __ATOMIC_RELAXED);
+        uint32_t clean_us_max = __atomic_load_n(&c->clean_switch_us_max, __ATOMIC_RELAXED);
+        if (switch_us_max > reader->job_switch_us_max) {
+            reader->job_switch_us_max = switch_us_max;
+        }
+        if (clean_us_max > reader->clean_switch_us_max) {
+            reader->clean_switch_us_max = clean_us_max;
+        }
+        reader->shares += __atomic_load_n(&c->shares, __ATOMIC_RELAXED);
+        reader->shares_dropped += __atomic_load_n(&c->shares_dropped, __ATOMIC_RELAXED);
+        share_hist_read(&workers[i].share_hist, &copy);
+        share_hist_merge(&reader->share_hist, &copy);
+    }
+    reader->total_hashes += delta;
+    return delta;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file miner_worker.h
+ * @brief Per-core mining worker state and lock-free counters
+ *
+ * Each worker owns a private copy of the job's SHA-256d engine state, so
+ * workers never write shared data while hashing; which nonces a worker
+ * scans is decided by the scheduler (miner_sched.h). Progress is published
+ * through a per-worker counter block that occupies a whole cache line: the
+ * owning worker is its only writer, and the stats reader merges all blocks
+ * without locks. A second block holds 64-bit totals (hashes, scan cycles,
+ * hashes of the current job) behind a sequence lock, so a reader on
+ * another core gets a consistent snapshot without tearing on 32-bit cores.
+ * The shares the worker finds are counted by difficulty in a histogram of
+ * its own, under the same kind of lock (share_hist.h).
+ */
+
+#ifndef __MINER_WORKER_H__
+#define __MINER_WORKER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_backend.h"
+#include "sha256d.h"
+#include "share_hist.h"
+#include "target.h"
+#include "work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Counter blocks are padded to this size to avoid false sharing */
+#define MINER_CACHE_LINE        64
+
+/** Maximum number of workers a stats reader can merge */
+#define MINER_MAX_WORKERS       8
+
+/** Maximum nonces per miner_worker_scan() call (one candidate bitmap word) */
+#define MINER_WORKER_CHUNK      32
+
+/**
+ * @brief Counters published by one worker
+ *
+ * Written only by the owning worker (relaxed atomic stores) and read by the
+ * stats reader. hashes wraps at 2^32; the reader accumulates deltas.
+ * best_difficulty holds the bits of a float so it can be published with a
+ * single 32-bit store; it only grows. The roll counters record how often
+ * and how long the worker switched header variants (see work.h). The job
+ * counters record how long after publication the worker moved to a newer
+ * job (see miner_ctx_publish()). The share counters record what went into
+ * the worker's share ring and what a full ring turned away.
+ */
+typedef struct {
+    uint32_t hashes;                    ///< Nonces checked (wrapping)
+    uint32_t best_difficulty;           ///< Difficulty of the best share (float bits)
+    uint32_t ntime_rolls;               ///< Switches that only rolled ntime
+    uint32_t version_rolls;             ///< Switches that changed the version (midstate)
+    uint32_t extranonce_rolls;          ///< Switches that bumped extranonce2
+    uint32_t roll_us;                   ///< Total time spent switching (us)
+    uint32_t roll_us_max;               ///< Longest single switch (us)
+    uint32_t job_switches;              ///< Newer jobs picked up while running
+    uint32_t job_switch_us_max;         ///< Longest publication-to-pickup delay (us)
+    uint32_t clean_switch_us_max;       ///< The same for clean jobs: the abort latency (us)
+    uint32_t shares;                    ///< Shares and new bests pushed to the share ring
+    uint32_t shares_dropped;            ///< Shares lost to a full share ring
+} __attribute__((aligned(MINER_CACHE_LINE))) miner_counters_t;
+
+/**
+ * @brief 64-bit totals published by one worker under a sequence lock
+ *
+ * The owning worker makes seq odd, updates the words and makes it even
+ * again; a reader retries until it sees the same even seq before and after
+ * its copy (miner_worker_totals()). Each 64-bit value is stored as two
+ * 32-bit words, so no access needs a 64-bit atomic.
+ */
+typedef struct {
+    uint32_t seq;                       ///< Odd while the worker writes the block
+    uint32_t job_id;                    ///< Job job_hashes counts
+    uint32_t hashes[2];                 ///< Nonces checked (low, high word)
+    uint32_t cycles[2];                 ///< CPU cycles spent in backend scans (low, high word)
+    uint32_t job_hashes[2];             ///< Nonces checked for job_id (low, high word)
+} __attribute__((aligned(MINER_CACHE_LINE))) miner_totals_t;
+
+/** A consistent copy of a worker's totals */
+typedef struct {
+    uint32_t job_id;
+    uint64_t hashes;
+    uint64_t cycles;
+    uint64_t job_hashes;
+} miner_totals_snapshot_t;
+
+typedef struct {
+    miner_counters_t counters;          ///< Published progress (own cache line)
+    miner_totals_t totals;              ///< Published 64-bit totals (own cache line)
+    uint32_t id;                        ///< Worker index
+    uint32_t job_id;                    ///< Job the engine state belongs to
+    uint32_t roll;                      ///< Header variant loaded in ctx
+    sha256d_ctx_t ctx;                  ///< Private engine state (header, midstate)
+    target_t best;                      ///< Lowest hash found (private to the worker)
+    share_hist_t share_hist __attribute__((aligned(MINER_CACHE_LINE))); ///< Shares by difficulty (published)
+} miner_worker_t;
+
+typedef struct {
+    uint32_t last_hashes[MINER_MAX_WORKERS];
+    uint64_t total_hashes;              ///< Merged hashes since the reader was reset
+    double best_difficulty;             ///< Best share difficulty over all workers
+    uint32_t ntime_rolls;               ///< Sum over workers
+    uint32_t version_rolls;             ///< Sum over workers
+    uint32_t extranonce_rolls;          ///< Sum over workers
+    uint64_t roll_us;                   ///< Sum over workers
+    uint32_t roll_us_max;               ///< Max over workers
+    uint32_t job_switches;              ///< Sum over workers
+    uint32_t job_switch_us_max;         ///< Max over workers
+    uint32_t clean_switch_us_max;       ///< Max over workers
+    uint32_t shares;                    ///< Sum over workers
+    uint32_t shares_dropped;            ///< Sum over workers
+    share_hist_t share_hist;            ///< Merged share histograms: every job, and the newest one
+} miner_stats_reader_t;
+
+/**
+ * @brief Initialize a worker with cleared counters
+ *
+ * @param worker Worker to initialize
+ * @param id Worker index
+ */
+void miner_worker_init(miner_worker_t *worker, uint32_t id);
+
+/**
+ * @brief Take a private copy of a job's engine state
+ *
+ * @param worker Worker
+ * @param job_id Job identifier
+ * @param engine Engine state prepared with sha256d_init() for roll 0 of the job
+ */
+void miner_worker_load(miner_worker_t *worker, uint32_t job_id, const sha256d_ctx_t *engine);
+
+/**
+ * @brief Count a move to a newer job in the worker's job counters
+ *
+ * @param worker Worker
+ * @param latency_us Time since the job was published
+ * @param clean The job was published as clean
+ */
+void miner_worker_count_switch(miner_worker_t *worker, uint32_t latency_us, bool clean);
+
+/**
+ * @brief Count a share the worker reported in its share counters
+ *
+ * @param worker Worker
+ * @param queued The share ring took it
+ */
+void miner_worker_count_share(miner_worker_t *worker, bool queued);
+
+/**
+ * @brief Add scanned nonces and the cycles they took to the worker's totals
+ *
+ * Called by miner_worker_scan(); the nonces count for the worker's current
+ * job (miner_worker_load()).
+ *
+ * @param worker Worker (called from its own thread only)
+ * @param hashes Nonces checked
+ * @param cycles CPU cycles the check took (miner_cycles())
+ */
+void miner_worker_add_totals(miner_worker_t *worker, uint32_t hashes, uint32_t cycles);
+
+/**
+ * @brief Take a consistent snapshot of a worker's totals (any thread)
+ *
+ * Retries while the worker is updating them; call it from a task that does
+ * not preempt the worker on its core.
+ */
+void miner_worker_totals(const miner_worker_t *worker, miner_totals_snapshot_t *snapshot);
+
+/**
+ * @brief Switch the worker's engine to another header variant of the job
+ *
+ * Timed and counted in the worker's roll counters.
+ *
+ * @param worker Worker
+ * @param work Template of the job
+ * @param roll Roll to load
+ */
+void miner_worker_roll(miner_worker_t *worker, const work_template_t *work, uint32_t roll);
+
+/**
+ * @brief Check a run of nonces and publish the hash counter and totals
+ *
+ * @param worker Worker
+ * @param backend Hash backend to scan with
+ * @param nonce First nonce
+ * @param count Nonces to check (1 .. MINER_WORKER_CHUNK)
+ * @param max_top_word Candidate threshold (see sha256d_check_nonce())
+ * @param mask Candidate bitmap relative to nonce
+ * @return Number of candidates
+ */
+uint32_t miner_worker_scan(miner_worker_t *worker, const hash_backend_t *backend, uint32_t nonce, uint32_t count,
+                           uint32_t max_top_word, uint32_t *mask);
+
+/**
+ * @brief Offer a digest as this worker's best share
+ *
+ * Compares the full 256-bit value against the worker's lowest hash so far
+ * and, if lower, records it and publishes its difficulty.
+ *
+ * @param worker Worker (called from its own thread only)
+ * @param hash 32-byte digest
+ * @return true if the hash is a new best
+ */
+bool miner_worker_offer_best(miner_worker_t *worker, const uint8_t *hash);
+
+/**
+ * @brief Candidate threshold under which a hash may beat the worker's best
+ */
+static inline uint32_t miner_worker_best_top_word(const miner_worker_t *worker)
+{
+    return target_top_word(&worker->best);
+}
+
+/**
+ * @brief Difficulty of the best share this worker has published
+ */
+double miner_worker_best(const miner_worker_t *worker);
+
+/**
+ * @brief Reset a stats reader to the workers' current counters
+ */
+void miner_stats_reset(miner_stats_reader_t *reader, const miner_worker_t *workers, size_t count);
+
+/**
+ * @brief Merge all workers' counters into the reader
+ *
+ * Must run at least once per 2^32 hashes of any single worker.
+ *
+ * @return Hashes since the previous collect
+ */
+uint64_t miner_stats_collect(miner_stats_reader_t *reader, const miner_worker_t *workers, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MINER_WORKER_H__
@@ -0,0 +1,263 @@
+/**
+ * @file pool_conn.c
+ * @brief Non-blocking pool connection shared by the Stratum v1 and V2 clients
+ */
+
+#include "pool_conn.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// lwIP never raises SIGPIPE; Linux does unless asked not to
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+void pool_conn_init(pool_conn_t *conn, const char *host, uint16_t port, const pool_conn_ops_t *ops, void *client,
+                    int mining_state, uint8_t *tx, size_t tx_size)
+{
+    memset(conn, 0, sizeof(*conn));
+    conn->host = host;
+    conn->port = port;
+    conn->ops = ops;
+    conn->client = client;
+    conn->mining_state = mining_state;
+    conn->fd = -1;
+    conn->tx = tx;
+    conn->tx_size = tx_size;
+    miner_lock_init(&conn->lock);
+}
+
+void pool_conn_set_state(pool_conn_t *conn, int state)
+{
+    miner_lock(&conn->lock);
+    conn->status.state = state;
+    miner_unlock(&conn->lock);
+}
+
+void pool_conn_disconnect(pool_conn_t *conn, bool failed)
+{
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    conn->tx_len = 0;
+    conn->deadline_us = miner_time_us() + POOL_CONN_RECONNECT_US;
+
+    miner_lock(&conn->lock);
+    conn->status.state = POOL_CONN_DISCONNECTED;
+    conn->status.reconnects += failed ? 1 : 0;
+    // Shares of this session cannot be submitted on the next one
+    conn->status.dropped += conn->queue_tail - conn->queue_head;
+    conn->queue_head = conn->queue_tail;
+    miner_unlock(&conn->lock);
+
+    if (conn->ops->closed != NULL) {
+        conn->ops->closed(conn->client);
+    }
+}
+
+static void pool_conn_fail(pool_conn_t *conn)
+{
+    pool_conn_disconnect(conn, true);
+}
+
+static void pool_conn_connect(pool_conn_t *conn)
+{
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char port[8];
+    int one = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%u", (unsigned)conn->port);
+    if (getaddrinfo(conn->host, port, &hints, &res) != 0 || res == NULL) {
+        pool_conn_fail(conn);
+        return;
+    }
+
+    conn->fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (conn->fd < 0) {
+        freeaddrinfo(res);
+        pool_conn_fail(conn);
+        return;
+    }
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL, 0) | O_NONBLOCK);
+    // Shares are small and latency-sensitive
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int rc = connect(conn->fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc == 0) {
+        conn->ops->connected(conn->client);
+    } else if (errno == EINPROGRESS) {
+        conn->deadline_us = miner_time_us() + POOL_CONN_CONNECT_TIMEOUT_US;
+        pool_conn_set_state(conn, POOL_CONN_CONNECTING);
+    } else {
+        pool_conn_fail(conn);
+    }
+}
+
+// Hand received data to the client's decoder
+static void pool_conn_receive(pool_conn_t *conn)
+{
+    ssize_t n = recv(conn->fd, conn->rx, sizeof(conn->rx), 0);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        pool_conn_fail(conn);
+        return;
+    }
+    if (n > 0) {
+        miner_lock(&conn->lock);
+        conn->status.rx_bytes += (uint64_t)n;
+        miner_unlock(&conn->lock);
+        conn->ops->received(conn->client, conn->rx, (size_t)n);
+    }
+}
+
+static void pool_conn_transmit(pool_conn_t *conn)
+{
+    ssize_t n = send(conn->fd, conn->tx, conn->tx_len, MSG_NOSIGNAL);
+
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            pool_conn_fail(conn);
+        }
+        return;
+    }
+    memmove(conn->tx, conn->tx + n, conn->tx_len - (size_t)n);
+    conn->tx_len -= (size_t)n;
+    miner_lock(&conn->lock);
+    conn->status.tx_bytes += (uint64_t)n;
+    miner_unlock(&conn->lock);
+}
+
+void pool_conn_poll(pool_conn_t *conn, uint32_t timeout_ms)
+{
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    fd_set rfds;
+    fd_set wfds;
+
+    if (conn->fd < 0) {
+        if (miner_time_us() >= conn->deadline_us) {
+            pool_conn_connect(conn);
+        }
+        if (conn->fd < 0) {
+            // Keep the caller's loop paced while there is no socket
+            select(0, NULL, NULL, NULL, &tv);
+            return;
+        }
+    }
+
+    if (conn->status.state == conn->mining_state) {
+        conn->ops->drain(conn->client);
+    }
+
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    FD_SET(conn->fd, &rfds);
+    if (conn->status.state == POOL_CONN_CONNECTING || conn->tx_len > 0) {
+        FD_SET(conn->fd, &wfds);
+    }
+    if (select(conn->fd + 1, &rfds, &wfds, NULL, &tv) < 0) {
+        if (errno != EINTR) {
+            pool_conn_fail(conn);
+        }
+        return;
+    }
+
+    if (conn->status.state == POOL_CONN_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+
+        if (!FD_ISSET(conn->fd, &wfds)) {
+            if (miner_time_us() >= conn->deadline_us) {
+                pool_conn_fail(conn);
+            }
+            return;
+        }
+        if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+            pool_conn_fail(conn);
+            return;
+        }
+        conn->ops->connected(conn->client);
+    }
+
+    if (conn->fd >= 0 && FD_ISSET(conn->fd, &rfds)) {
+        pool_conn_receive(conn);
+    }
+    if (conn->fd >= 0 && conn->tx_len > 0) {
+        pool_conn_transmit(conn);
+    }
+}
+
+bool pool_conn_peek_share(pool_conn_t *conn, stratum_share_t *share)
+{
+    bool queued;
+
+    miner_lock(&conn->lock);
+    queued = conn->queue_head != conn->queue_tail;
+    if (queued) {
+        *share = conn->queue[conn->queue_head % POOL_CONN_SUBMIT_QUEUE];
+    }
+    miner_unlock(&conn->lock);
+    return queued;
+}
+
+void pool_conn_pop_share(pool_conn_t *conn, bool submitted)
+{
+    miner_lock(&conn->lock);
+    conn->queue_head++;
+    if (submitted) {
+        conn->status.submitted++;
+    } else {
+        conn->status.dropped++;
+    }
+    miner_unlock(&conn->lock);
+}
+
+bool pool_conn_take_job(pool_conn_t *conn, uint32_t *seq, stratum_job_t *job)
+{
+    bool fresh;
+
+    // One copy of the ~1.1 KB template per job; jobs arrive every few seconds
+    miner_lock(&conn->lock);
+    fresh = conn->job.seq != *seq;
+    if (fresh) {
+        *job = conn->job;
+        *seq = job->seq;
+    }
+    miner_unlock(&conn->lock);
+    return fresh;
+}
+
+bool pool_conn_submit(pool_conn_t *conn, const stratum_share_t *share)
+{
+    bool queued;
+
+    miner_lock(&conn->lock);
+    queued = conn->queue_tail - conn->queue_head < POOL_CONN_SUBMIT_QUEUE &&
+             conn->status.state == conn->mining_state;
+    if (queued) {
+        conn->queue[conn->queue_tail++ % POOL_CONN_SUBMIT_QUEUE] = *share;
+    } else {
+        conn->status.dropped++;
+    }
+    miner_unlock(&conn->lock);
+    return queued;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file pool_conn.h
+ * @brief Non-blocking pool connection shared by the Stratum v1 and V2 clients
+ *
+ * Both pool clients (stratum.h, sv2.h) are a single event loop on one
+ * non-blocking TCP socket (lwIP on the board, BSD sockets on the host).
+ * This is that loop without the protocol: connecting with a timeout,
+ * reconnecting after POOL_CONN_RECONNECT_US, the transmit buffer, the
+ * slot the latest job is published in and the queue of shares waiting
+ * for the loop. The client supplies the framing through pool_conn_ops_t
+ * and its transmit buffer, so each protocol keeps its own buffer size.
+ *
+ * The event loop owns the socket and the transmit buffer. The job slot,
+ * the share queue and the status are shared with the miners under the
+ * connection's lock, which the client also uses for the counters only its
+ * protocol has. The client publishes jobs and counts the pool's verdicts
+ * in that status itself.
+ *
+ * Name resolution (getaddrinfo) is the one blocking call; it only runs
+ * when (re)connecting.
+ */
+
+#ifndef __POOL_CONN_H__
+#define __POOL_CONN_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "miner_port.h"
+#include "stratum_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Receive chunk: data is handed to the client's decoder as it arrives */
+#define POOL_CONN_RX_CHUNK          512
+
+/** Shares that can wait for the event loop */
+#define POOL_CONN_SUBMIT_QUEUE      16
+
+/** Delay before reconnecting after a failure */
+#ifndef POOL_CONN_RECONNECT_US
+#define POOL_CONN_RECONNECT_US      5000000
+#endif
+
+/** Time allowed for the TCP connect */
+#define POOL_CONN_CONNECT_TIMEOUT_US 10000000
+
+/** States every client starts with; each protocol numbers its own after them */
+#define POOL_CONN_DISCONNECTED      0   ///< Waiting to (re)connect
+#define POOL_CONN_CONNECTING        1   ///< TCP connect in progress
+
+/** A share to submit */
+typedef struct {
+    char job_id[STRATUM_JOB_ID_MAX];    ///< stratum_job_t.id of the job it was found in
+    uint64_t extranonce2;               ///< Extranonce2 of the rolled variant
+    uint32_t ntime;                     ///< Header time
+    uint32_t nonce;                     ///< Header nonce
+    uint32_t version;                   ///< Full header version
+} stratum_share_t;
+
+/** Protocol hooks, all called from the event loop */
+typedef struct {
+    void (*connected)(void *client);    ///< Socket connected: queue the handshake
+    void (*received)(void *client, const uint8_t *data, size_t len); ///< Data arrived
+    void (*drain)(void *client);        ///< In the mining state: frame queued shares
+    void (*closed)(void *client);       ///< Connection dropped: forget the session (may be NULL)
+} pool_conn_ops_t;
+
+/** Connection state and the counters both protocols keep */
+typedef struct {
+    int state;                          ///< POOL_CONN_* or the protocol's own state
+    uint32_t jobs;                      ///< Jobs published
+    uint32_t submitted;                 ///< Shares sent to the pool
+    uint32_t accepted;                  ///< Shares the pool accepted
+    uint32_t rejected;                  ///< Shares the pool rejected
+    uint32_t dropped;                   ///< Shares lost to a full queue or a closed connection
+    uint32_t reconnects;                ///< Connections lost or refused
+    double difficulty;                  ///< Current share difficulty
+    uint64_t rx_bytes;                  ///< Bytes received, all sessions
+    uint64_t tx_bytes;                  ///< Bytes sent, all sessions
+} pool_conn_status_t;
+
+typedef struct {
+    const char *host;
+    uint16_t port;
+    const pool_conn_ops_t *ops;
+    void *client;                       ///< Argument of the hooks
+    int mining_state;                   ///< State in which shares are queued and drained
+    int fd;
+    uint64_t deadline_us;               ///< Connect timeout, or when to reconnect
+    uint8_t rx[POOL_CONN_RX_CHUNK];
+    uint8_t *tx;                        ///< The client's transmit buffer
+    size_t tx_size;
+    size_t tx_len;
+
+    // Shared with the miners, under lock
+    miner_lock_t lock;
+    stratum_job_t job;                  ///< Latest published job
+    stratum_share_t queue[POOL_CONN_SUBMIT_QUEUE];
+    uint32_t queue_head;
+    uint32_t queue_tail;
+    pool_conn_status_t status;
+} pool_conn_t;
+
+/**
+ * @brief Initialize a connection; it connects on the first pool_conn_poll()
+ *
+ * @param conn Connection to initialize
+ * @param host Pool host name or address (must outlive the connection)
+ * @param port Pool port
+ * @param ops Protocol hooks
+ * @param client Argument of the hooks
+ * @param mining_state Client state in which shares are accepted
+ * @param tx Transmit buffer
+ * @param tx_size Its size
+ */
+void pool_conn_init(pool_conn_t *conn, const char *host, uint16_t port, const pool_conn_ops_t *ops, void *client,
+                    int mining_state, uint8_t *tx, size_t tx_size);
+
+/**
+ * @brief Run the event loop once
+ *
+ * Waits up to timeout_ms for the socket, then handles whatever is
+ * ready: connect completion, received data, queued shares and pending
+ * output.
+ */
+void pool_conn_poll(pool_conn_t *conn, uint32_t timeout_ms);
+
+/**
+ * @brief Drop the connection and schedule a reconnect (event loop only)
+ *
+ * Queued shares are dropped: they cannot be submitted on the next session.
+ *
+ * @param conn Connection
+ * @param failed Count it in reconnects (lost or refused, not closed by us)
+ */
+void pool_conn_disconnect(pool_conn_t *conn, bool failed);
+
+/**
+ * @brief Set the client state (event loop only)
+ */
+void pool_conn_set_state(pool_conn_t *conn, int state);
+
+/**
+ * @brief Room left in the transmit buffer, at conn->tx + conn->tx_len
+ */
+static inline size_t pool_conn_tx_room(const pool_conn_t *conn)
+{
+    return conn->tx_size - conn->tx_len;
+}
+
+/**
+ * @brief Look at the oldest queued share (event loop only)
+ *
+ * @return false if the queue is empty
+ */
+bool pool_conn_peek_share(pool_conn_t *conn, stratum_share_t *share);
+
+/**
+ * @brief Remove the oldest queued share, counting it submitted or dropped
+ *        (event loop only)
+ */
+void pool_conn_pop_share(pool_conn_t *conn, bool submitted);
+
+/**
+ * @brief Copy the latest job if it is newer than the one the caller has
+ *
+ * @param conn Connection
+ * @param seq Sequence number of the caller's job (0 for none); updated
+ * @param job Output job
+ * @return true if a newer job was copied
+ */
+bool pool_conn_take_job(pool_conn_t *conn, uint32_t *seq, stratum_job_t *job);
+
+/**
+ * @brief Queue a share for submission (safe to call from any thread)
+ *
+ * @return false if the queue is full or the client is not mining; the
+ *         share is counted as dropped
+ */
+bool pool_conn_submit(pool_conn_t *conn, const stratum_share_t *share);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __POOL_CONN_H__
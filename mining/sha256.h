@@ -0,0 +1,86 @@
+/**
+ * @file sha256.h
+ * @brief Portable streaming SHA-256 and SHA-256d for arbitrary-length messages
+ *
+ * Reference implementation used for everything that is not the per-nonce
+ * hot path: coinbase and merkle hashing, self-tests and cross-checking the
+ * specialized kernels in sha256d.h. Never allocates memory.
+ */
+
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Streaming SHA-256 context
+ *
+ * Plain data: copying a context snapshots the hash state, which is how a
+ * midstate for a fixed message prefix is cached.
+ */
+typedef struct {
+    uint32_t state[8];          /**< Intermediate hash value */
+    uint64_t length;            /**< Total message length in bytes */
+    uint8_t buffer[64];         /**< Pending partial block */
+} sha256_ctx_t;
+
+/**
+ * @brief Start a new SHA-256 computation
+ *
+ * @param ctx Context to initialize
+ */
+void sha256_init(sha256_ctx_t *ctx);
+
+/**
+ * @brief Absorb message bytes
+ *
+ * @param ctx Context
+ * @param data Message bytes
+ * @param len Number of bytes
+ */
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+
+/**
+ * @brief Finish the computation and write the digest
+ *
+ * @param ctx Context (must be re-initialized before reuse)
+ * @param hash Output buffer for the 32-byte digest
+ */
+void sha256_final(sha256_ctx_t *ctx, uint8_t *hash);
+
+/**
+ * @brief One-shot SHA-256
+ *
+ * @param data Message bytes
+ * @param len Number of bytes
+ * @param hash Output buffer for the 32-byte digest
+ */
+void sha256(const void *data, size_t len, uint8_t *hash);
+
+/**
+ * @brief Compress one 64-byte block into a hash state
+ *
+ * @param state Hash state, updated in place
+ * @param block 64-byte message block
+ */
+void sha256_transform(uint32_t *state, const uint8_t *block);
+
+/**
+ * @brief Double SHA256 hash: SHA256(SHA256(data))
+ *
+ * @param data Message bytes
+ * @param len Number of bytes
+ * @param hash Output buffer for the 32-byte digest
+ */
+void double_sha256(const uint8_t* data, size_t len, uint8_t* hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SHA256_H__
@@ -0,0 +1,275 @@
+/**
+ * @file sha256d.c
+ * @brief Fully unrolled SHA-256d implementation for 80-byte block headers
+ */
+
+#include "sha256d.h"
+#include <string.h>
+#include "miner_port.h"
+#include "miner_profile.h"
+#include "sha256d_rounds.h"
+
+/**
+ * @brief Run the 64 SHA-256 rounds on one 16-word block
+ *
+ * @param state Hash state, updated in place
+ * @param w Message block as big-endian words (clobbered by the expansion)
+ */
+static inline __attribute__((always_inline)) void sha256d_compress(uint32_t *state, uint32_t *w)
+{
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    ROUNDS_8(0, W_LOAD);
+    ROUNDS_8(8, W_LOAD);
+    ROUNDS_8(16, W_EXPAND);
+    ROUNDS_8(24, W_EXPAND);
+    ROUNDS_8(32, W_EXPAND);
+    ROUNDS_8(40, W_EXPAND);
+    ROUNDS_8(48, W_EXPAND);
+    ROUNDS_8(56, W_EXPAND);
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/**
+ * @brief Run the second SHA-256 over a first-hash state and write the digest
+ *
+ * @param state Final state of the first SHA-256 (clobbered)
+ * @param hash Output buffer for the 32-byte digest
+ */
+static inline __attribute__((always_inline)) void sha256d_second(uint32_t *state, uint8_t *hash)
+{
+    uint32_t w[16];
+
+    // Second SHA256: the 32-byte digest plus padding for 256 bits
+    memcpy(w, state, 32);
+    w[8] = 0x80000000;
+    memset(&w[9], 0, 6 * sizeof(uint32_t));
+    w[15] = 256;
+    memcpy(state, SHA256D_IV, 32);
+    sha256d_compress(state, w);
+
+    for (int i = 0; i < 8; i++) {
+        hash[i * 4] = (uint8_t)(state[i] >> 24);
+        hash[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        hash[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        hash[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
+
+/**
+ * @brief Hash the header tail from a given state and finish the double hash
+ *
+ * @param state SHA-256 state after header bytes 0-63 (clobbered)
+ * @param tail Header words 16-19 (merkle tail, time, bits, nonce)
+ * @param hash Output buffer for the 32-byte digest
+ */
+static inline __attribute__((always_inline)) void sha256d_finish(uint32_t *state, const uint32_t *tail,
+                                                                 uint8_t *hash)
+{
+    uint32_t w[16];
+
+    // First SHA256, block 2: header bytes 64-79 plus padding for 640 bits
+    w[0] = tail[0];
+    w[1] = tail[1];
+    w[2] = tail[2];
+    w[3] = tail[3];
+    w[4] = 0x80000000;
+    memset(&w[5], 0, 10 * sizeof(uint32_t));
+    w[15] = 640;
+    sha256d_compress(state, w);
+
+    sha256d_second(state, hash);
+}
+
+void sha256d_init(sha256d_ctx_t *ctx, const uint8_t *header)
+{
+    for (int i = 0; i < SHA256D_HEADER_SIZE / 4; i++) {
+        ctx->words[i] = ((uint32_t)header[i * 4] << 24) |
+                        ((uint32_t)header[i * 4 + 1] << 16) |
+                        ((uint32_t)header[i * 4 + 2] << 8) |
+                        (uint32_t)header[i * 4 + 3];
+    }
+    sha256d_update_midstate(ctx);
+}
+
+void sha256d_update_midstate(sha256d_ctx_t *ctx)
+{
+    uint32_t w[16];
+
+    memcpy(ctx->midstate, SHA256D_IV, sizeof(ctx->midstate));
+    memcpy(w, ctx->words, 64);
+    sha256d_compress(ctx->midstate, w);
+
+    sha256d_precompute(ctx);
+}
+
+void sha256d_precompute(sha256d_ctx_t *ctx)
+{
+    sha256d_precomp_t *pc = &ctx->precomp;
+    const uint32_t *tail = &ctx->words[16];
+    uint32_t a = ctx->midstate[0], b = ctx->midstate[1], c = ctx->midstate[2], d = ctx->midstate[3];
+    uint32_t e = ctx->midstate[4], f = ctx->midstate[5], g = ctx->midstate[6], h = ctx->midstate[7];
+
+    // Rounds 0-2 only consume the merkle tail, time and bits
+    ROUND(a, b, c, d, e, f, g, h, 0, tail[0]);
+    ROUND(h, a, b, c, d, e, f, g, 1, tail[1]);
+    ROUND(g, h, a, b, c, d, e, f, 2, tail[2]);
+
+    // Round 3 adds the nonce to t1; everything else in it is fixed per job.
+    // Variable roles for round 3 are (f, g, h, a, b, c, d, e).
+    uint32_t t1 = e + EP1(b) + CH(b, c, d) + SHA256D_K[3];
+    uint32_t t2 = EP0(f) + MAJ(f, g, h);
+    pc->state[0] = a + t1;
+    pc->state[1] = b;
+    pc->state[2] = c;
+    pc->state[3] = d;
+    pc->state[4] = t1 + t2;
+    pc->state[5] = f;
+    pc->state[6] = g;
+    pc->state[7] = h;
+
+    // Schedule words 16-19 with w[4] = 0x80000000, w[5..14] = 0, w[15] = 640
+    pc->w16 = tail[0] + SIG0(tail[1]);
+    pc->w17 = tail[1] + SIG0(tail[2]) + SIG1(640);
+    pc->w18_base = tail[2] + SIG1(pc->w16);
+    pc->w19_base = SIG0(0x80000000) + SIG1(pc->w17);
+}
+
+void IRAM_ATTR sha256d_hash(const sha256d_ctx_t *ctx, uint8_t *hash)
+{
+    uint32_t state[8];
+    uint32_t w[16];
+
+    // First SHA256, block 1: header bytes 0-63
+    memcpy(state, SHA256D_IV, sizeof(state));
+    memcpy(w, ctx->words, 64);
+    sha256d_compress(state, w);
+
+    sha256d_finish(state, &ctx->words[16], hash);
+}
+
+void IRAM_ATTR sha256d_hash_midstate(const sha256d_ctx_t *ctx, uint8_t *hash)
+{
+    uint32_t state[8];
+
+    memcpy(state, ctx->midstate, sizeof(state));
+    sha256d_finish(state, &ctx->words[16], hash);
+}
+
+/**
+ * @brief Finish the first SHA-256 for one nonce from the tail precomputation
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param n Nonce as a big-endian message word
+ * @param state Output: final state of the first SHA-256
+ */
+static inline __attribute__((always_inline)) void sha256d_tail_nonce(const sha256d_ctx_t *ctx, uint32_t n,
+                                                                     uint32_t *state)
+{
+    const sha256d_precomp_t *pc = &ctx->precomp;
+    uint32_t w[16];
+
+    // Rounds 0-2 and the fixed part of round 3 come from the job setup
+    uint32_t a = pc->state[0] + n, b = pc->state[1], c = pc->state[2], d = pc->state[3];
+    uint32_t e = pc->state[4] + n, f = pc->state[5], g = pc->state[6], h = pc->state[7];
+
+    // Rolling window positioned for round 4: slots 0-3 already hold words
+    // 16-19, slots 4-15 the constant padding words
+    w[0] = pc->w16;
+    w[1] = pc->w17;
+    w[2] = pc->w18_base + SIG0(n);
+    w[3] = pc->w19_base + n;
+    w[4] = 0x80000000;
+    memset(&w[5], 0, 10 * sizeof(uint32_t));
+    w[15] = 640;
+
+#define W_TAIL(i) ((i) < 20 ? w[(i) & 15] : W_EXPAND(i))
+    ROUND(e, f, g, h, a, b, c, d, 4, W_LOAD(4));
+    ROUND(d, e, f, g, h, a, b, c, 5, W_LOAD(5));
+    ROUND(c, d, e, f, g, h, a, b, 6, W_LOAD(6));
+    ROUND(b, c, d, e, f, g, h, a, 7, W_LOAD(7));
+    ROUNDS_8(8, W_LOAD);
+    ROUNDS_8(16, W_TAIL);
+    ROUNDS_8(24, W_EXPAND);
+    ROUNDS_8(32, W_EXPAND);
+    ROUNDS_8(40, W_EXPAND);
+    ROUNDS_8(48, W_EXPAND);
+    ROUNDS_8(56, W_EXPAND);
+#undef W_TAIL
+
+    state[0] = ctx->midstate[0] + a; state[1] = ctx->midstate[1] + b;
+    state[2] = ctx->midstate[2] + c; state[3] = ctx->midstate[3] + d;
+    state[4] = ctx->midstate[4] + e; state[5] = ctx->midstate[5] + f;
+    state[6] = ctx->midstate[6] + g; state[7] = ctx->midstate[7] + h;
+}
+
+/**
+ * @brief Run the second SHA-256 only as far as needed to obtain H7
+ *
+ * The final h register is the e value produced by round 60, so rounds 61-63
+ * (and their schedule words) can be skipped when only H7 is of interest.
+ *
+ * @param state Final state of the first SHA-256
+ * @return Digest word H7, i.e. bytes 28-31 of the hash in big-endian order
+ */
+static inline __attribute__((always_inline)) uint32_t sha256d_second_h7(const uint32_t *state)
+{
+    uint32_t w[16];
+    uint32_t a = SHA256D_IV[0], b = SHA256D_IV[1], c = SHA256D_IV[2], d = SHA256D_IV[3];
+    uint32_t e = SHA256D_IV[4], f = SHA256D_IV[5], g = SHA256D_IV[6], h = SHA256D_IV[7];
+
+    memcpy(w, state, 32);
+    w[8] = 0x80000000;
+    memset(&w[9], 0, 6 * sizeof(uint32_t));
+    w[15] = 256;
+
+    ROUNDS_8(0, W_LOAD);
+    ROUNDS_8(8, W_LOAD);
+    ROUNDS_8(16, W_EXPAND);
+    ROUNDS_8(24, W_EXPAND);
+    ROUNDS_8(32, W_EXPAND);
+    ROUNDS_8(40, W_EXPAND);
+    ROUNDS_8(48, W_EXPAND);
+    ROUND(a, b, c, d, e, f, g, h, 56, W_EXPAND(56));
+    ROUND(h, a, b, c, d, e, f, g, 57, W_EXPAND(57));
+    ROUND(g, h, a, b, c, d, e, f, 58, W_EXPAND(58));
+    ROUND(f, g, h, a, b, c, d, e, 59, W_EXPAND(59));
+    ROUND(e, f, g, h, a, b, c, d, 60, W_EXPAND(60));
+
+    return SHA256D_IV[7] + h;
+}
+
+void IRAM_ATTR sha256d_hash_nonce(const sha256d_ctx_t *ctx, uint32_t nonce, uint8_t *hash)
+{
+    uint32_t state[8];
+    MINER_PROFILE_START(t);
+
+    sha256d_tail_nonce(ctx, __builtin_bswap32(nonce), state);
+    MINER_PROFILE_LAP(MINER_STAGE_BLOCK2, t, 1);
+    sha256d_second(state, hash);
+    MINER_PROFILE_STOP(MINER_STAGE_DIGEST, t, 1);
+}
+
+bool IRAM_ATTR sha256d_check_nonce(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word,
+                                   uint8_t *hash)
+{
+    uint32_t state[8];
+    MINER_PROFILE_START(t);
+
+    sha256d_tail_nonce(ctx, __builtin_bswap32(nonce), state);
+    MINER_PROFILE_LAP(MINER_STAGE_BLOCK2, t, 1);
+
+    // The most significant 32 bits of the hash, read as a little-endian number
+    if (__builtin_bswap32(sha256d_second_h7(state)) > max_top_word) {
+        MINER_PROFILE_STOP(MINER_STAGE_DIGEST, t, 1);
+        return false;
+    }
+
+    // Rare candidate: run the complete second hash for the caller
+    sha256d_second(state, hash);
+    MINER_PROFILE_STOP(MINER_STAGE_DIGEST, t, 1);
+    return true;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file sha256d.h
+ * @brief Allocation-free SHA-256d engine for 80-byte Bitcoin block headers
+ *
+ * The generic double_sha256() path (sha256.h) streams arbitrary-length
+ * messages byte by byte. This engine instead keeps the header in a caller-owned context as
+ * pre-byteswapped (big-endian) 32-bit words, so the mining loop only has to
+ * patch the nonce word and run the fully unrolled compression rounds.
+ *
+ * The first 64 bytes of a header (version, previous hash and most of the
+ * merkle root) do not change while the nonce is iterated, so the state after
+ * compressing that block (the "midstate") is computed once per job and the
+ * per-nonce path only compresses the 16-byte tail plus the second SHA-256.
+ *
+ * Inside that tail block only word 3 (the nonce) changes between attempts.
+ * The job setup therefore also runs the first three rounds of the tail
+ * compression, folds the nonce-independent part of round 3, and expands the
+ * message schedule words that do not depend on the nonce, so the per-nonce
+ * kernel sha256d_hash_nonce() starts at round 3.
+ *
+ * For the vast majority of nonces the most significant word of the final
+ * hash is already above any useful target. sha256d_check_nonce() computes
+ * only the rounds that feed digest word H7 and completes the digest only for
+ * candidates that pass.
+ *
+ * The engine never allocates memory and produces exactly the same 32-byte
+ * digest as double_sha256(header, 80, hash).
+ */
+
+#ifndef __SHA256D_H__
+#define __SHA256D_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of a serialized Bitcoin block header in bytes */
+#define SHA256D_HEADER_SIZE     80
+
+/** Size of a SHA-256 digest in bytes */
+#define SHA256D_HASH_SIZE       32
+
+/** Index of the nonce word inside sha256d_ctx_t::words */
+#define SHA256D_NONCE_WORD      19
+
+/**
+ * @brief Nonce-independent part of the header tail compression
+ *
+ * Computed from the midstate and header words 16-18 (merkle tail, time, bits).
+ */
+typedef struct {
+    uint32_t state[8];      /**< Working variables after round 3, without the nonce term */
+    uint32_t w16;           /**< Message schedule word 16 */
+    uint32_t w17;           /**< Message schedule word 17 */
+    uint32_t w18_base;      /**< Word 18 without the sigma0(nonce) term */
+    uint32_t w19_base;      /**< Word 19 without the nonce term */
+} sha256d_precomp_t;
+
+/**
+ * @brief SHA-256d hashing state for a single block header
+ *
+ * Owned by the caller (typically on the mining task stack).
+ */
+typedef struct {
+    uint32_t words[SHA256D_HEADER_SIZE / 4];  /**< Header as big-endian 32-bit words */
+    uint32_t midstate[8];                     /**< SHA-256 state after header bytes 0-63 */
+    sha256d_precomp_t precomp;                /**< Nonce-independent tail rounds and schedule */
+} sha256d_ctx_t;
+
+/**
+ * @brief Load an 80-byte block header and run all per-job precomputation
+ *
+ * Call once per job; only the nonce changes afterwards.
+ *
+ * @param ctx Engine state to initialize
+ * @param header Serialized block header (80 bytes)
+ */
+void sha256d_init(sha256d_ctx_t *ctx, const uint8_t *header);
+
+/**
+ * @brief Recompute the cached midstate after changing words 0-15
+ *
+ * Only needed when the first 64 header bytes are edited in place
+ * (e.g. version or merkle root); sha256d_init() already does this.
+ * Also refreshes the tail precomputation, which depends on the midstate.
+ *
+ * @param ctx Engine state
+ */
+void sha256d_update_midstate(sha256d_ctx_t *ctx);
+
+/**
+ * @brief Recompute the nonce-independent tail rounds after changing words 16-18
+ *
+ * Needed when the merkle tail, time or bits are edited in place (e.g. ntime
+ * rolling). sha256d_init() and sha256d_update_midstate() already do this.
+ *
+ * @param ctx Engine state with a valid midstate
+ */
+void sha256d_precompute(sha256d_ctx_t *ctx);
+
+/**
+ * @brief Replace the nonce (header bytes 76-79) without reloading the header
+ *
+ * @param ctx Engine state
+ * @param nonce Nonce value as it would be stored little-endian in the header
+ */
+static inline void sha256d_set_nonce(sha256d_ctx_t *ctx, uint32_t nonce)
+{
+    ctx->words[SHA256D_NONCE_WORD] = __builtin_bswap32(nonce);
+}
+
+/**
+ * @brief Compute SHA256(SHA256(header)) for the loaded header
+ *
+ * @param ctx Engine state
+ * @param hash Output buffer for the 32-byte digest (same byte order as double_sha256)
+ */
+void sha256d_hash(const sha256d_ctx_t *ctx, uint8_t *hash);
+
+/**
+ * @brief Compute SHA256(SHA256(header)) starting from the cached midstate
+ *
+ * Compresses only the 16-byte header tail and the second SHA-256, i.e. two
+ * compressions per nonce instead of three. Same result as sha256d_hash().
+ *
+ * @param ctx Engine state with a valid midstate
+ * @param hash Output buffer for the 32-byte digest
+ */
+void sha256d_hash_midstate(const sha256d_ctx_t *ctx, uint8_t *hash);
+
+/**
+ * @brief Compute the double hash for a given nonce using the tail precomputation
+ *
+ * Starts the tail compression at round 3 and ignores the nonce stored in
+ * ctx->words, so the mining loop does not need to call sha256d_set_nonce().
+ * Same result as sha256d_hash() with that nonce set.
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param nonce Nonce value as it would be stored little-endian in the header
+ * @param hash Output buffer for the 32-byte digest
+ */
+void sha256d_hash_nonce(const sha256d_ctx_t *ctx, uint32_t nonce, uint8_t *hash);
+
+/**
+ * @brief Early-reject check: hash a nonce only as far as needed to compare H7
+ *
+ * The top word is the most significant 32 bits of the hash read as a
+ * little-endian 256-bit number (bytes 31..28), i.e. the bits counted first by
+ * count_leading_zeros(). Rounds 61-63 of the second SHA-256 are skipped for
+ * rejected nonces.
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param nonce Nonce value as it would be stored little-endian in the header
+ * @param max_top_word Largest top word that still counts as a candidate
+ * @param hash Output buffer for the 32-byte digest, written only on success
+ * @return true if the nonce is a candidate and @p hash holds its full digest
+ */
+bool sha256d_check_nonce(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word, uint8_t *hash);
+
+/**
+ * @brief Top-word limit for hashes with more than a given number of leading zeros
+ *
+ * @param zeros Number of leading zero bits that must be exceeded
+ * @return Limit to pass to sha256d_check_nonce()
+ */
+static inline uint32_t sha256d_top_word_limit(uint32_t zeros)
+{
+    return zeros >= 31 ? 0 : 0xFFFFFFFFu >> (zeros + 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SHA256D_H__
@@ -0,0 +1,179 @@
+/**
+ * @file sha256d_batch.c
+ * @brief Runtime-dispatched multi-lane SHA-256d batch checking
+ *
+ * The vector kernels are generated from sha256d_batch_kernel.h with GCC
+ * vector extensions and per-function target attributes, so no special
+ * compiler flags are needed and the binary still runs on CPUs without the
+ * wider instruction sets.
+ */
+
+#include "sha256d_batch.h"
+#include <string.h>
+#include "miner_port.h"
+#include "sha256d_rounds.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256D_BATCH_X86 1
+#else
+#define SHA256D_BATCH_X86 0
+#endif
+
+#if SHA256D_BATCH_X86
+
+typedef uint32_t batch_v4u32 __attribute__((vector_size(16)));
+typedef uint32_t batch_v8u32 __attribute__((vector_size(32)));
+typedef uint32_t batch_v16u32 __attribute__((vector_size(64)));
+
+#define BATCH_FN        sha256d_batch_sse41
+#define BATCH_VEC       batch_v4u32
+#define BATCH_LANES     4
+#define BATCH_TARGET    __attribute__((target("sse4.1")))
+#include "sha256d_batch_kernel.h"
+#undef BATCH_FN
+#undef BATCH_VEC
+#undef BATCH_LANES
+#undef BATCH_TARGET
+
+#define BATCH_FN        sha256d_batch_avx2
+#define BATCH_VEC       batch_v8u32
+#define BATCH_LANES     8
+#define BATCH_TARGET    __attribute__((target("avx2")))
+#include "sha256d_batch_kernel.h"
+#undef BATCH_FN
+#undef BATCH_VEC
+#undef BATCH_LANES
+#undef BATCH_TARGET
+
+#define BATCH_FN        sha256d_batch_avx512
+#define BATCH_VEC       batch_v16u32
+#define BATCH_LANES     16
+#define BATCH_TARGET    __attribute__((target("avx512f")))
+#include "sha256d_batch_kernel.h"
+#undef BATCH_FN
+#undef BATCH_VEC
+#undef BATCH_LANES
+#undef BATCH_TARGET
+
+#endif // SHA256D_BATCH_X86
+
+/**
+ * @brief Check a group of consecutive nonces, returning a lane bitmap
+ */
+typedef uint32_t (*batch_group_fn)(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word);
+
+bool sha256d_batch_supported(sha256d_batch_lanes_t lanes)
+{
+    switch (lanes) {
+    case SHA256D_BATCH_SCALAR:
+        return true;
+#if SHA256D_BATCH_X86
+    case SHA256D_BATCH_SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case SHA256D_BATCH_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SHA256D_BATCH_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+sha256d_batch_lanes_t sha256d_batch_detect(void)
+{
+    static const sha256d_batch_lanes_t preference[] = {
+        SHA256D_BATCH_AVX512, SHA256D_BATCH_AVX2, SHA256D_BATCH_SSE41
+    };
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        if (sha256d_batch_supported(preference[i])) {
+            return preference[i];
+        }
+    }
+    return SHA256D_BATCH_SCALAR;
+}
+
+const char *sha256d_batch_name(sha256d_batch_lanes_t lanes)
+{
+    switch (lanes) {
+    case SHA256D_BATCH_SCALAR:
+        return "scalar";
+    case SHA256D_BATCH_SSE41:
+        return "sse4.1x4";
+    case SHA256D_BATCH_AVX2:
+        return "avx2x8";
+    case SHA256D_BATCH_AVX512:
+        return "avx512x16";
+    default:
+        return "unknown";
+    }
+}
+
+static batch_group_fn batch_group_for(sha256d_batch_lanes_t lanes)
+{
+    if (!sha256d_batch_supported(lanes)) {
+        return NULL;
+    }
+    switch (lanes) {
+#if SHA256D_BATCH_X86
+    case SHA256D_BATCH_SSE41:
+        return sha256d_batch_sse41;
+    case SHA256D_BATCH_AVX2:
+        return sha256d_batch_avx2;
+    case SHA256D_BATCH_AVX512:
+        return sha256d_batch_avx512;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+uint32_t sha256d_batch_with(const sha256d_batch_job_t *job, sha256d_batch_lanes_t lanes,
+                            uint32_t nonce_start, uint32_t count, uint32_t *out_mask)
+{
+    batch_group_fn group = batch_group_for(lanes);
+    uint32_t width = group ? (uint32_t)lanes : 1;
+    uint32_t candidates = 0;
+    uint32_t i = 0;
+    uint8_t hash[32];
+
+    memset(out_mask, 0, SHA256D_BATCH_MASK_WORDS(count) * sizeof(uint32_t));
+
+    // Whole vector groups; widths divide 32, so a group never straddles a mask word
+    if (group != NULL) {
+        for (; count - i >= width; i += width) {
+            uint32_t bits = group(&job->ctx, nonce_start + i, job->max_top_word);
+            if (bits != 0) {
+                out_mask[i / 32] |= bits << (i % 32);
+                candidates += (uint32_t)__builtin_popcount(bits);
+            }
+        }
+    }
+
+    // Remainder (or everything, for the scalar variant)
+    for (; i < count; i++) {
+        if (sha256d_check_nonce(&job->ctx, nonce_start + i, job->max_top_word, hash)) {
+            out_mask[i / 32] |= 1u << (i % 32);
+            candidates++;
+        }
+    }
+
+    return candidates;
+}
+
+uint32_t sha256d_batch(const sha256d_batch_job_t *job, uint32_t nonce_start, uint32_t count,
+                       uint32_t *out_mask)
+{
+    static sha256d_batch_lanes_t selected;
+    // Detected on first use from any thread. CPU features never change, so
+    // racing first calls store the same value; relaxed atomics keep the
+    // accesses themselves well-defined.
+    sha256d_batch_lanes_t lanes = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+
+    if (lanes == 0) {
+        lanes = sha256d_batch_detect();
+        __atomic_store_n(&selected, lanes, __ATOMIC_RELAXED);
+    }
+    return sha256d_batch_with(job, lanes, nonce_start, count, out_mask);
+}
@@ -0,0 +1,105 @@
+/**
+ * @file sha256d_batch.h
+ * @brief Multi-lane SHA-256d batch checking for host-side mining and share verification
+ *
+ * Hashes runs of consecutive nonces in parallel vector lanes (4 with SSE4.1,
+ * 8 with AVX2, 16 with AVX-512) and reports which nonces are candidates
+ * under a top-word threshold, exactly like sha256d_check_nonce(). The lane
+ * width is selected at runtime from the CPU features; every build has the
+ * scalar fallback, which is the only variant on the ESP32.
+ *
+ * Only the candidate decision is vectorized: callers recompute the full
+ * digest of the (rare) candidates with sha256d_hash_nonce().
+ */
+
+#ifndef __SHA256D_BATCH_H__
+#define __SHA256D_BATCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sha256d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Batch kernel variants, named by their lane count
+ */
+typedef enum {
+    SHA256D_BATCH_SCALAR = 1,   /**< Portable scalar loop over sha256d_check_nonce() */
+    SHA256D_BATCH_SSE41 = 4,    /**< 4 lanes, x86 SSE4.1 */
+    SHA256D_BATCH_AVX2 = 8,     /**< 8 lanes, x86 AVX2 */
+    SHA256D_BATCH_AVX512 = 16   /**< 16 lanes, x86 AVX-512F */
+} sha256d_batch_lanes_t;
+
+/**
+ * @brief A prepared header plus the candidate threshold
+ */
+typedef struct {
+    sha256d_ctx_t ctx;          /**< Header with midstate and precomputation (sha256d_init()) */
+    uint32_t max_top_word;      /**< Largest top word that counts as a candidate */
+} sha256d_batch_job_t;
+
+/**
+ * @brief Number of 32-bit mask words needed for @p count nonces
+ */
+#define SHA256D_BATCH_MASK_WORDS(count)  (((count) + 31) / 32)
+
+/**
+ * @brief Check whether a batch variant can run on this CPU
+ *
+ * @param lanes Variant to query
+ * @return true if the variant is compiled in and supported by the CPU
+ */
+bool sha256d_batch_supported(sha256d_batch_lanes_t lanes);
+
+/**
+ * @brief Widest batch variant supported by this CPU
+ *
+ * @return Selected variant (SHA256D_BATCH_SCALAR if no vector unit is usable)
+ */
+sha256d_batch_lanes_t sha256d_batch_detect(void);
+
+/**
+ * @brief Human-readable name of a batch variant
+ *
+ * @param lanes Variant
+ * @return Static string such as "avx2x8"
+ */
+const char *sha256d_batch_name(sha256d_batch_lanes_t lanes);
+
+/**
+ * @brief Check @p count consecutive nonces with the widest supported variant
+ *
+ * @param job Prepared header and threshold
+ * @param nonce_start First nonce (wraps around after 0xFFFFFFFF)
+ * @param count Number of nonces
+ * @param out_mask Output bitmap of SHA256D_BATCH_MASK_WORDS(count) words:
+ *                 bit (i % 32) of word (i / 32) is set if nonce_start + i is a candidate
+ * @return Number of candidates
+ */
+uint32_t sha256d_batch(const sha256d_batch_job_t *job, uint32_t nonce_start, uint32_t count,
+                       uint32_t *out_mask);
+
+/**
+ * @brief Same as sha256d_batch() with an explicitly chosen variant
+ *
+ * Used by tests and benchmarks to compare lane widths on identical input.
+ * An unsupported variant falls back to the scalar loop.
+ *
+ * @param job Prepared header and threshold
+ * @param lanes Variant to use
+ * @param nonce_start First nonce
+ * @param count Number of nonces
+ * @param out_mask Output bitmap (see sha256d_batch())
+ * @return Number of candidates
+ */
+uint32_t sha256d_batch_with(const sha256d_batch_job_t *job, sha256d_batch_lanes_t lanes,
+                            uint32_t nonce_start, uint32_t count, uint32_t *out_mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SHA256D_BATCH_H__
@@ -0,0 +1,112 @@
+/**
+ * @file sha256d_batch_kernel.h
+ * @brief Lane-parallel SHA-256d check kernel template (internal)
+ *
+ * Included by sha256d_batch.c once per vector width with these defined:
+ * - BATCH_FN:     name of the generated function
+ * - BATCH_VEC:    GCC vector type of BATCH_LANES uint32_t lanes
+ * - BATCH_LANES:  number of lanes (consecutive nonces per call)
+ * - BATCH_TARGET: function attribute enabling the instruction set
+ *
+ * Each lane runs the same algorithm as sha256d_check_nonce(): the tail
+ * compression starts at round 3 from the per-job precomputation and the
+ * second SHA-256 stops at round 60, where H7 is known.
+ */
+
+/**
+ * @brief Check BATCH_LANES consecutive nonces
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param nonce First nonce of the group
+ * @param max_top_word Candidate threshold (see sha256d_check_nonce())
+ * @return Bit i set if nonce + i is a candidate
+ */
+static BATCH_TARGET uint32_t BATCH_FN(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    const sha256d_precomp_t *pc = &ctx->precomp;
+    uint32_t lanes[BATCH_LANES];
+    BATCH_VEC n;
+    BATCH_VEC w[16];
+    BATCH_VEC state[8];
+    const BATCH_VEC zero = { 0 };
+
+    for (int i = 0; i < BATCH_LANES; i++) {
+        lanes[i] = __builtin_bswap32(nonce + (uint32_t)i);
+    }
+    memcpy(&n, lanes, sizeof(n));
+
+    // First SHA-256, header tail: rounds 0-2 and the fixed part of round 3
+    // are shared by all lanes
+    BATCH_VEC a = zero + pc->state[0] + n, b = zero + pc->state[1];
+    BATCH_VEC c = zero + pc->state[2], d = zero + pc->state[3];
+    BATCH_VEC e = zero + pc->state[4] + n, f = zero + pc->state[5];
+    BATCH_VEC g = zero + pc->state[6], h = zero + pc->state[7];
+
+    w[0] = zero + pc->w16;
+    w[1] = zero + pc->w17;
+    w[2] = zero + pc->w18_base + SIG0(n);
+    w[3] = zero + pc->w19_base + n;
+    w[4] = zero + 0x80000000;
+    for (int i = 5; i < 15; i++) {
+        w[i] = zero;
+    }
+    w[15] = zero + 640;
+
+#define W_TAIL(i) ((i) < 20 ? w[(i) & 15] : W_EXPAND(i))
+    ROUND(e, f, g, h, a, b, c, d, 4, W_LOAD(4));
+    ROUND(d, e, f, g, h, a, b, c, 5, W_LOAD(5));
+    ROUND(c, d, e, f, g, h, a, b, 6, W_LOAD(6));
+    ROUND(b, c, d, e, f, g, h, a, 7, W_LOAD(7));
+    ROUNDS_8(8, W_LOAD);
+    ROUNDS_8(16, W_TAIL);
+    ROUNDS_8(24, W_EXPAND);
+    ROUNDS_8(32, W_EXPAND);
+    ROUNDS_8(40, W_EXPAND);
+    ROUNDS_8(48, W_EXPAND);
+    ROUNDS_8(56, W_EXPAND);
+#undef W_TAIL
+
+    state[0] = a + ctx->midstate[0]; state[1] = b + ctx->midstate[1];
+    state[2] = c + ctx->midstate[2]; state[3] = d + ctx->midstate[3];
+    state[4] = e + ctx->midstate[4]; state[5] = f + ctx->midstate[5];
+    state[6] = g + ctx->midstate[6]; state[7] = h + ctx->midstate[7];
+
+    // Second SHA-256 up to round 60, which yields the final h register
+    for (int i = 0; i < 8; i++) {
+        w[i] = state[i];
+    }
+    w[8] = zero + 0x80000000;
+    for (int i = 9; i < 15; i++) {
+        w[i] = zero;
+    }
+    w[15] = zero + 256;
+
+    a = zero + SHA256D_IV[0]; b = zero + SHA256D_IV[1];
+    c = zero + SHA256D_IV[2]; d = zero + SHA256D_IV[3];
+    e = zero + SHA256D_IV[4]; f = zero + SHA256D_IV[5];
+    g = zero + SHA256D_IV[6]; h = zero + SHA256D_IV[7];
+
+    ROUNDS_8(0, W_LOAD);
+    ROUNDS_8(8, W_LOAD);
+    ROUNDS_8(16, W_EXPAND);
+    ROUNDS_8(24, W_EXPAND);
+    ROUNDS_8(32, W_EXPAND);
+    ROUNDS_8(40, W_EXPAND);
+    ROUNDS_8(48, W_EXPAND);
+    ROUND(a, b, c, d, e, f, g, h, 56, W_EXPAND(56));
+    ROUND(h, a, b, c, d, e, f, g, 57, W_EXPAND(57));
+    ROUND(g, h, a, b, c, d, e, f, 58, W_EXPAND(58));
+    ROUND(f, g, h, a, b, c, d, e, 59, W_EXPAND(59));
+    ROUND(e, f, g, h, a, b, c, d, 60, W_EXPAND(60));
+
+    h += SHA256D_IV[7];
+    memcpy(lanes, &h, sizeof(lanes));
+
+    uint32_t mask = 0;
+    for (int i = 0; i < BATCH_LANES; i++) {
+        if (__builtin_bswap32(lanes[i]) <= max_top_word) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file sha256d_nway.c
+ * @brief Interleaved 2-way and 4-way scalar SHA-256d check kernels
+ */
+
+#include "sha256d_nway.h"
+#include <string.h>
+#include "miner_port.h"
+#include "sha256d_rounds.h"
+
+// Both widths take part in the boot-time backend selection, so both run from IRAM
+#define NWAY_FN         sha256d_check_nonce_x2
+#define NWAY_LANES      2
+#define NWAY_ATTR       IRAM_ATTR
+#include "sha256d_nway_kernel.h"
+#undef NWAY_FN
+#undef NWAY_LANES
+#undef NWAY_ATTR
+
+#define NWAY_FN         sha256d_check_nonce_x4
+#define NWAY_LANES      4
+#define NWAY_ATTR       IRAM_ATTR
+#include "sha256d_nway_kernel.h"
+#undef NWAY_FN
+#undef NWAY_LANES
+#undef NWAY_ATTR
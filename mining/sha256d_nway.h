@@ -0,0 +1,86 @@
+/**
+ * @file sha256d_nway.h
+ * @brief Interleaved (2-way / 4-way) scalar SHA-256d check kernels
+ *
+ * A single SHA-256 round is a long dependency chain, which leaves issue
+ * slots idle on in-order cores such as the Xtensa LX7. These kernels advance
+ * two or four independent nonces through the compression together in plain
+ * C (no intrinsics), giving the compiler independent instructions to
+ * schedule between the dependent ones while the working variables of all
+ * lanes stay in the register file.
+ *
+ * Each lane makes the same decision as sha256d_check_nonce(); candidates are
+ * reported as a lane bitmap and their full digest is recomputed with
+ * sha256d_hash_nonce().
+ *
+ * Both widths are always built and registered as hash backends (see
+ * hash_backend.h), so the firmware measures them at boot. Callers that want
+ * one fixed width use sha256d_check_nonce_nway(), selected at compile time
+ * through SHA256D_INTERLEAVE (1, 2 or 4, default 1). Out-of-order hosts with
+ * few registers gain nothing (the extra lanes spill).
+ */
+
+#ifndef __SHA256D_NWAY_H__
+#define __SHA256D_NWAY_H__
+
+#include <stdint.h>
+#include "sha256d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Interleave width used by sha256d_check_nonce_nway() (1, 2 or 4) */
+#ifndef SHA256D_INTERLEAVE
+#define SHA256D_INTERLEAVE      1
+#endif
+
+#if SHA256D_INTERLEAVE != 1 && SHA256D_INTERLEAVE != 2 && SHA256D_INTERLEAVE != 4
+#error "SHA256D_INTERLEAVE must be 1, 2 or 4"
+#endif
+
+/**
+ * @brief Check two consecutive nonces with an interleaved kernel
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param nonce First nonce (lane 0); lane 1 is nonce + 1
+ * @param max_top_word Candidate threshold (see sha256d_check_nonce())
+ * @return Bit i set if nonce + i is a candidate
+ */
+uint32_t sha256d_check_nonce_x2(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word);
+
+/**
+ * @brief Check four consecutive nonces with an interleaved kernel
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param nonce First nonce (lane 0); lanes 1-3 are nonce + 1 .. nonce + 3
+ * @param max_top_word Candidate threshold (see sha256d_check_nonce())
+ * @return Bit i set if nonce + i is a candidate
+ */
+uint32_t sha256d_check_nonce_x4(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word);
+
+/**
+ * @brief Check SHA256D_INTERLEAVE consecutive nonces with the configured kernel
+ *
+ * @param ctx Engine state with valid midstate and precomputation
+ * @param nonce First nonce
+ * @param max_top_word Candidate threshold (see sha256d_check_nonce())
+ * @return Bit i set if nonce + i is a candidate
+ */
+#if SHA256D_INTERLEAVE == 1
+static inline uint32_t sha256d_check_nonce_nway(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+    return sha256d_check_nonce(ctx, nonce, max_top_word, hash) ? 1u : 0u;
+}
+#elif SHA256D_INTERLEAVE == 2
+#define sha256d_check_nonce_nway    sha256d_check_nonce_x2
+#else
+#define sha256d_check_nonce_nway    sha256d_check_nonce_x4
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SHA256D_NWAY_H__
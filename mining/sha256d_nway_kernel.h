@@ -0,0 +1,122 @@
+/**
+ * @file sha256d_nway_kernel.h
+ * @brief Interleaved scalar SHA-256d check kernel template (internal)
+ *
+ * Included by sha256d_nway.c once per width with these defined:
+ * - NWAY_FN:    name of the generated function
+ * - NWAY_LANES: number of interleaved nonces
+ * - NWAY_ATTR:  placement attribute (IRAM_ATTR: every width takes part in
+ *               the boot-time backend selection)
+ *
+ * Working variables are small per-lane arrays and every round loops over the
+ * lanes; the loops are fully unrolled, so after scalar replacement each lane
+ * lives in its own registers and the rounds of different lanes interleave.
+ */
+
+#define NW_LOAD(i)      (w[l][i])
+#define NW_EXPAND(i)    (w[l][(i) & 15] += SIG1(w[l][((i) - 2) & 15]) + w[l][((i) - 7) & 15] + \
+                                           SIG0(w[l][((i) - 15) & 15]))
+#define NW_TAIL(i)      ((i) < 20 ? w[l][(i) & 15] : NW_EXPAND(i))
+
+#define NW_ROUND(a, b, c, d, e, f, g, h, i, W)                                      \
+    _Pragma("GCC unroll 4")                                                         \
+    for (int l = 0; l < NWAY_LANES; l++) {                                          \
+        uint32_t t1 = h[l] + EP1(e[l]) + CH(e[l], f[l], g[l]) + SHA256D_K[i] + W(i); \
+        uint32_t t2 = EP0(a[l]) + MAJ(a[l], b[l], c[l]);                            \
+        d[l] += t1;                                                                 \
+        h[l] = t1 + t2;                                                             \
+    }
+
+#define NW_ROUNDS_8(i, W)                              \
+    NW_ROUND(a, b, c, d, e, f, g, h, (i) + 0, W)       \
+    NW_ROUND(h, a, b, c, d, e, f, g, (i) + 1, W)       \
+    NW_ROUND(g, h, a, b, c, d, e, f, (i) + 2, W)       \
+    NW_ROUND(f, g, h, a, b, c, d, e, (i) + 3, W)       \
+    NW_ROUND(e, f, g, h, a, b, c, d, (i) + 4, W)       \
+    NW_ROUND(d, e, f, g, h, a, b, c, (i) + 5, W)       \
+    NW_ROUND(c, d, e, f, g, h, a, b, (i) + 6, W)       \
+    NW_ROUND(b, c, d, e, f, g, h, a, (i) + 7, W)
+
+NWAY_ATTR uint32_t NWAY_FN(const sha256d_ctx_t *ctx, uint32_t nonce, uint32_t max_top_word)
+{
+    const sha256d_precomp_t *pc = &ctx->precomp;
+    uint32_t a[NWAY_LANES], b[NWAY_LANES], c[NWAY_LANES], d[NWAY_LANES];
+    uint32_t e[NWAY_LANES], f[NWAY_LANES], g[NWAY_LANES], h[NWAY_LANES];
+    uint32_t w[NWAY_LANES][16];
+    uint32_t mask = 0;
+
+    // First SHA-256, header tail: start at round 4 from the precomputation
+    _Pragma("GCC unroll 4")
+    for (int l = 0; l < NWAY_LANES; l++) {
+        uint32_t n = __builtin_bswap32(nonce + (uint32_t)l);
+
+        a[l] = pc->state[0] + n; b[l] = pc->state[1]; c[l] = pc->state[2]; d[l] = pc->state[3];
+        e[l] = pc->state[4] + n; f[l] = pc->state[5]; g[l] = pc->state[6]; h[l] = pc->state[7];
+
+        w[l][0] = pc->w16;
+        w[l][1] = pc->w17;
+        w[l][2] = pc->w18_base + SIG0(n);
+        w[l][3] = pc->w19_base + n;
+        w[l][4] = 0x80000000;
+        for (int i = 5; i < 15; i++) {
+            w[l][i] = 0;
+        }
+        w[l][15] = 640;
+    }
+
+    NW_ROUND(e, f, g, h, a, b, c, d, 4, NW_LOAD)
+    NW_ROUND(d, e, f, g, h, a, b, c, 5, NW_LOAD)
+    NW_ROUND(c, d, e, f, g, h, a, b, 6, NW_LOAD)
+    NW_ROUND(b, c, d, e, f, g, h, a, 7, NW_LOAD)
+    NW_ROUNDS_8(8, NW_LOAD)
+    NW_ROUNDS_8(16, NW_TAIL)
+    NW_ROUNDS_8(24, NW_EXPAND)
+    NW_ROUNDS_8(32, NW_EXPAND)
+    NW_ROUNDS_8(40, NW_EXPAND)
+    NW_ROUNDS_8(48, NW_EXPAND)
+    NW_ROUNDS_8(56, NW_EXPAND)
+
+    // Second SHA-256 over the first digest, up to round 60 (final h)
+    _Pragma("GCC unroll 4")
+    for (int l = 0; l < NWAY_LANES; l++) {
+        w[l][0] = ctx->midstate[0] + a[l]; w[l][1] = ctx->midstate[1] + b[l];
+        w[l][2] = ctx->midstate[2] + c[l]; w[l][3] = ctx->midstate[3] + d[l];
+        w[l][4] = ctx->midstate[4] + e[l]; w[l][5] = ctx->midstate[5] + f[l];
+        w[l][6] = ctx->midstate[6] + g[l]; w[l][7] = ctx->midstate[7] + h[l];
+        w[l][8] = 0x80000000;
+        for (int i = 9; i < 15; i++) {
+            w[l][i] = 0;
+        }
+        w[l][15] = 256;
+
+        a[l] = SHA256D_IV[0]; b[l] = SHA256D_IV[1]; c[l] = SHA256D_IV[2]; d[l] = SHA256D_IV[3];
+        e[l] = SHA256D_IV[4]; f[l] = SHA256D_IV[5]; g[l] = SHA256D_IV[6]; h[l] = SHA256D_IV[7];
+    }
+
+    NW_ROUNDS_8(0, NW_LOAD)
+    NW_ROUNDS_8(8, NW_LOAD)
+    NW_ROUNDS_8(16, NW_EXPAND)
+    NW_ROUNDS_8(24, NW_EXPAND)
+    NW_ROUNDS_8(32, NW_EXPAND)
+    NW_ROUNDS_8(40, NW_EXPAND)
+    NW_ROUNDS_8(48, NW_EXPAND)
+    NW_ROUND(a, b, c, d, e, f, g, h, 56, NW_EXPAND)
+    NW_ROUND(h, a, b, c, d, e, f, g, 57, NW_EXPAND)
+    NW_ROUND(g, h, a, b, c, d, e, f, 58, NW_EXPAND)
+    NW_ROUND(f, g, h, a, b, c, d, e, 59, NW_EXPAND)
+    NW_ROUND(e, f, g, h, a, b, c, d, 60, NW_EXPAND)
+
+    _Pragma("GCC unroll 4")
+    for (int l = 0; l < NWAY_LANES; l++) {
+        if (__builtin_bswap32(SHA256D_IV[7] + h[l]) <= max_top_word) {
+            mask |= 1u << l;
+        }
+    }
+    return mask;
+}
+
+#undef NW_LOAD
+#undef NW_EXPAND
+#undef NW_TAIL
+#undef NW_ROUND
+#undef NW_ROUNDS_8
@@ -0,0 +1,76 @@
+/**
+ * @file sha256d_rounds.h
+ * @brief SHA-256 constants and round macros shared by the SHA-256d kernels
+ *
+ * Internal to the mining core. The macros expect working variables named
+ * a-h and a rolling 16-entry message window named w in the calling scope.
+ * They only use +, ^, &, |, >> and <<, so they work for uint32_t as well as
+ * GCC vector types holding several independent lanes.
+ */
+
+#ifndef __SHA256D_ROUNDS_H__
+#define __SHA256D_ROUNDS_H__
+
+#include <stdint.h>
+#include "miner_port.h"
+
+/**
+ * @brief SHA-256 round constants (FIPS 180-4, section 4.2.2)
+ *
+ * Kept in DRAM so the hot loop does not go through the flash cache.
+ */
+DRAM_ATTR static const uint32_t SHA256D_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * @brief SHA-256 initial hash value (FIPS 180-4, section 5.3.3)
+ */
+DRAM_ATTR static const uint32_t SHA256D_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define EP0(x)      (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define EP1(x)      (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SIG0(x)     (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SIG1(x)     (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+// One compression round; the caller rotates the variable names instead of
+// shuffling eight registers every round. The temporaries take the type of the
+// working variables, so the same macros serve scalar and vector kernels.
+#define ROUND(a, b, c, d, e, f, g, h, i, wi)                                    \
+    do {                                                                        \
+        __typeof__(h) t1 = (h) + EP1(e) + CH(e, f, g) + SHA256D_K[i] + (wi);    \
+        __typeof__(h) t2 = EP0(a) + MAJ(a, b, c);                               \
+        (d) += t1;                                                              \
+        (h) = t1 + t2;                                                          \
+    } while (0)
+
+// Message words: the first 16 come straight from the block, the rest are
+// expanded in place over a rolling 16-word window
+#define W_LOAD(i)   (w[i])
+#define W_EXPAND(i) (w[(i) & 15] += SIG1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + \
+                                    SIG0(w[((i) - 15) & 15]))
+
+#define ROUNDS_8(i, W)                              \
+    ROUND(a, b, c, d, e, f, g, h, (i) + 0, W((i) + 0)); \
+    ROUND(h, a, b, c, d, e, f, g, (i) + 1, W((i) + 1)); \
+    ROUND(g, h, a, b, c, d, e, f, (i) + 2, W((i) + 2)); \
+    ROUND(f, g, h, a, b, c, d, e, (i) + 3, W((i) + 3)); \
+    ROUND(e, f, g, h, a, b, c, d, (i) + 4, W((i) + 4)); \
+    ROUND(d, e, f, g, h, a, b, c, (i) + 5, W((i) + 5)); \
+    ROUND(c, d, e, f, g, h, a, b, (i) + 6, W((i) + 6)); \
+    ROUND(b, c, d, e, f, g, h, a, (i) + 7, W((i) + 7))
+
+#endif // __SHA256D_ROUNDS_H__
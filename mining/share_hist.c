@@ -0,0 +1,208 @@
+/**
+ * @file share_hist.c
+ * @brief Share-difficulty histograms and the hashrate they imply
+ */
+
+#include "share_hist.h"
+#include <math.h>
+#include <string.h>
+
+uint32_t share_hist_bin(double difficulty)
+{
+    int exp;
+
+    if (!(difficulty > 0)) {
+        return 0;
+    }
+    // difficulty = m * 2^exp with 0.5 <= m < 1: floor(log2) is exp - 1
+    frexp(difficulty, &exp);
+    exp -= 1 + SHARE_HIST_MIN_EXP;
+    if (exp < 0) {
+        return 0;
+    }
+    return exp < SHARE_HIST_BINS ? (uint32_t)exp : SHARE_HIST_BINS - 1;
+}
+
+uint32_t share_hist_floor(double share_difficulty)
+{
+    int exp;
+
+    if (!(share_difficulty > 0)) {
+        return 1;
+    }
+    // ceil(log2): powers of two (m == 0.5) are their own floor
+    if (frexp(share_difficulty, &exp) == 0.5) {
+        exp--;
+    }
+    exp -= SHARE_HIST_MIN_EXP;
+    if (exp < 1) {
+        return 1;
+    }
+    return exp < SHARE_HIST_BINS ? (uint32_t)exp : SHARE_HIST_BINS - 1;
+}
+
+double share_hist_work(uint32_t bin)
+{
+    // D * 2^48 / 0xFFFF
+    return ldexp(65536.0 / 65535.0, (int)bin + SHARE_HIST_MIN_EXP + 32);
+}
+
+void share_hist_init(share_hist_t *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+// Sequence lock around the worker's writes, as in miner_worker_add_totals()
+static inline uint32_t hist_write_begin(share_hist_t *hist)
+{
+    uint32_t seq = hist->seq;
+
+    __atomic_store_n(&hist->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return seq;
+}
+
+static inline void hist_write_end(share_hist_t *hist, uint32_t seq)
+{
+    __atomic_store_n(&hist->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void share_hist_start_job(share_hist_t *hist, uint32_t job_id, uint32_t job_floor)
+{
+    uint32_t seq;
+
+    if (hist->job_id == job_id) {
+        return;
+    }
+    seq = hist_write_begin(hist);
+    __atomic_store_n(&hist->job_id, job_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->job_floor, job_floor, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < SHARE_HIST_BINS; i++) {
+        __atomic_store_n(&hist->job_bins[i], 0, __ATOMIC_RELAXED);
+    }
+    hist_write_end(hist, seq);
+}
+
+void share_hist_add(share_hist_t *hist, double difficulty)
+{
+    uint32_t bin = share_hist_bin(difficulty);
+    // Sole writer: plain reads of our own words are safe
+    uint32_t job_floor = hist->job_floor;
+    uint32_t seq = hist_write_begin(hist);
+
+    __atomic_store_n(&hist->job_bins[bin], hist->job_bins[bin] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->bins[bin], hist->bins[bin] + 1, __ATOMIC_RELAXED);
+    if (bin >= job_floor) {
+        __atomic_store_n(&hist->credited[job_floor], hist->credited[job_floor] + 1, __ATOMIC_RELAXED);
+    }
+    hist_write_end(hist, seq);
+}
+
+void share_hist_read(const share_hist_t *hist, share_hist_t *copy)
+{
+    while (1) {
+        uint32_t seq = __atomic_load_n(&hist->seq, __ATOMIC_ACQUIRE);
+
+        copy->seq = 0;
+        copy->job_id = __atomic_load_n(&hist->job_id, __ATOMIC_RELAXED);
+        copy->job_floor = __atomic_load_n(&hist->job_floor, __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < SHARE_HIST_BINS; i++) {
+            copy->job_bins[i] = __atomic_load_n(&hist->job_bins[i], __ATOMIC_RELAXED);
+            copy->bins[i] = __atomic_load_n(&hist->bins[i], __ATOMIC_RELAXED);
+            copy->credited[i] = __atomic_load_n(&hist->credited[i], __ATOMIC_RELAXED);
+        }
+        // Keep the copy above the second seq load
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0 && __atomic_load_n(&hist->seq, __ATOMIC_RELAXED) == seq) {
+            return;
+        }
+    }
+}
+
+void share_hist_merge(share_hist_t *sum, const share_hist_t *copy)
+{
+    bool newer = copy->job_id > sum->job_id;
+
+    if (newer) {
+        sum->job_id = copy->job_id;
+        sum->job_floor = copy->job_floor;
+    }
+    for (uint32_t i = 0; i < SHARE_HIST_BINS; i++) {
+        if (newer) {
+            sum->job_bins[i] = copy->job_bins[i];
+        } else if (copy->job_id == sum->job_id) {
+            sum->job_bins[i] += copy->job_bins[i];
+        }
+        sum->bins[i] += copy->bins[i];
+        sum->credited[i] += copy->credited[i];
+    }
+}
+
+// Poisson bounds on the mean of a count n (Wilson-Hilferty), scaled by the
+// work of one share
+static void estimate_bounds(share_estimate_t *estimate, uint32_t n, double work)
+{
+    double z = SHARE_HIST_Z;
+    double low = 0;
+    double high;
+
+    if (n > 0) {
+        double base = 1 - 1 / (9.0 * n) - z / (3 * sqrt((double)n));
+        low = base > 0 ? n * base * base * base : 0;
+    }
+    double up = 1 - 1 / (9.0 * (n + 1)) + z / (3 * sqrt(n + 1.0));
+    high = (n + 1.0) * up * up * up;
+
+    estimate->shares = n;
+    estimate->hashes = n * work;
+    estimate->low = low * work;
+    estimate->high = high * work;
+}
+
+void share_hist_estimate_job(const share_hist_t *hist, share_estimate_t *estimate)
+{
+    uint32_t n = 0;
+
+    for (uint32_t i = hist->job_floor; i < SHARE_HIST_BINS; i++) {
+        n += hist->job_bins[i];
+    }
+    estimate_bounds(estimate, n, share_hist_work(hist->job_floor));
+}
+
+void share_hist_estimate_all(const share_hist_t *hist, share_estimate_t *estimate)
+{
+    uint32_t n = 0;
+    double hashes = 0;
+
+    for (uint32_t i = 0; i < SHARE_HIST_BINS; i++) {
+        n += hist->credited[i];
+        hashes += hist->credited[i] * share_hist_work(i);
+    }
+    // Mixed floors: the bounds of the count, scaled by the mean work per share
+    estimate_bounds(estimate, n, n > 0 ? hashes / n : share_hist_work(hist->job_floor));
+    estimate->hashes = hashes;
+}
+
+share_check_t share_estimate_check(const share_estimate_t *estimate, uint64_t counted)
+{
+    if ((double)counted > estimate->high) {
+        return SHARE_CHECK_FEW;
+    }
+    if ((double)counted < estimate->low) {
+        return SHARE_CHECK_MANY;
+    }
+    return SHARE_CHECK_OK;
+}
+
+const char *share_check_name(share_check_t check)
+{
+    switch (check) {
+    case SHARE_CHECK_OK:
+        return "ok";
+    case SHARE_CHECK_FEW:
+        return "too few shares";
+    case SHARE_CHECK_MANY:
+        return "too many shares";
+    }
+    return "?";
+}
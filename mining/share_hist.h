@@ -0,0 +1,161 @@
+/**
+ * @file share_hist.h
+ * @brief Share-difficulty histograms and the hashrate they imply
+ *
+ * Every worker counts the shares it finds by achieved difficulty, one bin
+ * per power of two, for its current job and since it was initialized. The
+ * stats reader merges the workers' histograms (miner_stats_collect()).
+ *
+ * A hash has difficulty D or more with probability 0xFFFF / (D * 2^48),
+ * whatever the share target. Above the job's share difficulty every such
+ * hash is a share, so the number of shares at or above a power of two F is
+ * a Poisson count with mean hashes * 0xFFFF / (F * 2^48). Turned around,
+ * the shares give an estimate of the hashes done - the "effective" work a
+ * pool credits - with confidence bounds that only depend on how many shares
+ * there are. Each job's estimate starts at its floor: the lowest power of
+ * two at or above its share difficulty. The cumulative one credits every
+ * share at or above its job's floor with that floor's work.
+ *
+ * Comparing the estimate with the hashes the workers counted tells whether
+ * they really checked what they counted: a kernel that is fast but wrong,
+ * or a worker that skips nonces, finds fewer shares than the count allows
+ * (share_estimate_check()).
+ *
+ * The estimator runs in the stats task with doubles; the workers only do a
+ * few stores per share.
+ */
+
+#ifndef __SHARE_HIST_H__
+#define __SHARE_HIST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bins per histogram */
+#define SHARE_HIST_BINS         72
+
+/** log2 of the lowest bin: bin k counts difficulties in [2^(k + SHARE_HIST_MIN_EXP), 2^(k + 1 + SHARE_HIST_MIN_EXP)) */
+#define SHARE_HIST_MIN_EXP      (-24)
+
+/** Standard deviations of the confidence bounds (about 99.7%) */
+#define SHARE_HIST_Z            3.0
+
+/**
+ * @brief Share counts of one worker, or of all workers once merged
+ *
+ * The worker writes it under a sequence lock like miner_totals_t: seq is
+ * odd while it updates, and share_hist_read() retries until it copies the
+ * block between two equal, even seq values.
+ */
+typedef struct {
+    uint32_t seq;                       ///< Odd while the worker writes the block
+    uint32_t job_id;                    ///< Job job_bins counts (0: none)
+    uint32_t job_floor;                 ///< share_hist_floor() of that job
+    uint32_t job_bins[SHARE_HIST_BINS]; ///< Shares of job_id per bin
+    uint32_t bins[SHARE_HIST_BINS];     ///< Shares of every job per bin
+    uint32_t credited[SHARE_HIST_BINS]; ///< Shares at or above their job's floor, per floor
+} share_hist_t;
+
+/** Hashes the shares in a histogram stand for */
+typedef struct {
+    uint32_t shares;                    ///< Shares the estimate rests on
+    double hashes;                      ///< Expected hashes for that many shares
+    double low;                         ///< Lower confidence bound on the hashes
+    double high;                        ///< Upper confidence bound on the hashes
+} share_estimate_t;
+
+typedef enum {
+    SHARE_CHECK_OK,                     ///< Counted hashes within the bounds
+    SHARE_CHECK_FEW,                    ///< Fewer shares than the counted hashes give: wrong kernel, skipped nonces
+    SHARE_CHECK_MANY,                   ///< More shares than the counted hashes give: uncounted or repeated work
+} share_check_t;
+
+/**
+ * @brief Bin of an achieved difficulty (clamped to the histogram)
+ */
+uint32_t share_hist_bin(double difficulty);
+
+/**
+ * @brief Floor of a share difficulty: the first bin whose whole range is at
+ *        or above it
+ *
+ * Never 0, as bin 0 also holds everything below its range.
+ */
+uint32_t share_hist_floor(double share_difficulty);
+
+/**
+ * @brief Expected hashes per hash of difficulty 2^(bin + SHARE_HIST_MIN_EXP) or more
+ */
+double share_hist_work(uint32_t bin);
+
+/**
+ * @brief Clear a histogram
+ */
+void share_hist_init(share_hist_t *hist);
+
+/**
+ * @brief Start counting a new job (owning worker only)
+ *
+ * Does nothing if the histogram already counts that job.
+ *
+ * @param hist Worker's histogram
+ * @param job_id Job identifier
+ * @param job_floor share_hist_floor() of the job's share difficulty
+ */
+void share_hist_start_job(share_hist_t *hist, uint32_t job_id, uint32_t job_floor);
+
+/**
+ * @brief Count a hash that meets the current job's share target (owning worker only)
+ */
+void share_hist_add(share_hist_t *hist, double difficulty);
+
+/**
+ * @brief Take a consistent copy of a worker's histogram (any thread)
+ *
+ * Retries while the worker updates it; call it from a task that does not
+ * preempt the worker on its core.
+ */
+void share_hist_read(const share_hist_t *hist, share_hist_t *copy);
+
+/**
+ * @brief Add a copy to a sum
+ *
+ * The sum keeps the newest job: a copy of a newer job replaces its job
+ * bins, one of the same job adds to them, one of an older job adds only
+ * to the cumulative bins.
+ */
+void share_hist_merge(share_hist_t *sum, const share_hist_t *copy);
+
+/**
+ * @brief Estimate the hashes of the histogram's job from its shares at or
+ *        above the job's floor
+ */
+void share_hist_estimate_job(const share_hist_t *hist, share_estimate_t *estimate);
+
+/**
+ * @brief Estimate the hashes of every job from the credited shares
+ *
+ * Without any share, the current job's floor stands in for the work per
+ * share in the upper bound.
+ */
+void share_hist_estimate_all(const share_hist_t *hist, share_estimate_t *estimate);
+
+/**
+ * @brief Compare counted hashes with an estimate's bounds
+ */
+share_check_t share_estimate_check(const share_estimate_t *estimate, uint64_t counted);
+
+/**
+ * @brief Short name of a check result for logs
+ */
+const char *share_check_name(share_check_t check);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SHARE_HIST_H__
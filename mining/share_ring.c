@@ -0,0 +1,49 @@
+/**
+ * @file share_ring.c
+ * @brief Lock-free single-producer, single-consumer ring of found shares
+ */
+
+#include "share_ring.h"
+#include <string.h>
+#include "miner_port.h"
+
+void share_ring_init(share_ring_t *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+}
+
+IRAM_ATTR bool share_ring_push(share_ring_t *ring, const miner_share_t *share)
+{
+    uint32_t tail = ring->tail;
+    // Acquire: the consumer is done with the slot before we overwrite it
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head >= SHARE_RING_SIZE) {
+        return false;
+    }
+    ring->slots[tail % SHARE_RING_SIZE] = *share;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool share_ring_pop(share_ring_t *ring, miner_share_t *share)
+{
+    uint32_t head = ring->head;
+    // Acquire: the slot's contents are visible once the tail covers it
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return false;
+    }
+    *share = ring->slots[head % SHARE_RING_SIZE];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t share_ring_count(const share_ring_t *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    return tail - head;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file share_ring.h
+ * @brief Lock-free single-producer, single-consumer ring of found shares
+ *
+ * Every worker owns one ring and is its only producer; one consumer (the
+ * pool, node or supervisor task) drains it. A push copies the share into
+ * the next free slot and publishes it with one release store: no lock, no
+ * logging, no socket and no waiting on the worker. When the consumer falls
+ * behind and the ring is full, the push fails and the worker counts the
+ * share as dropped.
+ *
+ * The producer's index and the consumer's index sit in separate cache
+ * lines, so the two sides never write the same line.
+ */
+
+#ifndef __SHARE_RING_H__
+#define __SHARE_RING_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "miner_worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Shares a worker can have in flight to the consumer (power of two) */
+#define SHARE_RING_SIZE         16
+
+/** A hash a worker found: a share, a block or a new personal best */
+typedef struct {
+    uint32_t worker;                    ///< Worker index
+    uint32_t job_id;                    ///< Job the nonce belongs to (miner_job_t.id)
+    uint32_t job_slot;                  ///< Slot of that job (may be rebuilt once the job is replaced)
+    uint32_t version;                   ///< Header version of the rolled variant
+    uint32_t ntime;                     ///< Header time of the rolled variant
+    uint64_t extranonce2;               ///< Extranonce2 of the rolled variant
+    uint32_t nonce;                     ///< Header nonce
+    uint8_t hash[32];                   ///< Full SHA-256d digest
+    double difficulty;                  ///< Share difficulty (diff1 / hash)
+    bool meets_share;                   ///< hash <= job share target
+    bool meets_block;                   ///< hash <= block target from nBits
+    bool new_best;                      ///< Lowest hash this worker has found
+} miner_share_t;
+
+typedef struct {
+    uint32_t tail __attribute__((aligned(MINER_CACHE_LINE)));  ///< Shares pushed (producer, wrapping)
+    uint32_t head __attribute__((aligned(MINER_CACHE_LINE)));  ///< Shares popped (consumer, wrapping)
+    miner_share_t slots[SHARE_RING_SIZE] __attribute__((aligned(MINER_CACHE_LINE)));
+} share_ring_t;
+
+/**
+ * @brief Empty a ring (while neither side uses it)
+ */
+void share_ring_init(share_ring_t *ring);
+
+/**
+ * @brief Append a share (producer only)
+ *
+ * @return false if the ring is full; the share is not stored
+ */
+bool share_ring_push(share_ring_t *ring, const miner_share_t *share);
+
+/**
+ * @brief Take the oldest share (consumer only)
+ *
+ * @return false if the ring is empty
+ */
+bool share_ring_pop(share_ring_t *ring, miner_share_t *share);
+
+/**
+ * @brief Shares waiting in the ring (either side; a snapshot)
+ */
+uint32_t share_ring_count(const share_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SHARE_RING_H__
@@ -0,0 +1,302 @@
+/**
+ * @file stratum.c
+ * @brief Non-blocking Stratum v1 pool client
+ */
+
+#include "stratum.h"
+#include <stdio.h>
+#include <string.h>
+#include "version_rolling.h"
+
+// Forget the session's requests: they are never answered on the next one
+static void stratum_closed(void *arg)
+{
+    stratum_client_t *client = (stratum_client_t *)arg;
+
+    memset(client->pending_ids, 0, sizeof(client->pending_ids));
+    miner_lock(&client->conn.lock);
+    client->status.pending = 0;
+    miner_unlock(&client->conn.lock);
+}
+
+static void stratum_fail(stratum_client_t *client)
+{
+    pool_conn_disconnect(&client->conn, true);
+}
+
+// Append a request line to the transmit buffer; returns its id or 0
+static uint32_t stratum_send(stratum_client_t *client, const char *method, const char *params)
+{
+    uint32_t id = ++client->next_id;
+    size_t room = pool_conn_tx_room(&client->conn);
+    int len = snprintf(client->tx + client->conn.tx_len, room, "{\"id\":%lu,\"method\":\"%s\",\"params\":%s}\n",
+                       (unsigned long)id, method, params);
+
+    if (len < 0 || (size_t)len >= room) {
+        client->next_id--;
+        return 0;
+    }
+    client->conn.tx_len += (size_t)len;
+    return id;
+}
+
+// Queue the pipelined handshake once the socket is connected
+static void stratum_handshake(void *arg)
+{
+    stratum_client_t *client = (stratum_client_t *)arg;
+    char params[256];
+
+    client->subscribed = false;
+    client->authorized = false;
+    client->configure_id = 0;
+    client->next_id = 0;
+    stratum_parser_init(&client->parser);
+
+    if (client->config.version_mask != 0) {
+        size_t len = version_rolling_configure_request(client->tx, sizeof(client->tx), client->next_id + 1,
+                                                       client->config.version_mask);
+        if (len > 0) {
+            client->configure_id = ++client->next_id;
+            client->conn.tx_len = len;
+        }
+    }
+    client->subscribe_id = stratum_send(client, "mining.subscribe", "[\"" STRATUM_USER_AGENT "\"]");
+    snprintf(params, sizeof(params), "[\"%s\",\"%s\"]", client->config.user,
+             client->config.password ? client->config.password : "");
+    client->authorize_id = stratum_send(client, "mining.authorize", params);
+    pool_conn_set_state(&client->conn, STRATUM_SUBSCRIBING);
+}
+
+// mining.notify, decoded by the parser into a ready template
+static void stratum_on_notify(stratum_client_t *client, const stratum_job_t *job)
+{
+    if (!client->subscribed) {
+        return;
+    }
+    miner_lock(&client->conn.lock);
+    client->conn.job.work = job->work;
+    client->conn.job.work.version_mask = client->status.version_mask;
+    memcpy(client->conn.job.id, job->id, sizeof(client->conn.job.id));
+    client->conn.job.difficulty = client->conn.status.difficulty;
+    client->conn.job.clean = job->clean;
+    client->conn.job.seq++;
+    client->conn.status.jobs++;
+    miner_unlock(&client->conn.lock);
+}
+
+// Result of mining.subscribe: [[subscriptions...], extranonce1, extranonce2_size]
+static void stratum_on_subscribe(stratum_client_t *client, const stratum_msg_t *msg)
+{
+    if (msg->extranonce2_size < 1 || msg->extranonce2_size > WORK_EXTRANONCE2_MAX) {
+        stratum_fail(client);
+        return;
+    }
+    client->extranonce2_size = msg->extranonce2_size;
+    stratum_parser_set_extranonce(&client->parser, msg->extranonce1, msg->extranonce1_len, msg->extranonce2_size);
+    client->subscribed = true;
+}
+
+// Free slot for a mining.submit id, or -1 while STRATUM_PENDING_MAX are unanswered
+static int stratum_free_pending(const stratum_client_t *client)
+{
+    for (int i = 0; i < STRATUM_PENDING_MAX; i++) {
+        if (client->pending_ids[i] == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Verdict on a mining.submit: find the request by id and count it
+static void stratum_on_submit_result(stratum_client_t *client, const stratum_msg_t *msg)
+{
+    uint32_t elapsed = 0;
+    int slot = -1;
+
+    for (int i = 0; i < STRATUM_PENDING_MAX && msg->id != 0; i++) {
+        if (client->pending_ids[i] == msg->id) {
+            slot = i;
+            client->pending_ids[i] = 0;
+            elapsed = (uint32_t)(miner_time_us() - client->pending_us[i]);
+            break;
+        }
+    }
+
+    miner_lock(&client->conn.lock);
+    if (slot < 0) {
+        client->status.unmatched++;
+    } else {
+        client->status.pending--;
+        if (msg->result) {
+            client->conn.status.accepted++;
+        } else {
+            client->conn.status.rejected++;
+        }
+        if (elapsed > client->status.response_us_max) {
+            client->status.response_us_max = elapsed;
+        }
+    }
+    miner_unlock(&client->conn.lock);
+}
+
+static void stratum_on_response(stratum_client_t *client, const stratum_msg_t *msg)
+{
+    if (msg->id == client->configure_id) {
+        miner_lock(&client->conn.lock);
+        client->status.version_mask = msg->version_rolling ? msg->version_mask & client->config.version_mask : 0;
+        miner_unlock(&client->conn.lock);
+    } else if (msg->id == client->subscribe_id) {
+        if (msg->error) {
+            stratum_fail(client);
+            return;
+        }
+        stratum_on_subscribe(client, msg);
+    } else if (msg->id == client->authorize_id) {
+        if (!msg->result) {
+            stratum_fail(client);
+            return;
+        }
+        client->authorized = true;
+    } else {
+        stratum_on_submit_result(client, msg);
+    }
+
+    if (client->conn.fd >= 0 && client->subscribed && client->authorized &&
+        client->conn.status.state == STRATUM_SUBSCRIBING) {
+        pool_conn_set_state(&client->conn, STRATUM_MINING);
+    }
+}
+
+static void stratum_on_msg(stratum_client_t *client, const stratum_msg_t *msg)
+{
+    switch (msg->type) {
+    case STRATUM_MSG_RESPONSE:
+        stratum_on_response(client, msg);
+        break;
+    case STRATUM_MSG_NOTIFY:
+        stratum_on_notify(client, &msg->job);
+        break;
+    case STRATUM_MSG_SET_DIFFICULTY:
+        miner_lock(&client->conn.lock);
+        client->conn.status.difficulty = msg->difficulty;
+        miner_unlock(&client->conn.lock);
+        break;
+    case STRATUM_MSG_SET_VERSION_MASK:
+        if (client->configure_id != 0) {
+            miner_lock(&client->conn.lock);
+            client->status.version_mask = msg->version_mask & client->config.version_mask;
+            miner_unlock(&client->conn.lock);
+        }
+        break;
+    default:
+        // Malformed lines and methods we do not handle are ignored
+        break;
+    }
+}
+
+// Feed received data to the parser, handling each message as it completes
+static void stratum_receive(void *arg, const uint8_t *data, size_t len)
+{
+    stratum_client_t *client = (stratum_client_t *)arg;
+    size_t done = 0;
+
+    while (client->conn.fd >= 0 && done < len) {
+        const stratum_msg_t *msg;
+        done += stratum_parser_feed(&client->parser, (const char *)data + done, len - done, &msg);
+        if (msg != NULL) {
+            stratum_on_msg(client, msg);
+        }
+    }
+}
+
+// Turn queued shares into mining.submit requests while there is room in
+// the transmit buffer and in the pending table
+static void stratum_drain_queue(void *arg)
+{
+    stratum_client_t *client = (stratum_client_t *)arg;
+
+    for (;;) {
+        stratum_share_t share;
+        char params[256];
+        int slot = stratum_free_pending(client);
+        int len;
+
+        if (slot < 0 || !pool_conn_peek_share(&client->conn, &share)) {
+            return;
+        }
+
+        len = snprintf(params, sizeof(params), "[\"%s\",\"%s\",\"", client->config.user, share.job_id);
+        // Extranonce2 goes out as the bytes placed in the coinbase (little-endian)
+        for (size_t i = 0; i < client->extranonce2_size && len > 0 && (size_t)len < sizeof(params); i++) {
+            len += snprintf(params + len, sizeof(params) - (size_t)len, "%02x",
+                            (unsigned)(uint8_t)(share.extranonce2 >> (8 * i)));
+        }
+        if (len > 0 && (size_t)len < sizeof(params)) {
+            len += snprintf(params + len, sizeof(params) - (size_t)len, "\",\"%08lx\",\"%08lx\"",
+                            (unsigned long)share.ntime, (unsigned long)share.nonce);
+        }
+        if (client->status.version_mask != 0 && len > 0 && (size_t)len < sizeof(params)) {
+            len += snprintf(params + len, sizeof(params) - (size_t)len, ",\"%08lx\"",
+                            (unsigned long)(share.version & client->status.version_mask));
+        }
+        // Never send a truncated share (only possible with an overlong user name)
+        bool fits = len > 0 && (size_t)len < sizeof(params) - 1;
+        if (fits) {
+            params[len] = ']';
+            params[len + 1] = '\0';
+            uint32_t id = stratum_send(client, "mining.submit", params);
+            if (id == 0) {
+                return;
+            }
+            client->pending_ids[slot] = id;
+            client->pending_us[slot] = miner_time_us();
+            miner_lock(&client->conn.lock);
+            client->status.pending++;
+            miner_unlock(&client->conn.lock);
+        }
+        pool_conn_pop_share(&client->conn, fits);
+    }
+}
+
+static const pool_conn_ops_t stratum_ops = {
+    .connected = stratum_handshake,
+    .received = stratum_receive,
+    .drain = stratum_drain_queue,
+    .closed = stratum_closed,
+};
+
+void stratum_client_init(stratum_client_t *client, const stratum_config_t *config)
+{
+    memset(client, 0, sizeof(*client));
+    client->config = *config;
+    pool_conn_init(&client->conn, client->config.host, client->config.port, &stratum_ops, client, STRATUM_MINING,
+                   (uint8_t *)client->tx, sizeof(client->tx));
+}
+
+void stratum_client_close(stratum_client_t *client)
+{
+    pool_conn_disconnect(&client->conn, false);
+}
+
+void stratum_client_poll(stratum_client_t *client, uint32_t timeout_ms)
+{
+    pool_conn_poll(&client->conn, timeout_ms);
+}
+
+bool stratum_client_take_job(stratum_client_t *client, uint32_t *seq, stratum_job_t *job)
+{
+    return pool_conn_take_job(&client->conn, seq, job);
+}
+
+bool stratum_client_submit(stratum_client_t *client, const stratum_share_t *share)
+{
+    return pool_conn_submit(&client->conn, share);
+}
+
+void stratum_client_status(stratum_client_t *client, stratum_status_t *status)
+{
+    miner_lock(&client->conn.lock);
+    *status = client->status;
+    status->conn = client->conn.status;
+    miner_unlock(&client->conn.lock);
+}
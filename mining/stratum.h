@@ -0,0 +1,151 @@
+/**
+ * @file stratum.h
+ * @brief Non-blocking Stratum v1 pool client
+ *
+ * The client is a single event loop: stratum_client_poll() connects,
+ * sends and receives on one non-blocking TCP socket (pool_conn.h, shared
+ * with the SV2 client) and returns after at most the given timeout.
+ * On the board it runs in its own task on core 0; nothing in it ever
+ * waits on a mining worker, and workers never wait on the network:
+ *
+ * - mining.notify is decoded by the streaming parser (stratum_parser.h)
+ *   straight into a work_template_t (coinbase around extranonce1/
+ *   extranonce2, merkle branch, header fields) and published as a
+ *   stratum_job_t. The mining supervisor picks it up with
+ *   stratum_client_take_job().
+ * - Shares are handed to stratum_client_submit(), which only appends to
+ *   a small queue (the firmware calls it from the event loop's own task,
+ *   draining the workers' share rings). The event loop turns queued
+ *   shares into pipelined mining.submit requests: up to
+ *   STRATUM_PENDING_MAX wait for the pool's verdict at a time, and each
+ *   verdict is matched to its request by id, so responses may arrive in
+ *   any order.
+ *
+ * The handshake pipelines mining.configure (BIP310 version rolling, when
+ * a mask is configured), mining.subscribe and mining.authorize. The pool's
+ * mining.set_difficulty and mining.set_version_mask apply to the jobs that
+ * follow. A dropped connection is retried after POOL_CONN_RECONNECT_US.
+ */
+
+#ifndef __STRATUM_H__
+#define __STRATUM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "miner_port.h"
+#include "pool_conn.h"
+#include "stratum_parser.h"
+#include "work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Transmit buffer */
+#define STRATUM_TX_MAX              2048
+
+/** mining.submit requests that can wait for the pool's response */
+#define STRATUM_PENDING_MAX         16
+
+/** User agent sent with mining.subscribe */
+#define STRATUM_USER_AGENT          "esp32-btc-miner/1.0"
+
+typedef enum {
+    STRATUM_DISCONNECTED = POOL_CONN_DISCONNECTED, ///< Waiting to (re)connect
+    STRATUM_CONNECTING = POOL_CONN_CONNECTING,     ///< TCP connect in progress
+    STRATUM_SUBSCRIBING,                ///< Handshake sent, waiting for subscribe/authorize results
+    STRATUM_MINING,                     ///< Subscribed and authorized
+} stratum_state_t;
+
+typedef struct {
+    const char *host;                   ///< Pool host name or address
+    uint16_t port;                      ///< Pool port
+    const char *user;                   ///< Worker name for mining.authorize and mining.submit
+    const char *password;               ///< Worker password
+    uint32_t version_mask;              ///< Version bits to request (0: no mining.configure)
+} stratum_config_t;
+
+/** Connection state and counters */
+typedef struct {
+    pool_conn_status_t conn;            ///< State (stratum_state_t), shares, difficulty and traffic
+    uint32_t pending;                   ///< mining.submit requests waiting for a response
+    uint32_t unmatched;                 ///< Responses to no request we have open (ignored)
+    uint32_t response_us_max;           ///< Longest mining.submit round trip (us)
+    uint32_t version_mask;              ///< Negotiated version rolling mask
+} stratum_status_t;
+
+typedef struct {
+    stratum_config_t config;
+    pool_conn_t conn;                   ///< Socket, job slot and share queue
+    char tx[STRATUM_TX_MAX];
+
+    // Session, only touched by the event loop
+    uint32_t next_id;
+    uint32_t configure_id;
+    uint32_t subscribe_id;
+    uint32_t authorize_id;
+    bool subscribed;
+    bool authorized;
+    size_t extranonce2_size;
+    uint32_t pending_ids[STRATUM_PENDING_MAX]; ///< Ids of unanswered mining.submit requests (0: free)
+    uint64_t pending_us[STRATUM_PENDING_MAX];  ///< When each of them was sent
+    stratum_parser_t parser;            ///< Decodes received data, mining.notify into a job
+
+    // Shared with the miners, under conn.lock
+    stratum_status_t status;            ///< Protocol counters; status.conn is read from conn.status
+} stratum_client_t;
+
+/**
+ * @brief Initialize a client; it connects on the first stratum_client_poll()
+ *
+ * @param client Client to initialize
+ * @param config Pool settings (the strings must outlive the client)
+ */
+void stratum_client_init(stratum_client_t *client, const stratum_config_t *config);
+
+/**
+ * @brief Run the event loop once
+ *
+ * Waits up to timeout_ms for the socket, then handles whatever is
+ * ready: connect completion, received lines, queued shares and pending
+ * output.
+ *
+ * @param client Client
+ * @param timeout_ms Longest time to wait for socket activity
+ */
+void stratum_client_poll(stratum_client_t *client, uint32_t timeout_ms);
+
+/**
+ * @brief Close the connection (it is reopened by the next poll after
+ *        POOL_CONN_RECONNECT_US)
+ */
+void stratum_client_close(stratum_client_t *client);
+
+/**
+ * @brief Copy the latest job if it is newer than the one the caller has
+ *
+ * @param client Client
+ * @param seq Sequence number of the caller's job (0 for none); updated
+ * @param job Output job
+ * @return true if a newer job was copied
+ */
+bool stratum_client_take_job(stratum_client_t *client, uint32_t *seq, stratum_job_t *job);
+
+/**
+ * @brief Queue a share for submission (safe to call from any thread)
+ *
+ * @return false if the queue is full; the share is counted as dropped
+ */
+bool stratum_client_submit(stratum_client_t *client, const stratum_share_t *share);
+
+/**
+ * @brief Snapshot of the connection state and counters
+ */
+void stratum_client_status(stratum_client_t *client, stratum_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __STRATUM_H__
@@ -0,0 +1,641 @@
+/**
+ * @file stratum_parser.c
+ * @brief Streaming, allocation-free parser for Stratum v1 messages
+ */
+
+#include "stratum_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// JSON states
+enum {
+    PS_VALUE,                           // Expecting a value (or ']' of an empty array)
+    PS_KEY,                             // Expecting a key (or '}' of an empty object)
+    PS_KEY_STRING,                      // Inside a key
+    PS_COLON,                           // After a key
+    PS_STRING,                          // Inside a string value
+    PS_ESCAPE,                          // After a backslash in a string value
+    PS_PRIMITIVE,                       // Inside a number or literal
+    PS_AFTER,                           // After a value: ',' or a closing bracket
+    PS_DONE,                            // Top-level value complete, waiting for the newline
+};
+
+// Keys we route on
+enum {
+    KEY_OTHER,
+    KEY_ID,
+    KEY_METHOD,
+    KEY_PARAMS,
+    KEY_RESULT,
+    KEY_ERROR,
+    KEY_VERSION_ROLLING,
+    KEY_VERSION_ROLLING_MASK,
+};
+
+// Destinations of values
+enum {
+    SLOT_NONE,
+    SLOT_ID,
+    SLOT_METHOD,
+    SLOT_RESULT,
+    SLOT_ERROR,
+    SLOT_PARAM0,                        // Job id, difficulty or version mask
+    SLOT_PREVHASH,
+    SLOT_COINBASE1,
+    SLOT_COINBASE2,
+    SLOT_BRANCH,
+    SLOT_VERSION,
+    SLOT_NBITS,
+    SLOT_NTIME,
+    SLOT_CLEAN,
+    SLOT_EXTRANONCE1,
+    SLOT_EXTRANONCE2_SIZE,
+    SLOT_VERSION_ROLLING,
+    SLOT_VERSION_ROLLING_MASK,
+};
+
+enum {
+    METHOD_NONE,
+    METHOD_NOTIFY,
+    METHOD_SET_DIFFICULTY,
+    METHOD_SET_VERSION_MASK,
+    METHOD_OTHER,
+};
+
+// Fields seen in the current message
+#define SEEN_ID             (1u << 0)
+#define SEEN_JOB_ID         (1u << 1)
+#define SEEN_DIFFICULTY     (1u << 2)
+#define SEEN_MASK           (1u << 3)
+#define SEEN_PREVHASH       (1u << 4)
+#define SEEN_COINBASE1      (1u << 5)
+#define SEEN_COINBASE2      (1u << 6)
+#define SEEN_VERSION        (1u << 7)
+#define SEEN_NBITS          (1u << 8)
+#define SEEN_NTIME          (1u << 9)
+#define SEEN_NOTIFY         (SEEN_JOB_ID | SEEN_PREVHASH | SEEN_COINBASE1 | SEEN_COINBASE2 | SEEN_VERSION | \
+                             SEEN_NBITS | SEEN_NTIME)
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Parse 1-8 hex digits of the text buffer
+static bool text_hex32(const stratum_parser_t *p, uint32_t *value)
+{
+    uint32_t v = 0;
+
+    if (p->text_len < 1 || p->text_len > 8) {
+        return false;
+    }
+    for (uint8_t i = 0; i < p->text_len; i++) {
+        int d = hex_digit(p->text[i]);
+        if (d < 0) {
+            return false;
+        }
+        v = v << 4 | (uint32_t)d;
+    }
+    *value = v;
+    return true;
+}
+
+static bool text_is(const stratum_parser_t *p, const char *s)
+{
+    size_t len = strlen(s);
+    return p->text_len == len && memcmp(p->text, s, len) == 0;
+}
+
+static void parser_reset_msg(stratum_parser_t *p)
+{
+    stratum_msg_t *m = &p->msg;
+
+    m->type = STRATUM_MSG_INVALID;
+    m->id = 0;
+    m->result = false;
+    m->error = false;
+    m->extranonce1_len = 0;
+    m->extranonce2_size = 0;
+    m->version_rolling = false;
+    m->version_mask = 0;
+    m->difficulty = 0;
+    m->job.id[0] = '\0';
+    m->job.clean = false;
+    m->job.work.merkle_count = 0;
+
+    p->state = PS_VALUE;
+    p->depth = 0;
+    p->object = 0;
+    p->bad = false;
+    p->method = METHOD_NONE;
+    p->seen = 0;
+    p->coinbase1_len = 0;
+    p->coinbase2_len = 0;
+}
+
+void stratum_parser_init(stratum_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser_reset_msg(parser);
+}
+
+void stratum_parser_set_extranonce(stratum_parser_t *parser, const uint8_t *extranonce1, size_t extranonce1_len,
+                                   size_t extranonce2_size)
+{
+    if (extranonce1_len > STRATUM_EXTRANONCE1_MAX) {
+        extranonce1_len = STRATUM_EXTRANONCE1_MAX;
+    }
+    memcpy(parser->extranonce1, extranonce1, extranonce1_len);
+    parser->extranonce1_len = extranonce1_len;
+    parser->extranonce2_size = extranonce2_size;
+}
+
+// Destination of a value starting inside the innermost open container
+static uint8_t parser_slot(const stratum_parser_t *p)
+{
+    uint8_t top = (p->object & 1) ? p->keys[0] : KEY_OTHER;
+    bool object = (p->object >> (p->depth - 1)) & 1;
+    uint16_t index = p->index[p->depth - 1];
+
+    switch (p->depth) {
+    case 1:
+        switch (top) {
+        case KEY_ID:
+            return SLOT_ID;
+        case KEY_METHOD:
+            return SLOT_METHOD;
+        case KEY_RESULT:
+            return SLOT_RESULT;
+        case KEY_ERROR:
+            return SLOT_ERROR;
+        default:
+            return SLOT_NONE;
+        }
+    case 2:
+        if (top == KEY_PARAMS && !object) {
+            static const uint8_t params[] = {
+                SLOT_PARAM0, SLOT_PREVHASH, SLOT_COINBASE1, SLOT_COINBASE2, SLOT_NONE,
+                SLOT_VERSION, SLOT_NBITS, SLOT_NTIME, SLOT_CLEAN,
+            };
+            return index < sizeof(params) ? params[index] : SLOT_NONE;
+        }
+        if (top == KEY_RESULT && !object) {
+            return index == 1 ? SLOT_EXTRANONCE1 : index == 2 ? SLOT_EXTRANONCE2_SIZE : SLOT_NONE;
+        }
+        if (top == KEY_RESULT && object) {
+            return p->keys[1] == KEY_VERSION_ROLLING ? SLOT_VERSION_ROLLING :
+                   p->keys[1] == KEY_VERSION_ROLLING_MASK ? SLOT_VERSION_ROLLING_MASK : SLOT_NONE;
+        }
+        return SLOT_NONE;
+    case 3:
+        return top == KEY_PARAMS && p->index[1] == 4 && !object ? SLOT_BRANCH : SLOT_NONE;
+    default:
+        return SLOT_NONE;
+    }
+}
+
+// Point the hex decoder at the destination of a hex slot
+static void parser_start_hex(stratum_parser_t *p)
+{
+    work_template_t *work = &p->msg.job.work;
+    size_t gap = p->extranonce1_len + p->extranonce2_size;
+
+    p->hex_digits = 0;
+    p->hex = NULL;
+    p->hex_max = 0;
+    switch (p->slot) {
+    case SLOT_PREVHASH:
+        p->hex = work->header.prev_hash;
+        p->hex_max = 32;
+        break;
+    case SLOT_COINBASE1:
+        p->hex = work->coinbase;
+        p->hex_max = WORK_COINBASE_MAX;
+        break;
+    case SLOT_COINBASE2:
+        if ((p->seen & SEEN_COINBASE1) && p->coinbase1_len + gap <= WORK_COINBASE_MAX) {
+            p->hex = work->coinbase + p->coinbase1_len + gap;
+            p->hex_max = WORK_COINBASE_MAX - p->coinbase1_len - gap;
+        }
+        break;
+    case SLOT_BRANCH:
+        if (p->index[2] < WORK_MERKLE_MAX) {
+            p->hex = work->merkle_branch[p->index[2]];
+            p->hex_max = 32;
+        }
+        break;
+    case SLOT_EXTRANONCE1:
+        p->hex = p->msg.extranonce1;
+        p->hex_max = STRATUM_EXTRANONCE1_MAX;
+        break;
+    default:
+        break;
+    }
+    if (p->hex == NULL) {
+        p->bad = true;
+    }
+}
+
+static bool slot_is_hex(uint8_t slot)
+{
+    return slot == SLOT_PREVHASH || slot == SLOT_COINBASE1 || slot == SLOT_COINBASE2 || slot == SLOT_BRANCH ||
+           slot == SLOT_EXTRANONCE1;
+}
+
+// A value begins: work out where it goes
+static void parser_begin_value(stratum_parser_t *p, bool string)
+{
+    p->slot = p->depth > 0 ? parser_slot(p) : SLOT_NONE;
+    p->text_len = 0;
+    if (string && slot_is_hex(p->slot)) {
+        parser_start_hex(p);
+    } else if (!string && slot_is_hex(p->slot)) {
+        p->bad = true;
+    }
+}
+
+// A hex or text value is complete: store it
+static void parser_end_value(stratum_parser_t *p, bool string)
+{
+    stratum_msg_t *m = &p->msg;
+    size_t bytes = p->hex_digits / 2;
+    uint32_t value;
+
+    if (slot_is_hex(p->slot)) {
+        if (p->hex_digits % 2 != 0) {
+            p->bad = true;
+            return;
+        }
+        switch (p->slot) {
+        case SLOT_PREVHASH:
+            p->seen |= bytes == 32 ? SEEN_PREVHASH : 0;
+            break;
+        case SLOT_COINBASE1:
+            p->coinbase1_len = bytes;
+            p->seen |= SEEN_COINBASE1;
+            break;
+        case SLOT_COINBASE2:
+            p->coinbase2_len = bytes;
+            p->seen |= SEEN_COINBASE2;
+            break;
+        case SLOT_BRANCH:
+            if (bytes != 32) {
+                p->bad = true;
+            } else if (p->index[2] + 1u > m->job.work.merkle_count) {
+                m->job.work.merkle_count = p->index[2] + 1u;
+            }
+            break;
+        case SLOT_EXTRANONCE1:
+            m->extranonce1_len = bytes;
+            break;
+        }
+        return;
+    }
+
+    p->text[p->text_len < STRATUM_PARSER_TEXT_MAX ? p->text_len : STRATUM_PARSER_TEXT_MAX - 1] = '\0';
+    switch (p->slot) {
+    case SLOT_ID:
+        if (!string && !text_is(p, "null")) {
+            m->id = (uint32_t)strtoul(p->text, NULL, 10);
+            p->seen |= SEEN_ID;
+        }
+        break;
+    case SLOT_METHOD:
+        p->method = text_is(p, "mining.notify") ? METHOD_NOTIFY :
+                    text_is(p, "mining.set_difficulty") ? METHOD_SET_DIFFICULTY :
+                    text_is(p, "mining.set_version_mask") ? METHOD_SET_VERSION_MASK : METHOD_OTHER;
+        break;
+    case SLOT_RESULT:
+        m->result = !string && text_is(p, "true");
+        break;
+    case SLOT_ERROR:
+        m->error = string || !text_is(p, "null");
+        break;
+    case SLOT_PARAM0:
+        if (!string) {
+            m->difficulty = strtod(p->text, NULL);
+            p->seen |= SEEN_DIFFICULTY;
+            break;
+        }
+        if (p->text_len < STRATUM_JOB_ID_MAX) {
+            memcpy(m->job.id, p->text, p->text_len + 1u);
+            p->seen |= SEEN_JOB_ID;
+        }
+        if (text_hex32(p, &m->version_mask)) {
+            p->seen |= SEEN_MASK;
+        }
+        break;
+    case SLOT_VERSION:
+    case SLOT_NBITS:
+    case SLOT_NTIME:
+        if (p->text_len != 8 || !text_hex32(p, &value)) {
+            p->bad = true;
+        } else if (p->slot == SLOT_VERSION) {
+            m->job.work.header.version = value;
+            p->seen |= SEEN_VERSION;
+        } else if (p->slot == SLOT_NBITS) {
+            m->job.work.header.bits = value;
+            p->seen |= SEEN_NBITS;
+        } else {
+            m->job.work.header.timestamp = value;
+            p->seen |= SEEN_NTIME;
+        }
+        break;
+    case SLOT_CLEAN:
+        m->job.clean = !string && text_is(p, "true");
+        break;
+    case SLOT_EXTRANONCE2_SIZE:
+        m->extranonce2_size = (uint32_t)strtoul(p->text, NULL, 10);
+        break;
+    case SLOT_VERSION_ROLLING:
+        m->version_rolling = !string && text_is(p, "true");
+        break;
+    case SLOT_VERSION_ROLLING_MASK:
+        if (!text_hex32(p, &m->version_mask)) {
+            m->version_rolling = false;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Assemble the job of a mining.notify around the extranonce gap
+static bool parser_finish_notify(stratum_parser_t *p)
+{
+    work_template_t *work = &p->msg.job.work;
+    uint8_t *prev = work->header.prev_hash;
+
+    if ((p->seen & SEEN_NOTIFY) != SEEN_NOTIFY || p->extranonce2_size < 1 ||
+        p->extranonce2_size > WORK_EXTRANONCE2_MAX) {
+        return false;
+    }
+    // prevhash is sent as eight 32-bit words, each byte-swapped
+    for (int i = 0; i < 32; i += 4) {
+        uint8_t t = prev[i];
+        prev[i] = prev[i + 3];
+        prev[i + 3] = t;
+        t = prev[i + 1];
+        prev[i + 1] = prev[i + 2];
+        prev[i + 2] = t;
+    }
+    memset(work->header.merkle_root, 0, sizeof(work->header.merkle_root));
+    work->header.nonce = 0;
+    work->ntime_roll = WORK_NTIME_ROLL_DEFAULT;
+    work->version_mask = 0;
+    memcpy(work->coinbase + p->coinbase1_len, p->extranonce1, p->extranonce1_len);
+    work->extranonce2_offset = p->coinbase1_len + p->extranonce1_len;
+    work->extranonce2_size = p->extranonce2_size;
+    work->extranonce2 = 0;
+    memset(work->coinbase + work->extranonce2_offset, 0, p->extranonce2_size);
+    work->coinbase_len = work->extranonce2_offset + p->extranonce2_size + p->coinbase2_len;
+    work_cache_coinbase(work);
+    return true;
+}
+
+// The line ended: classify the message
+static void parser_finish(stratum_parser_t *p)
+{
+    stratum_msg_t *m = &p->msg;
+
+    if (p->bad || p->state != PS_DONE) {
+        m->type = STRATUM_MSG_INVALID;
+        return;
+    }
+    switch (p->method) {
+    case METHOD_NONE:
+        m->type = (p->seen & SEEN_ID) ? STRATUM_MSG_RESPONSE : STRATUM_MSG_INVALID;
+        break;
+    case METHOD_NOTIFY:
+        m->type = parser_finish_notify(p) ? STRATUM_MSG_NOTIFY : STRATUM_MSG_INVALID;
+        break;
+    case METHOD_SET_DIFFICULTY:
+        m->type = (p->seen & SEEN_DIFFICULTY) && m->difficulty > 0 ? STRATUM_MSG_SET_DIFFICULTY :
+                  STRATUM_MSG_INVALID;
+        break;
+    case METHOD_SET_VERSION_MASK:
+        m->type = (p->seen & SEEN_MASK) ? STRATUM_MSG_SET_VERSION_MASK : STRATUM_MSG_INVALID;
+        break;
+    default:
+        m->type = STRATUM_MSG_OTHER;
+        break;
+    }
+}
+
+static uint8_t key_id(const stratum_parser_t *p)
+{
+    static const struct {
+        const char *name;
+        uint8_t id;
+    } keys[] = {
+        { "id", KEY_ID },
+        { "method", KEY_METHOD },
+        { "params", KEY_PARAMS },
+        { "result", KEY_RESULT },
+        { "error", KEY_ERROR },
+        { "version-rolling", KEY_VERSION_ROLLING },
+        { "version-rolling.mask", KEY_VERSION_ROLLING_MASK },
+    };
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (text_is(p, keys[i].name)) {
+            return keys[i].id;
+        }
+    }
+    return KEY_OTHER;
+}
+
+static void parser_push(stratum_parser_t *p, bool object)
+{
+    if (p->depth >= STRATUM_PARSER_DEPTH) {
+        p->bad = true;
+        return;
+    }
+    if (p->depth > 0 && parser_slot(p) == SLOT_ERROR) {
+        // "error": [code, message, data]
+        p->msg.error = true;
+    }
+    p->object = (uint8_t)((p->object & ~(1u << p->depth)) | ((object ? 1u : 0u) << p->depth));
+    p->keys[p->depth] = KEY_OTHER;
+    p->index[p->depth] = 0;
+    p->depth++;
+    p->state = object ? PS_KEY : PS_VALUE;
+}
+
+static void parser_value_done(stratum_parser_t *p)
+{
+    p->state = p->depth == 0 ? PS_DONE : PS_AFTER;
+}
+
+// One character other than the line ending
+static void parser_char(stratum_parser_t *p, char c)
+{
+    bool in_object = p->depth > 0 && ((p->object >> (p->depth - 1)) & 1);
+
+    switch (p->state) {
+    case PS_STRING:
+        if (c == '"') {
+            parser_end_value(p, true);
+            parser_value_done(p);
+        } else if (slot_is_hex(p->slot)) {
+            int d = hex_digit(c);
+            size_t byte = p->hex_digits / 2;
+            if (d < 0 || byte >= p->hex_max) {
+                p->bad = true;
+            } else if (p->hex_digits++ % 2 == 0) {
+                p->hex[byte] = (uint8_t)(d << 4);
+            } else {
+                p->hex[byte] |= (uint8_t)d;
+            }
+        } else if (c == '\\') {
+            p->state = PS_ESCAPE;
+        } else if (p->text_len < STRATUM_PARSER_TEXT_MAX - 1) {
+            p->text[p->text_len++] = c;
+        } else {
+            p->text_len = STRATUM_PARSER_TEXT_MAX;          // Too long for any short field
+        }
+        return;
+    case PS_ESCAPE:
+        // Short fields keep the escaped character as is
+        if (p->text_len < STRATUM_PARSER_TEXT_MAX - 1) {
+            p->text[p->text_len++] = c;
+        }
+        p->state = PS_STRING;
+        return;
+    case PS_KEY_STRING:
+        if (c == '"') {
+            p->keys[p->depth - 1] = p->text_len < STRATUM_PARSER_TEXT_MAX ? key_id(p) : KEY_OTHER;
+            p->state = PS_COLON;
+        } else if (p->text_len < STRATUM_PARSER_TEXT_MAX - 1) {
+            p->text[p->text_len++] = c;
+        } else {
+            p->text_len = STRATUM_PARSER_TEXT_MAX;
+        }
+        return;
+    default:
+        break;
+    }
+
+    if (c == ' ' || c == '\t' || c == '\r') {
+        if (p->state == PS_PRIMITIVE) {
+            parser_end_value(p, false);
+            parser_value_done(p);
+        }
+        return;
+    }
+
+    switch (p->state) {
+    case PS_PRIMITIVE:
+        if (c != ',' && c != ']' && c != '}') {
+            if (p->text_len < STRATUM_PARSER_TEXT_MAX - 1) {
+                p->text[p->text_len++] = c;
+            } else {
+                p->text_len = STRATUM_PARSER_TEXT_MAX;
+            }
+            return;
+        }
+        parser_end_value(p, false);
+        parser_value_done(p);
+        if (p->state == PS_DONE) {
+            p->bad = true;                                  // Bare top-level primitive
+            return;
+        }
+        break;                                              // The delimiter is handled below
+    case PS_KEY:
+        if (c == '"') {
+            p->text_len = 0;
+            p->state = PS_KEY_STRING;
+        } else if (c == '}' && p->index[p->depth - 1] == 0) {
+            p->depth--;
+            parser_value_done(p);
+        } else {
+            p->bad = true;
+        }
+        return;
+    case PS_COLON:
+        if (c == ':') {
+            p->state = PS_VALUE;
+        } else {
+            p->bad = true;
+        }
+        return;
+    case PS_VALUE:
+        if (c == '{' || c == '[') {
+            parser_push(p, c == '{');
+        } else if (c == ']' && p->depth > 0 && !in_object && p->index[p->depth - 1] == 0) {
+            p->depth--;
+            parser_value_done(p);
+        } else if (c == '"') {
+            parser_begin_value(p, true);
+            p->state = PS_STRING;
+        } else if (c == ',' || c == ']' || c == '}' || c == ':') {
+            p->bad = true;
+        } else {
+            parser_begin_value(p, false);
+            p->text[p->text_len++] = c;
+            p->state = PS_PRIMITIVE;
+        }
+        return;
+    case PS_DONE:
+        p->bad = true;                                      // Anything but the newline
+        return;
+    default:
+        break;
+    }
+
+    // PS_AFTER
+    if (c == ',') {
+        p->index[p->depth - 1]++;
+        p->state = in_object ? PS_KEY : PS_VALUE;
+    } else if ((c == '}' && in_object) || (c == ']' && !in_object)) {
+        p->depth--;
+        parser_value_done(p);
+    } else {
+        p->bad = true;
+    }
+}
+
+size_t stratum_parser_feed(stratum_parser_t *parser, const char *data, size_t len, const stratum_msg_t **msg)
+{
+    *msg = NULL;
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+
+        if (c == '\n') {
+            bool empty = parser->state == PS_VALUE && parser->depth == 0 && !parser->bad;
+            if (empty) {
+                continue;
+            }
+            if (parser->state == PS_PRIMITIVE) {
+                parser_end_value(parser, false);
+                parser_value_done(parser);
+            }
+            parser_finish(parser);
+            *msg = &parser->msg;
+            // The next message starts clean; the caller reads this one first
+            parser->state = PS_VALUE;
+            parser->depth = 0;
+            parser->bad = false;
+            parser->seen = 0;
+            parser->method = METHOD_NONE;
+            return i + 1;
+        }
+        if (parser->state == PS_VALUE && parser->depth == 0 && parser->seen == 0 && !parser->bad &&
+            parser->method == METHOD_NONE) {
+            parser_reset_msg(parser);
+        }
+        if (!parser->bad) {
+            parser_char(parser, c);
+        }
+    }
+    return len;
+}
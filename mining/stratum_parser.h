@@ -0,0 +1,151 @@
+/**
+ * @file stratum_parser.h
+ * @brief Streaming, allocation-free parser for Stratum v1 messages
+ *
+ * The parser is a byte-at-a-time JSON state machine. It takes the socket
+ * data in whatever pieces recv() returns, so the client needs no line
+ * buffer. Fields are not collected into a DOM or a token list. Each value
+ * is routed by its position in the message (top-level key, array index)
+ * straight into a fixed stratum_msg_t:
+ *
+ * - hex fields (prevhash, coinbase halves, merkle branch, extranonce1)
+ *   are decoded two digits at a time into their final place. coinb1 and
+ *   coinb2 land in the job's coinbase buffer around the extranonce gap, so
+ *   a mining.notify comes out as a ready work_template_t;
+ * - short fields (id, method, numbers, literals, 8-digit header words)
+ *   go through a small text buffer.
+ *
+ * Routing does not depend on key order (some pools send "params" before
+ * "method"). The state is the stratum_parser_t alone: a bounded nesting
+ * stack and no recursion, so stack use does not depend on the input.
+ */
+
+#ifndef __STRATUM_PARSER_H__
+#define __STRATUM_PARSER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum pool job id length, including the terminator */
+#define STRATUM_JOB_ID_MAX          64
+
+/** Maximum extranonce1 size in bytes */
+#define STRATUM_EXTRANONCE1_MAX     16
+
+/** Deepest container nesting accepted (deeper messages are invalid) */
+#define STRATUM_PARSER_DEPTH        8
+
+/** Longest short field (method, id, number, literal) */
+#define STRATUM_PARSER_TEXT_MAX     64
+
+/** A job ready to mine */
+typedef struct {
+    uint32_t seq;                       ///< Incremented for every published job
+    char id[STRATUM_JOB_ID_MAX];        ///< Pool job id, echoed in mining.submit
+    work_template_t work;               ///< Header, coinbase and branch; extranonce2 starts at 0
+    double difficulty;                  ///< Share difficulty in force for the job
+    bool clean;                         ///< Pool asked to abandon previous jobs
+} stratum_job_t;
+
+typedef enum {
+    STRATUM_MSG_INVALID,                ///< Malformed JSON, or a field that is missing or does not fit
+    STRATUM_MSG_RESPONSE,               ///< Result of one of our requests
+    STRATUM_MSG_NOTIFY,                 ///< mining.notify
+    STRATUM_MSG_SET_DIFFICULTY,         ///< mining.set_difficulty
+    STRATUM_MSG_SET_VERSION_MASK,       ///< mining.set_version_mask
+    STRATUM_MSG_OTHER,                  ///< A method we do not handle
+} stratum_msg_type_t;
+
+/** One decoded message; which fields are valid depends on the type */
+typedef struct {
+    stratum_msg_type_t type;
+    uint32_t id;                        ///< Response id
+    bool result;                        ///< Response result is true
+    bool error;                         ///< Response error is present and not null
+
+    // mining.subscribe result: [subscriptions, extranonce1, extranonce2_size]
+    uint8_t extranonce1[STRATUM_EXTRANONCE1_MAX];
+    size_t extranonce1_len;
+    uint32_t extranonce2_size;
+
+    // mining.configure result, or the mining.set_version_mask parameter
+    bool version_rolling;               ///< "version-rolling": true
+    uint32_t version_mask;              ///< "version-rolling.mask", or the new mask
+
+    double difficulty;                  ///< mining.set_difficulty parameter
+    stratum_job_t job;                  ///< mining.notify (seq, difficulty and version_mask unset)
+} stratum_msg_t;
+
+typedef struct {
+    stratum_msg_t msg;                  ///< Message being decoded
+
+    // Coinbase layout from the subscription
+    uint8_t extranonce1[STRATUM_EXTRANONCE1_MAX];
+    size_t extranonce1_len;
+    size_t extranonce2_size;
+
+    // JSON state
+    uint8_t state;
+    uint8_t depth;                      ///< Open containers
+    uint8_t object;                     ///< Bit d set: container d is an object
+    uint8_t keys[STRATUM_PARSER_DEPTH]; ///< Current key of each object
+    uint16_t index[STRATUM_PARSER_DEPTH]; ///< Current element of each container
+    uint8_t slot;                       ///< Where the current value goes
+    bool bad;                           ///< Skip to the end of the line
+
+    // Current value
+    char text[STRATUM_PARSER_TEXT_MAX];
+    uint8_t text_len;
+    uint8_t *hex;                       ///< Destination of a hex field
+    size_t hex_max;                     ///< Its capacity in bytes
+    size_t hex_digits;                  ///< Digits decoded so far
+
+    // Fields seen in this message
+    uint8_t method;
+    uint16_t seen;
+    size_t coinbase1_len;
+    size_t coinbase2_len;
+} stratum_parser_t;
+
+/**
+ * @brief Reset a parser for a new connection
+ */
+void stratum_parser_init(stratum_parser_t *parser);
+
+/**
+ * @brief Set the coinbase layout of the subscription
+ *
+ * mining.notify coinbases are assembled as coinb1 | extranonce1 |
+ * extranonce2 (zeros) | coinb2.
+ *
+ * @param parser Parser
+ * @param extranonce1 Pool-assigned extranonce1
+ * @param extranonce1_len Its size (at most STRATUM_EXTRANONCE1_MAX)
+ * @param extranonce2_size Size of extranonce2 (1 - WORK_EXTRANONCE2_MAX)
+ */
+void stratum_parser_set_extranonce(stratum_parser_t *parser, const uint8_t *extranonce1, size_t extranonce1_len,
+                                   size_t extranonce2_size);
+
+/**
+ * @brief Parse received bytes up to the end of the next message
+ *
+ * @param parser Parser
+ * @param data Received bytes
+ * @param len Number of bytes
+ * @param msg Set to the decoded message when one ends within the consumed
+ *            bytes (valid until the next call), NULL otherwise
+ * @return Number of bytes consumed; call again with the rest
+ */
+size_t stratum_parser_feed(stratum_parser_t *parser, const char *data, size_t len, const stratum_msg_t **msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __STRATUM_PARSER_H__
@@ -0,0 +1,282 @@
+/**
+ * @file sv2.c
+ * @brief Non-blocking Stratum V2 client for a standard (header-only) channel
+ */
+
+#include "sv2.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "target.h"
+
+// OpenStandardMiningChannel request id; one channel per connection
+#define SV2_OPEN_REQUEST_ID 1
+
+static void sv2_fail(sv2_client_t *client)
+{
+    pool_conn_disconnect(&client->conn, true);
+}
+
+// Append a frame to the transmit buffer
+static bool sv2_send(sv2_client_t *client, const sv2_msg_t *msg)
+{
+    size_t len = sv2_encode(msg, client->tx + client->conn.tx_len, pool_conn_tx_room(&client->conn));
+
+    client->conn.tx_len += len;
+    return len > 0;
+}
+
+// Queue SetupConnection once the socket is connected
+static void sv2_setup(void *arg)
+{
+    sv2_client_t *client = (sv2_client_t *)arg;
+    sv2_msg_t msg;
+
+    client->sequence = 0;
+    client->future = false;
+    client->have_prev = false;
+    client->fixed_version = false;
+    sv2_decoder_init(&client->decoder);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SETUP_CONNECTION;
+    msg.protocol = SV2_PROTOCOL_MINING;
+    msg.min_version = SV2_PROTOCOL_VERSION;
+    msg.max_version = SV2_PROTOCOL_VERSION;
+    msg.flags = SV2_REQUIRES_STANDARD_JOBS;
+    if (client->config.version_mask != 0) {
+        msg.flags |= SV2_REQUIRES_VERSION_ROLLING;
+    }
+    snprintf(msg.text, sizeof(msg.text), "%s", client->config.host);
+    msg.port = client->config.port;
+    sv2_send(client, &msg);
+    pool_conn_set_state(&client->conn, SV2_SETTING_UP);
+}
+
+static void sv2_open_channel(sv2_client_t *client)
+{
+    sv2_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_OPEN_STANDARD_MINING_CHANNEL;
+    msg.request_id = SV2_OPEN_REQUEST_ID;
+    snprintf(msg.text, sizeof(msg.text), "%s", client->config.user);
+    msg.hashrate = client->config.hashrate;
+    // No limit on the target the pool may assign
+    memset(msg.hash, 0xff, sizeof(msg.hash));
+    if (!sv2_send(client, &msg)) {
+        sv2_fail(client);
+        return;
+    }
+    pool_conn_set_state(&client->conn, SV2_OPENING);
+}
+
+// Channel target as a share difficulty
+static void sv2_set_target(sv2_client_t *client, const uint8_t *target)
+{
+    target_t value;
+
+    target_from_hash(target, &value);
+    miner_lock(&client->conn.lock);
+    client->conn.status.difficulty = target_difficulty(&value);
+    miner_unlock(&client->conn.lock);
+}
+
+// Publish header-only work for a job on the previous hash in force
+static void sv2_publish(sv2_client_t *client, uint32_t job_id, uint32_t version, const uint8_t *merkle_root,
+                        uint32_t min_ntime, bool clean)
+{
+    block_header_t header = client->prev;
+
+    header.version = version;
+    memcpy(header.merkle_root, merkle_root, 32);
+    if (min_ntime > header.timestamp) {
+        header.timestamp = min_ntime;
+    }
+
+    miner_lock(&client->conn.lock);
+    work_init(&client->conn.job.work, &header, WORK_NTIME_ROLL_DEFAULT);
+    client->conn.job.work.version_mask = client->fixed_version ? 0 : client->config.version_mask;
+    snprintf(client->conn.job.id, sizeof(client->conn.job.id), "%lu", (unsigned long)job_id);
+    client->conn.job.difficulty = client->conn.status.difficulty;
+    client->conn.job.clean = clean;
+    client->conn.job.seq++;
+    client->conn.status.jobs++;
+    miner_unlock(&client->conn.lock);
+}
+
+static void sv2_on_job(sv2_client_t *client, const sv2_msg_t *msg)
+{
+    if (msg->future) {
+        client->future = true;
+        client->future_id = msg->job_id;
+        client->future_version = msg->version;
+        memcpy(client->future_root, msg->hash, 32);
+    } else if (client->have_prev) {
+        // Earlier jobs on the same previous hash stay valid
+        sv2_publish(client, msg->job_id, msg->version, msg->hash, msg->ntime, false);
+    }
+}
+
+static void sv2_on_prev_hash(sv2_client_t *client, const sv2_msg_t *msg)
+{
+    memcpy(client->prev.prev_hash, msg->hash, 32);
+    client->prev.timestamp = msg->ntime;
+    client->prev.bits = msg->nbits;
+    client->have_prev = true;
+    // The future job it names becomes the only valid one
+    if (client->future && client->future_id == msg->job_id) {
+        client->future = false;
+        sv2_publish(client, client->future_id, client->future_version, client->future_root, msg->ntime, true);
+    }
+}
+
+static void sv2_on_msg(sv2_client_t *client, const sv2_msg_t *msg)
+{
+    sv2_state_t state = (sv2_state_t)client->conn.status.state;
+
+    // Frames we cannot decode are ignored, as are other channels' messages
+    if (!msg->decoded) {
+        return;
+    }
+    switch (msg->type) {
+    case SV2_SETUP_CONNECTION_SUCCESS:
+        if (state == SV2_SETTING_UP) {
+            client->fixed_version = (msg->flags & SV2_REQUIRES_FIXED_VERSION) != 0;
+            sv2_open_channel(client);
+        }
+        break;
+    case SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS:
+        if (state == SV2_OPENING && msg->request_id == SV2_OPEN_REQUEST_ID) {
+            sv2_set_target(client, msg->hash);
+            miner_lock(&client->conn.lock);
+            client->status.channel_id = msg->channel_id;
+            client->conn.status.state = SV2_MINING;
+            miner_unlock(&client->conn.lock);
+        }
+        break;
+    case SV2_SETUP_CONNECTION_ERROR:
+    case SV2_OPEN_MINING_CHANNEL_ERROR:
+        sv2_fail(client);
+        break;
+    case SV2_NEW_MINING_JOB:
+        if (state == SV2_MINING && msg->channel_id == client->status.channel_id) {
+            sv2_on_job(client, msg);
+        }
+        break;
+    case SV2_SET_NEW_PREV_HASH:
+        if (state == SV2_MINING && msg->channel_id == client->status.channel_id) {
+            sv2_on_prev_hash(client, msg);
+        }
+        break;
+    case SV2_SET_TARGET:
+        if (state == SV2_MINING && msg->channel_id == client->status.channel_id) {
+            sv2_set_target(client, msg->hash);
+        }
+        break;
+    case SV2_SUBMIT_SHARES_SUCCESS:
+        miner_lock(&client->conn.lock);
+        client->conn.status.accepted += msg->count;
+        miner_unlock(&client->conn.lock);
+        break;
+    case SV2_SUBMIT_SHARES_ERROR:
+        miner_lock(&client->conn.lock);
+        client->conn.status.rejected++;
+        miner_unlock(&client->conn.lock);
+        break;
+    default:
+        break;
+    }
+}
+
+// Feed received data to the decoder, handling each frame as it completes
+static void sv2_receive(void *arg, const uint8_t *data, size_t len)
+{
+    sv2_client_t *client = (sv2_client_t *)arg;
+    size_t done = 0;
+
+    while (client->conn.fd >= 0 && done < len) {
+        const sv2_msg_t *msg;
+        done += sv2_decoder_feed(&client->decoder, data + done, len - done, &msg);
+        if (msg != NULL) {
+            sv2_on_msg(client, msg);
+        }
+    }
+}
+
+// Turn queued shares into SubmitSharesStandard frames while there is room
+static void sv2_drain_queue(void *arg)
+{
+    sv2_client_t *client = (sv2_client_t *)arg;
+
+    for (;;) {
+        stratum_share_t share;
+        sv2_msg_t msg;
+        char *end;
+
+        if (!pool_conn_peek_share(&client->conn, &share)) {
+            return;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.type = SV2_SUBMIT_SHARES_STANDARD;
+        msg.channel_id = client->status.channel_id;
+        msg.sequence = client->sequence + 1;
+        msg.job_id = (uint32_t)strtoul(share.job_id, &end, 10);
+        msg.nonce = share.nonce;
+        msg.ntime = share.ntime;
+        msg.version = share.version;
+        // Job ids are ours, so a malformed one is a caller bug: drop the share
+        bool valid = share.job_id[0] != '\0' && *end == '\0';
+        if (valid) {
+            if (!sv2_send(client, &msg)) {
+                return;
+            }
+            client->sequence++;
+        }
+        pool_conn_pop_share(&client->conn, valid);
+    }
+}
+
+static const pool_conn_ops_t sv2_ops = {
+    .connected = sv2_setup,
+    .received = sv2_receive,
+    .drain = sv2_drain_queue,
+    .closed = NULL,
+};
+
+void sv2_client_init(sv2_client_t *client, const sv2_config_t *config)
+{
+    memset(client, 0, sizeof(*client));
+    client->config = *config;
+    pool_conn_init(&client->conn, client->config.host, client->config.port, &sv2_ops, client, SV2_MINING,
+                   client->tx, sizeof(client->tx));
+}
+
+void sv2_client_close(sv2_client_t *client)
+{
+    pool_conn_disconnect(&client->conn, false);
+}
+
+void sv2_client_poll(sv2_client_t *client, uint32_t timeout_ms)
+{
+    pool_conn_poll(&client->conn, timeout_ms);
+}
+
+bool sv2_client_take_job(sv2_client_t *client, uint32_t *seq, stratum_job_t *job)
+{
+    return pool_conn_take_job(&client->conn, seq, job);
+}
+
+bool sv2_client_submit(sv2_client_t *client, const stratum_share_t *share)
+{
+    return pool_conn_submit(&client->conn, share);
+}
+
+void sv2_client_status(sv2_client_t *client, sv2_status_t *status)
+{
+    miner_lock(&client->conn.lock);
+    *status = client->status;
+    status->conn = client->conn.status;
+    miner_unlock(&client->conn.lock);
+}
@@ -0,0 +1,150 @@
+/**
+ * @file sv2.h
+ * @brief Non-blocking Stratum V2 client for a standard (header-only) channel
+ *
+ * With Stratum v1 every job carries the coinbase halves and the merkle
+ * branch as hex, and the device rebuilds the merkle root for every
+ * extranonce2. On an SV2 standard channel the pool (or a proxy) keeps
+ * the coinbase: a job is the version and the merkle root, the previous
+ * block hash, nBits and min_ntime come with SetNewPrevHash, and shares
+ * are nonce, ntime and version. Jobs arrive as a few dozen bytes of
+ * binary frames (sv2_codec.h) and are published as header-only
+ * work_template_t (coinbase_len 0): the roll space is ntime x version,
+ * with no coinbase or merkle hashing on the device.
+ *
+ * The client is the same single event loop as the Stratum v1 client
+ * (stratum.h), on the same connection (pool_conn.h) and with the same
+ * threading rules: sv2_client_poll() owns the socket,
+ * sv2_client_take_job() hands jobs to the supervisor as stratum_job_t and
+ * sv2_client_submit() only queues a stratum_share_t.
+ * The job id is the SV2 job id in decimal.
+ *
+ * The session is SetupConnection (mining protocol, version 2, standard
+ * jobs only), then OpenStandardMiningChannel. A future job (no
+ * min_ntime) is published when SetNewPrevHash activates it, as a clean
+ * job; a job for the current previous hash is published as it arrives.
+ * The channel target is converted to a share difficulty (equal to within
+ * double precision); SetTarget applies to the jobs that follow. Shares
+ * carry a sequence number and SubmitShares.Success may acknowledge
+ * several at once.
+ *
+ * The connection is plain TCP: the Noise handshake and encryption that
+ * SV2 uses on the internet are not implemented, so the pool must be a
+ * trusted proxy on the local network that accepts unencrypted
+ * connections.
+ */
+
+#ifndef __SV2_H__
+#define __SV2_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "miner_port.h"
+#include "pool_conn.h"
+#include "stratum.h"
+#include "sv2_codec.h"
+#include "work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Transmit buffer: a SubmitSharesStandard frame is 30 bytes */
+#define SV2_TX_MAX                  512
+
+typedef enum {
+    SV2_DISCONNECTED = POOL_CONN_DISCONNECTED, ///< Waiting to (re)connect
+    SV2_CONNECTING = POOL_CONN_CONNECTING,     ///< TCP connect in progress
+    SV2_SETTING_UP,                     ///< SetupConnection sent
+    SV2_OPENING,                        ///< OpenStandardMiningChannel sent
+    SV2_MINING,                         ///< Channel open
+} sv2_state_t;
+
+typedef struct {
+    const char *host;                   ///< Proxy host name or address
+    uint16_t port;                      ///< Proxy port
+    const char *user;                   ///< User identity for the channel
+    float hashrate;                     ///< Nominal hashrate (h/s), for the pool's first target
+    uint32_t version_mask;              ///< Version bits to roll (BIP320; 0: fixed version, as when the pool requires it)
+} sv2_config_t;
+
+/** Connection state and counters */
+typedef struct {
+    pool_conn_status_t conn;            ///< State (sv2_state_t), shares, channel difficulty and traffic
+    uint32_t channel_id;                ///< Open channel
+} sv2_status_t;
+
+typedef struct {
+    sv2_config_t config;
+    pool_conn_t conn;                   ///< Socket, job slot and share queue
+    uint8_t tx[SV2_TX_MAX];
+
+    // Session, only touched by the event loop
+    sv2_decoder_t decoder;
+    uint32_t sequence;                  ///< Last share sequence number sent
+    bool future;                        ///< A future job waits for its previous hash
+    uint32_t future_id;
+    uint32_t future_version;
+    uint8_t future_root[32];
+    bool have_prev;                     ///< SetNewPrevHash received
+    bool fixed_version;                 ///< SetupConnection.Success asked for REQUIRES_FIXED_VERSION
+    block_header_t prev;                ///< Previous hash, nBits and min_ntime in force
+
+    // Shared with the miners, under conn.lock
+    sv2_status_t status;                ///< Protocol counters; status.conn is read from conn.status
+} sv2_client_t;
+
+/**
+ * @brief Initialize a client; it connects on the first sv2_client_poll()
+ *
+ * @param client Client to initialize
+ * @param config Proxy settings (the strings must outlive the client)
+ */
+void sv2_client_init(sv2_client_t *client, const sv2_config_t *config);
+
+/**
+ * @brief Run the event loop once
+ *
+ * Waits up to timeout_ms for the socket, then handles whatever is
+ * ready: connect completion, received frames, queued shares and pending
+ * output.
+ */
+void sv2_client_poll(sv2_client_t *client, uint32_t timeout_ms);
+
+/**
+ * @brief Close the connection (it is reopened by the next poll after
+ *        POOL_CONN_RECONNECT_US)
+ */
+void sv2_client_close(sv2_client_t *client);
+
+/**
+ * @brief Copy the latest job if it is newer than the one the caller has
+ *
+ * @param client Client
+ * @param seq Sequence number of the caller's job (0 for none); updated
+ * @param job Output job (header-only work)
+ * @return true if a newer job was copied
+ */
+bool sv2_client_take_job(sv2_client_t *client, uint32_t *seq, stratum_job_t *job);
+
+/**
+ * @brief Queue a share for submission (safe to call from any worker)
+ *
+ * Only job_id, ntime, nonce and version are sent; extranonce2 is unused.
+ *
+ * @return false if the queue is full or the channel is not open; the
+ *         share is counted as dropped
+ */
+bool sv2_client_submit(sv2_client_t *client, const stratum_share_t *share);
+
+/**
+ * @brief Snapshot of the connection state and counters
+ */
+void sv2_client_status(sv2_client_t *client, sv2_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SV2_H__
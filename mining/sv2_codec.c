@@ -0,0 +1,393 @@
+/**
+ * @file sv2_codec.c
+ * @brief Stratum V2 binary framing and the mining messages of a standard channel
+ */
+
+#include "sv2_codec.h"
+#include <string.h>
+
+// Bounds-checked payload cursor; a short read clears ok and yields zeros
+typedef struct {
+    const uint8_t *p;
+    size_t left;
+    bool ok;
+} sv2_reader_t;
+
+typedef struct {
+    uint8_t *p;
+    size_t left;
+    bool ok;
+} sv2_writer_t;
+
+static const uint8_t *take(sv2_reader_t *r, size_t len)
+{
+    const uint8_t *p = r->p;
+
+    if (!r->ok || r->left < len) {
+        r->ok = false;
+        return NULL;
+    }
+    r->p += len;
+    r->left -= len;
+    return p;
+}
+
+static uint32_t read_le(sv2_reader_t *r, size_t len)
+{
+    const uint8_t *p = take(r, len);
+    uint32_t value = 0;
+
+    for (size_t i = 0; p != NULL && i < len; i++) {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t read_u64(sv2_reader_t *r)
+{
+    uint64_t low = read_le(r, 4);
+    return low | (uint64_t)read_le(r, 4) << 32;
+}
+
+static void read_bytes(sv2_reader_t *r, uint8_t *out, size_t len)
+{
+    const uint8_t *p = take(r, len);
+
+    if (p != NULL) {
+        memcpy(out, p, len);
+    }
+}
+
+// STR0_255 into text, truncated to SV2_TEXT_MAX - 1 characters
+static void read_str(sv2_reader_t *r, char *text)
+{
+    size_t len = read_le(r, 1);
+    const uint8_t *p = take(r, len);
+    size_t kept = len < SV2_TEXT_MAX - 1 ? len : SV2_TEXT_MAX - 1;
+
+    if (text == NULL) {
+        return;
+    }
+    if (p != NULL) {
+        memcpy(text, p, kept);
+    }
+    text[p != NULL ? kept : 0] = '\0';
+}
+
+static void write_bytes(sv2_writer_t *w, const void *data, size_t len)
+{
+    if (!w->ok || w->left < len) {
+        w->ok = false;
+        return;
+    }
+    memcpy(w->p, data, len);
+    w->p += len;
+    w->left -= len;
+}
+
+static void write_le(sv2_writer_t *w, uint32_t value, size_t len)
+{
+    uint8_t bytes[4];
+
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+    write_bytes(w, bytes, len);
+}
+
+static void write_u64(sv2_writer_t *w, uint64_t value)
+{
+    write_le(w, (uint32_t)value, 4);
+    write_le(w, (uint32_t)(value >> 32), 4);
+}
+
+static void write_str(sv2_writer_t *w, const char *text)
+{
+    size_t len = strnlen(text, SV2_TEXT_MAX - 1);
+
+    write_le(w, (uint32_t)len, 1);
+    write_bytes(w, text, len);
+}
+
+static bool is_channel_msg(uint8_t type)
+{
+    switch (type) {
+    case SV2_NEW_MINING_JOB:
+    case SV2_SUBMIT_SHARES_STANDARD:
+    case SV2_SUBMIT_SHARES_SUCCESS:
+    case SV2_SUBMIT_SHARES_ERROR:
+    case SV2_SET_NEW_PREV_HASH:
+    case SV2_SET_TARGET:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Payload fields of msg->type; false for a type we do not know
+static bool decode_payload(sv2_reader_t *r, sv2_msg_t *msg)
+{
+    uint32_t bits;
+
+    switch (msg->type) {
+    case SV2_SETUP_CONNECTION:
+        msg->protocol = (uint8_t)read_le(r, 1);
+        msg->min_version = (uint16_t)read_le(r, 2);
+        msg->max_version = (uint16_t)read_le(r, 2);
+        msg->flags = read_le(r, 4);
+        read_str(r, msg->text);
+        msg->port = (uint16_t)read_le(r, 2);
+        // Vendor, hardware version, firmware and device id
+        for (int i = 0; i < 4; i++) {
+            read_str(r, NULL);
+        }
+        break;
+    case SV2_SETUP_CONNECTION_SUCCESS:
+        msg->min_version = (uint16_t)read_le(r, 2);
+        msg->flags = read_le(r, 4);
+        break;
+    case SV2_SETUP_CONNECTION_ERROR:
+        msg->flags = read_le(r, 4);
+        read_str(r, msg->text);
+        break;
+    case SV2_OPEN_STANDARD_MINING_CHANNEL:
+        msg->request_id = read_le(r, 4);
+        read_str(r, msg->text);
+        bits = read_le(r, 4);
+        memcpy(&msg->hashrate, &bits, sizeof(bits));
+        read_bytes(r, msg->hash, 32);
+        break;
+    case SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS:
+        msg->request_id = read_le(r, 4);
+        msg->channel_id = read_le(r, 4);
+        read_bytes(r, msg->hash, 32);
+        msg->extranonce_prefix_len = (uint8_t)read_le(r, 1);
+        if (msg->extranonce_prefix_len > sizeof(msg->extranonce_prefix)) {
+            r->ok = false;
+        }
+        read_bytes(r, msg->extranonce_prefix, r->ok ? msg->extranonce_prefix_len : 0);
+        read_le(r, 4);                                      // group_channel_id
+        break;
+    case SV2_OPEN_MINING_CHANNEL_ERROR:
+        msg->request_id = read_le(r, 4);
+        read_str(r, msg->text);
+        break;
+    case SV2_NEW_MINING_JOB:
+        msg->channel_id = read_le(r, 4);
+        msg->job_id = read_le(r, 4);
+        bits = read_le(r, 1);
+        if (bits > 1) {
+            r->ok = false;
+        }
+        msg->future = bits == 0;
+        msg->ntime = bits == 1 ? read_le(r, 4) : 0;
+        msg->version = read_le(r, 4);
+        // B0_32 that must hold a whole root
+        if (read_le(r, 1) != 32) {
+            r->ok = false;
+        }
+        read_bytes(r, msg->hash, 32);
+        break;
+    case SV2_SUBMIT_SHARES_STANDARD:
+        msg->channel_id = read_le(r, 4);
+        msg->sequence = read_le(r, 4);
+        msg->job_id = read_le(r, 4);
+        msg->nonce = read_le(r, 4);
+        msg->ntime = read_le(r, 4);
+        msg->version = read_le(r, 4);
+        break;
+    case SV2_SUBMIT_SHARES_SUCCESS:
+        msg->channel_id = read_le(r, 4);
+        msg->sequence = read_le(r, 4);
+        msg->count = read_le(r, 4);
+        msg->shares_sum = read_u64(r);
+        break;
+    case SV2_SUBMIT_SHARES_ERROR:
+        msg->channel_id = read_le(r, 4);
+        msg->sequence = read_le(r, 4);
+        read_str(r, msg->text);
+        break;
+    case SV2_SET_NEW_PREV_HASH:
+        msg->channel_id = read_le(r, 4);
+        msg->job_id = read_le(r, 4);
+        read_bytes(r, msg->hash, 32);
+        msg->ntime = read_le(r, 4);
+        msg->nbits = read_le(r, 4);
+        break;
+    case SV2_SET_TARGET:
+        msg->channel_id = read_le(r, 4);
+        read_bytes(r, msg->hash, 32);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static void decode_frame(sv2_decoder_t *decoder)
+{
+    sv2_msg_t *msg = &decoder->msg;
+    uint16_t extension = (uint16_t)(decoder->header[0] | decoder->header[1] << 8);
+    sv2_reader_t r = { decoder->payload, decoder->length, true };
+
+    memset(msg, 0, sizeof(*msg));
+    msg->type = decoder->header[2];
+    msg->extension = extension & ~SV2_CHANNEL_BIT;
+    if (decoder->length > SV2_PAYLOAD_MAX || msg->extension != 0) {
+        return;
+    }
+    // Trailing bytes are tolerated: later protocol revisions may append fields
+    msg->decoded = decode_payload(&r, msg) && r.ok;
+}
+
+void sv2_decoder_init(sv2_decoder_t *decoder)
+{
+    decoder->header_len = 0;
+    decoder->length = 0;
+    decoder->received = 0;
+}
+
+size_t sv2_decoder_feed(sv2_decoder_t *decoder, const uint8_t *data, size_t len, const sv2_msg_t **msg)
+{
+    size_t done = 0;
+
+    *msg = NULL;
+    while (done < len && decoder->header_len < SV2_HEADER_SIZE) {
+        decoder->header[decoder->header_len++] = data[done++];
+        if (decoder->header_len == SV2_HEADER_SIZE) {
+            decoder->length = decoder->header[3] | (size_t)decoder->header[4] << 8 |
+                              (size_t)decoder->header[5] << 16;
+            decoder->received = 0;
+        }
+    }
+    if (decoder->header_len < SV2_HEADER_SIZE) {
+        return done;
+    }
+
+    size_t chunk = decoder->length - decoder->received;
+    if (chunk > len - done) {
+        chunk = len - done;
+    }
+    if (decoder->received < SV2_PAYLOAD_MAX) {
+        size_t kept = SV2_PAYLOAD_MAX - decoder->received;
+        memcpy(decoder->payload + decoder->received, data + done, chunk < kept ? chunk : kept);
+    }
+    decoder->received += chunk;
+    done += chunk;
+
+    if (decoder->received == decoder->length) {
+        decode_frame(decoder);
+        decoder->header_len = 0;
+        *msg = &decoder->msg;
+    }
+    return done;
+}
+
+size_t sv2_encode(const sv2_msg_t *msg, uint8_t *out, size_t max)
+{
+    sv2_writer_t w = { out + SV2_HEADER_SIZE, max > SV2_HEADER_SIZE ? max - SV2_HEADER_SIZE : 0,
+                       max >= SV2_HEADER_SIZE };
+    uint32_t bits;
+
+    switch (msg->type) {
+    case SV2_SETUP_CONNECTION:
+        write_le(&w, msg->protocol, 1);
+        write_le(&w, msg->min_version, 2);
+        write_le(&w, msg->max_version, 2);
+        write_le(&w, msg->flags, 4);
+        write_str(&w, msg->text);
+        write_le(&w, msg->port, 2);
+        write_str(&w, SV2_VENDOR);
+        write_str(&w, "");
+        write_str(&w, SV2_FIRMWARE);
+        write_str(&w, "");
+        break;
+    case SV2_SETUP_CONNECTION_SUCCESS:
+        write_le(&w, msg->min_version, 2);
+        write_le(&w, msg->flags, 4);
+        break;
+    case SV2_SETUP_CONNECTION_ERROR:
+        write_le(&w, msg->flags, 4);
+        write_str(&w, msg->text);
+        break;
+    case SV2_OPEN_STANDARD_MINING_CHANNEL:
+        write_le(&w, msg->request_id, 4);
+        write_str(&w, msg->text);
+        memcpy(&bits, &msg->hashrate, sizeof(bits));
+        write_le(&w, bits, 4);
+        write_bytes(&w, msg->hash, 32);
+        break;
+    case SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS:
+        write_le(&w, msg->request_id, 4);
+        write_le(&w, msg->channel_id, 4);
+        write_bytes(&w, msg->hash, 32);
+        if (msg->extranonce_prefix_len > sizeof(msg->extranonce_prefix)) {
+            return 0;
+        }
+        write_le(&w, msg->extranonce_prefix_len, 1);
+        write_bytes(&w, msg->extranonce_prefix, msg->extranonce_prefix_len);
+        write_le(&w, 0, 4);                                 // group_channel_id: none
+        break;
+    case SV2_OPEN_MINING_CHANNEL_ERROR:
+        write_le(&w, msg->request_id, 4);
+        write_str(&w, msg->text);
+        break;
+    case SV2_NEW_MINING_JOB:
+        write_le(&w, msg->channel_id, 4);
+        write_le(&w, msg->job_id, 4);
+        write_le(&w, msg->future ? 0 : 1, 1);
+        if (!msg->future) {
+            write_le(&w, msg->ntime, 4);
+        }
+        write_le(&w, msg->version, 4);
+        write_le(&w, 32, 1);
+        write_bytes(&w, msg->hash, 32);
+        break;
+    case SV2_SUBMIT_SHARES_STANDARD:
+        write_le(&w, msg->channel_id, 4);
+        write_le(&w, msg->sequence, 4);
+        write_le(&w, msg->job_id, 4);
+        write_le(&w, msg->nonce, 4);
+        write_le(&w, msg->ntime, 4);
+        write_le(&w, msg->version, 4);
+        break;
+    case SV2_SUBMIT_SHARES_SUCCESS:
+        write_le(&w, msg->channel_id, 4);
+        write_le(&w, msg->sequence, 4);
+        write_le(&w, msg->count, 4);
+        write_u64(&w, msg->shares_sum);
+        break;
+    case SV2_SUBMIT_SHARES_ERROR:
+        write_le(&w, msg->channel_id, 4);
+        write_le(&w, msg->sequence, 4);
+        write_str(&w, msg->text);
+        break;
+    case SV2_SET_NEW_PREV_HASH:
+        write_le(&w, msg->channel_id, 4);
+        write_le(&w, msg->job_id, 4);
+        write_bytes(&w, msg->hash, 32);
+        write_le(&w, msg->ntime, 4);
+        write_le(&w, msg->nbits, 4);
+        break;
+    case SV2_SET_TARGET:
+        write_le(&w, msg->channel_id, 4);
+        write_bytes(&w, msg->hash, 32);
+        break;
+    default:
+        return 0;
+    }
+    if (!w.ok) {
+        return 0;
+    }
+
+    size_t length = (size_t)(w.p - out) - SV2_HEADER_SIZE;
+    uint16_t extension = is_channel_msg(msg->type) ? SV2_CHANNEL_BIT : 0;
+
+    out[0] = (uint8_t)extension;
+    out[1] = (uint8_t)(extension >> 8);
+    out[2] = msg->type;
+    out[3] = (uint8_t)length;
+    out[4] = (uint8_t)(length >> 8);
+    out[5] = (uint8_t)(length >> 16);
+    return SV2_HEADER_SIZE + length;
+}
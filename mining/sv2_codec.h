@@ -0,0 +1,159 @@
+/**
+ * @file sv2_codec.h
+ * @brief Stratum V2 binary framing and the mining messages of a standard channel
+ *
+ * Every SV2 message is a 6-byte frame header followed by its payload:
+ *
+ *     extension_type  U16  bit 15 (channel_msg) set for channel messages
+ *     msg_type        U8
+ *     msg_length      U24  payload bytes
+ *
+ * Integers are little-endian, U256 values (hashes, targets) are 32 bytes
+ * in the same byte order as in the block header, STR0_255 and B0_32 carry
+ * a one-byte length and OPTION[T] a 0/1 count before the value.
+ *
+ * The decoder is fed socket data in whatever pieces recv() returns and
+ * keeps at most one payload of SV2_PAYLOAD_MAX bytes; larger frames are
+ * skipped. Decoded messages land in one fixed sv2_msg_t, like the
+ * Stratum v1 parser's stratum_msg_t. sv2_encode() frames the same struct,
+ * so the client and the test pool share one codec.
+ *
+ * Only the messages a header-only (standard) channel needs are known:
+ * connection setup, opening the channel, jobs, previous hash, target
+ * and share submission.
+ */
+
+#ifndef __SV2_CODEC_H__
+#define __SV2_CODEC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Frame header size */
+#define SV2_HEADER_SIZE         6
+
+/** Largest payload decoded: every message a standard channel receives, full error string included */
+#define SV2_PAYLOAD_MAX         320
+
+/** Longest string kept from a message (endpoint host, user identity, error code), terminator included */
+#define SV2_TEXT_MAX            64
+
+/** channel_msg bit of extension_type */
+#define SV2_CHANNEL_BIT         0x8000
+
+/** Protocol version negotiated in SetupConnection */
+#define SV2_PROTOCOL_VERSION    2
+
+/** SetupConnection protocol field: mining protocol */
+#define SV2_PROTOCOL_MINING     0
+
+/** SetupConnection flag: the device only understands standard jobs */
+#define SV2_REQUIRES_STANDARD_JOBS  0x01
+
+/** SetupConnection flag: the device rolls the BIP320 version bits */
+#define SV2_REQUIRES_VERSION_ROLLING    0x04
+
+/** SetupConnection.Success flag: the pool does not accept a rolled version */
+#define SV2_REQUIRES_FIXED_VERSION  0x01
+
+/** Vendor and firmware strings sent in SetupConnection */
+#define SV2_VENDOR              "esp32-btc-miner"
+#define SV2_FIRMWARE            "1.0"
+
+typedef enum {
+    SV2_SETUP_CONNECTION                = 0x00,
+    SV2_SETUP_CONNECTION_SUCCESS        = 0x01,
+    SV2_SETUP_CONNECTION_ERROR          = 0x02,
+    SV2_OPEN_STANDARD_MINING_CHANNEL    = 0x10,
+    SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS = 0x11,
+    SV2_OPEN_MINING_CHANNEL_ERROR       = 0x12,
+    SV2_NEW_MINING_JOB                  = 0x15,
+    SV2_SUBMIT_SHARES_STANDARD          = 0x1a,
+    SV2_SUBMIT_SHARES_SUCCESS           = 0x1c,
+    SV2_SUBMIT_SHARES_ERROR             = 0x1d,
+    SV2_SET_NEW_PREV_HASH               = 0x20,
+    SV2_SET_TARGET                      = 0x21,
+} sv2_msg_type_t;
+
+/** One message; which fields are valid depends on the type */
+typedef struct {
+    uint8_t type;                       ///< sv2_msg_type_t, or any type for a message not decoded
+    bool decoded;                       ///< Known type, payload fit and was well-formed
+    uint16_t extension;                 ///< extension_type without the channel bit
+
+    // SetupConnection and its answers
+    uint8_t protocol;                   ///< SV2_PROTOCOL_MINING
+    uint16_t min_version;               ///< Also SetupConnection.Success used_version
+    uint16_t max_version;
+    uint32_t flags;
+    uint16_t port;                      ///< Endpoint port
+
+    // Channels, jobs and shares
+    uint32_t request_id;                ///< OpenStandardMiningChannel and its answers
+    uint32_t channel_id;
+    uint32_t job_id;
+    bool future;                        ///< NewMiningJob without min_ntime: waits for SetNewPrevHash
+    uint32_t ntime;                     ///< Job or previous hash min_ntime; share ntime
+    uint32_t version;                   ///< Job or share version
+    uint32_t nbits;                     ///< SetNewPrevHash
+    uint32_t nonce;                     ///< Share nonce
+    uint32_t sequence;                  ///< Share sequence number; last one acknowledged
+    uint32_t count;                     ///< Shares acknowledged by SubmitShares.Success
+    uint64_t shares_sum;                ///< Difficulty sum acknowledged by SubmitShares.Success
+    float hashrate;                     ///< OpenStandardMiningChannel nominal_hash_rate (h/s)
+    uint8_t hash[32];                   ///< Merkle root, previous block hash or target (header byte order)
+    uint8_t extranonce_prefix[32];      ///< OpenStandardMiningChannel.Success
+    uint8_t extranonce_prefix_len;
+    char text[SV2_TEXT_MAX];            ///< Endpoint host, user identity or error code (truncated)
+} sv2_msg_t;
+
+typedef struct {
+    uint8_t header[SV2_HEADER_SIZE];
+    size_t header_len;                  ///< Header bytes received
+    size_t length;                      ///< Payload length from the header
+    size_t received;                    ///< Payload bytes received, kept or skipped
+    uint8_t payload[SV2_PAYLOAD_MAX];
+    sv2_msg_t msg;                      ///< Last message decoded
+} sv2_decoder_t;
+
+/**
+ * @brief Reset a decoder to the start of a frame
+ */
+void sv2_decoder_init(sv2_decoder_t *decoder);
+
+/**
+ * @brief Feed received bytes, stopping at the end of a frame
+ *
+ * @param decoder Decoder
+ * @param data Received bytes
+ * @param len Number of bytes
+ * @param msg Output: the frame's message if one was completed (check
+ *            decoded), else NULL. Valid until the next call.
+ * @return Bytes consumed; call again with the rest
+ */
+size_t sv2_decoder_feed(sv2_decoder_t *decoder, const uint8_t *data, size_t len, const sv2_msg_t **msg);
+
+/**
+ * @brief Frame a message
+ *
+ * SetupConnection sends SV2_VENDOR and SV2_FIRMWARE with empty hardware
+ * and device strings; text is the endpoint host, user identity or error
+ * code depending on the type.
+ *
+ * @param msg Message (type and the fields of that type)
+ * @param out Output buffer
+ * @param max Buffer size
+ * @return Frame length, or 0 for an unknown type or a frame that does not fit
+ */
+size_t sv2_encode(const sv2_msg_t *msg, uint8_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SV2_CODEC_H__
@@ -0,0 +1,122 @@
+/**
+ * @file target.c
+ * @brief Hash difficulty evaluation
+ */
+
+#include "target.h"
+#include <math.h>
+#include <string.h>
+
+// Count leading zero bits in hash
+uint32_t count_leading_zeros(const uint8_t* hash)
+{
+    uint32_t zeros = 0;
+    for(int i = 31; i >= 0; i--) {
+        if(hash[i] == 0) {
+            zeros += 8;
+        } else {
+            uint8_t byte = hash[i];
+            while((byte & 0x80) == 0) {
+                zeros++;
+                byte <<= 1;
+            }
+            break;
+        }
+    }
+    return zeros;
+}
+
+// diff1 = 0xFFFF * 2^208
+static double target_diff1(void)
+{
+    return ldexp(65535.0, 208);
+}
+
+bool target_from_bits(uint32_t bits, target_t *target)
+{
+    uint32_t size = bits >> 24;
+    uint32_t mantissa = bits & 0x007FFFFF;
+
+    memset(target, 0, sizeof(*target));
+    if (mantissa == 0) {
+        return false;
+    }
+    if (bits & 0x00800000) {
+        return false;
+    }
+    if (size > 34 || (mantissa > 0xFF && size > 33) || (mantissa > 0xFFFF && size > 32)) {
+        return false;
+    }
+
+    if (size <= 3) {
+        target->words[7] = mantissa >> (8 * (3 - size));
+        return target->words[7] != 0;
+    }
+
+    // mantissa * 2^shift, spread over at most two words
+    uint32_t shift = 8 * (size - 3);
+    uint64_t value = (uint64_t)mantissa << (shift % 32);
+    int low = 7 - (int)(shift / 32);
+
+    target->words[low] = (uint32_t)value;
+    if (low > 0) {
+        target->words[low - 1] = (uint32_t)(value >> 32);
+    }
+    return true;
+}
+
+void target_from_difficulty(double difficulty, target_t *target)
+{
+    double value = difficulty > 0 ? target_diff1() / difficulty : HUGE_VAL;
+
+    if (!(value < ldexp(1.0, 256))) {
+        memset(target->words, 0xFF, sizeof(target->words));
+        return;
+    }
+    // Peel off words from the top; each step is exact in binary floating point
+    for (int i = 0; i < 8; i++) {
+        double scale = ldexp(1.0, 32 * (7 - i));
+        double word = floor(value / scale);
+
+        target->words[i] = (uint32_t)word;
+        value -= word * scale;
+    }
+}
+
+void target_from_hash(const uint8_t *hash, target_t *value)
+{
+    for (int i = 0; i < 8; i++) {
+        const uint8_t *p = hash + 28 - 4 * i;
+
+        value->words[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                          ((uint32_t)p[3] << 24);
+    }
+}
+
+int target_compare(const target_t *a, const target_t *b)
+{
+    for (int i = 0; i < 8; i++) {
+        if (a->words[i] != b->words[i]) {
+            return a->words[i] < b->words[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+double target_difficulty(const target_t *value)
+{
+    double v = 0;
+
+    for (int i = 0; i < 8; i++) {
+        v += ldexp((double)value->words[i], 32 * (7 - i));
+    }
+    return v > 0 ? target_diff1() / v : HUGE_VAL;
+}
+
+double target_hash_difficulty(const uint8_t *hash)
+{
+    target_t value;
+
+    target_from_hash(hash, &value);
+    return target_difficulty(&value);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file target.h
+ * @brief Hash difficulty evaluation
+ *
+ * Hashes are compared as little-endian 256-bit numbers: byte 31 of the
+ * digest is the most significant byte.
+ *
+ * Targets are expanded once per job - from the compact nBits field of the
+ * header or from a pool's share difficulty - into eight 32-bit words, most
+ * significant first. Word 0 is the "top word" the SHA-256d kernels reject
+ * on (see sha256d_check_nonce()), so target_top_word() is directly the
+ * max_top_word for a scan, and the full compare of a candidate usually
+ * exits after the first word.
+ */
+
+#ifndef __TARGET_H__
+#define __TARGET_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** nBits of difficulty 1 (0x00000000FFFF0000...0000) */
+#define TARGET_DIFF1_BITS       0x1d00ffffu
+
+/**
+ * @brief 256-bit unsigned number, most significant word first
+ *
+ * Used for targets and, loaded with target_from_hash(), for hashes.
+ */
+typedef struct {
+    uint32_t words[8];
+} target_t;
+
+/**
+ * @brief Count leading zero bits of a hash, starting from byte 31
+ *
+ * @param hash 32-byte digest
+ * @return Number of leading zero bits (0-256)
+ */
+uint32_t count_leading_zeros(const uint8_t* hash);
+
+/**
+ * @brief Expand a compact nBits value into a target
+ *
+ * Follows Bitcoin Core's SetCompact(): the low 23 bits are the mantissa
+ * and the top byte the size in bytes.
+ *
+ * @param bits Compact target as stored in header bytes 72-75
+ * @param target Expanded target (zero on failure)
+ * @return false if bits encodes a negative or overflowing value
+ */
+bool target_from_bits(uint32_t bits, target_t *target);
+
+/**
+ * @brief Target for a pool share difficulty
+ *
+ * target = diff1 / difficulty, where diff1 is the nBits 0x1d00ffff target
+ * (the stratum convention). Precision is that of a double, which is far
+ * below one share of difference at any practical difficulty.
+ *
+ * @param difficulty Share difficulty; values <= 0 give the maximum target
+ * @param target Expanded target
+ */
+void target_from_difficulty(double difficulty, target_t *target);
+
+/**
+ * @brief Load a digest into the target representation
+ */
+void target_from_hash(const uint8_t *hash, target_t *value);
+
+/**
+ * @brief Compare two 256-bit numbers
+ *
+ * @return <0, 0 or >0 as a is less than, equal to or greater than b
+ */
+int target_compare(const target_t *a, const target_t *b);
+
+/**
+ * @brief Check hash <= target, stopping at the first differing word
+ *
+ * @param hash 32-byte digest
+ * @param target Expanded target
+ * @return true if the hash meets the target
+ */
+static inline bool target_hash_meets(const uint8_t *hash, const target_t *target)
+{
+    for (int i = 0; i < 8; i++) {
+        const uint8_t *p = hash + 28 - 4 * i;
+        uint32_t word = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+
+        if (word != target->words[i]) {
+            return word < target->words[i];
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Candidate threshold for the kernels: hashes meeting the target
+ *        always have top word <= this value
+ */
+static inline uint32_t target_top_word(const target_t *target)
+{
+    return target->words[0];
+}
+
+/**
+ * @brief Difficulty of a target or hash value (diff1 / value)
+ *
+ * @return Difficulty as a double; HUGE_VAL for zero
+ */
+double target_difficulty(const target_t *value);
+
+/**
+ * @brief Share difficulty of a digest (diff1 / hash)
+ */
+double target_hash_difficulty(const uint8_t *hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TARGET_H__
@@ -0,0 +1,40 @@
+/**
+ * @file version_rolling.c
+ * @brief BIP310 version-rolling negotiation and BIP320 version bits
+ */
+
+#include "version_rolling.h"
+#include <stdio.h>
+
+uint32_t version_rolling_count(uint32_t mask)
+{
+    int bits = __builtin_popcount(mask);
+
+    return bits >= 31 ? 1u << 31 : 1u << bits;
+}
+
+uint32_t version_rolling_apply(uint32_t base, uint32_t mask, uint32_t index)
+{
+    uint32_t version = base & ~mask;
+
+    for (uint32_t bit = 1; mask != 0 && index != 0; bit <<= 1) {
+        if (mask & bit) {
+            if (index & 1) {
+                version |= bit;
+            }
+            index >>= 1;
+            mask &= ~bit;
+        }
+    }
+    return version;
+}
+
+size_t version_rolling_configure_request(char *buf, size_t size, uint32_t id, uint32_t mask)
+{
+    int len = snprintf(buf, size,
+                       "{\"id\":%lu,\"method\":\"mining.configure\",\"params\":[[\"version-rolling\"],"
+                       "{\"version-rolling.mask\":\"%08lx\",\"version-rolling.min-bit-count\":%d}]}\n",
+                       (unsigned long)id, (unsigned long)mask, VERSION_ROLLING_MIN_BITS);
+
+    return len < 0 || (size_t)len >= size ? 0 : (size_t)len;
+}
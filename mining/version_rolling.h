@@ -0,0 +1,63 @@
+/**
+ * @file version_rolling.h
+ * @brief BIP310 version-rolling negotiation and BIP320 version bits
+ *
+ * A pool that supports the stratum "version-rolling" extension lets the
+ * miner change the header version within a negotiated mask. BIP320 sets
+ * aside bits 13-28 for this. Changing the version only touches header word 0,
+ * so each value gives another 2^32 nonces for one midstate recompute - no
+ * coinbase or merkle work.
+ *
+ * Negotiation is a mining.configure request; the granted mask is the
+ * intersection of what we asked for and what the pool answers, which the
+ * Stratum client reads from the response stratum_parser_feed() decodes.
+ */
+
+#ifndef __VERSION_ROLLING_H__
+#define __VERSION_ROLLING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** General-purpose version bits reserved by BIP320 */
+#define VERSION_ROLLING_BIP320_MASK     0x1fffe000u
+
+/** Minimum number of rollable bits we ask the pool for */
+#define VERSION_ROLLING_MIN_BITS        2
+
+/**
+ * @brief Number of distinct versions a mask allows (capped at 2^31)
+ */
+uint32_t version_rolling_count(uint32_t mask);
+
+/**
+ * @brief The index-th version: the bits of index deposited into the mask bits
+ *
+ * @param base Version from the job
+ * @param mask Rollable bits
+ * @param index Value to spread over the mask bits, lowest bit first
+ * @return (base & ~mask) | deposited bits
+ */
+uint32_t version_rolling_apply(uint32_t base, uint32_t mask, uint32_t index);
+
+/**
+ * @brief Format a mining.configure request for version rolling
+ *
+ * @param buf Output buffer (newline-terminated JSON line)
+ * @param size Size of buf
+ * @param id Request id
+ * @param mask Bits we would like to roll
+ * @return Length written, or 0 if buf is too small
+ */
+size_t version_rolling_configure_request(char *buf, size_t size, uint32_t id, uint32_t mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __VERSION_ROLLING_H__
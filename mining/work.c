@@ -0,0 +1,197 @@
+/**
+ * @file work.c
+ * @brief Work templates: header variants beyond one 2^32 nonce range
+ */
+
+#include "work.h"
+#include <string.h>
+
+// Second block of a 64-byte message: padding and the 512-bit length
+static const uint8_t pad64[64] = { 0x80, [62] = 0x02 };
+
+static void store_state(const uint32_t *state, uint8_t *out)
+{
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = (uint8_t)(state[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
+
+// SHA-256 of a 32-byte digest (the outer hash of SHA-256d): one block
+static void hash_digest(const uint8_t *digest, uint8_t *out)
+{
+    uint8_t block[64] = { 0 };
+    sha256_ctx_t ctx;
+
+    memcpy(block, digest, 32);
+    block[32] = 0x80;
+    block[62] = 0x01;
+    sha256_init(&ctx);
+    sha256_transform(ctx.state, block);
+    store_state(ctx.state, out);
+}
+
+// SHA-256d of a 64-byte branch pair, in place: three compressions
+static void hash_pair(uint8_t *pair)
+{
+    sha256_ctx_t ctx;
+    uint8_t digest[32];
+
+    sha256_init(&ctx);
+    sha256_transform(ctx.state, pair);
+    sha256_transform(ctx.state, pad64);
+    store_state(ctx.state, digest);
+    hash_digest(digest, pair);
+}
+
+void work_init(work_template_t *work, const block_header_t *header, uint32_t ntime_roll)
+{
+    memset(work, 0, sizeof(*work));
+    work->header = *header;
+    work->header.nonce = 0;
+    work->ntime_roll = ntime_roll;
+}
+
+bool work_set_coinbase(work_template_t *work, const uint8_t *coinbase1, size_t coinbase1_len,
+                       const uint8_t *extranonce1, size_t extranonce1_len, size_t extranonce2_size,
+                       const uint8_t *coinbase2, size_t coinbase2_len)
+{
+    size_t len = coinbase1_len + extranonce1_len + extranonce2_size + coinbase2_len;
+
+    if (extranonce2_size < 1 || extranonce2_size > WORK_EXTRANONCE2_MAX || len > WORK_COINBASE_MAX) {
+        return false;
+    }
+    memcpy(work->coinbase, coinbase1, coinbase1_len);
+    memcpy(work->coinbase + coinbase1_len, extranonce1, extranonce1_len);
+    work->extranonce2_offset = coinbase1_len + extranonce1_len;
+    work->extranonce2_size = extranonce2_size;
+    memset(work->coinbase + work->extranonce2_offset, 0, extranonce2_size);
+    memcpy(work->coinbase + work->extranonce2_offset + extranonce2_size, coinbase2, coinbase2_len);
+    work->coinbase_len = len;
+    work_cache_coinbase(work);
+    return true;
+}
+
+void work_cache_coinbase(work_template_t *work)
+{
+    sha256_init(&work->coinbase_prefix);
+    sha256_update(&work->coinbase_prefix, work->coinbase, work->extranonce2_offset & ~(size_t)63);
+}
+
+bool work_add_branch(work_template_t *work, const uint8_t *hash)
+{
+    if (work->merkle_count >= WORK_MERKLE_MAX) {
+        return false;
+    }
+    memcpy(work->merkle_branch[work->merkle_count++], hash, 32);
+    return true;
+}
+
+uint32_t work_rolls(const work_template_t *work)
+{
+    uint64_t rolls = ((uint64_t)work->ntime_roll + 1) * version_rolling_count(work->version_mask);
+
+    if (work->coinbase_len != 0) {
+        // Extranonce2 values of 4 or more bytes outlast any 32-bit roll index
+        uint64_t values = work->extranonce2_size >= 4 ? 1ull << 32 : 1ull << (8 * work->extranonce2_size);
+        rolls *= values;
+    }
+    return rolls > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)rolls;
+}
+
+void work_roll(const work_template_t *work, uint32_t roll, work_roll_t *out)
+{
+    uint32_t versions = version_rolling_count(work->version_mask);
+    uint32_t span = work->ntime_roll + 1;
+    uint32_t outer = roll / versions;
+    uint32_t step = work->coinbase_len != 0 ? outer / span : 0;
+    uint64_t extranonce2 = work->extranonce2 + step;
+
+    if (work->extranonce2_size < 8) {
+        extranonce2 &= (1ull << (8 * work->extranonce2_size)) - 1;
+    }
+    out->version = version_rolling_apply(work->header.version, work->version_mask, roll % versions);
+    out->ntime = work->header.timestamp + outer % span;
+    out->extranonce2 = extranonce2;
+    out->extranonce_step = step;
+}
+
+void work_merkle_root(const work_template_t *work, uint64_t extranonce2, uint8_t *root)
+{
+    size_t suffix = work->extranonce2_offset + work->extranonce2_size;
+    uint8_t extranonce[WORK_EXTRANONCE2_MAX];
+    uint8_t digest[32];
+    uint8_t pair[64];
+    sha256_ctx_t ctx;
+
+    if (work->coinbase_len == 0) {
+        memcpy(root, work->header.merkle_root, 32);
+        return;
+    }
+
+    // Resume after the cached blocks; a template built by hand may have none
+    ctx = work->coinbase_prefix;
+    if (ctx.length == 0 || ctx.length > work->extranonce2_offset) {
+        sha256_init(&ctx);
+    }
+    for (size_t i = 0; i < work->extranonce2_size; i++) {
+        extranonce[i] = (uint8_t)(extranonce2 >> (8 * i));
+    }
+    sha256_update(&ctx, work->coinbase + ctx.length, work->extranonce2_offset - (size_t)ctx.length);
+    sha256_update(&ctx, extranonce, work->extranonce2_size);
+    sha256_update(&ctx, work->coinbase + suffix, work->coinbase_len - suffix);
+    sha256_final(&ctx, digest);
+    hash_digest(digest, pair);
+
+    // The coinbase is always the leftmost leaf
+    for (size_t i = 0; i < work->merkle_count; i++) {
+        memcpy(pair + 32, work->merkle_branch[i], 32);
+        hash_pair(pair);
+    }
+    memcpy(root, pair, 32);
+}
+
+void work_header(const work_template_t *work, uint32_t roll, uint8_t *header)
+{
+    block_header_t h = work->header;
+    work_roll_t r;
+
+    work_roll(work, roll, &r);
+    work_merkle_root(work, r.extranonce2, h.merkle_root);
+    h.version = r.version;
+    h.timestamp = r.ntime;
+    h.nonce = 0;
+    block_header_serialize(&h, header);
+}
+
+work_switch_t work_apply_roll(const work_template_t *work, sha256d_ctx_t *ctx, uint32_t from, uint32_t to)
+{
+    work_roll_t old;
+    work_roll_t r;
+
+    work_roll(work, from, &old);
+    work_roll(work, to, &r);
+    ctx->words[BLOCK_HEADER_TIME_OFFSET / 4] = __builtin_bswap32(r.ntime);
+    ctx->words[BLOCK_HEADER_VERSION_OFFSET / 4] = __builtin_bswap32(r.version);
+    if (r.extranonce_step == old.extranonce_step) {
+        if (r.version == old.version) {
+            sha256d_precompute(ctx);
+            return WORK_SWITCH_NTIME;
+        }
+        sha256d_update_midstate(ctx);
+        return WORK_SWITCH_VERSION;
+    }
+
+    uint8_t root[32];
+    work_merkle_root(work, r.extranonce2, root);
+    for (int i = 0; i < 8; i++) {
+        ctx->words[BLOCK_HEADER_MERKLE_OFFSET / 4 + i] = ((uint32_t)root[i * 4] << 24) |
+                                                        ((uint32_t)root[i * 4 + 1] << 16) |
+                                                        ((uint32_t)root[i * 4 + 2] << 8) |
+                                                        (uint32_t)root[i * 4 + 3];
+    }
+    sha256d_update_midstate(ctx);
+    return WORK_SWITCH_EXTRANONCE;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file work.h
+ * @brief Work templates: header variants beyond one 2^32 nonce range
+ *
+ * A job covers more than one nonce range. Each "roll" index selects one
+ * header variant. From the innermost loop out:
+ *
+ * - the version bits allowed by version_mask (BIP310/BIP320) are iterated;
+ * - then ntime is rolled, up to ntime_roll seconds past the job's time;
+ * - then extranonce2 is bumped, which rebuilds the coinbase hash and merkle
+ *   root.
+ *
+ * The scheduler hands out 64-bit positions (roll << 32 | nonce), so an
+ * exhausted nonce range simply continues in the next roll.
+ *
+ * A variant is a pure function of the template and the roll. Each worker
+ * switches its private engine state on its own with work_apply_roll(), so
+ * no worker waits for a shared refill. An ntime roll only redoes the tail
+ * precomputation. A version change also recomputes the midstate. An
+ * extranonce2 bump also hashes the coinbase and folds the merkle branch.
+ * The coinbase blocks before extranonce2 are hashed once per template
+ * (work_cache_coinbase()), so a bump only hashes the blocks from
+ * extranonce2 on, then three compressions per branch level.
+ *
+ * Rolling one second per 2^32 nonces keeps ntime behind wall-clock time
+ * below about 4 GH/s per job.
+ */
+
+#ifndef __WORK_H__
+#define __WORK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "block_header.h"
+#include "sha256.h"
+#include "sha256d.h"
+#include "version_rolling.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum serialized coinbase size (coinbase1 + extranonces + coinbase2) */
+#define WORK_COINBASE_MAX       512
+
+/** Maximum merkle branch length (blocks of up to 2^16 transactions) */
+#define WORK_MERKLE_MAX         16
+
+/** Maximum extranonce2 size in bytes */
+#define WORK_EXTRANONCE2_MAX    8
+
+/** Default ntime drift: seconds the time may be rolled past the job's */
+#define WORK_NTIME_ROLL_DEFAULT 600
+
+typedef struct {
+    block_header_t header;                  ///< Job header; merkle_root unused with a coinbase
+    uint32_t ntime_roll;                    ///< Seconds ntime may advance past header.timestamp
+    uint32_t version_mask;                  ///< Version bits that may be rolled (0: fixed version)
+    uint8_t coinbase[WORK_COINBASE_MAX];    ///< coinbase1 | extranonce1 | extranonce2 | coinbase2
+    size_t coinbase_len;                    ///< 0: header-only work (no extranonce2 bumps)
+    size_t extranonce2_offset;              ///< Position of extranonce2 in coinbase
+    size_t extranonce2_size;                ///< Bytes of extranonce2 (1-8)
+    uint64_t extranonce2;                   ///< Extranonce2 of the first roll
+    sha256_ctx_t coinbase_prefix;           ///< Hash of the whole coinbase blocks before extranonce2
+    uint8_t merkle_branch[WORK_MERKLE_MAX][32];
+    size_t merkle_count;
+} work_template_t;
+
+/** Header variant of one roll */
+typedef struct {
+    uint32_t version;                       ///< Header version
+    uint32_t ntime;                         ///< Header time
+    uint64_t extranonce2;                   ///< Extranonce2 (truncated to its size)
+    uint32_t extranonce_step;               ///< Bumps since the first roll
+} work_roll_t;
+
+/** What work_apply_roll() had to recompute */
+typedef enum {
+    WORK_SWITCH_NTIME,                      ///< Tail precomputation only
+    WORK_SWITCH_VERSION,                    ///< Midstate and tail
+    WORK_SWITCH_EXTRANONCE,                 ///< Coinbase, merkle root, midstate and tail
+} work_switch_t;
+
+/**
+ * @brief Initialize header-only work
+ *
+ * The version is fixed until version_mask is set (e.g. to the mask the
+ * pool granted in its mining.configure result, which stratum_parser_feed()
+ * decodes and the Stratum client intersects with the requested mask).
+ *
+ * @param work Template to initialize
+ * @param header Job header (nonce ignored)
+ * @param ntime_roll Seconds ntime may be rolled forward
+ */
+void work_init(work_template_t *work, const block_header_t *header, uint32_t ntime_roll);
+
+/**
+ * @brief Attach a stratum-style coinbase so extranonce2 can be bumped
+ *
+ * @param work Template
+ * @param coinbase1 Coinbase bytes before the extranonces
+ * @param coinbase1_len Size of coinbase1
+ * @param extranonce1 Pool-assigned extranonce1
+ * @param extranonce1_len Size of extranonce1
+ * @param extranonce2_size Size of extranonce2 (1-8 bytes)
+ * @param coinbase2 Coinbase bytes after the extranonces
+ * @param coinbase2_len Size of coinbase2
+ * @return false if the coinbase does not fit or the extranonce2 size is invalid
+ */
+bool work_set_coinbase(work_template_t *work, const uint8_t *coinbase1, size_t coinbase1_len,
+                       const uint8_t *extranonce1, size_t extranonce1_len, size_t extranonce2_size,
+                       const uint8_t *coinbase2, size_t coinbase2_len);
+
+/**
+ * @brief Cache the hash state of the coinbase blocks before extranonce2
+ *
+ * work_set_coinbase() and the Stratum parser call it. Whoever changes the
+ * coinbase bytes before extranonce2 in place must call it again.
+ *
+ * @param work Template with a complete coinbase
+ */
+void work_cache_coinbase(work_template_t *work);
+
+/**
+ * @brief Append one merkle branch hash (internal byte order)
+ *
+ * @return false if the branch is full
+ */
+bool work_add_branch(work_template_t *work, const uint8_t *hash);
+
+/**
+ * @brief Number of distinct header variants (at most 2^32 - 1)
+ */
+uint32_t work_rolls(const work_template_t *work);
+
+/**
+ * @brief Version, ntime and extranonce2 of a roll
+ */
+void work_roll(const work_template_t *work, uint32_t roll, work_roll_t *out);
+
+/**
+ * @brief Merkle root for an extranonce2 value
+ *
+ * Header-only work returns header.merkle_root. Hashing starts from the
+ * cached coinbase prefix.
+ *
+ * @param work Template
+ * @param extranonce2 Extranonce2 value
+ * @param root Merkle root (32 bytes, internal byte order)
+ */
+void work_merkle_root(const work_template_t *work, uint64_t extranonce2, uint8_t *root);
+
+/**
+ * @brief Serialize the header of a roll (nonce 0)
+ *
+ * @param work Template
+ * @param roll Roll index (below work_rolls())
+ * @param header Output header (80 bytes)
+ */
+void work_header(const work_template_t *work, uint32_t roll, uint8_t *header);
+
+/**
+ * @brief Switch engine state from one roll to another in place
+ *
+ * @param work Template
+ * @param ctx Engine state currently loaded with roll from
+ * @param from Roll the engine holds
+ * @param to Roll to switch to
+ * @return The most expensive kind of change the switch needed
+ */
+work_switch_t work_apply_roll(const work_template_t *work, sha256d_ctx_t *ctx, uint32_t from, uint32_t to);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WORK_H__
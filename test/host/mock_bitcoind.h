@@ -0,0 +1,72 @@
+/**
+ * @file mock_bitcoind.h
+ * @brief Regtest-style bitcoind JSON-RPC stand-in running in a child process (host tests)
+ *
+ * The node listens on an ephemeral loopback port and serves one HTTP
+ * request per connection, with Basic authentication (MOCK_BITCOIND_USER,
+ * MOCK_BITCOIND_PASS; anything else gets 401):
+ *
+ * - getblocktemplate returns a regtest template on top of the current tip
+ *   (the regtest genesis block at first): bits 207fffff, the BIP9 version,
+ *   MOCK_BITCOIND_TXS transactions of filler bytes with their fees, one of
+ *   them with a distinct witness id, and the default witness commitment
+ *   over all of them. Transaction MOCK_BITCOIND_TX_KEPT is as large as
+ *   GBT_TX_DATA_MAX, so a miner keeps only the ones before it;
+ * - submitblock checks the block like a node would: proof of work,
+ *   previous block, coinbase (BIP34 height, value, payout to
+ *   MOCK_BITCOIND_ADDRESS, witness commitment and reserved value), a
+ *   prefix of the template's transactions and the merkle root. A valid
+ *   block becomes the new tip; an invalid one is answered with a reason
+ *   such as "high-hash";
+ * - stop makes the process exit.
+ *
+ * The exit status counts protocol errors (malformed requests, unknown
+ * methods, a getblocktemplate without the segwit rule).
+ */
+
+#ifndef __MOCK_BITCOIND_H__
+#define __MOCK_BITCOIND_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** RPC credentials */
+#define MOCK_BITCOIND_USER      "rpcuser"
+#define MOCK_BITCOIND_PASS      "rpcpass"
+
+/** Regtest payout address the node expects in the coinbase */
+#define MOCK_BITCOIND_ADDRESS   "bcrt1qw508d6qejxtdg4y5r3zarvary0c5xw7kygt080"
+
+/** Transactions in each template, and how many of them fit a miner */
+#define MOCK_BITCOIND_TXS       5
+#define MOCK_BITCOIND_TX_KEPT   3
+
+/** Block subsidy; transaction i pays (i + 1) * MOCK_BITCOIND_FEE */
+#define MOCK_BITCOIND_SUBSIDY   5000000000ull
+#define MOCK_BITCOIND_FEE       1000
+
+typedef struct {
+    pid_t pid;
+    uint16_t port;
+} mock_bitcoind_t;
+
+/** Regtest genesis block hash (internal byte order): the first template's previous block */
+extern const uint8_t mock_bitcoind_genesis_hash[32];
+
+/**
+ * @brief Fork the node process
+ *
+ * @param node Output: child pid and listening port
+ * @return false if the socket or the process could not be created
+ */
+bool mock_bitcoind_start(mock_bitcoind_t *node);
+
+/**
+ * @brief Send stop and wait for the node process to exit
+ *
+ * @return Its protocol error count, or -1 if it did not exit normally
+ */
+int mock_bitcoind_finish(mock_bitcoind_t *node);
+
+#endif // __MOCK_BITCOIND_H__
@@ -0,0 +1,272 @@
+/**
+ * @file mock_pool.c
+ * @brief Scripted Stratum v1 pool running in a child process (host tests)
+ */
+
+#include "mock_pool.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "mining/miner_core.h"
+
+const uint8_t mock_pool_genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+const uint8_t mock_pool_genesis_hash[32] = {
+    0x6f, 0xe2, 0x8c, 0x0a, 0xb6, 0xf1, 0xb3, 0x72, 0xc1, 0xa6, 0xa2, 0x46, 0xae, 0x63, 0xf7, 0x4f,
+    0x93, 0x1e, 0x83, 0x65, 0xe1, 0x5a, 0x08, 0x9c, 0x68, 0xd6, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+const uint8_t mock_pool_branch[32] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10
+};
+
+// Genesis coinbase around the extranonces
+#define COINBASE1 "01000000010000000000000000000000000000000000000000000000000000000000000000" \
+                  "ffffffff4d04ffff001d010445"
+#define COINBASE2 "732030332f4a616e2f32303039204368616e63656c6c6f72206f6e206272696e6b206f66207365" \
+                  "636f6e64206261696c6f757420666f722062616e6b73ffffffff0100f2052a010000004341046" \
+                  "78afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4" \
+                  "f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000"
+
+// Previous block of job 2 as stratum sends it (each 32-bit word byte-swapped)
+#define JOB2_PREVHASH "0a8ce26f72b3f1b646a2a6c14ff763ae65831e939c085ae10019d66800000000"
+#define JOB2_BRANCH "00112233445566778899aabbccddeeff0123456789abcdeffedcba9876543210"
+
+static size_t unhex(const char *hex, uint8_t *out, size_t max)
+{
+    size_t n = 0;
+
+    while (n < max && hex[2 * n] != '\0' && hex[2 * n] != '"') {
+        unsigned byte;
+        if (sscanf(hex + 2 * n, "%2x", &byte) != 1) {
+            break;
+        }
+        out[n++] = (uint8_t)byte;
+    }
+    return n;
+}
+
+// Template of a job exactly as the client should rebuild it
+static void job_work(int job, work_template_t *work)
+{
+    uint8_t coinbase1[64];
+    uint8_t coinbase2[256];
+    uint8_t extranonce1[4];
+    block_header_t header;
+
+    block_header_parse(mock_pool_genesis_header, &header);
+    if (job == 2) {
+        memcpy(header.prev_hash, mock_pool_genesis_hash, 32);
+    }
+    work_init(work, &header, WORK_NTIME_ROLL_DEFAULT);
+    work->version_mask = VERSION_ROLLING_BIP320_MASK;
+    work_set_coinbase(work, coinbase1, unhex(COINBASE1, coinbase1, sizeof(coinbase1)), extranonce1,
+                      unhex(MOCK_POOL_EXTRANONCE1, extranonce1, sizeof(extranonce1)), 4, coinbase2,
+                      unhex(COINBASE2, coinbase2, sizeof(coinbase2)));
+    if (job == 2) {
+        work_add_branch(work, mock_pool_branch);
+    }
+}
+
+static void send_line(int fd, const char *line)
+{
+    size_t len = strlen(line);
+
+    while (len > 0) {
+        ssize_t n = write(fd, line, len);
+        if (n <= 0) {
+            return;
+        }
+        line += n;
+        len -= (size_t)n;
+    }
+}
+
+static void send_notify(int fd, int job)
+{
+    char line[1024];
+
+    snprintf(line, sizeof(line),
+             "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"%d\",\"%s\",\"" COINBASE1 "\",\""
+             COINBASE2 "\",[%s],\"00000001\",\"1d00ffff\",\"495fab29\",%s]}\n",
+             job, job == 2 ? JOB2_PREVHASH : "0000000000000000000000000000000000000000000000000000000000000000",
+             job == 2 ? "\"" JOB2_BRANCH "\"" : "", job == 2 ? "true" : "false");
+    send_line(fd, line);
+}
+
+// Quoted strings of the params array: user, job id, extranonce2, ntime, nonce[, version bits]
+static int submit_params(const char *line, char fields[6][72])
+{
+    const char *p = strstr(line, "\"params\":[");
+    int n = 0;
+
+    if (p == NULL) {
+        return 0;
+    }
+    p += strlen("\"params\":[");
+    while (n < 6 && *p == '"') {
+        const char *end = strchr(p + 1, '"');
+        if (end == NULL || end - p - 1 >= 72) {
+            return 0;
+        }
+        memcpy(fields[n], p + 1, (size_t)(end - p - 1));
+        fields[n][end - p - 1] = '\0';
+        n++;
+        p = end + 1;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return *p == ']' ? n : 0;
+}
+
+// Rebuild the share's header and check it against the pool difficulty
+static bool share_valid(char fields[6][72], int count, double difficulty)
+{
+    work_template_t work;
+    block_header_t header;
+    uint8_t extranonce2[4];
+    uint8_t serialized[BLOCK_HEADER_SIZE];
+    uint8_t hash[32];
+    target_t target;
+    int job = atoi(fields[1]);
+
+    if ((job != 1 && job != 2) || unhex(fields[2], extranonce2, sizeof(extranonce2)) != 4 ||
+        strlen(fields[2]) != 8) {
+        return false;
+    }
+    job_work(job, &work);
+    header = work.header;
+    work_merkle_root(&work, block_header_read_le32(extranonce2), header.merkle_root);
+    header.timestamp = (uint32_t)strtoul(fields[3], NULL, 16);
+    header.nonce = (uint32_t)strtoul(fields[4], NULL, 16);
+    if (count == 6) {
+        uint32_t bits = (uint32_t)strtoul(fields[5], NULL, 16);
+        header.version = (header.version & ~work.version_mask) | (bits & work.version_mask);
+    }
+    if (header.timestamp < work.header.timestamp || header.timestamp > work.header.timestamp + work.ntime_roll) {
+        return false;
+    }
+    block_header_serialize(&header, serialized);
+    double_sha256(serialized, sizeof(serialized), hash);
+    target_from_difficulty(difficulty, &target);
+    return target_hash_meets(hash, &target);
+}
+
+static int serve(int fd, double difficulty)
+{
+    FILE *in = fdopen(fd, "r");
+    char line[2048];
+    char reply[256];
+    int errors = 0;
+    bool job2_sent = false;
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        const char *id_field = strstr(line, "\"id\":");
+        unsigned long id = id_field != NULL ? strtoul(id_field + 5, NULL, 10) : 0;
+
+        if (strstr(line, "\"mining.configure\"") != NULL) {
+            snprintf(reply, sizeof(reply), "{\"id\":%lu,\"result\":{\"version-rolling\":true,"
+                     "\"version-rolling.mask\":\"1fffe000\"},\"error\":null}\n", id);
+            send_line(fd, reply);
+        } else if (strstr(line, "\"mining.subscribe\"") != NULL) {
+            snprintf(reply, sizeof(reply), "{\"id\":%lu,\"result\":[[[\"mining.set_difficulty\",\"1\"],"
+                     "[\"mining.notify\",\"1\"]],\"" MOCK_POOL_EXTRANONCE1 "\",4],\"error\":null}\n", id);
+            send_line(fd, reply);
+        } else if (strstr(line, "\"mining.authorize\"") != NULL) {
+            bool ok = strstr(line, "[\"" MOCK_POOL_USER "\"") != NULL;
+            snprintf(reply, sizeof(reply), "{\"id\":%lu,\"result\":%s,\"error\":null}\n", id,
+                     ok ? "true" : "false");
+            send_line(fd, reply);
+            if (ok) {
+                snprintf(reply, sizeof(reply),
+                         "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%.17g]}\n", difficulty);
+                send_line(fd, reply);
+                send_notify(fd, 1);
+            }
+        } else if (strstr(line, "\"mining.submit\"") != NULL) {
+            char fields[6][72];
+            int count = submit_params(line, fields);
+
+            if (count < 5 || strcmp(fields[0], MOCK_POOL_USER) != 0) {
+                errors++;
+                continue;
+            }
+            bool ok = share_valid(fields, count, difficulty);
+            if (!ok) {
+                // A response to a request that was never sent comes first
+                snprintf(reply, sizeof(reply), "{\"id\":%lu,\"result\":true,\"error\":null}\n", id + 1000);
+                send_line(fd, reply);
+            }
+            snprintf(reply, sizeof(reply), ok ? "{\"id\":%lu,\"result\":true,\"error\":null}\n" :
+                     "{\"id\":%lu,\"result\":null,\"error\":[23,\"Low difficulty share\",null]}\n", id);
+            send_line(fd, reply);
+            if (ok && !job2_sent) {
+                send_notify(fd, 2);
+                job2_sent = true;
+            }
+        } else {
+            errors++;
+        }
+    }
+    fclose(in);
+    return errors;
+}
+
+bool mock_pool_start(mock_pool_t *pool, double difficulty)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listener < 0) {
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &len) != 0) {
+        close(listener);
+        return false;
+    }
+    pool->port = ntohs(addr.sin_port);
+
+    fflush(stdout);
+    pool->pid = fork();
+    if (pool->pid < 0) {
+        close(listener);
+        return false;
+    }
+    if (pool->pid == 0) {
+        // Never outlive a test that failed before connecting or closing
+        alarm(30);
+        int fd = accept(listener, NULL, NULL);
+        close(listener);
+        _exit(fd < 0 ? 1 : serve(fd, difficulty));
+    }
+    close(listener);
+    return true;
+}
+
+int mock_pool_finish(mock_pool_t *pool)
+{
+    int status;
+
+    if (waitpid(pool->pid, &status, 0) != pool->pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file mock_pool.h
+ * @brief Scripted Stratum v1 pool running in a child process (host tests)
+ *
+ * The pool listens on an ephemeral loopback port and serves one
+ * connection:
+ *
+ * - mining.configure grants the BIP320 version-rolling mask;
+ * - mining.subscribe assigns MOCK_POOL_EXTRANONCE1 and 4-byte extranonce2;
+ * - mining.authorize accepts MOCK_POOL_USER only, then sends the
+ *   difficulty and job "1": the genesis block, its coinbase split around
+ *   the extranonces;
+ * - mining.submit rebuilds the header from the share, hashes it and
+ *   accepts it if it meets the difficulty. The rejection of a share is
+ *   preceded by a response to an id the client never used. After the
+ *   first accepted share the pool sends job "2" (genesis as the previous
+ *   block, one branch hash, clean_jobs).
+ *
+ * The child exits when the client disconnects; its exit status counts
+ * protocol errors (malformed or unknown requests).
+ */
+
+#ifndef __MOCK_POOL_H__
+#define __MOCK_POOL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** Worker name the pool authorizes */
+#define MOCK_POOL_USER          "mock.worker"
+
+/** Extranonce1 the pool assigns: bytes 50-53 of the genesis coinbase */
+#define MOCK_POOL_EXTRANONCE1   "54686520"
+
+/** Genesis extranonce2 ("Time", little-endian) and the header's nonce */
+#define MOCK_POOL_GENESIS_EXTRANONCE2   0x656d6954
+#define MOCK_POOL_GENESIS_NONCE         0x7c2bac1d
+
+typedef struct {
+    pid_t pid;
+    uint16_t port;
+} mock_pool_t;
+
+/** Bitcoin genesis block header */
+extern const uint8_t mock_pool_genesis_header[80];
+
+/** Genesis block hash (internal byte order): job 2's previous block */
+extern const uint8_t mock_pool_genesis_hash[32];
+
+/** The branch hash of job 2 (internal byte order) */
+extern const uint8_t mock_pool_branch[32];
+
+/**
+ * @brief Fork the pool process
+ *
+ * @param pool Output: child pid and listening port
+ * @param difficulty Share difficulty announced and enforced by the pool
+ * @return false if the socket or the process could not be created
+ */
+bool mock_pool_start(mock_pool_t *pool, double difficulty);
+
+/**
+ * @brief Wait for the pool process to exit
+ *
+ * @return Its protocol error count, or -1 if it did not exit normally
+ */
+int mock_pool_finish(mock_pool_t *pool);
+
+#endif // __MOCK_POOL_H__
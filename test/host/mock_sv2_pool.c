@@ -0,0 +1,308 @@
+/**
+ * @file mock_sv2_pool.c
+ * @brief Scripted Stratum V2 pool (plaintext) running in a child process (host tests)
+ */
+
+#include "mock_sv2_pool.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "mining/miner_core.h"
+
+typedef struct {
+    int fd;
+    double difficulty;
+    uint32_t setup_flags;               ///< SetupConnection.Success flags
+    uint32_t version_mask;              ///< Version bits shares may roll
+    target_t target;
+    block_header_t prev;                ///< Previous hash, time and nBits in force
+    block_header_t jobs[4];             ///< Headers of jobs 1-3 (index 0 unused)
+    uint32_t last_job;                  ///< Newest job that can be mined
+    uint32_t sequence;                  ///< Last sequence number received
+    uint32_t acked;                     ///< Shares accepted in the current read
+    uint32_t accepted;                  ///< Shares accepted so far
+    int errors;
+} mock_sv2_t;
+
+static void send_msg(mock_sv2_t *pool, const sv2_msg_t *msg)
+{
+    uint8_t frame[SV2_HEADER_SIZE + SV2_PAYLOAD_MAX];
+    size_t len = sv2_encode(msg, frame, sizeof(frame));
+    const uint8_t *p = frame;
+
+    if (len == 0) {
+        pool->errors++;
+    }
+    while (len > 0) {
+        ssize_t n = write(pool->fd, p, len);
+        if (n <= 0) {
+            return;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+// Target as SV2 sends it: a U256 in hash byte order
+static void target_bytes(const target_t *target, uint8_t *out)
+{
+    for (int i = 0; i < 8; i++) {
+        block_header_write_le32(out + 28 - 4 * i, target->words[i]);
+    }
+}
+
+static void send_job(mock_sv2_t *pool, uint32_t job, bool future, uint32_t version, const uint8_t *root)
+{
+    sv2_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_NEW_MINING_JOB;
+    msg.channel_id = MOCK_SV2_CHANNEL_ID;
+    msg.job_id = job;
+    msg.future = future;
+    msg.ntime = pool->prev.timestamp;
+    msg.version = version;
+    memcpy(msg.hash, root, 32);
+    pool->jobs[job] = pool->prev;
+    pool->jobs[job].version = version;
+    memcpy(pool->jobs[job].merkle_root, root, 32);
+    if (!future) {
+        pool->last_job = job;
+    }
+    send_msg(pool, &msg);
+}
+
+static void send_prev_hash(mock_sv2_t *pool, uint32_t job, const uint8_t *prev_hash, uint32_t ntime)
+{
+    sv2_msg_t msg;
+
+    memcpy(pool->prev.prev_hash, prev_hash, 32);
+    pool->prev.timestamp = ntime;
+    memcpy(pool->jobs[job].prev_hash, prev_hash, 32);
+    pool->jobs[job].timestamp = ntime;
+    pool->last_job = job;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SET_NEW_PREV_HASH;
+    msg.channel_id = MOCK_SV2_CHANNEL_ID;
+    msg.job_id = job;
+    memcpy(msg.hash, prev_hash, 32);
+    msg.ntime = ntime;
+    msg.nbits = pool->prev.bits;
+    send_msg(pool, &msg);
+}
+
+// Rebuild the share's header and check it against the channel target.
+// Like the Stratum v1 mock, jobs on an older previous hash are not stale.
+static bool share_valid(mock_sv2_t *pool, const sv2_msg_t *share)
+{
+    uint32_t job = share->job_id;
+    block_header_t header;
+    uint8_t serialized[BLOCK_HEADER_SIZE];
+    uint8_t hash[32];
+
+    if (job < 1 || job > pool->last_job) {
+        return false;
+    }
+    header = pool->jobs[job];
+    if (((share->version ^ header.version) & ~pool->version_mask) != 0 ||
+        share->ntime < header.timestamp || share->ntime > header.timestamp + WORK_NTIME_ROLL_DEFAULT) {
+        return false;
+    }
+    header.version = share->version;
+    header.timestamp = share->ntime;
+    header.nonce = share->nonce;
+    block_header_serialize(&header, serialized);
+    double_sha256(serialized, sizeof(serialized), hash);
+    return target_hash_meets(hash, &pool->target);
+}
+
+static void on_submit(mock_sv2_t *pool, const sv2_msg_t *share)
+{
+    sv2_msg_t msg;
+
+    if (share->channel_id != MOCK_SV2_CHANNEL_ID || share->sequence != pool->sequence + 1) {
+        pool->errors++;
+    }
+    pool->sequence = share->sequence;
+    if (share_valid(pool, share)) {
+        pool->acked++;
+        return;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SUBMIT_SHARES_ERROR;
+    msg.channel_id = MOCK_SV2_CHANNEL_ID;
+    msg.sequence = share->sequence;
+    strcpy(msg.text, "difficulty-too-low");
+    send_msg(pool, &msg);
+}
+
+// One SubmitShares.Success for the shares accepted from a read
+static void flush_acks(mock_sv2_t *pool)
+{
+    sv2_msg_t msg;
+    bool first = pool->accepted == 0;
+
+    if (pool->acked == 0) {
+        return;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SUBMIT_SHARES_SUCCESS;
+    msg.channel_id = MOCK_SV2_CHANNEL_ID;
+    msg.sequence = pool->sequence;
+    msg.count = pool->acked;
+    msg.shares_sum = (uint64_t)(pool->acked * pool->difficulty + 0.5);
+    send_msg(pool, &msg);
+    pool->accepted += pool->acked;
+    pool->acked = 0;
+
+    if (first) {
+        send_job(pool, 2, false, MOCK_SV2_JOB2_VERSION, mock_pool_branch);
+        send_job(pool, 3, true, MOCK_SV2_JOB2_VERSION, mock_pool_branch);
+        send_prev_hash(pool, 3, mock_pool_genesis_hash, pool->prev.timestamp + WORK_NTIME_ROLL_DEFAULT);
+    }
+}
+
+static void on_open(mock_sv2_t *pool, const sv2_msg_t *open)
+{
+    sv2_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.request_id = open->request_id;
+    if (strcmp(open->text, MOCK_POOL_USER) != 0) {
+        msg.type = SV2_OPEN_MINING_CHANNEL_ERROR;
+        strcpy(msg.text, "unknown-user");
+        send_msg(pool, &msg);
+        return;
+    }
+    msg.type = SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS;
+    msg.channel_id = MOCK_SV2_CHANNEL_ID;
+    target_bytes(&pool->target, msg.hash);
+    memcpy(msg.extranonce_prefix, "mock", 4);
+    msg.extranonce_prefix_len = 4;
+    send_msg(pool, &msg);
+
+    send_job(pool, 1, true, pool->prev.version, pool->prev.merkle_root);
+    send_prev_hash(pool, 1, pool->prev.prev_hash, pool->prev.timestamp);
+}
+
+static void on_msg(mock_sv2_t *pool, const sv2_msg_t *msg)
+{
+    sv2_msg_t reply;
+
+    if (!msg->decoded) {
+        pool->errors++;
+        return;
+    }
+    switch (msg->type) {
+    case SV2_SETUP_CONNECTION:
+        memset(&reply, 0, sizeof(reply));
+        if (msg->protocol != SV2_PROTOCOL_MINING || msg->min_version > SV2_PROTOCOL_VERSION ||
+            msg->max_version < SV2_PROTOCOL_VERSION || !(msg->flags & SV2_REQUIRES_STANDARD_JOBS)) {
+            pool->errors++;
+            reply.type = SV2_SETUP_CONNECTION_ERROR;
+            strcpy(reply.text, "unsupported-protocol");
+        } else {
+            reply.type = SV2_SETUP_CONNECTION_SUCCESS;
+            reply.min_version = SV2_PROTOCOL_VERSION;
+            reply.flags = pool->setup_flags;
+            // Rolled versions only when asked for and not refused
+            if ((msg->flags & SV2_REQUIRES_VERSION_ROLLING) && !(pool->setup_flags & SV2_REQUIRES_FIXED_VERSION)) {
+                pool->version_mask = VERSION_ROLLING_BIP320_MASK;
+            }
+        }
+        send_msg(pool, &reply);
+        break;
+    case SV2_OPEN_STANDARD_MINING_CHANNEL:
+        on_open(pool, msg);
+        break;
+    case SV2_SUBMIT_SHARES_STANDARD:
+        on_submit(pool, msg);
+        break;
+    default:
+        pool->errors++;
+        break;
+    }
+}
+
+static int serve(int fd, double difficulty, uint32_t setup_flags)
+{
+    static sv2_decoder_t decoder;
+    mock_sv2_t pool;
+    uint8_t buf[1024];
+    ssize_t n;
+
+    memset(&pool, 0, sizeof(pool));
+    pool.fd = fd;
+    pool.difficulty = difficulty;
+    pool.setup_flags = setup_flags;
+    target_from_difficulty(difficulty, &pool.target);
+    block_header_parse(mock_pool_genesis_header, &pool.prev);
+    sv2_decoder_init(&decoder);
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        size_t done = 0;
+
+        while (done < (size_t)n) {
+            const sv2_msg_t *msg;
+            done += sv2_decoder_feed(&decoder, buf + done, (size_t)n - done, &msg);
+            if (msg != NULL) {
+                on_msg(&pool, msg);
+            }
+        }
+        flush_acks(&pool);
+    }
+    close(fd);
+    return pool.errors;
+}
+
+bool mock_sv2_pool_start(mock_sv2_pool_t *pool, double difficulty, uint32_t setup_flags)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listener < 0) {
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &len) != 0) {
+        close(listener);
+        return false;
+    }
+    pool->port = ntohs(addr.sin_port);
+
+    fflush(stdout);
+    pool->pid = fork();
+    if (pool->pid < 0) {
+        close(listener);
+        return false;
+    }
+    if (pool->pid == 0) {
+        // Never outlive a test that failed before connecting or closing
+        alarm(30);
+        int fd = accept(listener, NULL, NULL);
+        close(listener);
+        _exit(fd < 0 ? 1 : serve(fd, difficulty, setup_flags));
+    }
+    close(listener);
+    return true;
+}
+
+int mock_sv2_pool_finish(mock_sv2_pool_t *pool)
+{
+    int status;
+
+    if (waitpid(pool->pid, &status, 0) != pool->pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file mock_sv2_pool.h
+ * @brief Scripted Stratum V2 pool (plaintext) running in a child process (host tests)
+ *
+ * The pool listens on an ephemeral loopback port and serves one
+ * connection with standard-channel frames:
+ *
+ * - SetupConnection must ask for the mining protocol, version 2 and
+ *   standard jobs only. SetupConnection.Success carries the given flags;
+ *   shares may roll the BIP320 version bits only if the client asked for
+ *   REQUIRES_VERSION_ROLLING and those flags lack REQUIRES_FIXED_VERSION;
+ * - OpenStandardMiningChannel opens channel MOCK_SV2_CHANNEL_ID for
+ *   MOCK_POOL_USER only (anyone else gets OpenMiningChannel.Error), with
+ *   the target of the given difficulty, then sends job 1 as a future job
+ *   (the genesis header's version and merkle root) and SetNewPrevHash for
+ *   it (the genesis previous hash, time and nBits);
+ * - SubmitSharesStandard must carry the channel and the next sequence
+ *   number. The header is rebuilt and hashed (the version bits allowed
+ *   above and WORK_NTIME_ROLL_DEFAULT seconds of ntime may be rolled). Shares
+ *   accepted from one read are acknowledged by a single
+ *   SubmitShares.Success; a bad one gets SubmitShares.Error. After the
+ *   first accepted share the pool sends job 2 for the same previous hash
+ *   (version 0x20000000, mock_pool_branch as the merkle root), then the
+ *   same fields as future job 3, activated by a SetNewPrevHash on top of
+ *   the genesis block. Shares of earlier jobs are still accepted, as by mock_pool.h.
+ *
+ * The child exits when the client disconnects; its exit status counts
+ * protocol errors (frames that do not decode, unexpected messages, a
+ * wrong channel or sequence number).
+ */
+
+#ifndef __MOCK_SV2_POOL_H__
+#define __MOCK_SV2_POOL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "mock_pool.h"
+
+/** Channel the pool opens */
+#define MOCK_SV2_CHANNEL_ID     7
+
+/** Version of job 2 */
+#define MOCK_SV2_JOB2_VERSION   0x20000000
+
+typedef struct {
+    pid_t pid;
+    uint16_t port;
+} mock_sv2_pool_t;
+
+/**
+ * @brief Fork the pool process
+ *
+ * @param pool Output: child pid and listening port
+ * @param difficulty Share difficulty of the channel target
+ * @param setup_flags SetupConnection.Success flags (SV2_REQUIRES_FIXED_VERSION)
+ * @return false if the socket or the process could not be created
+ */
+bool mock_sv2_pool_start(mock_sv2_pool_t *pool, double difficulty, uint32_t setup_flags);
+
+/**
+ * @brief Wait for the pool process to exit
+ *
+ * @return Its protocol error count, or -1 if it did not exit normally
+ */
+int mock_sv2_pool_finish(mock_sv2_pool_t *pool);
+
+#endif // __MOCK_SV2_POOL_H__
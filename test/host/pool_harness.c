@@ -0,0 +1,75 @@
+/**
+ * @file pool_harness.c
+ * @brief Polling helpers for the pool client tests (host tests)
+ */
+
+#include "pool_harness.h"
+#include <string.h>
+#include "mock_pool.h"
+
+static void status(pool_conn_t *conn, pool_conn_status_t *out)
+{
+    miner_lock(&conn->lock);
+    *out = conn->status;
+    miner_unlock(&conn->lock);
+}
+
+bool pool_harness_poll_state(pool_conn_t *conn, int state)
+{
+    pool_conn_status_t now;
+    uint64_t deadline = miner_time_us() + POOL_HARNESS_TIMEOUT_US;
+
+    do {
+        pool_conn_poll(conn, POOL_HARNESS_POLL_MS);
+        status(conn, &now);
+    } while (now.state != state && miner_time_us() < deadline);
+    return now.state == state;
+}
+
+bool pool_harness_poll_job(pool_conn_t *conn, uint32_t *seq, stratum_job_t *job)
+{
+    uint64_t deadline = miner_time_us() + POOL_HARNESS_TIMEOUT_US;
+
+    while (!pool_conn_take_job(conn, seq, job)) {
+        if (miner_time_us() >= deadline) {
+            return false;
+        }
+        pool_conn_poll(conn, POOL_HARNESS_POLL_MS);
+    }
+    return true;
+}
+
+bool pool_harness_poll_answers(pool_conn_t *conn)
+{
+    pool_conn_status_t now;
+    uint64_t deadline = miner_time_us() + POOL_HARNESS_TIMEOUT_US;
+
+    do {
+        pool_conn_poll(conn, POOL_HARNESS_POLL_MS);
+        status(conn, &now);
+    } while ((now.accepted + now.rejected < now.submitted || conn->queue_head != conn->queue_tail) &&
+             miner_time_us() < deadline);
+    return now.accepted + now.rejected == now.submitted;
+}
+
+bool pool_harness_poll_failure(pool_conn_t *conn)
+{
+    pool_conn_status_t now;
+    uint64_t deadline = miner_time_us() + POOL_HARNESS_TIMEOUT_US;
+
+    do {
+        pool_conn_poll(conn, POOL_HARNESS_POLL_MS);
+        status(conn, &now);
+    } while (now.reconnects == 0 && miner_time_us() < deadline);
+    return now.reconnects != 0;
+}
+
+void pool_harness_genesis_share(const stratum_job_t *job, stratum_share_t *share)
+{
+    memset(share, 0, sizeof(*share));
+    strcpy(share->job_id, job->id);
+    share->extranonce2 = MOCK_POOL_GENESIS_EXTRANONCE2;
+    share->ntime = job->work.header.timestamp;
+    share->nonce = MOCK_POOL_GENESIS_NONCE;
+    share->version = job->work.header.version;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file pool_harness.h
+ * @brief Polling helpers for the pool client tests (host tests)
+ *
+ * Both pool clients run their event loop on a pool_conn_t, so the tests
+ * drive it and read its status directly. Each helper polls for up to
+ * POOL_HARNESS_TIMEOUT_US and reports whether it got what it waited for.
+ */
+
+#ifndef __POOL_HARNESS_H__
+#define __POOL_HARNESS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mining/miner_core.h"
+
+/** Event loop timeout of each poll */
+#define POOL_HARNESS_POLL_MS        10
+
+/** How long a helper waits */
+#define POOL_HARNESS_TIMEOUT_US     5000000
+
+/**
+ * @brief Poll until the client reaches a state
+ */
+bool pool_harness_poll_state(pool_conn_t *conn, int state);
+
+/**
+ * @brief Poll until a job newer than *seq is published
+ */
+bool pool_harness_poll_job(pool_conn_t *conn, uint32_t *seq, stratum_job_t *job);
+
+/**
+ * @brief Poll until the queue is drained and the pool has answered every
+ *        submitted share
+ */
+bool pool_harness_poll_answers(pool_conn_t *conn);
+
+/**
+ * @brief Poll until the connection fails (the pool refused the client)
+ */
+bool pool_harness_poll_failure(pool_conn_t *conn);
+
+/**
+ * @brief The genesis share in the layout the clients submit
+ *
+ * The header-only Stratum V2 client ignores the extranonce2.
+ */
+void pool_harness_genesis_share(const stratum_job_t *job, stratum_share_t *share);
+
+#endif // __POOL_HARNESS_H__
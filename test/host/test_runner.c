@@ -0,0 +1,130 @@
+/**
+ * @file test_runner.c
+ * @brief Host entry point and assertion backend for the Unity-compatible layer
+ *
+ * Compiled once per test group; TEST_GROUP names the registration function
+ * of the group (e.g. test_mining_functions), exactly as the device test
+ * application calls it.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include "unity.h"
+
+#ifndef TEST_GROUP
+#error "TEST_GROUP must name the test registration function"
+#endif
+
+void TEST_GROUP(void);
+
+static jmp_buf abort_frame;
+static const char *current_test;
+static unsigned tests_run;
+static unsigned tests_failed;
+
+// Test files that have no fixtures rely on these no-op defaults
+__attribute__((weak)) void setUp(void)
+{
+}
+
+__attribute__((weak)) void tearDown(void)
+{
+}
+
+void unity_host_begin(void)
+{
+    tests_run = 0;
+    tests_failed = 0;
+}
+
+int unity_host_end(void)
+{
+    printf("\n-----------------------\n%u Tests %u Failures 0 Ignored\n%s\n",
+           tests_run, tests_failed, tests_failed ? "FAIL" : "OK");
+    return (int)tests_failed;
+}
+
+void unity_host_run(void (*test)(void), const char *name, int line)
+{
+    (void)line;
+    current_test = name;
+    tests_run++;
+
+    if (setjmp(abort_frame) == 0) {
+        setUp();
+        test();
+        tearDown();
+        printf("%s:PASS\n", name);
+    } else {
+        tearDown();
+        tests_failed++;
+    }
+}
+
+void unity_host_fail(const char *file, int line, const char *message)
+{
+    printf("%s:%d:%s:FAIL: %s\n", file, line, current_test, message);
+    longjmp(abort_frame, 1);
+}
+
+void unity_host_assert_uint(uint64_t expected, uint64_t actual, const char *file, int line, bool hex)
+{
+    if (expected != actual) {
+        char message[96];
+        snprintf(message, sizeof(message),
+                 hex ? "Expected 0x%" PRIX64 " Was 0x%" PRIX64 : "Expected %" PRIu64 " Was %" PRIu64,
+                 expected, actual);
+        unity_host_fail(file, line, message);
+    }
+}
+
+void unity_host_assert_int(int64_t expected, int64_t actual, const char *file, int line)
+{
+    if (expected != actual) {
+        char message[96];
+        snprintf(message, sizeof(message), "Expected %" PRId64 " Was %" PRId64, expected, actual);
+        unity_host_fail(file, line, message);
+    }
+}
+
+void unity_host_assert_double(double delta, double expected, double actual, const char *file, int line)
+{
+    if (!(fabs(expected - actual) <= delta)) {
+        char message[96];
+        snprintf(message, sizeof(message), "Expected %g +/- %g Was %g", expected, delta, actual);
+        unity_host_fail(file, line, message);
+    }
+}
+
+void unity_host_assert_memory(const void *expected, const void *actual, size_t len, const char *file, int line)
+{
+    const uint8_t *e = (const uint8_t *)expected;
+    const uint8_t *a = (const uint8_t *)actual;
+
+    for (size_t i = 0; i < len; i++) {
+        if (e[i] != a[i]) {
+            char message[96];
+            snprintf(message, sizeof(message), "Memory mismatch at byte %zu: expected 0x%02X was 0x%02X",
+                     i, e[i], a[i]);
+            unity_host_fail(file, line, message);
+        }
+    }
+}
+
+void unity_host_assert_string(const char *expected, const char *actual, const char *file, int line)
+{
+    if (actual == NULL || strcmp(expected, actual) != 0) {
+        char message[160];
+        snprintf(message, sizeof(message), "Expected \"%s\" Was \"%s\"", expected, actual ? actual : "(null)");
+        unity_host_fail(file, line, message);
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    TEST_GROUP();
+    return UNITY_END();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file unity.h
+ * @brief Minimal Unity-compatible assertion layer for host builds
+ *
+ * The device test suite uses the Unity framework shipped with ESP-IDF. On
+ * the host the same test sources are compiled against this header, which
+ * implements the subset of the Unity API they use. Each test group is linked
+ * into its own executable together with test_runner.c.
+ */
+
+#ifndef __HOST_UNITY_H__
+#define __HOST_UNITY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void setUp(void);
+void tearDown(void);
+
+void unity_host_begin(void);
+int unity_host_end(void);
+void unity_host_run(void (*test)(void), const char *name, int line);
+void unity_host_fail(const char *file, int line, const char *message);
+void unity_host_assert_uint(uint64_t expected, uint64_t actual, const char *file, int line, bool hex);
+void unity_host_assert_int(int64_t expected, int64_t actual, const char *file, int line);
+void unity_host_assert_double(double delta, double expected, double actual, const char *file, int line);
+void unity_host_assert_memory(const void *expected, const void *actual, size_t len, const char *file, int line);
+void unity_host_assert_string(const char *expected, const char *actual, const char *file, int line);
+
+#define UNITY_BEGIN()                   unity_host_begin()
+#define UNITY_END()                     unity_host_end()
+#define RUN_TEST(func)                  unity_host_run(func, #func, __LINE__)
+
+#define TEST_FAIL_MESSAGE(msg)          unity_host_fail(__FILE__, __LINE__, (msg))
+#define TEST_ASSERT_MESSAGE(cond, msg)  do { if (!(cond)) { TEST_FAIL_MESSAGE(msg); } } while (0)
+#define TEST_ASSERT(cond)               TEST_ASSERT_MESSAGE((cond), #cond)
+#define TEST_ASSERT_TRUE(cond)          TEST_ASSERT_MESSAGE((cond), "Expected TRUE: " #cond)
+#define TEST_ASSERT_FALSE(cond)         TEST_ASSERT_MESSAGE(!(cond), "Expected FALSE: " #cond)
+#define TEST_ASSERT_NULL(ptr)           TEST_ASSERT_MESSAGE((ptr) == NULL, "Expected NULL: " #ptr)
+#define TEST_ASSERT_NOT_NULL(ptr)       TEST_ASSERT_MESSAGE((ptr) != NULL, "Expected non-NULL: " #ptr)
+#define TEST_ASSERT_TRUE_MESSAGE(c, m)  TEST_ASSERT_MESSAGE((c), (m))
+#define TEST_ASSERT_EQUAL_PTR(e, a)     TEST_ASSERT_MESSAGE((const void *)(e) == (const void *)(a), \
+                                                            "Expected " #a " == " #e)
+
+#define TEST_ASSERT_EQUAL_INT(e, a)     unity_host_assert_int((int64_t)(e), (int64_t)(a), __FILE__, __LINE__)
+#define TEST_ASSERT_EQUAL(e, a)         TEST_ASSERT_EQUAL_INT(e, a)
+#define TEST_ASSERT_NOT_EQUAL(e, a)     TEST_ASSERT_MESSAGE((e) != (a), "Expected values to differ")
+#define TEST_ASSERT_EQUAL_UINT8(e, a)   unity_host_assert_uint((uint8_t)(e), (uint8_t)(a), __FILE__, __LINE__, false)
+#define TEST_ASSERT_EQUAL_UINT16(e, a)  unity_host_assert_uint((uint16_t)(e), (uint16_t)(a), __FILE__, __LINE__, false)
+#define TEST_ASSERT_EQUAL_UINT32(e, a)  unity_host_assert_uint((uint32_t)(e), (uint32_t)(a), __FILE__, __LINE__, false)
+#define TEST_ASSERT_EQUAL_UINT64(e, a)  unity_host_assert_uint((uint64_t)(e), (uint64_t)(a), __FILE__, __LINE__, false)
+#define TEST_ASSERT_EQUAL_size_t(e, a)  unity_host_assert_uint((uint64_t)(e), (uint64_t)(a), __FILE__, __LINE__, false)
+#define TEST_ASSERT_EQUAL_HEX8(e, a)    unity_host_assert_uint((uint8_t)(e), (uint8_t)(a), __FILE__, __LINE__, true)
+#define TEST_ASSERT_EQUAL_HEX32(e, a)   unity_host_assert_uint((uint32_t)(e), (uint32_t)(a), __FILE__, __LINE__, true)
+#define TEST_ASSERT_EQUAL_HEX64(e, a)   unity_host_assert_uint((uint64_t)(e), (uint64_t)(a), __FILE__, __LINE__, true)
+#define TEST_ASSERT_EQUAL_HEX32_ARRAY(e, a, n) \
+    unity_host_assert_memory((e), (a), (n) * sizeof(uint32_t), __FILE__, __LINE__)
+#define TEST_ASSERT_EQUAL_UINT8_ARRAY(e, a, n) \
+    unity_host_assert_memory((e), (a), (n), __FILE__, __LINE__)
+#define TEST_ASSERT_EQUAL_MEMORY(e, a, n) unity_host_assert_memory((e), (a), (n), __FILE__, __LINE__)
+#define TEST_ASSERT_EQUAL_STRING(e, a)  unity_host_assert_string((e), (a), __FILE__, __LINE__)
+
+#define TEST_ASSERT_GREATER_THAN(t, a)      TEST_ASSERT_MESSAGE((a) > (t), "Expected " #a " > " #t)
+#define TEST_ASSERT_GREATER_OR_EQUAL(t, a)  TEST_ASSERT_MESSAGE((a) >= (t), "Expected " #a " >= " #t)
+#define TEST_ASSERT_LESS_THAN(t, a)         TEST_ASSERT_MESSAGE((a) < (t), "Expected " #a " < " #t)
+#define TEST_ASSERT_LESS_OR_EQUAL(t, a)     TEST_ASSERT_MESSAGE((a) <= (t), "Expected " #a " <= " #t)
+#define TEST_ASSERT_DOUBLE_WITHIN(d, e, a)  unity_host_assert_double((d), (e), (a), __FILE__, __LINE__)
+#define TEST_ASSERT_FLOAT_WITHIN(d, e, a)   unity_host_assert_double((d), (e), (a), __FILE__, __LINE__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HOST_UNITY_H__
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// hash160 of the genesis coinbase key, behind every Base58 vector below
+static const uint8_t genesis_hash160[20] = {
+    0x62, 0xe9, 0x07, 0xb1, 0x5c, 0xbf, 0x27, 0xd5, 0x42, 0x53, 0x99, 0xeb, 0xf6, 0xf0, 0xfb, 0x50,
+    0xeb, 0xb8, 0x8f, 0x18
+};
+
+// BIP173 P2WPKH program
+static const uint8_t bip173_program[20] = {
+    0x75, 0x1e, 0x76, 0xe8, 0x19, 0x91, 0x96, 0xd4, 0x54, 0x94, 0x1c, 0x45, 0xd1, 0xb3, 0xa3, 0x23,
+    0xf1, 0x43, 0x3b, 0xd6
+};
+
+static void check_p2pkh(const char *address)
+{
+    uint8_t script[ADDRESS_SCRIPT_MAX];
+
+    TEST_ASSERT_EQUAL_size_t(25, address_to_script(address, script));
+    TEST_ASSERT_EQUAL_HEX8(0x76, script[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xa9, script[1]);
+    TEST_ASSERT_EQUAL_HEX8(20, script[2]);
+    TEST_ASSERT_EQUAL_MEMORY(genesis_hash160, script + 3, 20);
+    TEST_ASSERT_EQUAL_HEX8(0x88, script[23]);
+    TEST_ASSERT_EQUAL_HEX8(0xac, script[24]);
+}
+
+static void check_p2sh(const char *address)
+{
+    uint8_t script[ADDRESS_SCRIPT_MAX];
+
+    TEST_ASSERT_EQUAL_size_t(23, address_to_script(address, script));
+    TEST_ASSERT_EQUAL_HEX8(0xa9, script[0]);
+    TEST_ASSERT_EQUAL_HEX8(20, script[1]);
+    TEST_ASSERT_EQUAL_MEMORY(genesis_hash160, script + 2, 20);
+    TEST_ASSERT_EQUAL_HEX8(0x87, script[22]);
+}
+
+// Test Base58Check P2PKH and P2SH on mainnet and testnet/regtest
+void test_address_base58(void)
+{
+    check_p2pkh("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
+    check_p2pkh("mpXwg4jMtRhuSpVq4xS3HFHmCmWp9NyGKt");
+    check_p2sh("3Ai1JZ8pdJb2ksieUV8FsxSNVJCpoPi8W6");
+    check_p2sh("2N2GDNJ4rEm6NxfMC9ck8VuRdheQzXWaNZv");
+}
+
+// Test bech32 v0 and bech32m v1 programs, any case
+void test_address_segwit(void)
+{
+    static const uint8_t p2wsh[32] = {
+        0x18, 0x63, 0x14, 0x3c, 0x14, 0xc5, 0x16, 0x68, 0x04, 0xbd, 0x19, 0x20, 0x33, 0x56, 0xda, 0x13,
+        0x6c, 0x98, 0x56, 0x78, 0xcd, 0x4d, 0x27, 0xa1, 0xb8, 0xc6, 0x32, 0x96, 0x04, 0x90, 0x32, 0x62
+    };
+    static const uint8_t taproot[32] = {
+        0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b, 0x07,
+        0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98
+    };
+    static const char *p2wpkh[] = {
+        "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4",
+        "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4",
+        "bcrt1qw508d6qejxtdg4y5r3zarvary0c5xw7kygt080",
+    };
+    uint8_t script[ADDRESS_SCRIPT_MAX];
+
+    for (size_t i = 0; i < sizeof(p2wpkh) / sizeof(p2wpkh[0]); i++) {
+        TEST_ASSERT_EQUAL_size_t(22, address_to_script(p2wpkh[i], script));
+        TEST_ASSERT_EQUAL_HEX8(0x00, script[0]);
+        TEST_ASSERT_EQUAL_HEX8(20, script[1]);
+        TEST_ASSERT_EQUAL_MEMORY(bip173_program, script + 2, 20);
+    }
+
+    TEST_ASSERT_EQUAL_size_t(34, address_to_script("tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7",
+                                                   script));
+    TEST_ASSERT_EQUAL_HEX8(0x00, script[0]);
+    TEST_ASSERT_EQUAL_HEX8(32, script[1]);
+    TEST_ASSERT_EQUAL_MEMORY(p2wsh, script + 2, 32);
+
+    TEST_ASSERT_EQUAL_size_t(34, address_to_script("bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0",
+                                                   script));
+    TEST_ASSERT_EQUAL_HEX8(0x51, script[0]);
+    TEST_ASSERT_EQUAL_HEX8(32, script[1]);
+    TEST_ASSERT_EQUAL_MEMORY(taproot, script + 2, 32);
+}
+
+// Test that malformed addresses and bad checksums are refused
+void test_address_invalid(void)
+{
+    static const char *bad[] = {
+        "",
+        "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNb",                   // Checksum
+        "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfN0",                   // '0' is not Base58
+        "11A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa",                  // Extra leading zero
+        "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5",           // Checksum
+        "bc1qW508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4",           // Mixed case
+        "ltc1qw508d6qejxtdg4y5r3zarvary0c5xw7kgmn4n9",          // Other coin
+        "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqh2y7hd", // v1 with bech32
+        "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kemeawh",           // v0 with bech32m
+        "bc1pw5dgrnzv",                                         // 1-byte program
+    };
+    uint8_t script[ADDRESS_SCRIPT_MAX];
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_EQUAL_size_t(0, address_to_script(bad[i], script));
+    }
+}
+
+// Register tests with Unity
+void test_address_functions(void)
+{
+    RUN_TEST(test_address_base58);
+    RUN_TEST(test_address_segwit);
+    RUN_TEST(test_address_invalid);
+}
@@ -0,0 +1,91 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Bitcoin genesis block header (block 0)
+static const uint8_t genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+// Test parsing the genesis header fields
+void test_block_header_parse_genesis(void)
+{
+    block_header_t header;
+
+    block_header_parse(genesis_header, &header);
+
+    TEST_ASSERT_EQUAL_HEX32(1, header.version);
+    TEST_ASSERT_EQUAL_HEX32(1231006505, header.timestamp);
+    TEST_ASSERT_EQUAL_HEX32(0x1d00ffff, header.bits);
+    TEST_ASSERT_EQUAL_HEX32(2083236893, header.nonce);
+    TEST_ASSERT_EQUAL_HEX8(0x3b, header.merkle_root[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x4a, header.merkle_root[31]);
+}
+
+// Test that serializing parsed fields reproduces the exact bytes
+void test_block_header_serialize_roundtrip(void)
+{
+    block_header_t header;
+    uint8_t out[80];
+
+    block_header_parse(genesis_header, &header);
+    block_header_serialize(&header, out);
+
+    TEST_ASSERT_EQUAL_MEMORY(genesis_header, out, 80);
+}
+
+// Test field placement and little-endian encoding
+void test_block_header_serialize_layout(void)
+{
+    block_header_t header;
+    uint8_t out[80];
+
+    memset(&header, 0, sizeof(header));
+    header.version = 0x20000000;
+    header.prev_hash[0] = 0xAA;
+    header.merkle_root[31] = 0xBB;
+    header.timestamp = 0x11223344;
+    header.bits = 0x1d00ffff;
+    header.nonce = 0xDEADBEEF;
+
+    block_header_serialize(&header, out);
+
+    TEST_ASSERT_EQUAL_HEX8(0x00, out[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x20, out[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, out[BLOCK_HEADER_PREV_HASH_OFFSET]);
+    TEST_ASSERT_EQUAL_HEX8(0xBB, out[BLOCK_HEADER_MERKLE_OFFSET + 31]);
+    TEST_ASSERT_EQUAL_HEX8(0x44, out[BLOCK_HEADER_TIME_OFFSET]);
+    TEST_ASSERT_EQUAL_HEX8(0xff, out[BLOCK_HEADER_BITS_OFFSET]);
+    TEST_ASSERT_EQUAL_HEX8(0x1d, out[BLOCK_HEADER_BITS_OFFSET + 3]);
+    TEST_ASSERT_EQUAL_HEX8(0xEF, out[BLOCK_HEADER_NONCE_OFFSET]);
+    TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, block_header_read_le32(&out[BLOCK_HEADER_NONCE_OFFSET]));
+}
+
+// Test that a serialized header hashes to the genesis block hash
+void test_block_header_genesis_hash(void)
+{
+    block_header_t header;
+    uint8_t out[80];
+    uint8_t hash[32];
+
+    block_header_parse(genesis_header, &header);
+    block_header_serialize(&header, out);
+    double_sha256(out, sizeof(out), hash);
+
+    // 000000000019d668... displayed; 43 leading zero bits
+    TEST_ASSERT_EQUAL_UINT32(43, count_leading_zeros(hash));
+    TEST_ASSERT_EQUAL_HEX8(0x6f, hash[0]);
+}
+
+// Register tests with Unity
+void test_block_header_functions(void)
+{
+    RUN_TEST(test_block_header_parse_genesis);
+    RUN_TEST(test_block_header_serialize_roundtrip);
+    RUN_TEST(test_block_header_serialize_layout);
+    RUN_TEST(test_block_header_genesis_hash);
+}
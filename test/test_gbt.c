@@ -0,0 +1,440 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+#include "mock_bitcoind.h"
+
+// Host only: the node is a child process on a loopback socket
+
+#define POLL_MS         10
+#define TIMEOUT_US      5000000
+
+// Empty-block witness commitment: SHA256d of 64 zero bytes
+static const uint8_t empty_commitment[GBT_COMMITMENT_SIZE] = {
+    0x6a, 0x24, 0xaa, 0x21, 0xa9, 0xed,
+    0xe2, 0xf6, 0x1c, 0x3f, 0x71, 0xd1, 0xde, 0xfd, 0x3f, 0xa9, 0x99, 0xdf, 0xa3, 0x69, 0x53, 0x75,
+    0x5c, 0x69, 0x06, 0x89, 0x79, 0x99, 0x62, 0xb4, 0x8b, 0xeb, 0xd8, 0x36, 0x97, 0x4e, 0x8c, 0xf9
+};
+
+static mock_bitcoind_t node;
+static gbt_client_t client;
+static gbt_config_t config;
+static bool node_started;
+static gbt_template_t tmpl;
+static work_template_t work;
+
+static void start(const char *password)
+{
+    TEST_ASSERT_TRUE(mock_bitcoind_start(&node));
+    node_started = true;
+    config.host = "127.0.0.1";
+    config.port = node.port;
+    config.user = MOCK_BITCOIND_USER;
+    config.password = password;
+    config.address = MOCK_BITCOIND_ADDRESS;
+    config.version_mask = VERSION_ROLLING_BIP320_MASK;
+    TEST_ASSERT_TRUE(gbt_client_init(&client, &config));
+}
+
+// Poll until a job newer than *seq is published, or time out
+static bool poll_job(uint32_t *seq, stratum_job_t *job)
+{
+    uint64_t deadline = miner_time_us() + TIMEOUT_US;
+
+    while (!gbt_client_take_job(&client, seq, job)) {
+        if (miner_time_us() >= deadline) {
+            return false;
+        }
+        gbt_client_poll(&client, POLL_MS);
+    }
+    return true;
+}
+
+// Poll until the node has answered every queued block, or time out
+static bool poll_answers(gbt_status_t *status, uint32_t answers)
+{
+    uint64_t deadline = miner_time_us() + TIMEOUT_US;
+
+    do {
+        gbt_client_poll(&client, POLL_MS);
+        gbt_client_status(&client, status);
+    } while (status->accepted + status->rejected + status->stale < answers && miner_time_us() < deadline);
+    return status->accepted + status->rejected + status->stale == answers;
+}
+
+void setUp(void)
+{
+    node_started = false;
+    memset(&tmpl, 0, sizeof(tmpl));
+}
+
+void tearDown(void)
+{
+    if (node_started) {
+        TEST_ASSERT_EQUAL_INT(0, mock_bitcoind_finish(&node));
+    }
+}
+
+// Header of a solution, as the node rebuilds it
+static void share_header(const stratum_job_t *job, const stratum_share_t *share, uint8_t *out)
+{
+    block_header_t header = job->work.header;
+
+    header.version = share->version;
+    header.timestamp = share->ntime;
+    header.nonce = share->nonce;
+    work_merkle_root(&job->work, share->extranonce2, header.merkle_root);
+    block_header_serialize(&header, out);
+}
+
+// Test the BIP34 height push at the start of the coinbase scriptSig
+void test_gbt_coinbase_height(void)
+{
+    static const struct {
+        uint32_t height;
+        uint8_t push[6];
+        size_t len;
+    } heights[] = {
+        { 1, { 0x51 }, 1 },
+        { 16, { 0x60 }, 1 },
+        { 17, { 0x01, 0x11 }, 2 },
+        { 127, { 0x01, 0x7f }, 2 },
+        { 128, { 0x02, 0x80, 0x00 }, 3 },
+        { 256, { 0x02, 0x00, 0x01 }, 3 },
+        { 65535, { 0x03, 0xff, 0xff, 0x00 }, 4 },
+        { 840000, { 0x03, 0x40, 0xd1, 0x0c }, 4 },
+        { 0x80000000, { 0x05, 0x00, 0x00, 0x00, 0x80, 0x00 }, 6 },
+    };
+    static const uint8_t script[22] = { 0x00, 0x14 };
+
+    for (size_t i = 0; i < sizeof(heights) / sizeof(heights[0]); i++) {
+        size_t script_sig = heights[i].len + 1 + GBT_EXTRANONCE2_SIZE + 1 + strlen(GBT_COINBASE_TAG);
+
+        tmpl.height = heights[i].height;
+        TEST_ASSERT_TRUE(gbt_build_work(&tmpl, script, sizeof(script), &work));
+        TEST_ASSERT_EQUAL_UINT8(script_sig, work.coinbase[41]);
+        TEST_ASSERT_EQUAL_MEMORY(heights[i].push, work.coinbase + 42, heights[i].len);
+        TEST_ASSERT_EQUAL_size_t(42 + heights[i].len + 1, work.extranonce2_offset);
+        TEST_ASSERT_EQUAL_size_t(GBT_EXTRANONCE2_SIZE, work.extranonce2_size);
+        TEST_ASSERT_EQUAL_MEMORY(GBT_COINBASE_TAG, work.coinbase + 42 + script_sig - strlen(GBT_COINBASE_TAG),
+                                 strlen(GBT_COINBASE_TAG));
+    }
+}
+
+// Test the coinbase outputs: payout, and the witness commitment of an empty block
+void test_gbt_coinbase_outputs(void)
+{
+    static const uint8_t script[25] = { 0x76, 0xa9, 0x14, 1, 2, 3, [23] = 0x88, 0xac };
+    static const uint8_t value[8] = { 0x26, 0xf2, 0x05, 0x2a, 0x01, 0x00, 0x00, 0x00 };
+    // Outputs follow the 4-byte sequence after the tag
+    size_t outputs = 42 + 1 + 1 + GBT_EXTRANONCE2_SIZE + 1 + strlen(GBT_COINBASE_TAG) + 4;
+
+    tmpl.height = 1;
+    tmpl.coinbase_value = 5000000038ull;
+    TEST_ASSERT_TRUE(gbt_build_work(&tmpl, script, sizeof(script), &work));
+    TEST_ASSERT_EQUAL_UINT8(1, work.coinbase[outputs]);
+    TEST_ASSERT_EQUAL_MEMORY(value, work.coinbase + outputs + 1, 8);
+    TEST_ASSERT_EQUAL_UINT8(sizeof(script), work.coinbase[outputs + 9]);
+    TEST_ASSERT_EQUAL_MEMORY(script, work.coinbase + outputs + 10, sizeof(script));
+    TEST_ASSERT_EQUAL_size_t(outputs + 10 + sizeof(script) + 4, work.coinbase_len);
+
+    tmpl.segwit = true;
+    TEST_ASSERT_TRUE(gbt_build_work(&tmpl, script, sizeof(script), &work));
+    TEST_ASSERT_EQUAL_UINT8(2, work.coinbase[outputs]);
+    outputs += 10 + sizeof(script);
+    TEST_ASSERT_EQUAL_MEMORY("\0\0\0\0\0\0\0\0", work.coinbase + outputs, 8);
+    TEST_ASSERT_EQUAL_UINT8(GBT_COMMITMENT_SIZE, work.coinbase[outputs + 8]);
+    TEST_ASSERT_EQUAL_MEMORY(empty_commitment, work.coinbase + outputs + 9, GBT_COMMITMENT_SIZE);
+    TEST_ASSERT_EQUAL_size_t(outputs + 9 + GBT_COMMITMENT_SIZE + 4, work.coinbase_len);
+}
+
+// Reference merkle root over whole levels
+static void reference_root(uint8_t (*leaves)[32], size_t count, uint8_t *root)
+{
+    while (count > 1) {
+        if (count % 2 != 0) {
+            memcpy(leaves[count], leaves[count - 1], 32);
+            count++;
+        }
+        for (size_t i = 0; i < count / 2; i++) {
+            uint8_t pair[64];
+            memcpy(pair, leaves[2 * i], 32);
+            memcpy(pair + 32, leaves[2 * i + 1], 32);
+            double_sha256(pair, sizeof(pair), leaves[i]);
+        }
+        count /= 2;
+    }
+    memcpy(root, leaves[0], 32);
+}
+
+// Test the merkle root of the work for every transaction count up to 17
+void test_gbt_merkle_branch(void)
+{
+    static uint8_t leaves[20][32];
+    static merkle_builder_t merkle;
+    static const uint8_t script[22] = { 0x00, 0x14 };
+    uint8_t coinbase[WORK_COINBASE_MAX];
+    uint8_t expect[32];
+    uint8_t root[32];
+
+    for (uint32_t count = 0; count <= 17; count++) {
+        // The template's branch, as the parser folds it
+        merkle_init(&merkle);
+        for (uint32_t i = 0; i < count; i++) {
+            memset(leaves[1 + i], (int)(i * 13 + 1), 32);
+            merkle_add(&merkle, leaves[1 + i]);
+        }
+        tmpl.tx_count = count;
+        tmpl.branch_len = merkle_finish(&merkle);
+        memcpy(tmpl.branch, merkle.branch, sizeof(tmpl.branch));
+        TEST_ASSERT_TRUE(gbt_build_work(&tmpl, script, sizeof(script), &work));
+        work_merkle_root(&work, 0x01020304, root);
+
+        memcpy(coinbase, work.coinbase, work.coinbase_len);
+        block_header_write_le32(coinbase + work.extranonce2_offset, 0x01020304);
+        double_sha256(coinbase, work.coinbase_len, leaves[0]);
+        reference_root(leaves, count + 1, expect);
+        TEST_ASSERT_EQUAL_MEMORY(expect, root, 32);
+    }
+}
+
+typedef struct {
+    uint8_t data[1024];
+    size_t len;
+} capture_t;
+
+static void capture(const uint8_t *data, size_t len, void *arg)
+{
+    capture_t *out = (capture_t *)arg;
+
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(out->data), out->len + len);
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+// Test the block layout: header, count, coinbase with its witness, transactions
+void test_gbt_block_serialize(void)
+{
+    static const uint8_t script[22] = { 0x00, 0x14 };
+    static const uint8_t txs[7] = { 0xaa, 0xbb, 0xcc, 0x01, 0x02, 0x03, 0x04 };
+    static capture_t out;
+    stratum_share_t share = { "1", 0x11223344, 1700000005, 0xdeadbeef, 0x20002000 };
+    stratum_job_t job;
+    uint8_t header[BLOCK_HEADER_SIZE];
+    size_t len;
+
+    tmpl.height = 200;
+    tmpl.bits = 0x207fffff;
+    tmpl.curtime = 1700000000;
+    tmpl.version = 0x20000000;
+    tmpl.segwit = true;
+    tmpl.tx_count = 2;
+    memcpy(tmpl.tx_data, txs, sizeof(txs));
+    tmpl.tx_data_len = sizeof(txs);
+    TEST_ASSERT_TRUE(gbt_build_work(&tmpl, script, sizeof(script), &job.work));
+
+    out.len = 0;
+    len = gbt_block_serialize(&tmpl, &job.work, &share, NULL, NULL);
+    TEST_ASSERT_EQUAL_size_t(len, gbt_block_serialize(&tmpl, &job.work, &share, capture, &out));
+    TEST_ASSERT_EQUAL_size_t(BLOCK_HEADER_SIZE + 1 + job.work.coinbase_len + 2 + 34 + sizeof(txs), len);
+    TEST_ASSERT_EQUAL_size_t(len, out.len);
+
+    share_header(&job, &share, header);
+    TEST_ASSERT_EQUAL_MEMORY(header, out.data, BLOCK_HEADER_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(3, out.data[80]);
+
+    // Version, segwit marker and flag, then the txid serialization with extranonce2 in place
+    const uint8_t *cb = out.data + 81;
+    TEST_ASSERT_EQUAL_MEMORY(job.work.coinbase, cb, 4);
+    TEST_ASSERT_EQUAL_HEX8(0x00, cb[4]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, cb[5]);
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, block_header_read_le32(cb + 2 + job.work.extranonce2_offset));
+    TEST_ASSERT_EQUAL_MEMORY(job.work.coinbase + job.work.extranonce2_offset + 4,
+                             cb + 2 + job.work.extranonce2_offset + 4,
+                             job.work.coinbase_len - job.work.extranonce2_offset - 8);
+
+    // Witness: one 32-byte reserved value of zeros, then the lock time
+    const uint8_t *witness = cb + 2 + job.work.coinbase_len - 4;
+    TEST_ASSERT_EQUAL_UINT8(1, witness[0]);
+    TEST_ASSERT_EQUAL_UINT8(32, witness[1]);
+    for (int i = 0; i < 32; i++) {
+        TEST_ASSERT_EQUAL_UINT8(0, witness[2 + i]);
+    }
+    TEST_ASSERT_EQUAL_MEMORY("\0\0\0\0", witness + 34, 4);
+    TEST_ASSERT_EQUAL_MEMORY(txs, out.data + len - sizeof(txs), sizeof(txs));
+}
+
+// Test fetching a template: kept and dropped transactions, job fields
+void test_gbt_template(void)
+{
+    gbt_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+
+    start(MOCK_BITCOIND_PASS);
+    TEST_ASSERT_TRUE(poll_job(&seq, &job));
+
+    gbt_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(1, status.templates);
+    TEST_ASSERT_EQUAL_UINT32(1, status.height);
+    TEST_ASSERT_EQUAL_UINT32(MOCK_BITCOIND_TX_KEPT, status.tx_count);
+    TEST_ASSERT_EQUAL_UINT32(MOCK_BITCOIND_TXS - MOCK_BITCOIND_TX_KEPT, status.tx_dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, status.errors);
+
+    TEST_ASSERT_EQUAL_STRING("1", job.id);
+    TEST_ASSERT_TRUE(job.clean);
+    TEST_ASSERT_EQUAL_MEMORY(mock_bitcoind_genesis_hash, job.work.header.prev_hash, 32);
+    TEST_ASSERT_EQUAL_HEX32(0x207fffff, job.work.header.bits);
+    TEST_ASSERT_EQUAL_HEX32(0x20000000, job.work.header.version);
+    TEST_ASSERT_EQUAL_HEX32(VERSION_ROLLING_BIP320_MASK, job.work.version_mask);
+    TEST_ASSERT_EQUAL_size_t(GBT_EXTRANONCE2_SIZE, job.work.extranonce2_size);
+    // Coinbase and three transactions: two levels
+    TEST_ASSERT_EQUAL_size_t(2, job.work.merkle_count);
+    TEST_ASSERT_LESS_THAN(1e-9, job.difficulty);
+
+    // Nothing newer until the refresh period
+    TEST_ASSERT_FALSE(gbt_client_take_job(&client, &seq, &job));
+}
+
+typedef struct {
+    gbt_client_t *client;
+    const stratum_job_t *job;
+    stratum_share_t share;
+    uint32_t blocks;
+} block_arg_t;
+
+// Submit the first block found; with the regtest target that is almost any hash
+static void submit_block(miner_ctx_t *miner, const miner_share_t *found, void *arg)
+{
+    block_arg_t *submit = (block_arg_t *)arg;
+    stratum_share_t share;
+
+    (void)miner;
+    if (!found->meets_block || __atomic_fetch_add(&submit->blocks, 1, __ATOMIC_RELAXED) != 0) {
+        return;
+    }
+    strcpy(share.job_id, submit->job->id);
+    share.extranonce2 = found->extranonce2;
+    share.ntime = found->ntime;
+    share.nonce = found->nonce;
+    share.version = found->version;
+    submit->share = share;
+    gbt_client_submit(submit->client, &share);
+}
+
+// Test mining a block in a rolled variant and the node accepting it; the
+// next template builds on it
+void test_gbt_mine_block(void)
+{
+    static miner_ctx_t miner;
+    gbt_status_t status;
+    stratum_job_t job;
+    stratum_job_t next;
+    uint32_t seq = 0;
+    uint8_t header[BLOCK_HEADER_SIZE];
+    uint8_t hash[32];
+    block_arg_t arg = { .client = &client, .job = &job };
+    // Variant with version index 5, ntime + 1 and extranonce2 + 1
+    uint64_t roll = (uint64_t)65536 * (WORK_NTIME_ROLL_DEFAULT + 1) + 65536 + 5;
+
+    start(MOCK_BITCOIND_PASS);
+    TEST_ASSERT_TRUE(poll_job(&seq, &job));
+
+    miner_ctx_init(&miner, hash_backend_get(0), 2);
+    miner_ctx_set_share_callback(&miner, submit_block, &arg);
+    miner_ctx_set_share_difficulty(&miner, job.difficulty);
+    miner_ctx_set_work(&miner, &job.work);
+    miner_ctx_set_range(&miner, roll << 32, 64, 64);
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    miner_ctx_wait(&miner);
+    TEST_ASSERT_GREATER_THAN(0, arg.blocks);
+    TEST_ASSERT_EQUAL_UINT32(job.work.header.timestamp + 1, arg.share.ntime);
+    TEST_ASSERT_EQUAL_UINT64(1, arg.share.extranonce2);
+
+    TEST_ASSERT_TRUE(poll_answers(&status, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, status.submitted);
+    TEST_ASSERT_EQUAL_UINT32(1, status.accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, status.rejected);
+
+    // A template on top of the new block follows right away
+    TEST_ASSERT_TRUE(poll_job(&seq, &next));
+    share_header(&job, &arg.share, header);
+    double_sha256(header, sizeof(header), hash);
+    TEST_ASSERT_EQUAL_MEMORY(hash, next.work.header.prev_hash, 32);
+    TEST_ASSERT_TRUE(next.clean);
+    gbt_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(2, status.height);
+}
+
+// Test a block that misses the target, and a solution for an unknown template
+void test_gbt_rejected(void)
+{
+    gbt_status_t status;
+    stratum_job_t job;
+    stratum_share_t share;
+    uint32_t seq = 0;
+    uint8_t header[BLOCK_HEADER_SIZE];
+    uint8_t hash[32];
+    target_t target;
+
+    start(MOCK_BITCOIND_PASS);
+    TEST_ASSERT_TRUE(poll_job(&seq, &job));
+
+    strcpy(share.job_id, job.id);
+    share.extranonce2 = 0;
+    share.ntime = job.work.header.timestamp;
+    share.version = job.work.header.version;
+    target_from_bits(job.work.header.bits, &target);
+    share.nonce = 0;
+    do {
+        share.nonce++;
+        share_header(&job, &share, header);
+        double_sha256(header, sizeof(header), hash);
+    } while (target_hash_meets(hash, &target));
+    TEST_ASSERT_TRUE(gbt_client_submit(&client, &share));
+    strcpy(share.job_id, "99");
+    TEST_ASSERT_TRUE(gbt_client_submit(&client, &share));
+
+    TEST_ASSERT_TRUE(poll_answers(&status, 2));
+    TEST_ASSERT_EQUAL_UINT32(1, status.submitted);
+    TEST_ASSERT_EQUAL_UINT32(0, status.accepted);
+    TEST_ASSERT_EQUAL_UINT32(1, status.rejected);
+    TEST_ASSERT_EQUAL_UINT32(1, status.stale);
+    TEST_ASSERT_EQUAL_STRING("high-hash", status.reject_reason);
+}
+
+// Test that a wrong password counts as a failed request and publishes nothing
+void test_gbt_unauthorized(void)
+{
+    gbt_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+
+    start("wrong");
+    gbt_client_poll(&client, POLL_MS);
+    gbt_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(1, status.errors);
+    TEST_ASSERT_EQUAL_UINT32(0, status.templates);
+    TEST_ASSERT_FALSE(gbt_client_take_job(&client, &seq, &job));
+
+    // The retry waits GBT_RETRY_US
+    gbt_client_poll(&client, POLL_MS);
+    gbt_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(1, status.errors);
+
+    // And a payout address that does not decode is refused up front
+    config.address = "bc1qinvalid";
+    TEST_ASSERT_FALSE(gbt_client_init(&client, &config));
+}
+
+// Register tests with Unity
+void test_gbt_functions(void)
+{
+    RUN_TEST(test_gbt_coinbase_height);
+    RUN_TEST(test_gbt_coinbase_outputs);
+    RUN_TEST(test_gbt_merkle_branch);
+    RUN_TEST(test_gbt_block_serialize);
+    RUN_TEST(test_gbt_template);
+    RUN_TEST(test_gbt_mine_block);
+    RUN_TEST(test_gbt_rejected);
+    RUN_TEST(test_gbt_unauthorized);
+}
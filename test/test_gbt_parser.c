@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Regtest genesis block hash, internal byte order
+static const uint8_t regtest_genesis[32] = {
+    0x06, 0x22, 0x6e, 0x46, 0x11, 0x1a, 0x0b, 0x59, 0xca, 0xaf, 0x12, 0x60, 0x43, 0xeb, 0x5b, 0xbf,
+    0x28, 0xc3, 0x4f, 0x3a, 0x5e, 0x33, 0x2a, 0x1f, 0xc7, 0xb2, 0xb7, 0x3c, 0xf1, 0x88, 0x91, 0x0f
+};
+
+// Empty-block witness commitment: SHA256d of 64 zero bytes
+static const uint8_t empty_commitment[GBT_COMMITMENT_SIZE] = {
+    0x6a, 0x24, 0xaa, 0x21, 0xa9, 0xed,
+    0xe2, 0xf6, 0x1c, 0x3f, 0x71, 0xd1, 0xde, 0xfd, 0x3f, 0xa9, 0x99, 0xdf, 0xa3, 0x69, 0x53, 0x75,
+    0x5c, 0x69, 0x06, 0x89, 0x79, 0x99, 0x62, 0xb4, 0x8b, 0xeb, 0xd8, 0x36, 0x97, 0x4e, 0x8c, 0xf9
+};
+
+// A getblocktemplate response as bitcoind formats it, plus some whitespace
+static const char template_json[] =
+    "{\"result\": {\"capabilities\":[\"proposal\"],\"version\":536870912,\"rules\":[\"csv\",\"!segwit\"],"
+    "\"vbavailable\":{},\"vbrequired\":0,"
+    "\"previousblockhash\":\"0f9188f13cb7b2c71f2a335e3a4fc328bf5beb436012afca590b1a11466e2206\",\n"
+    "\"transactions\":[{\"data\":\"0100ff\","
+    "\"txid\":\"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f\","
+    "\"hash\":\"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f\","
+    "\"depends\":[],\"fee\":250,\"sigops\":4,\"weight\":12},\n"
+    "  {\"data\":\"02AABB\",\"txid\":\"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f\","
+    "\"depends\":[1],\"fee\":300}],"
+    "\"coinbaseaux\":{\"flags\":\"\"},\"coinbasevalue\":5000000550,\"longpollid\":\"x\\\"y\","
+    "\"mutable\":[\"time\",\"transactions\",\"prevblock\"],\"curtime\":1700000001,\"bits\":\"207fffff\","
+    "\"height\":840000,\"default_witness_commitment\":"
+    "\"6a24aa21a9ede2f61c3f71d1defd3fa999dfa36953755c690689799962b48bebd836974e8cf9\"} ,"
+    "\"error\":null,\"id\":1}\n";
+
+// Transactions in a large template: a 13-level branch
+#define MANY_TXS        5000
+
+static gbt_parser_t parser;
+static gbt_template_t tmpl;
+
+static gbt_parse_t feed(const char *json, size_t chunk)
+{
+    size_t len = strlen(json);
+    gbt_parse_t result = GBT_PARSE_MORE;
+
+    for (size_t i = 0; i < len && result == GBT_PARSE_MORE; i += chunk) {
+        result = gbt_parser_feed(&parser, json + i, len - i < chunk ? len - i : chunk);
+    }
+    return result;
+}
+
+// The hex hashes above count up from their first byte; internal order reverses them
+static void reversed_hash(uint8_t first, uint8_t *hash)
+{
+    for (int i = 0; i < 32; i++) {
+        hash[i] = (uint8_t)(first + 31 - i);
+    }
+}
+
+static void hash_pair(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+    uint8_t pair[64];
+
+    memcpy(pair, left, 32);
+    memcpy(pair + 32, right, 32);
+    double_sha256(pair, sizeof(pair), out);
+}
+
+// Test decoding a template in chunks of any size
+void test_gbt_parser_template(void)
+{
+    static const size_t chunks[] = { 1, 7, 64, sizeof(template_json) };
+    static const uint8_t data[6] = { 0x01, 0x00, 0xff, 0x02, 0xaa, 0xbb };
+    static const uint8_t zero[32] = { 0 };
+    uint8_t txid[2][32];
+    uint8_t wtxid0[32];
+    uint8_t right[32];
+    uint8_t left[32];
+    uint8_t root[32];
+
+    // Three leaves: the coinbase, transaction 0, and transaction 1 paired with itself
+    reversed_hash(0x00, txid[0]);
+    reversed_hash(0x40, txid[1]);
+    reversed_hash(0x20, wtxid0);
+    hash_pair(txid[1], txid[1], right);
+
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        memset(&tmpl, 0xa5, sizeof(tmpl));
+        gbt_parser_init(&parser, &tmpl);
+        TEST_ASSERT_EQUAL_INT(GBT_PARSE_DONE, feed(template_json, chunks[c]));
+
+        TEST_ASSERT_EQUAL_HEX32(0x20000000, tmpl.version);
+        TEST_ASSERT_EQUAL_MEMORY(regtest_genesis, tmpl.prev_hash, 32);
+        TEST_ASSERT_EQUAL_HEX32(0x207fffff, tmpl.bits);
+        TEST_ASSERT_EQUAL_UINT32(1700000001, tmpl.curtime);
+        TEST_ASSERT_EQUAL_UINT32(840000, tmpl.height);
+        TEST_ASSERT_EQUAL_UINT64(5000000550ull, tmpl.coinbase_value);
+        TEST_ASSERT_TRUE(tmpl.segwit);
+        TEST_ASSERT_EQUAL_MEMORY(empty_commitment, tmpl.default_commitment, GBT_COMMITMENT_SIZE);
+
+        TEST_ASSERT_EQUAL_UINT32(2, tmpl.tx_count);
+        TEST_ASSERT_EQUAL_UINT32(0, tmpl.tx_dropped);
+        TEST_ASSERT_EQUAL_UINT64(0, tmpl.dropped_fees);
+        TEST_ASSERT_EQUAL_UINT32(2, tmpl.branch_len);
+        TEST_ASSERT_EQUAL_MEMORY(txid[0], tmpl.branch[0], 32);
+        TEST_ASSERT_EQUAL_MEMORY(right, tmpl.branch[1], 32);
+
+        // No "hash" means no witness: transaction 1's wtxid is its txid
+        hash_pair(zero, wtxid0, left);
+        hash_pair(left, right, root);
+        TEST_ASSERT_EQUAL_MEMORY(root, tmpl.witness_root, 32);
+        TEST_ASSERT_EQUAL_size_t(sizeof(data), tmpl.tx_data_len);
+        TEST_ASSERT_EQUAL_MEMORY(data, tmpl.tx_data, sizeof(data));
+
+        // Anything after the response is ignored
+        TEST_ASSERT_EQUAL_INT(GBT_PARSE_DONE, gbt_parser_feed(&parser, "garbage", 7));
+    }
+}
+
+// Stream a template of count transactions; transaction big carries big_len bytes
+static gbt_parse_t feed_txs(size_t count, size_t big, size_t big_len)
+{
+    char text[160];
+    gbt_parse_t result;
+
+    gbt_parser_init(&parser, &tmpl);
+    feed("{\"id\":1,\"error\":null,\"result\":{\"version\":1,\"previousblockhash\":"
+         "\"0000000000000000000000000000000000000000000000000000000000000000\",\"transactions\":[", 64);
+    for (size_t i = 0; i < count; i++) {
+        feed(i > 0 ? ",{\"data\":\"" : "{\"data\":\"", 64);
+        for (size_t k = 0; k < (i == big ? big_len : 1); k++) {
+            feed(i == big ? "00" : "0a0b", 64);
+        }
+        snprintf(text, sizeof(text), "\",\"txid\":\"%04x000000000000000000000000000000000000000000000000000000"
+                 "000000\",\"fee\":%u}", (unsigned)i, (unsigned)(i + 1));
+        feed(text, 64);
+    }
+    result = feed("],\"coinbasevalue\":1000000,\"curtime\":1,\"bits\":\"1d00ffff\",\"height\":1}}", 64);
+    return result;
+}
+
+// Test that many small transactions are all kept, and that transactions
+// past the data limit are left out with their fees
+void test_gbt_parser_dropped(void)
+{
+    static merkle_builder_t merkle;
+    uint8_t txid[32] = { 0 };
+
+    // Thousands of transactions cost no memory beyond their data
+    TEST_ASSERT_EQUAL_INT(GBT_PARSE_DONE, feed_txs(MANY_TXS, MANY_TXS, 0));
+    TEST_ASSERT_EQUAL_UINT32(MANY_TXS, tmpl.tx_count);
+    TEST_ASSERT_EQUAL_UINT32(0, tmpl.tx_dropped);
+    TEST_ASSERT_EQUAL_UINT64(1000000, tmpl.coinbase_value);
+    TEST_ASSERT_EQUAL_size_t(2 * MANY_TXS, tmpl.tx_data_len);
+    TEST_ASSERT_FALSE(tmpl.segwit);
+    merkle_init(&merkle);
+    for (uint32_t i = 0; i < MANY_TXS; i++) {
+        txid[31] = (uint8_t)(i >> 8);
+        txid[30] = (uint8_t)i;
+        merkle_add(&merkle, txid);
+    }
+    TEST_ASSERT_EQUAL_UINT32(merkle_finish(&merkle), tmpl.branch_len);
+    TEST_ASSERT_EQUAL_MEMORY(merkle.branch, tmpl.branch, tmpl.branch_len * 32);
+
+    // A transaction too large for GBT_TX_DATA_MAX, and every one after it
+    TEST_ASSERT_EQUAL_INT(GBT_PARSE_DONE, feed_txs(5, 2, GBT_TX_DATA_MAX));
+    TEST_ASSERT_EQUAL_UINT32(2, tmpl.tx_count);
+    TEST_ASSERT_EQUAL_UINT32(3, tmpl.tx_dropped);
+    TEST_ASSERT_EQUAL_UINT64(3 + 4 + 5, tmpl.dropped_fees);
+    TEST_ASSERT_EQUAL_UINT64(1000000 - 12, tmpl.coinbase_value);
+    TEST_ASSERT_EQUAL_size_t(4, tmpl.tx_data_len);
+
+    // One that just fits is kept
+    TEST_ASSERT_EQUAL_INT(GBT_PARSE_DONE, feed_txs(1, 0, GBT_TX_DATA_MAX));
+    TEST_ASSERT_EQUAL_UINT32(1, tmpl.tx_count);
+    TEST_ASSERT_EQUAL_size_t(GBT_TX_DATA_MAX, tmpl.tx_data_len);
+}
+
+// Test RPC errors, missing fields and malformed JSON
+void test_gbt_parser_invalid(void)
+{
+    static const char *bad[] = {
+        // RPC error
+        "{\"result\":null,\"error\":{\"code\":-10,\"message\":\"Bitcoin Core is in initial sync\"},\"id\":1}",
+        // No height
+        "{\"result\":{\"version\":1,\"previousblockhash\":\"00000000000000000000000000000000000000000000000000"
+        "00000000000000\",\"transactions\":[],\"coinbasevalue\":1,\"curtime\":1,\"bits\":\"1d00ffff\"},\"id\":1}",
+        // Short previous block hash
+        "{\"result\":{\"version\":1,\"previousblockhash\":\"0000\",\"transactions\":[],\"coinbasevalue\":1,"
+        "\"curtime\":1,\"bits\":\"1d00ffff\",\"height\":1},\"id\":1}",
+        // Transaction without a txid
+        "{\"result\":{\"version\":1,\"previousblockhash\":\"00000000000000000000000000000000000000000000000000"
+        "00000000000000\",\"transactions\":[{\"data\":\"00\"}],\"coinbasevalue\":1,\"curtime\":1,"
+        "\"bits\":\"1d00ffff\",\"height\":1},\"id\":1}",
+        // Not hex
+        "{\"result\":{\"version\":1,\"previousblockhash\":\"0000000000000000000000000000000000000000000000000x"
+        "00000000000000\",\"transactions\":[],\"coinbasevalue\":1,\"curtime\":1,\"bits\":\"1d00ffff\","
+        "\"height\":1},\"id\":1}",
+        // Number as a string
+        "{\"result\":{\"version\":\"1\"},\"id\":1}",
+        // Trailing comma
+        "{\"result\":{\"version\":1,},\"id\":1}",
+    };
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        gbt_parser_init(&parser, &tmpl);
+        TEST_ASSERT_EQUAL_INT(GBT_PARSE_INVALID, feed(bad[i], 5));
+    }
+
+    // Incomplete
+    gbt_parser_init(&parser, &tmpl);
+    TEST_ASSERT_EQUAL_INT(GBT_PARSE_MORE, gbt_parser_feed(&parser, template_json, sizeof(template_json) / 2));
+}
+
+// Register tests with Unity
+void test_gbt_parser_functions(void)
+{
+    RUN_TEST(test_gbt_parser_template);
+    RUN_TEST(test_gbt_parser_dropped);
+    RUN_TEST(test_gbt_parser_invalid);
+}
@@ -0,0 +1,132 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/hash_backend.h"
+
+// Reports every nonce as a candidate and is "fast"; must never be selected
+static uint32_t scan_broken(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                            uint32_t max_top_word, uint32_t *out_mask)
+{
+    (void)ctx;
+    (void)nonce_start;
+    (void)max_top_word;
+    memset(out_mask, 0xFF, SHA256D_BATCH_MASK_WORDS(count) * sizeof(uint32_t));
+    return count;
+}
+
+static bool never_available(void)
+{
+    return false;
+}
+
+// Test registry lookup
+void test_hash_backend_registry(void)
+{
+    TEST_ASSERT_GREATER_OR_EQUAL((size_t)7, hash_backend_count());
+    TEST_ASSERT_LESS_OR_EQUAL((size_t)HASH_BACKEND_MAX, hash_backend_count());
+    TEST_ASSERT_EQUAL_STRING("reference", hash_backend_get(0)->name);
+    TEST_ASSERT_NULL(hash_backend_get(hash_backend_count()));
+    TEST_ASSERT_NOT_NULL(hash_backend_find("x4"));
+    TEST_ASSERT_EQUAL_STRING("x4", hash_backend_find("x4")->name);
+    TEST_ASSERT_NULL(hash_backend_find("does-not-exist"));
+}
+
+// Test that every available built-in backend passes its self-test
+void test_hash_backend_builtin_self_test(void)
+{
+    for (size_t i = 0; i < hash_backend_count(); i++) {
+        const hash_backend_t *backend = hash_backend_get(i);
+        if (backend->available != NULL && !backend->available()) {
+            continue;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(hash_backend_self_test(backend), backend->name);
+    }
+}
+
+// Test that all backends report the same candidates over a range
+void test_hash_backend_scans_agree(void)
+{
+    uint32_t expected[SHA256D_BATCH_MASK_WORDS(100)];
+    uint32_t mask[SHA256D_BATCH_MASK_WORDS(100)];
+    uint8_t header[80];
+    sha256d_ctx_t ctx;
+
+    for (int i = 0; i < 80; i++) {
+        header[i] = (uint8_t)(i * 5 + 1);
+    }
+    sha256d_init(&ctx, header);
+    uint32_t want = hash_backend_get(0)->scan(&ctx, 500, 100, 0x07FFFFFF, expected);
+
+    for (size_t i = 1; i < hash_backend_count(); i++) {
+        const hash_backend_t *backend = hash_backend_get(i);
+        if (backend->available != NULL && !backend->available()) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT32(want, backend->scan(&ctx, 500, 100, 0x07FFFFFF, mask));
+        TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, mask, SHA256D_BATCH_MASK_WORDS(100));
+    }
+}
+
+// Test that a backend with wrong answers fails and is never selected
+void test_hash_backend_rejects_broken(void)
+{
+    const hash_backend_t table[] = {
+        { "broken", scan_broken, NULL },
+        { "reference", hash_backend_get(0)->scan, NULL },
+    };
+    hash_backend_report_t report[2];
+
+    TEST_ASSERT_FALSE(hash_backend_self_test(&table[0]));
+
+    const hash_backend_t *selected = hash_backend_select_from(table, 2, report, 256);
+    TEST_ASSERT_EQUAL_PTR(&table[1], selected);
+    TEST_ASSERT_TRUE(report[0].available);
+    TEST_ASSERT_FALSE(report[0].passed);
+    TEST_ASSERT_EQUAL_UINT32(0, report[0].hashrate);
+    TEST_ASSERT_TRUE(report[1].passed);
+    TEST_ASSERT_GREATER_THAN(0u, report[1].hashrate);
+
+    TEST_ASSERT_NULL(hash_backend_select_from(table, 1, NULL, 256));
+}
+
+// Test that unavailable backends are skipped without being run
+void test_hash_backend_skips_unavailable(void)
+{
+    const hash_backend_t table[] = {
+        { "missing", scan_broken, never_available },
+        { "reference", hash_backend_get(0)->scan, NULL },
+    };
+    hash_backend_report_t report[2];
+
+    TEST_ASSERT_EQUAL_PTR(&table[1], hash_backend_select_from(table, 2, report, 256));
+    TEST_ASSERT_FALSE(report[0].available);
+    TEST_ASSERT_FALSE(report[0].passed);
+}
+
+// Test that selection returns a correct backend at least as fast as the reference
+void test_hash_backend_select_builtin(void)
+{
+    hash_backend_report_t report[HASH_BACKEND_MAX];
+
+    const hash_backend_t *selected = hash_backend_select(report, 2048);
+    TEST_ASSERT_NOT_NULL(selected);
+    TEST_ASSERT_TRUE(hash_backend_self_test(selected));
+
+    for (size_t i = 0; i < hash_backend_count(); i++) {
+        TEST_ASSERT_EQUAL_PTR(hash_backend_get(i), report[i].backend);
+        if (report[i].backend == selected) {
+            TEST_ASSERT_TRUE(report[i].passed);
+            TEST_ASSERT_GREATER_THAN(0u, report[i].hashrate);
+        }
+    }
+}
+
+// Register tests with Unity
+void test_hash_backend_functions(void)
+{
+    RUN_TEST(test_hash_backend_registry);
+    RUN_TEST(test_hash_backend_builtin_self_test);
+    RUN_TEST(test_hash_backend_scans_agree);
+    RUN_TEST(test_hash_backend_rejects_broken);
+    RUN_TEST(test_hash_backend_skips_unavailable);
+    RUN_TEST(test_hash_backend_select_builtin);
+}
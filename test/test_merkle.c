@@ -0,0 +1,94 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+#define LEAVES_TESTED   70
+
+static merkle_builder_t merkle;
+static uint8_t leaves[LEAVES_TESTED + 1][32];
+
+static void make_leaf(uint32_t i, uint8_t *hash)
+{
+    memset(hash, (int)(i * 29 + 7), 32);
+    hash[0] = (uint8_t)i;
+    hash[1] = (uint8_t)(i >> 8);
+}
+
+// Reference merkle root over whole levels; overwrites leaves
+static void reference_root(uint32_t count, uint8_t *root)
+{
+    while (count > 1) {
+        if (count % 2 != 0) {
+            memcpy(leaves[count], leaves[count - 1], 32);
+            count++;
+        }
+        for (uint32_t i = 0; i < count / 2; i++) {
+            uint8_t pair[64];
+            memcpy(pair, leaves[2 * i], 32);
+            memcpy(pair + 32, leaves[2 * i + 1], 32);
+            double_sha256(pair, sizeof(pair), leaves[i]);
+        }
+        count /= 2;
+    }
+    memcpy(root, leaves[0], 32);
+}
+
+// Test the branch against whole-level roots for every tree size up to LEAVES_TESTED
+void test_merkle_branch(void)
+{
+    static const uint8_t coinbases[2][32] = { { 0x01, 0x02 }, { 0xff, [31] = 0x80 } };
+    uint8_t expect[32];
+    uint8_t root[32];
+
+    for (uint32_t count = 1; count <= LEAVES_TESTED; count++) {
+        uint32_t depth = 0;
+
+        while ((1u << depth) < count) {
+            depth++;
+        }
+        merkle_init(&merkle);
+        for (uint32_t i = 1; i < count; i++) {
+            make_leaf(i, leaves[i]);
+            TEST_ASSERT_TRUE(merkle_add(&merkle, leaves[i]));
+        }
+        TEST_ASSERT_EQUAL_UINT32(count, merkle.count);
+        TEST_ASSERT_EQUAL_UINT32(depth, merkle_finish(&merkle));
+
+        // The branch must hold for any coinbase
+        for (int c = 0; c < 2; c++) {
+            memcpy(leaves[0], coinbases[c], 32);
+            for (uint32_t i = 1; i < count; i++) {
+                make_leaf(i, leaves[i]);
+            }
+            reference_root(count, expect);
+            merkle_root(&merkle, coinbases[c], root);
+            TEST_ASSERT_EQUAL_MEMORY(expect, root, 32);
+        }
+        if (count > 1) {
+            make_leaf(1, expect);
+            TEST_ASSERT_EQUAL_MEMORY(expect, merkle.branch[0], 32);
+        }
+    }
+}
+
+// Test the leaf limit
+void test_merkle_full(void)
+{
+    uint8_t leaf[32];
+
+    merkle_init(&merkle);
+    for (uint32_t i = 1; i < MERKLE_LEAVES_MAX; i++) {
+        make_leaf(i, leaf);
+        TEST_ASSERT_TRUE(merkle_add(&merkle, leaf));
+    }
+    TEST_ASSERT_FALSE(merkle_add(&merkle, leaf));
+    TEST_ASSERT_EQUAL_UINT32(MERKLE_LEAVES_MAX, merkle.count);
+    TEST_ASSERT_EQUAL_UINT32(MERKLE_DEPTH_MAX, merkle_finish(&merkle));
+}
+
+// Register tests with Unity
+void test_merkle_functions(void)
+{
+    RUN_TEST(test_merkle_branch);
+    RUN_TEST(test_merkle_full);
+}
@@ -0,0 +1,468 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Bitcoin genesis block header (block 0)
+static const uint8_t genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+#define GENESIS_NONCE       2083236893u
+
+typedef struct {
+    uint32_t calls;
+    uint32_t shares;
+    uint32_t blocks;
+    uint32_t block_nonce;
+    double block_difficulty;
+} share_log_t;
+
+// Share callbacks of one miner come from several threads
+static void record_share(miner_ctx_t *miner, const miner_share_t *share, void *arg)
+{
+    share_log_t *log = (share_log_t *)arg;
+    (void)miner;
+
+    __atomic_fetch_add(&log->calls, 1, __ATOMIC_RELAXED);
+    if (share->meets_share) {
+        __atomic_fetch_add(&log->shares, 1, __ATOMIC_RELAXED);
+    }
+    if (share->meets_block) {
+        __atomic_fetch_add(&log->blocks, 1, __ATOMIC_RELAXED);
+        log->block_nonce = share->nonce;
+        log->block_difficulty = share->difficulty;
+    }
+}
+
+// Test that a threaded miner finds the genesis nonce and counts every hash
+void test_miner_ctx_finds_genesis(void)
+{
+    static miner_ctx_t miner;
+    share_log_t log = { 0 };
+
+    miner_ctx_init(&miner, hash_backend_find("reject"), 3);
+    miner_ctx_set_share_callback(&miner, record_share, &log);
+    miner_ctx_set_job(&miner, genesis_header);
+    miner_ctx_set_range(&miner, GENESIS_NONCE - 3000, 6000, 256);
+
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    miner_ctx_wait(&miner);
+
+    TEST_ASSERT_FALSE(miner_ctx_running(&miner));
+    TEST_ASSERT_EQUAL_UINT64(6000, miner_ctx_collect(&miner));
+    TEST_ASSERT_EQUAL_UINT32(1, log.blocks);
+    TEST_ASSERT_EQUAL_UINT32(1, log.shares);
+    TEST_ASSERT_EQUAL_HEX32(GENESIS_NONCE, log.block_nonce);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 2536.4262984453103, log.block_difficulty);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 2536.4262984453103, miner.stats.best_difficulty);
+    TEST_ASSERT_GREATER_THAN(0u, log.calls);
+}
+
+// Test that the share rings carry what the callback sees, for the consumer to take
+void test_miner_ctx_share_ring(void)
+{
+    static miner_ctx_t miner;
+    share_log_t log = { 0 };
+    miner_share_t share;
+    uint32_t taken = 0;
+    uint32_t blocks = 0;
+
+    miner_ctx_init(&miner, hash_backend_find("reject"), 3);
+    miner_ctx_set_share_callback(&miner, record_share, &log);
+    miner_ctx_set_job(&miner, genesis_header);
+    miner_ctx_set_range(&miner, GENESIS_NONCE - 3000, 6000, 256);
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    miner_ctx_wait(&miner);
+
+    while (miner_ctx_take_share(&miner, &share)) {
+        TEST_ASSERT_TRUE(share.meets_share || share.new_best);
+        TEST_ASSERT_LESS_THAN(3, share.worker);
+        TEST_ASSERT_EQUAL_UINT32(miner_ctx_job(&miner)->id, share.job_id);
+        if (share.meets_block) {
+            TEST_ASSERT_EQUAL_HEX32(GENESIS_NONCE, share.nonce);
+            blocks++;
+        }
+        taken++;
+    }
+    miner_ctx_collect(&miner);
+    TEST_ASSERT_EQUAL_UINT32(1, blocks);
+    TEST_ASSERT_EQUAL_UINT32(log.calls, taken);
+    TEST_ASSERT_EQUAL_UINT32(taken, miner.stats.shares);
+    TEST_ASSERT_EQUAL_UINT32(0, miner.stats.shares_dropped);
+    TEST_ASSERT_FALSE(miner_ctx_take_share(&miner, &share));
+}
+
+// Test that every hash under the pool share target is reported exactly once
+void test_miner_ctx_share_target(void)
+{
+    static miner_ctx_t miner;
+    share_log_t log = { 0 };
+    uint8_t header[80];
+    uint8_t hash[32];
+    uint32_t expected = 0;
+
+    miner_ctx_init(&miner, hash_backend_find("reject"), 2);
+    miner_ctx_set_share_callback(&miner, record_share, &log);
+    // 2^-24 of difficulty 1: top word <= 0x00FFFF00, about one hash in 256
+    miner_ctx_set_share_difficulty(&miner, 1.0 / (1 << 24));
+    miner_ctx_set_job(&miner, genesis_header);
+    TEST_ASSERT_EQUAL_HEX32(0x00FFFF00, target_top_word(&miner_ctx_job(&miner)->share_target));
+    miner_ctx_set_range(&miner, 5000, 4000, 128);
+
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    miner_ctx_wait(&miner);
+
+    memcpy(header, genesis_header, sizeof(header));
+    for (uint32_t nonce = 5000; nonce < 9000; nonce++) {
+        header[76] = (uint8_t)nonce;
+        header[77] = (uint8_t)(nonce >> 8);
+        header[78] = 0;
+        header[79] = 0;
+        double_sha256(header, sizeof(header), hash);
+        expected += target_hash_meets(hash, &miner_ctx_job(&miner)->share_target);
+    }
+    TEST_ASSERT_GREATER_THAN(0u, expected);
+    TEST_ASSERT_EQUAL_UINT32(expected, log.shares);
+    TEST_ASSERT_EQUAL_UINT32(0, log.blocks);
+}
+
+// Test that each job gets a new id and fresh engine state
+void test_miner_ctx_set_job(void)
+{
+    static miner_ctx_t miner;
+    uint8_t header[80];
+
+    miner_ctx_init(&miner, hash_backend_get(0), 2);
+    miner_ctx_set_job(&miner, genesis_header);
+    TEST_ASSERT_EQUAL_UINT32(1, miner_ctx_job(&miner)->id);
+    TEST_ASSERT_EQUAL_UINT32(WORK_NTIME_ROLL_DEFAULT + 1, miner_ctx_job(&miner)->rolls);
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)miner_ctx_job(&miner)->rolls << 32,
+                             miner_sched_remaining(&miner_ctx_job(&miner)->sched));
+
+    memcpy(header, genesis_header, sizeof(header));
+    header[68] ^= 1;
+    miner_ctx_set_job(&miner, header);
+    TEST_ASSERT_EQUAL_UINT32(2, miner_ctx_job(&miner)->id);
+    TEST_ASSERT_NOT_EQUAL(0, memcmp(miner_ctx_job(&miner)->engine.words, genesis_header, 4));
+}
+
+typedef struct {
+    uint32_t shares;
+    uint32_t digest;
+} roll_log_t;
+
+// Order-independent fingerprint of a share's header variant and nonce
+static uint32_t roll_fingerprint(uint32_t version, uint32_t ntime, uint64_t extranonce2, uint32_t nonce)
+{
+    return (version * 2246822519u) ^ (ntime * 2654435761u) ^ ((uint32_t)extranonce2 * 40503u) ^ (nonce * 97u);
+}
+
+static void record_roll_share(miner_ctx_t *miner, const miner_share_t *share, void *arg)
+{
+    roll_log_t *log = (roll_log_t *)arg;
+    (void)miner;
+
+    if (share->meets_share) {
+        __atomic_fetch_add(&log->shares, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_xor(&log->digest, roll_fingerprint(share->version, share->ntime, share->extranonce2,
+                                                            share->nonce),
+                           __ATOMIC_RELAXED);
+    }
+}
+
+// Mine count positions from start of a small coinbase job; check every share
+static void check_rolled_shares(uint32_t version_mask, uint64_t start, uint32_t count, miner_ctx_t *miner)
+{
+    work_template_t work;
+    block_header_t fields;
+    roll_log_t log = { 0, 0 };
+    uint8_t coinbase[64];
+    uint8_t header[80];
+    uint8_t hash[32];
+    uint32_t expected_shares = 0;
+    uint32_t expected_digest = 0;
+
+    for (int i = 0; i < 64; i++) {
+        coinbase[i] = (uint8_t)(i * 5);
+    }
+    block_header_parse(genesis_header, &fields);
+    work_init(&work, &fields, 1);
+    work.version_mask = version_mask;
+    TEST_ASSERT_TRUE(work_set_coinbase(&work, coinbase, 30, coinbase + 30, 4, 2, coinbase + 36, 28));
+
+    miner_ctx_init(miner, hash_backend_find("reject"), 2);
+    miner_ctx_set_share_callback(miner, record_roll_share, &log);
+    miner_ctx_set_share_difficulty(miner, 1.0 / (1 << 28));
+    miner_ctx_set_work(miner, &work);
+    TEST_ASSERT_EQUAL_UINT32(version_rolling_count(version_mask) * 2 * 65536, miner_ctx_job(miner)->rolls);
+    miner_ctx_set_range(miner, start, count, 64);
+
+    TEST_ASSERT_TRUE(miner_ctx_start(miner));
+    miner_ctx_wait(miner);
+    TEST_ASSERT_EQUAL_UINT64(count, miner_ctx_collect(miner));
+
+    // Reference: serialize every variant and hash it with the generic path
+    for (uint64_t pos = start; pos < start + count; pos++) {
+        uint32_t roll_index = (uint32_t)(pos >> 32);
+        work_roll_t roll;
+
+        work_roll(&work, roll_index, &roll);
+        work_header(&work, roll_index, header);
+        block_header_write_le32(&header[76], (uint32_t)pos);
+        double_sha256(header, sizeof(header), hash);
+        if (target_hash_meets(hash, &miner_ctx_job(miner)->share_target)) {
+            expected_shares++;
+            expected_digest ^= roll_fingerprint(roll.version, roll.ntime, roll.extranonce2, (uint32_t)pos);
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0u, expected_shares);
+    TEST_ASSERT_EQUAL_UINT32(expected_shares, log.shares);
+    TEST_ASSERT_EQUAL_HEX32(expected_digest, log.digest);
+}
+
+// Test that workers continue across ntime rolls and extranonce2 bumps
+void test_miner_ctx_rolls(void)
+{
+    static miner_ctx_t miner;
+
+    // End of roll 1 (ntime + 1) and start of roll 2 (extranonce2 + 1)
+    check_rolled_shares(0, (2ull << 32) - 100, 200, &miner);
+    TEST_ASSERT_GREATER_THAN(0u, miner.stats.ntime_rolls);
+    TEST_ASSERT_GREATER_THAN(0u, miner.stats.extranonce_rolls);
+    TEST_ASSERT_EQUAL_UINT32(0, miner.stats.version_rolls);
+}
+
+// Test that version bits are rolled before ntime
+void test_miner_ctx_version_rolling(void)
+{
+    static miner_ctx_t miner;
+
+    // End of roll 0 and start of roll 1 (next version, same ntime)
+    check_rolled_shares(0x00006000, (1ull << 32) - 100, 200, &miner);
+    TEST_ASSERT_GREATER_THAN(0u, miner.stats.version_rolls);
+    TEST_ASSERT_EQUAL_UINT32(0, miner.stats.ntime_rolls);
+    TEST_ASSERT_EQUAL_UINT32(0, miner.stats.extranonce_rolls);
+}
+
+// Test that a stop request ends a job covering the whole nonce space
+void test_miner_ctx_stop(void)
+{
+    static miner_ctx_t miner;
+
+    miner_ctx_init(&miner, hash_backend_find("reject"), 2);
+    miner_ctx_set_job(&miner, genesis_header);
+
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    while (miner_ctx_collect(&miner) == 0) {
+    }
+    miner_ctx_stop(&miner);
+    miner_ctx_wait(&miner);
+
+    TEST_ASSERT_FALSE(miner_ctx_running(&miner));
+    TEST_ASSERT_GREATER_THAN(0ull, miner_sched_remaining(&miner_ctx_job(&miner)->sched));
+}
+
+// Test that two miners run side by side without sharing state
+void test_miner_ctx_reentrant(void)
+{
+    static miner_ctx_t a;
+    static miner_ctx_t b;
+    share_log_t log_a = { 0 };
+    share_log_t log_b = { 0 };
+    uint8_t other[80];
+
+    for (int i = 0; i < 80; i++) {
+        other[i] = (uint8_t)i;
+    }
+    miner_ctx_init(&a, hash_backend_find("reject"), 2);
+    miner_ctx_init(&b, hash_backend_find("x2"), 2);
+    miner_ctx_set_share_callback(&a, record_share, &log_a);
+    miner_ctx_set_share_callback(&b, record_share, &log_b);
+    miner_ctx_set_job(&a, genesis_header);
+    miner_ctx_set_job(&b, other);
+    miner_ctx_set_range(&a, GENESIS_NONCE - 100, 200, 32);
+    miner_ctx_set_range(&b, GENESIS_NONCE - 100, 200, 32);
+
+    TEST_ASSERT_TRUE(miner_ctx_start(&a));
+    TEST_ASSERT_TRUE(miner_ctx_start(&b));
+    miner_ctx_wait(&a);
+    miner_ctx_wait(&b);
+
+    TEST_ASSERT_EQUAL_UINT64(200, miner_ctx_collect(&a));
+    TEST_ASSERT_EQUAL_UINT64(200, miner_ctx_collect(&b));
+    TEST_ASSERT_EQUAL_UINT32(1, log_a.blocks);
+    TEST_ASSERT_EQUAL_UINT32(0, log_b.blocks);
+    TEST_ASSERT_TRUE(b.stats.best_difficulty < 1.0);
+}
+
+#define SWITCH_TIMEOUT_US   10000000
+
+typedef struct {
+    uint32_t shares;
+    uint32_t last_job;
+} job_log_t;
+
+static void record_job_share(miner_ctx_t *miner, const miner_share_t *share, void *arg)
+{
+    job_log_t *log = (job_log_t *)arg;
+
+    if (share->meets_share) {
+        // The job's slot is not rebuilt while its shares are reported
+        if (miner->jobs[share->job_slot].id == share->job_id) {
+            __atomic_fetch_add(&log->shares, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&log->last_job, share->job_id, __ATOMIC_RELAXED);
+    }
+}
+
+// Start a genesis job and wait until every worker is hashing it
+static void start_and_wait_hashing(miner_ctx_t *miner, job_log_t *log, uint32_t chunk)
+{
+    miner_ctx_init(miner, hash_backend_find("reject"), 2);
+    miner_ctx_set_share_callback(miner, record_job_share, log);
+    miner_ctx_set_share_difficulty(miner, 1.0 / (1 << 24));
+    miner_ctx_set_job(miner, genesis_header);
+    miner_ctx_set_range(miner, 0, 1ull << 40, chunk);
+    TEST_ASSERT_TRUE(miner_ctx_start(miner));
+    for (uint32_t i = 0; i < miner->worker_count; i++) {
+        while (__atomic_load_n(&miner->workers[i].counters.hashes, __ATOMIC_RELAXED) == 0) {
+            miner_yield();
+        }
+    }
+}
+
+// Build and publish a variant of the genesis job while the workers run
+static void publish_other_job(miner_ctx_t *miner, bool clean)
+{
+    block_header_t fields;
+    work_template_t work;
+    miner_job_t *job = miner_ctx_prepare(miner);
+
+    TEST_ASSERT_NOT_NULL(job);
+    TEST_ASSERT_TRUE(job != miner_ctx_job(miner));
+    block_header_parse(genesis_header, &fields);
+    fields.timestamp++;
+    work_init(&work, &fields, WORK_NTIME_ROLL_DEFAULT);
+    miner_ctx_build(miner, job, &work, 1.0 / (1 << 24));
+    miner_ctx_publish(miner, job, clean);
+    TEST_ASSERT_TRUE(job == miner_ctx_job(miner));
+}
+
+// Poll the counters until every worker has moved to the newest job
+static bool wait_switches(miner_ctx_t *miner)
+{
+    uint64_t deadline = miner_time_us() + SWITCH_TIMEOUT_US;
+
+    do {
+        miner_ctx_collect(miner);
+        miner_yield();
+    } while (miner->stats.job_switches < miner->worker_count && miner_time_us() < deadline);
+    return miner->stats.job_switches == miner->worker_count;
+}
+
+// Test replacing the job under running workers: they move at a chunk
+// boundary, report shares of the new job, and release the old slot
+void test_miner_ctx_publish(void)
+{
+    static miner_ctx_t miner;
+    job_log_t log = { 0, 0 };
+    uint64_t deadline;
+
+    start_and_wait_hashing(&miner, &log, 4096);
+    publish_other_job(&miner, false);
+    TEST_ASSERT_TRUE(wait_switches(&miner));
+    TEST_ASSERT_EQUAL_UINT32(0, miner.stats.clean_switch_us_max);
+
+    // Shares now come from job 2, and job 1's slot can be prepared again
+    deadline = miner_time_us() + SWITCH_TIMEOUT_US;
+    while (__atomic_load_n(&log.last_job, __ATOMIC_RELAXED) != 2 && miner_time_us() < deadline) {
+        miner_yield();
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, __atomic_load_n(&log.last_job, __ATOMIC_RELAXED));
+    TEST_ASSERT_NOT_NULL(miner_ctx_prepare(&miner));
+
+    miner_ctx_stop(&miner);
+    miner_ctx_wait(&miner);
+    TEST_ASSERT_GREATER_THAN(0u, log.shares);
+}
+
+// Test that a clean job aborts chunks in progress: with chunks far too
+// long to finish, the workers must still move within a scan batch
+void test_miner_ctx_clean_abort(void)
+{
+    static miner_ctx_t miner;
+    job_log_t log = { 0, 0 };
+
+    start_and_wait_hashing(&miner, &log, 0x80000000u);
+    publish_other_job(&miner, true);
+    TEST_ASSERT_TRUE(wait_switches(&miner));
+    TEST_ASSERT_TRUE(miner.stats.job_switch_us_max >= miner.stats.clean_switch_us_max);
+    TEST_ASSERT_TRUE(miner.stats.clean_switch_us_max < SWITCH_TIMEOUT_US);
+
+    miner_ctx_stop(&miner);
+    miner_ctx_wait(&miner);
+}
+
+// Poll until every worker's hash count has grown a few times over, or time
+// out. One step could be a scan the worker began before the check.
+static bool keeps_hashing(miner_ctx_t *miner)
+{
+    uint64_t deadline = miner_time_us() + SWITCH_TIMEOUT_US;
+
+    for (int round = 0; round < 3; round++) {
+        for (uint32_t i = 0; i < miner->worker_count; i++) {
+            uint32_t hashes = __atomic_load_n(&miner->workers[i].counters.hashes, __ATOMIC_RELAXED);
+
+            while (__atomic_load_n(&miner->workers[i].counters.hashes, __ATOMIC_RELAXED) == hashes) {
+                if (miner_time_us() >= deadline) {
+                    return false;
+                }
+                miner_yield();
+            }
+        }
+    }
+    return true;
+}
+
+// Test clean jobs published back to back: however a worker's job switch
+// interleaves with a publication, it must keep hashing the newest job
+void test_miner_ctx_clean_burst(void)
+{
+    static miner_ctx_t miner;
+    job_log_t log = { 0, 0 };
+
+    start_and_wait_hashing(&miner, &log, 4096);
+    for (int i = 0; i < 200; i++) {
+        // The spare slot frees up at the workers' next chunk
+        while (miner_ctx_prepare(&miner) == NULL) {
+            miner_yield();
+        }
+        publish_other_job(&miner, true);
+        if (i % 10 == 9) {
+            TEST_ASSERT_TRUE(keeps_hashing(&miner));
+        }
+    }
+
+    miner_ctx_stop(&miner);
+    miner_ctx_wait(&miner);
+}
+
+// Register tests with Unity
+void test_miner_ctx_functions(void)
+{
+    RUN_TEST(test_miner_ctx_finds_genesis);
+    RUN_TEST(test_miner_ctx_share_ring);
+    RUN_TEST(test_miner_ctx_share_target);
+    RUN_TEST(test_miner_ctx_set_job);
+    RUN_TEST(test_miner_ctx_rolls);
+    RUN_TEST(test_miner_ctx_version_rolling);
+    RUN_TEST(test_miner_ctx_stop);
+    RUN_TEST(test_miner_ctx_reentrant);
+    RUN_TEST(test_miner_ctx_publish);
+    RUN_TEST(test_miner_ctx_clean_abort);
+    RUN_TEST(test_miner_ctx_clean_burst);
+}
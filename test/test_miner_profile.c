@@ -0,0 +1,159 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+typedef struct {
+    uint32_t lines;
+    char last[160];
+} profile_test_dump_t;
+
+static void profile_test_print(const char *line, void *arg)
+{
+    profile_test_dump_t *dump = (profile_test_dump_t *)arg;
+
+    dump->lines++;
+    strncpy(dump->last, line, sizeof(dump->last) - 1);
+}
+
+// Test the power-of-two buckets and the stage names
+void test_miner_profile_buckets(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, miner_profile_bucket(0));
+    TEST_ASSERT_EQUAL_UINT32(0, miner_profile_bucket(1));
+    TEST_ASSERT_EQUAL_UINT32(1, miner_profile_bucket(2));
+    TEST_ASSERT_EQUAL_UINT32(1, miner_profile_bucket(3));
+    TEST_ASSERT_EQUAL_UINT32(10, miner_profile_bucket(1024));
+    TEST_ASSERT_EQUAL_UINT32(10, miner_profile_bucket(2047));
+    TEST_ASSERT_EQUAL_UINT32(MINER_PROFILE_BUCKETS - 2, miner_profile_bucket(1u << (MINER_PROFILE_BUCKETS - 2)));
+    TEST_ASSERT_EQUAL_UINT32(MINER_PROFILE_BUCKETS - 1, miner_profile_bucket(0xFFFFFFFFu));
+
+    TEST_ASSERT_EQUAL_STRING("scan", miner_profile_stage_name(MINER_STAGE_SCAN));
+    TEST_ASSERT_EQUAL_STRING("bookkeeping", miner_profile_stage_name(MINER_STAGE_BOOKKEEPING));
+    TEST_ASSERT_EQUAL_STRING("?", miner_profile_stage_name(MINER_STAGE_COUNT));
+}
+
+#if MINER_PROFILE
+
+// Registry index of a backend
+static size_t profile_test_index(const char *name)
+{
+    for (size_t i = 0; i < hash_backend_count(); i++) {
+        if (strcmp(hash_backend_get(i)->name, name) == 0) {
+            return i;
+        }
+    }
+    TEST_FAIL_MESSAGE("backend not found");
+    return 0;
+}
+
+// Test recording, reading and clearing one backend's histograms
+void test_miner_profile_record(void)
+{
+    size_t index = profile_test_index("reject");
+    miner_profile_stage_t stage;
+    profile_test_dump_t dump = { 0 };
+
+    miner_profile_reset();
+    MINER_PROFILE_BACKEND(hash_backend_get(index));
+    MINER_PROFILE_RECORD(MINER_STAGE_HEADER, 100, 1);
+    MINER_PROFILE_RECORD(MINER_STAGE_HEADER, 3000, 1);
+    MINER_PROFILE_RECORD(MINER_STAGE_HEADER, 120, 2);
+
+    TEST_ASSERT_TRUE(miner_profile_read(index, MINER_STAGE_HEADER, &stage));
+    TEST_ASSERT_EQUAL_UINT32(3, stage.calls);
+    TEST_ASSERT_EQUAL_UINT32(4, stage.items);
+    TEST_ASSERT_EQUAL_UINT64(3220, stage.cycles);
+    TEST_ASSERT_EQUAL_UINT32(3000, stage.max);
+    TEST_ASSERT_EQUAL_UINT32(2, stage.buckets[6]);
+    TEST_ASSERT_EQUAL_UINT32(1, stage.buckets[11]);
+    TEST_ASSERT_FALSE(miner_profile_read(HASH_BACKEND_MAX, MINER_STAGE_HEADER, &stage));
+
+    // A header line, then the one stage: 805.0 cycles per item
+    miner_profile_dump(profile_test_print, &dump);
+    TEST_ASSERT_EQUAL_UINT32(2, dump.lines);
+    TEST_ASSERT_EQUAL_STRING("  header 3 4 805.0 3000 | 6:2 11:1", dump.last);
+
+    // Backends outside the registry are not profiled
+    static const hash_backend_t stray = { 0 };
+    MINER_PROFILE_BACKEND(&stray);
+    MINER_PROFILE_RECORD(MINER_STAGE_HEADER, 100, 1);
+    TEST_ASSERT_TRUE(miner_profile_read(index, MINER_STAGE_HEADER, &stage));
+    TEST_ASSERT_EQUAL_UINT32(3, stage.calls);
+
+    // The cycle sum carries into its high word
+    MINER_PROFILE_BACKEND(hash_backend_get(index));
+    MINER_PROFILE_RECORD(MINER_STAGE_SCAN, 0xFFFFFFF0u, 1);
+    MINER_PROFILE_RECORD(MINER_STAGE_SCAN, 0xFFFFFFF0u, 1);
+    TEST_ASSERT_TRUE(miner_profile_read(index, MINER_STAGE_SCAN, &stage));
+    TEST_ASSERT_EQUAL_UINT64(0x1FFFFFFE0ull, stage.cycles);
+
+    miner_profile_reset();
+    TEST_ASSERT_TRUE(miner_profile_read(index, MINER_STAGE_HEADER, &stage));
+    TEST_ASSERT_EQUAL_UINT32(0, stage.calls);
+    TEST_ASSERT_EQUAL_UINT32(0, stage.max);
+    TEST_ASSERT_TRUE(miner_profile_read(index, MINER_STAGE_SCAN, &stage));
+    TEST_ASSERT_EQUAL_UINT64(0, stage.cycles);
+}
+
+// Test that a threaded miner feeds every stage of its backend
+void test_miner_profile_miner(void)
+{
+    static miner_ctx_t miner;
+    size_t index = profile_test_index("reject");
+    miner_profile_stage_t scan, block2, digest, bookkeeping;
+    uint8_t header[80];
+
+    memset(header, 0x3C, sizeof(header));
+    miner_profile_reset();
+    miner_ctx_init(&miner, hash_backend_get(index), 2);
+    miner_ctx_set_job(&miner, header);
+    miner_ctx_set_range(&miner, 0, 4096, 256);
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    miner_ctx_wait(&miner);
+
+    miner_profile_read(index, MINER_STAGE_SCAN, &scan);
+    miner_profile_read(index, MINER_STAGE_BLOCK2, &block2);
+    miner_profile_read(index, MINER_STAGE_DIGEST, &digest);
+    miner_profile_read(index, MINER_STAGE_BOOKKEEPING, &bookkeeping);
+    TEST_ASSERT_EQUAL_UINT32(4096, scan.items);
+    TEST_ASSERT_GREATER_OR_EQUAL(4096 / MINER_WORKER_CHUNK, scan.calls);
+    // Every nonce, plus the candidate re-hashes
+    TEST_ASSERT_GREATER_OR_EQUAL(4096, block2.items);
+    TEST_ASSERT_EQUAL_UINT32(block2.items, digest.items);
+    // One per chunk; stealing can split some
+    TEST_ASSERT_GREATER_OR_EQUAL(4096 / 256, bookkeeping.calls);
+    TEST_ASSERT_GREATER_THAN(0, scan.cycles);
+    TEST_ASSERT_GREATER_OR_EQUAL((uint32_t)(scan.cycles / scan.calls), scan.max);
+}
+
+#else
+
+// Test that nothing is recorded without MINER_PROFILE
+void test_miner_profile_disabled(void)
+{
+    miner_profile_stage_t stage;
+    profile_test_dump_t dump = { 0 };
+
+    MINER_PROFILE_BACKEND(hash_backend_get(0));
+    MINER_PROFILE_RECORD(MINER_STAGE_SCAN, 100, 1);
+    TEST_ASSERT_FALSE(miner_profile_read(0, MINER_STAGE_SCAN, &stage));
+    TEST_ASSERT_EQUAL_UINT32(0, stage.calls);
+
+    miner_profile_dump(profile_test_print, &dump);
+    TEST_ASSERT_EQUAL_UINT32(1, dump.lines);
+    TEST_ASSERT_EQUAL_STRING("profile: not built in (MINER_PROFILE=1)", dump.last);
+}
+
+#endif // MINER_PROFILE
+
+// Register tests with Unity
+void test_miner_profile_functions(void)
+{
+    RUN_TEST(test_miner_profile_buckets);
+#if MINER_PROFILE
+    RUN_TEST(test_miner_profile_record);
+    RUN_TEST(test_miner_profile_miner);
+#else
+    RUN_TEST(test_miner_profile_disabled);
+#endif
+}
@@ -0,0 +1,214 @@
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+#define RATES_TEST_UPDATES  200000
+
+// A fixed-point value as a double
+static double rates_test_fixed(uint64_t value)
+{
+    return (double)value / (1u << MINER_RATE_SHIFT);
+}
+
+// Test the decay factors against exp()
+void test_miner_rates_decay(void)
+{
+    static const uint64_t dts_us[] = { 1, 999, 100000, 2000000, 10000000, 37500000, 59999999, 250000000 };
+
+    TEST_ASSERT_EQUAL_UINT64(MINER_DECAY_ONE, miner_ewma_decay(0, 10));
+    for (size_t i = 0; i < sizeof(dts_us) / sizeof(dts_us[0]); i++) {
+        for (int w = 0; w < MINER_RATE_WINDOWS; w++) {
+            uint32_t window_s = miner_rate_window_s((miner_rate_window_t)w);
+            double expected = exp(-(double)dts_us[i] / (window_s * 1e6));
+            double decay = (double)miner_ewma_decay(dts_us[i], window_s) / MINER_DECAY_ONE;
+
+            // The exponent is rounded to 2^-24: a relative error of 2^-25
+            TEST_ASSERT_DOUBLE_WITHIN(expected * 1e-7 + 1e-9, expected, decay);
+        }
+    }
+    // Past 32 windows nothing of the old average is left
+    TEST_ASSERT_EQUAL_UINT64(0, miner_ewma_decay(320000000, 10));
+    TEST_ASSERT_EQUAL_UINT64(0, miner_ewma_decay(5000, 0));
+
+    // Decaying twice over dt is decaying once over 2 dt (up to the rounding
+    // of each exponent)
+    uint64_t half = miner_ewma_decay(5000000, 60);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-7, (double)miner_ewma_decay(10000000, 60) / MINER_DECAY_ONE,
+                              (double)half * half / MINER_DECAY_ONE / MINER_DECAY_ONE);
+}
+
+// Test rates from counts and intervals
+void test_miner_rates_fixed(void)
+{
+    TEST_ASSERT_EQUAL_UINT64(0, miner_rate_fixed(1000, 0));
+    TEST_ASSERT_EQUAL_UINT64(1000ull << MINER_RATE_SHIFT, miner_rate_fixed(2000, 2000000));
+    TEST_ASSERT_EQUAL_UINT64(3ull << (MINER_RATE_SHIFT - 1), miner_rate_fixed(3, 2000000));
+
+    // 50 MH/s for a day, and 10 GH over 100 ms
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 50e6, rates_test_fixed(miner_rate_fixed(4320000000000ull, 86400000000ull)));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 1e11, rates_test_fixed(miner_rate_fixed(10000000000ull, 100000)));
+
+    TEST_ASSERT_EQUAL_UINT64(12345, miner_rate_tenths(miner_rate_fixed(12345, 10000000)));
+    TEST_ASSERT_EQUAL_UINT64(15, miner_rate_tenths(3ull << (MINER_RATE_SHIFT - 1)));
+}
+
+// Test that the moving averages follow a step like a first-order filter,
+// whatever the update interval
+void test_miner_rates_ewma(void)
+{
+    uint64_t steady = 1000ull << MINER_RATE_SHIFT;
+    uint64_t average = 0;
+    uint64_t coarse = 0;
+
+    // A constant rate stays put
+    TEST_ASSERT_EQUAL_UINT64(steady, miner_ewma(steady, steady, miner_ewma_decay(2000000, 10)));
+    TEST_ASSERT_EQUAL_UINT64(steady, miner_ewma(0, steady, 0));
+    TEST_ASSERT_EQUAL_UINT64(steady, miner_ewma(steady, 0, MINER_DECAY_ONE));
+
+    // One window after a step from 0: 1 - 1/e of the way
+    for (int i = 0; i < 100; i++) {
+        average = miner_ewma(average, steady, miner_ewma_decay(100000, 10));
+    }
+    for (int i = 0; i < 4; i++) {
+        coarse = miner_ewma(coarse, steady, miner_ewma_decay(2500000, 10));
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 1000 * (1 - exp(-1)), rates_test_fixed(average));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, rates_test_fixed(average), rates_test_fixed(coarse));
+}
+
+// Test the estimates over workers with known totals
+void test_miner_rates_update(void)
+{
+    static miner_worker_t workers[3];
+    static miner_rates_t rates;
+
+    for (uint32_t i = 0; i < 3; i++) {
+        miner_worker_init(&workers[i], i);
+        workers[i].job_id = 1;
+    }
+    miner_worker_add_totals(&workers[0], 500, 1000);
+    miner_rates_init(&rates, workers, 3, 1000000);
+    TEST_ASSERT_EQUAL_UINT64(500, rates.total_hashes);
+    TEST_ASSERT_FALSE(rates.primed);
+
+    // Nothing happens without time passing
+    miner_rates_update(&rates, workers, 3, 1000000);
+    TEST_ASSERT_FALSE(rates.primed);
+
+    // 2 s: 4000 + 2000 hashes, 500 and 1000.5 cycles per hash; the first
+    // interval seeds every average
+    miner_worker_add_totals(&workers[0], 4000, 2000000);
+    miner_worker_add_totals(&workers[1], 2000, 2001000);
+    miner_rates_update(&rates, workers, 3, 3000000);
+    TEST_ASSERT_TRUE(rates.primed);
+    TEST_ASSERT_EQUAL_UINT64(3000ull << MINER_RATE_SHIFT, rates.rate);
+    TEST_ASSERT_EQUAL_UINT64(2000ull << MINER_RATE_SHIFT, rates.worker_rate[0]);
+    TEST_ASSERT_EQUAL_UINT64(1000ull << MINER_RATE_SHIFT, rates.worker_rate[1]);
+    TEST_ASSERT_EQUAL_UINT64(0, rates.worker_rate[2]);
+    TEST_ASSERT_EQUAL_UINT32(500u << MINER_RATE_SHIFT, rates.cycles_per_hash[0]);
+    TEST_ASSERT_EQUAL_UINT32(1000u << MINER_RATE_SHIFT | 1u << (MINER_RATE_SHIFT - 1), rates.cycles_per_hash[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, rates.cycles_per_hash[2]);
+    for (int w = 0; w < MINER_RATE_WINDOWS; w++) {
+        TEST_ASSERT_EQUAL_UINT64(rates.rate, rates.average[w]);
+    }
+    TEST_ASSERT_EQUAL_UINT64(6500, rates.total_hashes);
+    TEST_ASSERT_EQUAL_UINT32(1, rates.job_id);
+    TEST_ASSERT_EQUAL_UINT64(6500, rates.job_hashes);
+
+    // Worker 1 moves to job 2: the job count restarts with its hashes, and
+    // the 10 s average reacts faster than the 15 min one
+    workers[1].job_id = 2;
+    miner_worker_add_totals(&workers[1], 12000, 0);
+    miner_worker_add_totals(&workers[0], 8000, 0);
+    miner_rates_update(&rates, workers, 3, 5000000);
+    TEST_ASSERT_EQUAL_UINT64(10000ull << MINER_RATE_SHIFT, rates.rate);
+    TEST_ASSERT_EQUAL_UINT32(0, rates.cycles_per_hash[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, rates.job_id);
+    TEST_ASSERT_EQUAL_UINT64(12000, rates.job_hashes);
+    TEST_ASSERT_EQUAL_UINT64(26500, rates.total_hashes);
+    TEST_ASSERT_DOUBLE_WITHIN(0.5, 10000 - 7000 * exp(-0.2), rates_test_fixed(rates.average[MINER_RATE_10S]));
+    TEST_ASSERT_DOUBLE_WITHIN(0.5, 10000 - 7000 * exp(-2.0 / 60), rates_test_fixed(rates.average[MINER_RATE_1MIN]));
+    TEST_ASSERT_DOUBLE_WITHIN(0.5, 10000 - 7000 * exp(-2.0 / 900), rates_test_fixed(rates.average[MINER_RATE_15MIN]));
+}
+
+// Test that scans feed the totals, and that the totals pass 2^32
+void test_miner_rates_totals(void)
+{
+    const hash_backend_t *backend = hash_backend_find("reject");
+    static miner_worker_t worker;
+    miner_totals_snapshot_t snapshot;
+    sha256d_ctx_t engine;
+    uint8_t header[80];
+    uint32_t mask;
+
+    memset(header, 0x5A, sizeof(header));
+    sha256d_init(&engine, header);
+    miner_worker_init(&worker, 0);
+    TEST_ASSERT_EQUAL_size_t(MINER_CACHE_LINE, sizeof(miner_totals_t));
+    TEST_ASSERT_EQUAL_size_t(0, (uintptr_t)&worker.totals % MINER_CACHE_LINE);
+
+    miner_worker_load(&worker, 4, &engine);
+    miner_worker_scan(&worker, backend, 0, MINER_WORKER_CHUNK, 0, &mask);
+    miner_worker_scan(&worker, backend, MINER_WORKER_CHUNK, 5, 0, &mask);
+    miner_worker_totals(&worker, &snapshot);
+    TEST_ASSERT_EQUAL_UINT32(4, snapshot.job_id);
+    TEST_ASSERT_EQUAL_UINT64(MINER_WORKER_CHUNK + 5, snapshot.hashes);
+    TEST_ASSERT_EQUAL_UINT64(MINER_WORKER_CHUNK + 5, snapshot.job_hashes);
+    TEST_ASSERT_GREATER_THAN(0, snapshot.cycles);
+
+    for (int i = 0; i < 3; i++) {
+        miner_worker_add_totals(&worker, 0xF0000000u, 0xFFFFFFFFu);
+    }
+    miner_worker_totals(&worker, &snapshot);
+    TEST_ASSERT_EQUAL_UINT64(3 * 0xF0000000ull + MINER_WORKER_CHUNK + 5, snapshot.hashes);
+    TEST_ASSERT_EQUAL_UINT64(snapshot.hashes, snapshot.job_hashes);
+    TEST_ASSERT_GREATER_OR_EQUAL(3 * 0xFFFFFFFFull, snapshot.cycles);
+}
+
+// Writer thread: every update adds one hash and three cycles, and changes
+// job every 1000 updates
+static void rates_test_writer(void *arg)
+{
+    miner_worker_t *worker = (miner_worker_t *)arg;
+
+    for (uint32_t i = 0; i < RATES_TEST_UPDATES; i++) {
+        worker->job_id = i / 1000;
+        miner_worker_add_totals(worker, 1, 3);
+    }
+}
+
+// Test that snapshots taken while the worker writes are never torn
+void test_miner_rates_seqlock(void)
+{
+    static miner_worker_t worker;
+    miner_totals_snapshot_t snapshot;
+    miner_thread_t thread;
+    uint64_t last = 0;
+
+    miner_worker_init(&worker, 0);
+    TEST_ASSERT_TRUE(miner_thread_start(&thread, rates_test_writer, &worker, "rates_test", 1));
+    do {
+        miner_worker_totals(&worker, &snapshot);
+        if (snapshot.hashes == 0) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT64(3 * snapshot.hashes, snapshot.cycles);
+        TEST_ASSERT_GREATER_OR_EQUAL(last, snapshot.hashes);
+        TEST_ASSERT_EQUAL_UINT32((snapshot.hashes - 1) / 1000, snapshot.job_id);
+        TEST_ASSERT_EQUAL_UINT64((snapshot.hashes - 1) % 1000 + 1, snapshot.job_hashes);
+        last = snapshot.hashes;
+    } while (snapshot.hashes < RATES_TEST_UPDATES);
+    miner_thread_join(&thread);
+}
+
+// Register tests with Unity
+void test_miner_rates_functions(void)
+{
+    RUN_TEST(test_miner_rates_decay);
+    RUN_TEST(test_miner_rates_fixed);
+    RUN_TEST(test_miner_rates_ewma);
+    RUN_TEST(test_miner_rates_update);
+    RUN_TEST(test_miner_rates_totals);
+    RUN_TEST(test_miner_rates_seqlock);
+}
@@ -0,0 +1,181 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+#define SCHED_TEST_NONCES   20000
+
+// Test that shares are contiguous, disjoint and cover the range
+void test_miner_partition_covers_range(void)
+{
+    const uint64_t sizes[] = { 1ull << 32, 1000, 7 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (uint32_t workers = 1; workers <= 5; workers++) {
+            uint64_t next = 0;
+            for (uint32_t i = 0; i < workers; i++) {
+                uint64_t offset;
+                uint64_t size;
+                miner_partition(sizes[s], i, workers, &offset, &size);
+                TEST_ASSERT_EQUAL_UINT64(next, offset);
+                next += size;
+            }
+            TEST_ASSERT_EQUAL_UINT64(sizes[s], next);
+        }
+    }
+}
+
+// Test that a single worker walks its range in chunks and then stops
+void test_miner_sched_single_worker(void)
+{
+    miner_sched_t sched;
+    uint64_t pos;
+    uint32_t count;
+
+    miner_sched_init(&sched);
+    miner_sched_reset(&sched, 1, 100, 0xFFFFFF00, 0x100);
+
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF00, pos);
+    TEST_ASSERT_EQUAL_UINT32(100, count);
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFC8, pos);
+    TEST_ASSERT_EQUAL_UINT32(56, count);
+    TEST_ASSERT_FALSE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT64(0, miner_sched_remaining(&sched));
+    TEST_ASSERT_EQUAL_UINT32(0, sched.steals);
+}
+
+// Test that chunks end at roll boundaries and continue in the next roll
+void test_miner_sched_roll_boundary(void)
+{
+    miner_sched_t sched;
+    uint64_t pos;
+    uint32_t count;
+
+    miner_sched_init(&sched);
+    miner_sched_reset(&sched, 1, 100, 0xFFFFFFC0, 0x80);
+
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFFFFC0, pos);
+    TEST_ASSERT_EQUAL_UINT32(64, count);
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_HEX64(1ull << 32, pos);
+    TEST_ASSERT_EQUAL_UINT32(64, count);
+    TEST_ASSERT_FALSE(miner_sched_next(&sched, 0, &pos, &count));
+}
+
+// Test that an idle worker steals the back half of the largest range
+void test_miner_sched_steal(void)
+{
+    miner_sched_t sched;
+    uint64_t pos;
+    uint32_t count;
+
+    miner_sched_init(&sched);
+    miner_sched_reset(&sched, 2, 10, 0, 200);
+
+    // Worker 1 drains its half [100, 200)
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(miner_sched_next(&sched, 1, &pos, &count));
+    }
+    // Worker 0 took one chunk; 90 left in [10, 100)
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT32(0, pos);
+
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 1, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT32(55, pos);
+    TEST_ASSERT_EQUAL_UINT32(10, count);
+    TEST_ASSERT_EQUAL_UINT32(1, sched.steals);
+    TEST_ASSERT_EQUAL_UINT64(80, miner_sched_remaining(&sched));
+
+    // Worker 1 continues in the stolen range, worker 0 keeps [10, 55)
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 1, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT32(65, pos);
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT32(10, pos);
+}
+
+// Test that the last partial chunk of a victim is stolen whole
+void test_miner_sched_steal_remainder(void)
+{
+    miner_sched_t sched;
+    uint64_t pos;
+    uint32_t count;
+
+    miner_sched_init(&sched);
+    miner_sched_reset(&sched, 2, 10, 0, 16);
+
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT32(8, count);
+    TEST_ASSERT_TRUE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_EQUAL_UINT32(8, pos);
+    TEST_ASSERT_EQUAL_UINT32(8, count);
+    TEST_ASSERT_FALSE(miner_sched_next(&sched, 0, &pos, &count));
+    TEST_ASSERT_FALSE(miner_sched_next(&sched, 1, &pos, &count));
+}
+
+typedef struct {
+    miner_sched_t *sched;
+    uint32_t worker;
+    uint8_t *seen;
+    uint32_t duplicates;
+} sched_thread_arg_t;
+
+static void sched_thread(void *param)
+{
+    sched_thread_arg_t *arg = (sched_thread_arg_t *)param;
+    uint64_t pos;
+    uint32_t count;
+
+    while (miner_sched_next(arg->sched, arg->worker, &pos, &count)) {
+        for (uint32_t i = 0; i < count; i++) {
+            // Each nonce has one owner, so plain byte writes do not race
+            if (arg->seen[pos + i]++ != 0) {
+                arg->duplicates++;
+            }
+        }
+        // Make worker 0 slow so the others have to steal from it
+        if (arg->worker == 0) {
+            for (volatile int spin = 0; spin < 20000; spin++) {
+            }
+        }
+    }
+}
+
+// Test that concurrent workers hand out every nonce exactly once
+void test_miner_sched_threads_cover_range(void)
+{
+    static uint8_t seen[SCHED_TEST_NONCES];
+    static miner_sched_t sched;
+    miner_thread_t threads[4];
+    sched_thread_arg_t args[4];
+
+    memset(seen, 0, sizeof(seen));
+    miner_sched_init(&sched);
+    miner_sched_reset(&sched, 4, 64, 0, SCHED_TEST_NONCES);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        args[i] = (sched_thread_arg_t){ &sched, i, seen, 0 };
+        TEST_ASSERT_TRUE(miner_thread_start(&threads[i], sched_thread, &args[i], "sched_test", i));
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        miner_thread_join(&threads[i]);
+        TEST_ASSERT_EQUAL_UINT32(0, args[i].duplicates);
+    }
+    for (uint32_t n = 0; n < SCHED_TEST_NONCES; n++) {
+        TEST_ASSERT_EQUAL_UINT8(1, seen[n]);
+    }
+    TEST_ASSERT_GREATER_THAN(0u, sched.steals);
+}
+
+// Register tests with Unity
+void test_miner_sched_functions(void)
+{
+    RUN_TEST(test_miner_partition_covers_range);
+    RUN_TEST(test_miner_sched_single_worker);
+    RUN_TEST(test_miner_sched_roll_boundary);
+    RUN_TEST(test_miner_sched_steal);
+    RUN_TEST(test_miner_sched_steal_remainder);
+    RUN_TEST(test_miner_sched_threads_cover_range);
+}
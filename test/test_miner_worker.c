@@ -0,0 +1,153 @@
+#include <stddef.h>
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+static void worker_test_engine(sha256d_ctx_t *engine)
+{
+    uint8_t header[80];
+
+    for (int i = 0; i < 80; i++) {
+        header[i] = (uint8_t)(i * 3 + 17);
+    }
+    sha256d_init(engine, header);
+}
+
+// Test that counters sit alone in their cache line
+void test_miner_worker_counter_layout(void)
+{
+    miner_worker_t workers[2];
+
+    TEST_ASSERT_EQUAL_size_t(MINER_CACHE_LINE, sizeof(miner_counters_t));
+    TEST_ASSERT_EQUAL_size_t(0, sizeof(miner_worker_t) % MINER_CACHE_LINE);
+    TEST_ASSERT_EQUAL_size_t(0, offsetof(miner_worker_t, counters));
+    TEST_ASSERT_EQUAL_size_t(0, (uintptr_t)&workers[1].counters % MINER_CACHE_LINE);
+}
+
+// Test that each worker takes a private copy of the job's engine state
+void test_miner_worker_load(void)
+{
+    miner_worker_t workers[2];
+    sha256d_ctx_t engine;
+
+    worker_test_engine(&engine);
+    miner_worker_init(&workers[0], 0);
+    miner_worker_init(&workers[1], 1);
+    miner_worker_load(&workers[0], 7, &engine);
+    miner_worker_load(&workers[1], 7, &engine);
+
+    TEST_ASSERT_EQUAL_UINT32(1, workers[1].id);
+    TEST_ASSERT_EQUAL_UINT32(7, workers[1].job_id);
+    TEST_ASSERT_EQUAL_MEMORY(&engine, &workers[1].ctx, sizeof(engine));
+
+    sha256d_set_nonce(&workers[0].ctx, 0x12345678);
+    TEST_ASSERT_EQUAL_HEX32(engine.words[SHA256D_NONCE_WORD], workers[1].ctx.words[SHA256D_NONCE_WORD]);
+}
+
+// Test that scanning counts hashes and matches the scalar kernel
+void test_miner_worker_scan(void)
+{
+    const hash_backend_t *backend = hash_backend_find("reject");
+    miner_worker_t worker;
+    sha256d_ctx_t engine;
+    uint8_t hash[32];
+    uint32_t mask;
+    uint32_t expected = 0;
+
+    worker_test_engine(&engine);
+    miner_worker_init(&worker, 0);
+    miner_worker_load(&worker, 1, &engine);
+
+    uint32_t candidates = miner_worker_scan(&worker, backend, 0xC0000000, MINER_WORKER_CHUNK, 0x0FFFFFFF, &mask);
+    TEST_ASSERT_EQUAL_UINT32(MINER_WORKER_CHUNK, worker.counters.hashes);
+    for (uint32_t i = 0; i < MINER_WORKER_CHUNK; i++) {
+        if (sha256d_check_nonce(&engine, 0xC0000000 + i, 0x0FFFFFFF, hash)) {
+            expected |= 1u << i;
+        }
+    }
+    TEST_ASSERT_EQUAL_HEX32(expected, mask);
+    TEST_ASSERT_EQUAL_UINT32(__builtin_popcount(expected), candidates);
+
+    miner_worker_scan(&worker, backend, 0, 5, 0, &mask);
+    TEST_ASSERT_EQUAL_UINT32(MINER_WORKER_CHUNK + 5, worker.counters.hashes);
+}
+
+// Digest whose top word (bytes 28-31) is top and lower words are all ones
+static void worker_test_hash(uint32_t top, uint8_t *hash)
+{
+    memset(hash, 0xFF, 28);
+    hash[28] = (uint8_t)top;
+    hash[29] = (uint8_t)(top >> 8);
+    hash[30] = (uint8_t)(top >> 16);
+    hash[31] = (uint8_t)(top >> 24);
+}
+
+// Test that best shares are compared as 256-bit values
+void test_miner_worker_offer_best(void)
+{
+    miner_worker_t worker;
+    uint8_t hash[32];
+
+    miner_worker_init(&worker, 0);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, miner_worker_best_top_word(&worker));
+    TEST_ASSERT_TRUE(miner_worker_best(&worker) == 0.0);
+
+    worker_test_hash(0x00012345, hash);
+    TEST_ASSERT_TRUE(miner_worker_offer_best(&worker, hash));
+    TEST_ASSERT_EQUAL_HEX32(0x00012345, miner_worker_best_top_word(&worker));
+    TEST_ASSERT_FALSE(miner_worker_offer_best(&worker, hash));
+
+    // Same top word, lower in a later word
+    hash[0] = 0x00;
+    hash[27] = 0xFE;
+    TEST_ASSERT_TRUE(miner_worker_offer_best(&worker, hash));
+    hash[27] = 0xFF;
+    TEST_ASSERT_FALSE(miner_worker_offer_best(&worker, hash));
+
+    hash[27] = 0xFE;
+    TEST_ASSERT_TRUE(miner_worker_best(&worker) == (float)target_hash_difficulty(hash));
+}
+
+// Test merging counters across workers, including counter wrap
+void test_miner_stats_collect(void)
+{
+    miner_worker_t workers[3];
+    miner_stats_reader_t reader;
+    uint8_t hash[32];
+
+    for (uint32_t i = 0; i < 3; i++) {
+        miner_worker_init(&workers[i], i);
+    }
+    workers[2].counters.hashes = 0xFFFFFFF0;
+    miner_stats_reset(&reader, workers, 3);
+
+    workers[0].counters.hashes += 100;
+    workers[1].counters.hashes += 200;
+    workers[2].counters.hashes += 0x20;
+    worker_test_hash(0x00001000, hash);
+    miner_worker_offer_best(&workers[1], hash);
+    worker_test_hash(0x00080000, hash);
+    miner_worker_offer_best(&workers[2], hash);
+    worker_test_hash(0x00400000, hash);
+    miner_worker_offer_best(&workers[2], hash);
+
+    TEST_ASSERT_EQUAL_UINT64(332, miner_stats_collect(&reader, workers, 3));
+    TEST_ASSERT_EQUAL_UINT64(332, reader.total_hashes);
+    TEST_ASSERT_TRUE(reader.best_difficulty == miner_worker_best(&workers[1]));
+    TEST_ASSERT_EQUAL_HEX32(0x00080000, miner_worker_best_top_word(&workers[2]));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-8, 0.00024407731, reader.best_difficulty);
+
+    workers[0].counters.hashes += 8;
+    TEST_ASSERT_EQUAL_UINT64(8, miner_stats_collect(&reader, workers, 3));
+    TEST_ASSERT_EQUAL_UINT64(340, reader.total_hashes);
+}
+
+// Register tests with Unity
+void test_miner_worker_functions(void)
+{
+    RUN_TEST(test_miner_worker_counter_layout);
+    RUN_TEST(test_miner_worker_load);
+    RUN_TEST(test_miner_worker_scan);
+    RUN_TEST(test_miner_worker_offer_best);
+    RUN_TEST(test_miner_stats_collect);
+}
@@ -1,12 +1,6 @@
 #include <string.h>
 #include "unity.h"
-#include "mbedtls/md.h"
-
-// Forward declarations of functions from main.c that we want to test
-// These should ideally be in a header file
-extern void double_sha256(const uint8_t* data, size_t len, uint8_t* hash);
-extern uint32_t count_leading_zeros(const uint8_t* hash);
-extern void init_block_header(void);
+#include "mining/miner_core.h"
 
 // Test fixtures
 static uint8_t test_hash[32];
@@ -69,6 +63,71 @@ void test_double_sha256_deterministic(void)
     TEST_ASSERT_EQUAL_MEMORY(hash1, hash2, 32);
 }
 
+// Test SHA-256 against the FIPS 180-4 "abc" example
+void test_sha256_abc(void)
+{
+    static const uint8_t expected[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    uint8_t hash[32];
+
+    sha256("abc", 3, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+}
+
+// Test SHA-256 of the empty message
+void test_sha256_empty(void)
+{
+    static const uint8_t expected[32] = {
+        0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+        0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55
+    };
+    uint8_t hash[32];
+
+    sha256("", 0, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+}
+
+// Test that streaming in odd-sized pieces matches the one-shot hash
+void test_sha256_update_streaming(void)
+{
+    uint8_t data[200];
+    uint8_t expected[32];
+    uint8_t hash[32];
+    sha256_ctx_t ctx;
+
+    for (int i = 0; i < (int)sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+    sha256(data, sizeof(data), expected);
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, 1);
+    sha256_update(&ctx, data + 1, 62);
+    sha256_update(&ctx, data + 63, 65);
+    sha256_update(&ctx, data + 128, 72);
+    sha256_final(&ctx, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+}
+
+// Test double_sha256 against the known SHA256d("hello") value
+void test_double_sha256_hello(void)
+{
+    static const uint8_t expected[32] = {
+        0x95, 0x95, 0xc9, 0xdf, 0x90, 0x07, 0x51, 0x48, 0xeb, 0x06, 0x86, 0x03, 0x65, 0xdf, 0x33, 0x58,
+        0x4b, 0x75, 0xbf, 0xf7, 0x82, 0xa5, 0x10, 0xc6, 0xcd, 0x48, 0x83, 0xa4, 0x19, 0x83, 0x3d, 0x50
+    };
+    uint8_t hash[32];
+
+    double_sha256((const uint8_t*)"hello", 5, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+}
+
 // Test count_leading_zeros with all zeros
 void test_count_leading_zeros_all_zeros(void)
 {
@@ -136,6 +195,10 @@ void test_mining_functions(void)
     RUN_TEST(test_double_sha256_basic);
     RUN_TEST(test_double_sha256_empty);
     RUN_TEST(test_double_sha256_deterministic);
+    RUN_TEST(test_sha256_abc);
+    RUN_TEST(test_sha256_empty);
+    RUN_TEST(test_sha256_update_streaming);
+    RUN_TEST(test_double_sha256_hello);
     RUN_TEST(test_count_leading_zeros_all_zeros);
     RUN_TEST(test_count_leading_zeros_none);
     RUN_TEST(test_count_leading_zeros_one_byte);
@@ -0,0 +1,298 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/sha256.h"
+#include "mining/sha256d.h"
+
+// Bitcoin genesis block header (block 0)
+static const uint8_t genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+// Genesis block hash in digest byte order (displayed reversed as 000000000019d6...)
+static const uint8_t genesis_hash[32] = {
+    0x6f, 0xe2, 0x8c, 0x0a, 0xb6, 0xf1, 0xb3, 0x72, 0xc1, 0xa6, 0xa2, 0x46, 0xae, 0x63, 0xf7, 0x4f,
+    0x93, 0x1e, 0x83, 0x65, 0xe1, 0x5a, 0x08, 0x9c, 0x68, 0xd6, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// Test the engine against the genesis block known answer
+void test_sha256d_hash_genesis(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+    sha256d_hash(&ctx, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(genesis_hash, hash, 32);
+}
+
+// Test that the header is stored as big-endian words
+void test_sha256d_init_byteswaps_words(void)
+{
+    sha256d_ctx_t ctx;
+
+    sha256d_init(&ctx, genesis_header);
+
+    TEST_ASSERT_EQUAL_HEX32(0x01000000, ctx.words[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x3ba3edfd, ctx.words[9]);
+    TEST_ASSERT_EQUAL_HEX32(0x1dac2b7c, ctx.words[SHA256D_NONCE_WORD]);
+}
+
+// Test that setting the nonce matches a header with the nonce written in place
+void test_sha256d_set_nonce(void)
+{
+    sha256d_ctx_t ctx;
+    sha256d_ctx_t expected;
+    uint8_t header[80];
+    uint32_t nonce = 0x12345678;
+
+    memcpy(header, genesis_header, sizeof(header));
+    memcpy(&header[76], &nonce, 4);
+    sha256d_init(&expected, header);
+
+    sha256d_init(&ctx, genesis_header);
+    sha256d_set_nonce(&ctx, nonce);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected.words, ctx.words, sizeof(ctx.words));
+}
+
+// Test bit-exactness against the mbedtls reference for a range of nonces
+void test_sha256d_matches_double_sha256(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t header[80];
+    uint8_t expected[32];
+    uint8_t hash[32];
+
+    memcpy(header, genesis_header, sizeof(header));
+    sha256d_init(&ctx, header);
+
+    for (uint32_t nonce = 0; nonce < 64; nonce++) {
+        memcpy(&header[76], &nonce, 4);
+        sha256d_set_nonce(&ctx, nonce);
+
+        double_sha256(header, 80, expected);
+        sha256d_hash(&ctx, hash);
+
+        TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+    }
+}
+
+// Test the cached midstate against the genesis block known answer
+void test_sha256d_midstate_genesis(void)
+{
+    static const uint32_t expected[8] = {
+        0xbc909a33, 0x6358bff0, 0x90ccac7d, 0x1e59caa8,
+        0xc3c8d8e9, 0x4f0103c8, 0x96b18736, 0x4719f91b
+    };
+    sha256d_ctx_t ctx;
+
+    sha256d_init(&ctx, genesis_header);
+
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, ctx.midstate, 8);
+}
+
+// Test that the midstate path matches the full path for a range of nonces
+void test_sha256d_hash_midstate_matches_full(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t expected[32];
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+    sha256d_hash_midstate(&ctx, hash);
+    TEST_ASSERT_EQUAL_MEMORY(genesis_hash, hash, 32);
+
+    for (uint32_t nonce = 0; nonce < 64; nonce++) {
+        sha256d_set_nonce(&ctx, nonce * 0x01010101);
+
+        sha256d_hash(&ctx, expected);
+        sha256d_hash_midstate(&ctx, hash);
+
+        TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+    }
+}
+
+// Test that editing the first block requires and honours a midstate refresh
+void test_sha256d_update_midstate(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t expected[32];
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+    ctx.words[0] = 0x20000000;  // Change the version in place
+    sha256d_update_midstate(&ctx);
+
+    sha256d_hash(&ctx, expected);
+    sha256d_hash_midstate(&ctx, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+}
+
+// Test the nonce-specialized kernel against the genesis block known answer
+void test_sha256d_hash_nonce_genesis(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+    sha256d_hash_nonce(&ctx, 0x7c2bac1d, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(genesis_hash, hash, 32);
+}
+
+// Test that the precomputed schedule words match a plain expansion
+void test_sha256d_precompute_schedule(void)
+{
+    sha256d_ctx_t ctx;
+
+    sha256d_init(&ctx, genesis_header);
+
+    // W16 = sigma0(W1) + W0 for the tail block (W9 = W14 = 0)
+    uint32_t w0 = ctx.words[16], w1 = ctx.words[17];
+    uint32_t s0 = ((w1 >> 7) | (w1 << 25)) ^ ((w1 >> 18) | (w1 << 14)) ^ (w1 >> 3);
+    TEST_ASSERT_EQUAL_HEX32(w0 + s0, ctx.precomp.w16);
+}
+
+// Test that the nonce kernel matches the full path across nonces and headers
+void test_sha256d_hash_nonce_matches_full(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t header[80];
+    uint8_t expected[32];
+    uint8_t hash[32];
+
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 80; i++) {
+            header[i] = (uint8_t)(i * 7 + round * 31);
+        }
+        sha256d_init(&ctx, header);
+
+        for (uint32_t i = 0; i < 64; i++) {
+            uint32_t nonce = i * 0x9e3779b9;
+            sha256d_set_nonce(&ctx, nonce);
+
+            sha256d_hash(&ctx, expected);
+            sha256d_hash_nonce(&ctx, nonce, hash);
+
+            TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+        }
+    }
+}
+
+// Test that editing the tail words requires and honours a precompute refresh
+void test_sha256d_precompute_after_time_change(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t expected[32];
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+    ctx.words[17] += 1;  // Roll the timestamp by one second
+    sha256d_precompute(&ctx);
+
+    sha256d_hash(&ctx, expected);
+    sha256d_hash_nonce(&ctx, 0x7c2bac1d, hash);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+    TEST_ASSERT_NOT_EQUAL(0, memcmp(genesis_hash, hash, 32));
+}
+
+// Read the top word the same way count_leading_zeros() scans the hash
+static uint32_t top_word(const uint8_t *hash)
+{
+    return ((uint32_t)hash[31] << 24) | ((uint32_t)hash[30] << 16) |
+           ((uint32_t)hash[29] << 8) | (uint32_t)hash[28];
+}
+
+// Test the top-word limit for a given number of leading zeros
+void test_sha256d_top_word_limit(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(0x7FFFFFFF, sha256d_top_word_limit(0));
+    TEST_ASSERT_EQUAL_HEX32(0x00FFFFFF, sha256d_top_word_limit(7));
+    TEST_ASSERT_EQUAL_HEX32(0x00000001, sha256d_top_word_limit(30));
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, sha256d_top_word_limit(31));
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, sha256d_top_word_limit(70));
+}
+
+// Test that the genesis nonce passes the check with its full digest
+void test_sha256d_check_nonce_genesis(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+
+    // The genesis hash has 43 leading zero bits
+    TEST_ASSERT_TRUE(sha256d_check_nonce(&ctx, 0x7c2bac1d, sha256d_top_word_limit(42), hash));
+    TEST_ASSERT_EQUAL_MEMORY(genesis_hash, hash, 32);
+}
+
+// Test that rejected nonces leave the output buffer untouched
+void test_sha256d_check_nonce_reject(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t hash[32];
+
+    sha256d_init(&ctx, genesis_header);
+    memset(hash, 0xA5, sizeof(hash));
+
+    // Nonce 0 of the genesis header does not have 32 leading zero bits
+    TEST_ASSERT_FALSE(sha256d_check_nonce(&ctx, 0, 0, hash));
+    for (int i = 0; i < 32; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0xA5, hash[i]);
+    }
+}
+
+// Test the early-reject decision against the full-digest path
+void test_sha256d_check_nonce_matches_full(void)
+{
+    static const uint32_t limits[] = { 0xFFFFFFFF, 0x7FFFFFFF, 0x0FFFFFFF, 0x00FFFFFF };
+    sha256d_ctx_t ctx;
+    uint8_t expected[32];
+    uint8_t hash[32];
+    uint32_t passed = 0;
+
+    sha256d_init(&ctx, genesis_header);
+
+    for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+        for (uint32_t nonce = 0; nonce < 512; nonce++) {
+            sha256d_hash_nonce(&ctx, nonce, expected);
+            bool candidate = top_word(expected) <= limits[l];
+
+            TEST_ASSERT_EQUAL(candidate, sha256d_check_nonce(&ctx, nonce, limits[l], hash));
+            if (candidate) {
+                TEST_ASSERT_EQUAL_MEMORY(expected, hash, 32);
+                passed++;
+            }
+        }
+    }
+
+    // The loosest limit accepts everything, so the comparison was exercised
+    TEST_ASSERT_TRUE(passed >= 512);
+}
+
+// Register tests with Unity
+void test_sha256d_functions(void)
+{
+    RUN_TEST(test_sha256d_hash_genesis);
+    RUN_TEST(test_sha256d_init_byteswaps_words);
+    RUN_TEST(test_sha256d_set_nonce);
+    RUN_TEST(test_sha256d_matches_double_sha256);
+    RUN_TEST(test_sha256d_midstate_genesis);
+    RUN_TEST(test_sha256d_hash_midstate_matches_full);
+    RUN_TEST(test_sha256d_update_midstate);
+    RUN_TEST(test_sha256d_hash_nonce_genesis);
+    RUN_TEST(test_sha256d_precompute_schedule);
+    RUN_TEST(test_sha256d_hash_nonce_matches_full);
+    RUN_TEST(test_sha256d_precompute_after_time_change);
+    RUN_TEST(test_sha256d_top_word_limit);
+    RUN_TEST(test_sha256d_check_nonce_genesis);
+    RUN_TEST(test_sha256d_check_nonce_reject);
+    RUN_TEST(test_sha256d_check_nonce_matches_full);
+}
@@ -0,0 +1,127 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/sha256d_batch.h"
+
+#define BATCH_TEST_NONCES   1000
+
+static const sha256d_batch_lanes_t all_variants[] = {
+    SHA256D_BATCH_SCALAR, SHA256D_BATCH_SSE41, SHA256D_BATCH_AVX2, SHA256D_BATCH_AVX512
+};
+
+// Deterministic non-trivial header
+static void batch_test_job(sha256d_batch_job_t *job, uint32_t max_top_word)
+{
+    uint8_t header[80];
+
+    for (int i = 0; i < 80; i++) {
+        header[i] = (uint8_t)(i * 11 + 5);
+    }
+    sha256d_init(&job->ctx, header);
+    job->max_top_word = max_top_word;
+}
+
+// Build the expected bitmap with the scalar early-reject kernel
+static uint32_t batch_expected(const sha256d_batch_job_t *job, uint32_t nonce_start, uint32_t count,
+                               uint32_t *mask)
+{
+    uint8_t hash[32];
+    uint32_t candidates = 0;
+
+    memset(mask, 0, SHA256D_BATCH_MASK_WORDS(count) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        if (sha256d_check_nonce(&job->ctx, nonce_start + i, job->max_top_word, hash)) {
+            mask[i / 32] |= 1u << (i % 32);
+            candidates++;
+        }
+    }
+    return candidates;
+}
+
+// Test that the scalar variant is always available and detection returns something usable
+void test_sha256d_batch_detect(void)
+{
+    TEST_ASSERT_TRUE(sha256d_batch_supported(SHA256D_BATCH_SCALAR));
+    TEST_ASSERT_TRUE(sha256d_batch_supported(sha256d_batch_detect()));
+    TEST_ASSERT_EQUAL_STRING("scalar", sha256d_batch_name(SHA256D_BATCH_SCALAR));
+}
+
+// Test every supported variant against the scalar kernel on identical input
+void test_sha256d_batch_matches_scalar(void)
+{
+    uint32_t expected[SHA256D_BATCH_MASK_WORDS(BATCH_TEST_NONCES)];
+    uint32_t mask[SHA256D_BATCH_MASK_WORDS(BATCH_TEST_NONCES)];
+    sha256d_batch_job_t job;
+
+    // About one nonce in 16 passes this threshold
+    batch_test_job(&job, 0x0FFFFFFF);
+    uint32_t want = batch_expected(&job, 12345, BATCH_TEST_NONCES, expected);
+    TEST_ASSERT_GREATER_THAN(0, want);
+
+    for (size_t v = 0; v < sizeof(all_variants) / sizeof(all_variants[0]); v++) {
+        if (!sha256d_batch_supported(all_variants[v])) {
+            continue;
+        }
+        uint32_t got = sha256d_batch_with(&job, all_variants[v], 12345, BATCH_TEST_NONCES, mask);
+
+        TEST_ASSERT_EQUAL_UINT32(want, got);
+        TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, mask, SHA256D_BATCH_MASK_WORDS(BATCH_TEST_NONCES));
+    }
+}
+
+// Test counts that are not a multiple of the lane width and nonce wrap-around
+void test_sha256d_batch_remainder_and_wrap(void)
+{
+    uint32_t expected[2];
+    uint32_t mask[2];
+    sha256d_batch_job_t job;
+    const uint32_t start = 0xFFFFFFF0;  // wraps to 0 after 16 nonces
+    const uint32_t count = 45;
+
+    batch_test_job(&job, 0x3FFFFFFF);
+    uint32_t want = batch_expected(&job, start, count, expected);
+
+    for (size_t v = 0; v < sizeof(all_variants) / sizeof(all_variants[0]); v++) {
+        if (!sha256d_batch_supported(all_variants[v])) {
+            continue;
+        }
+        memset(mask, 0xFF, sizeof(mask));
+        uint32_t got = sha256d_batch_with(&job, all_variants[v], start, count, mask);
+
+        TEST_ASSERT_EQUAL_UINT32(want, got);
+        TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, mask, 2);
+    }
+}
+
+// Test that the auto-selected entry point finds the genesis block nonce
+void test_sha256d_batch_genesis(void)
+{
+    static const uint8_t genesis_header[80] = {
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+        0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+        0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+    };
+    const uint32_t genesis_nonce = 0x7c2bac1d;
+    uint32_t mask[2];
+    sha256d_batch_job_t job;
+
+    sha256d_init(&job.ctx, genesis_header);
+    job.max_top_word = 0;  // at least 32 leading zero bits
+
+    // The genesis nonce sits at offset 21 of a 64-nonce window
+    uint32_t got = sha256d_batch(&job, genesis_nonce - 21, 64, mask);
+
+    TEST_ASSERT_EQUAL_UINT32(1, got);
+    TEST_ASSERT_EQUAL_HEX32(1u << 21, mask[0]);
+    TEST_ASSERT_EQUAL_HEX32(0, mask[1]);
+}
+
+// Register tests with Unity
+void test_sha256d_batch_functions(void)
+{
+    RUN_TEST(test_sha256d_batch_detect);
+    RUN_TEST(test_sha256d_batch_matches_scalar);
+    RUN_TEST(test_sha256d_batch_remainder_and_wrap);
+    RUN_TEST(test_sha256d_batch_genesis);
+}
@@ -0,0 +1,107 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/sha256d_nway.h"
+
+#define NWAY_TEST_NONCES    1024
+
+// Bitcoin genesis block header (block 0)
+static const uint8_t genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+#define GENESIS_NONCE       2083236893u
+
+// Lane bitmap of the scalar early-reject kernel
+static uint32_t nway_expected(const sha256d_ctx_t *ctx, uint32_t nonce, int lanes, uint32_t max_top_word)
+{
+    uint8_t hash[32];
+    uint32_t mask = 0;
+
+    for (int l = 0; l < lanes; l++) {
+        if (sha256d_check_nonce(ctx, nonce + (uint32_t)l, max_top_word, hash)) {
+            mask |= 1u << l;
+        }
+    }
+    return mask;
+}
+
+// Test that the genesis nonce is found in every lane position
+void test_sha256d_nway_genesis(void)
+{
+    sha256d_ctx_t ctx;
+    uint32_t limit = sha256d_top_word_limit(32);
+
+    sha256d_init(&ctx, genesis_header);
+
+    for (uint32_t l = 0; l < 4; l++) {
+        uint32_t base = GENESIS_NONCE - l;
+        if (l < 2) {
+            TEST_ASSERT_EQUAL_HEX32(1u << l, sha256d_check_nonce_x2(&ctx, base, limit));
+        }
+        TEST_ASSERT_EQUAL_HEX32(1u << l, sha256d_check_nonce_x4(&ctx, base, limit));
+    }
+    TEST_ASSERT_EQUAL_HEX32(0, sha256d_check_nonce_x4(&ctx, GENESIS_NONCE + 1, limit));
+}
+
+// Test that both widths agree with the scalar kernel lane by lane
+void test_sha256d_nway_matches_scalar(void)
+{
+    sha256d_ctx_t ctx;
+    uint8_t header[80];
+    uint32_t hits = 0;
+
+    for (int i = 0; i < 80; i++) {
+        header[i] = (uint8_t)(i * 7 + 3);
+    }
+    sha256d_init(&ctx, header);
+
+    // 6 leading zero bits: a few candidates per thousand nonces
+    for (uint32_t nonce = 0; nonce < NWAY_TEST_NONCES; nonce += 4) {
+        uint32_t want = nway_expected(&ctx, nonce, 4, 0x03FFFFFF);
+        TEST_ASSERT_EQUAL_HEX32(want & 3, sha256d_check_nonce_x2(&ctx, nonce, 0x03FFFFFF));
+        TEST_ASSERT_EQUAL_HEX32(want >> 2, sha256d_check_nonce_x2(&ctx, nonce + 2, 0x03FFFFFF));
+        TEST_ASSERT_EQUAL_HEX32(want, sha256d_check_nonce_x4(&ctx, nonce, 0x03FFFFFF));
+        hits |= want;
+    }
+    TEST_ASSERT_NOT_EQUAL(0, hits);
+}
+
+// Test the threshold extremes and nonce wrap-around
+void test_sha256d_nway_limits(void)
+{
+    sha256d_ctx_t ctx;
+
+    sha256d_init(&ctx, genesis_header);
+
+    TEST_ASSERT_EQUAL_HEX32(0x3, sha256d_check_nonce_x2(&ctx, 0xFFFFFFFF, 0xFFFFFFFF));
+    TEST_ASSERT_EQUAL_HEX32(0xF, sha256d_check_nonce_x4(&ctx, 0xFFFFFFFE, 0xFFFFFFFF));
+    TEST_ASSERT_EQUAL_HEX32(nway_expected(&ctx, 0xFFFFFFFE, 4, 0x0FFFFFFF),
+                            sha256d_check_nonce_x4(&ctx, 0xFFFFFFFE, 0x0FFFFFFF));
+}
+
+// Test that the configured width dispatches to a matching kernel
+void test_sha256d_nway_configured(void)
+{
+    sha256d_ctx_t ctx;
+
+    sha256d_init(&ctx, genesis_header);
+
+    TEST_ASSERT_EQUAL_HEX32(1, sha256d_check_nonce_nway(&ctx, GENESIS_NONCE, sha256d_top_word_limit(32)));
+    for (uint32_t nonce = 0; nonce < 64; nonce += SHA256D_INTERLEAVE) {
+        TEST_ASSERT_EQUAL_HEX32(nway_expected(&ctx, nonce, SHA256D_INTERLEAVE, 0x0FFFFFFF),
+                                sha256d_check_nonce_nway(&ctx, nonce, 0x0FFFFFFF));
+    }
+}
+
+// Register tests with Unity
+void test_sha256d_nway_functions(void)
+{
+    RUN_TEST(test_sha256d_nway_genesis);
+    RUN_TEST(test_sha256d_nway_matches_scalar);
+    RUN_TEST(test_sha256d_nway_limits);
+    RUN_TEST(test_sha256d_nway_configured);
+}
@@ -0,0 +1,212 @@
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+#define HIST_TEST_HASHES    (1u << 18)
+
+// A share every ~1000 hashes: about 256 in HIST_TEST_HASHES
+#define HIST_TEST_DIFFICULTY    (1.0 / (1 << 22))
+
+// Test the bins, the floors and the work per share
+void test_share_hist_bins(void)
+{
+    uint32_t one = -SHARE_HIST_MIN_EXP;
+
+    TEST_ASSERT_EQUAL_UINT32(one, share_hist_bin(1.0));
+    TEST_ASSERT_EQUAL_UINT32(one, share_hist_bin(1.999));
+    TEST_ASSERT_EQUAL_UINT32(one + 1, share_hist_bin(2.0));
+    TEST_ASSERT_EQUAL_UINT32(one - 1, share_hist_bin(0.75));
+    TEST_ASSERT_EQUAL_UINT32(one + 10, share_hist_bin(1500.0));
+    TEST_ASSERT_EQUAL_UINT32(0, share_hist_bin(1e-12));
+    TEST_ASSERT_EQUAL_UINT32(0, share_hist_bin(0));
+    TEST_ASSERT_EQUAL_UINT32(SHARE_HIST_BINS - 1, share_hist_bin(1e30));
+
+    // The first bin entirely at or above the share difficulty
+    TEST_ASSERT_EQUAL_UINT32(one, share_hist_floor(1.0));
+    TEST_ASSERT_EQUAL_UINT32(one + 1, share_hist_floor(1.01));
+    TEST_ASSERT_EQUAL_UINT32(one - 1, share_hist_floor(0.5));
+    TEST_ASSERT_EQUAL_UINT32(1, share_hist_floor(1e-12));
+    TEST_ASSERT_EQUAL_UINT32(1, share_hist_floor(0));
+    TEST_ASSERT_EQUAL_UINT32(SHARE_HIST_BINS - 1, share_hist_floor(1e30));
+
+    // Difficulty 1: one hash in 2^48 / 0xFFFF
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 4295032833.0, share_hist_work(one));
+    TEST_ASSERT_DOUBLE_WITHIN(1, 4295032833.0 * 1024, share_hist_work(one + 10));
+}
+
+// Test per-job and cumulative counting, and merging workers
+void test_share_hist_merge(void)
+{
+    static share_hist_t a, b, sum;
+    share_hist_t copy;
+    uint32_t one = -SHARE_HIST_MIN_EXP;
+
+    share_hist_init(&a);
+    share_hist_init(&b);
+    share_hist_start_job(&a, 1, one);
+    share_hist_add(&a, 1.5);
+    share_hist_add(&a, 300.0);
+    // Below the floor (a share target that is not a power of two)
+    share_hist_add(&a, 0.9);
+    TEST_ASSERT_EQUAL_UINT32(1, a.job_bins[one]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.job_bins[one + 8]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.job_bins[one - 1]);
+    TEST_ASSERT_EQUAL_UINT32(2, a.credited[one]);
+
+    // A new job clears the job bins only; the same job again changes nothing
+    share_hist_start_job(&a, 2, one + 2);
+    share_hist_add(&a, 5.0);
+    share_hist_start_job(&a, 2, one + 2);
+    TEST_ASSERT_EQUAL_UINT32(2, a.job_id);
+    TEST_ASSERT_EQUAL_UINT32(0, a.job_bins[one]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.job_bins[one + 2]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.bins[one]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.bins[one + 2]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.credited[one + 2]);
+    TEST_ASSERT_EQUAL_UINT32(0, a.seq & 1);
+
+    share_hist_start_job(&b, 1, one);
+    share_hist_add(&b, 1.0);
+
+    // b is still on job 1: only its cumulative bins count
+    share_hist_init(&sum);
+    share_hist_read(&b, &copy);
+    share_hist_merge(&sum, &copy);
+    share_hist_read(&a, &copy);
+    share_hist_merge(&sum, &copy);
+    TEST_ASSERT_EQUAL_UINT32(2, sum.job_id);
+    TEST_ASSERT_EQUAL_UINT32(one + 2, sum.job_floor);
+    TEST_ASSERT_EQUAL_UINT32(1, sum.job_bins[one + 2]);
+    TEST_ASSERT_EQUAL_UINT32(0, sum.job_bins[one]);
+    TEST_ASSERT_EQUAL_UINT32(2, sum.bins[one]);
+    TEST_ASSERT_EQUAL_UINT32(3, sum.credited[one]);
+    TEST_ASSERT_EQUAL_UINT32(1, sum.credited[one + 2]);
+
+    // Once b moves to job 2 as well, the job bins add up
+    share_hist_start_job(&b, 2, one + 2);
+    share_hist_add(&b, 4.0);
+    share_hist_read(&b, &copy);
+    share_hist_merge(&sum, &copy);
+    TEST_ASSERT_EQUAL_UINT32(2, sum.job_bins[one + 2]);
+}
+
+// Test the estimates and their bounds against the Poisson counts
+void test_share_hist_estimate(void)
+{
+    static share_hist_t hist;
+    share_estimate_t estimate;
+    uint32_t one = -SHARE_HIST_MIN_EXP;
+    double work = share_hist_work(one);
+
+    // No share yet: up to about 6.7 shares' worth of hashes is plausible
+    share_hist_init(&hist);
+    share_hist_start_job(&hist, 1, one);
+    share_hist_estimate_job(&hist, &estimate);
+    TEST_ASSERT_EQUAL_UINT32(0, estimate.shares);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 0, estimate.low);
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 6.74, estimate.high / work);
+    share_hist_estimate_all(&hist, &estimate);
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 6.74, estimate.high / work);
+
+    // 100 shares at or above the floor: the Poisson means with a count of
+    // 100 at 3 sigma (exact: 72.6 and 133.8)
+    for (int i = 0; i < 100; i++) {
+        share_hist_add(&hist, i % 2 ? 1.0 : 37.0);
+    }
+    share_hist_add(&hist, 0.6);
+    share_hist_estimate_job(&hist, &estimate);
+    TEST_ASSERT_EQUAL_UINT32(100, estimate.shares);
+    TEST_ASSERT_DOUBLE_WITHIN(1, 100 * work, estimate.hashes);
+    TEST_ASSERT_DOUBLE_WITHIN(0.1, 72.6, estimate.low / work);
+    TEST_ASSERT_DOUBLE_WITHIN(0.1, 133.9, estimate.high / work);
+
+    TEST_ASSERT_EQUAL(SHARE_CHECK_OK, share_estimate_check(&estimate, (uint64_t)(100 * work)));
+    TEST_ASSERT_EQUAL(SHARE_CHECK_OK, share_estimate_check(&estimate, (uint64_t)(75 * work)));
+    TEST_ASSERT_EQUAL(SHARE_CHECK_FEW, share_estimate_check(&estimate, (uint64_t)(140 * work)));
+    TEST_ASSERT_EQUAL(SHARE_CHECK_MANY, share_estimate_check(&estimate, (uint64_t)(70 * work)));
+    TEST_ASSERT_EQUAL_STRING("too few shares", share_check_name(SHARE_CHECK_FEW));
+
+    // A second job with a floor four times higher credits its shares four
+    // times the work
+    share_hist_start_job(&hist, 2, one + 2);
+    for (int i = 0; i < 50; i++) {
+        share_hist_add(&hist, 4.0);
+    }
+    share_hist_estimate_all(&hist, &estimate);
+    TEST_ASSERT_EQUAL_UINT32(150, estimate.shares);
+    TEST_ASSERT_DOUBLE_WITHIN(1, 300 * work, estimate.hashes);
+    TEST_ASSERT_TRUE(estimate.low < estimate.hashes && estimate.hashes < estimate.high);
+}
+
+// Check only the even nonces, but claim all of them: a fast, wrong kernel
+static uint32_t scan_even_only(sha256d_ctx_t *ctx, uint32_t nonce_start, uint32_t count,
+                               uint32_t max_top_word, uint32_t *out_mask)
+{
+    uint32_t found = 0;
+    uint8_t hash[32];
+
+    memset(out_mask, 0, SHA256D_BATCH_MASK_WORDS(count) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        if ((nonce_start + i) % 2 == 0 && sha256d_check_nonce(ctx, nonce_start + i, max_top_word, hash)) {
+            out_mask[i / 32] |= 1u << (i % 32);
+            found++;
+        }
+    }
+    return found;
+}
+
+// Mine HIST_TEST_HASHES nonces at a low share difficulty
+static void hist_test_mine(miner_ctx_t *miner, const hash_backend_t *backend)
+{
+    uint8_t header[80];
+
+    memset(header, 0x6B, sizeof(header));
+    miner_ctx_init(miner, backend, 2);
+    miner_ctx_set_share_difficulty(miner, HIST_TEST_DIFFICULTY);
+    miner_ctx_set_job(miner, header);
+    miner_ctx_set_range(miner, 0, HIST_TEST_HASHES, 4096);
+    TEST_ASSERT_TRUE(miner_ctx_start(miner));
+    miner_ctx_wait(miner);
+    TEST_ASSERT_EQUAL_UINT64(HIST_TEST_HASHES, miner_ctx_collect(miner));
+}
+
+// Test that the shares of a correct kernel match the counted hashes, and
+// that a kernel skipping half the nonces is caught
+void test_share_hist_miner(void)
+{
+    static const hash_backend_t even_only = { "even_only", scan_even_only, NULL };
+    static miner_ctx_t miner;
+    const share_hist_t *hist = &miner.stats.share_hist;
+    share_estimate_t job, all;
+    uint32_t shares;
+
+    hist_test_mine(&miner, hash_backend_find("reject"));
+    share_hist_estimate_job(hist, &job);
+    share_hist_estimate_all(hist, &all);
+    TEST_ASSERT_EQUAL_UINT32(miner_ctx_job(&miner)->id, hist->job_id);
+    TEST_ASSERT_EQUAL_UINT32(share_hist_floor(HIST_TEST_DIFFICULTY), hist->job_floor);
+    TEST_ASSERT_GREATER_THAN(100, job.shares);
+    TEST_ASSERT_EQUAL_UINT32(job.shares, all.shares);
+    TEST_ASSERT_DOUBLE_WITHIN(1, job.hashes, all.hashes);
+    TEST_ASSERT_EQUAL(SHARE_CHECK_OK, share_estimate_check(&job, HIST_TEST_HASHES));
+    TEST_ASSERT_EQUAL(SHARE_CHECK_OK, share_estimate_check(&all, HIST_TEST_HASHES));
+    shares = job.shares;
+
+    // Counted even when the share rings overflow
+    TEST_ASSERT_GREATER_THAN(0, miner.stats.shares_dropped);
+
+    hist_test_mine(&miner, &even_only);
+    share_hist_estimate_job(hist, &job);
+    TEST_ASSERT_LESS_THAN(shares, job.shares);
+    TEST_ASSERT_EQUAL(SHARE_CHECK_FEW, share_estimate_check(&job, HIST_TEST_HASHES));
+}
+
+// Register tests with Unity
+void test_share_hist_functions(void)
+{
+    RUN_TEST(test_share_hist_bins);
+    RUN_TEST(test_share_hist_merge);
+    RUN_TEST(test_share_hist_estimate);
+    RUN_TEST(test_share_hist_miner);
+}
@@ -0,0 +1,107 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+#define RING_TEST_SHARES    20000
+
+static share_ring_t ring;
+
+// Test order, the full ring and index wrap-around
+void test_share_ring_fifo(void)
+{
+    miner_share_t share;
+    uint32_t next = 0;
+
+    memset(&share, 0, sizeof(share));
+    share_ring_init(&ring);
+    TEST_ASSERT_FALSE(share_ring_pop(&ring, &share));
+
+    for (uint32_t i = 0; i < SHARE_RING_SIZE; i++) {
+        share.nonce = i;
+        TEST_ASSERT_TRUE(share_ring_push(&ring, &share));
+    }
+    share.nonce = SHARE_RING_SIZE;
+    TEST_ASSERT_FALSE(share_ring_push(&ring, &share));
+    TEST_ASSERT_EQUAL_UINT32(SHARE_RING_SIZE, share_ring_count(&ring));
+
+    // Freeing one slot makes room for exactly one more
+    TEST_ASSERT_TRUE(share_ring_pop(&ring, &share));
+    TEST_ASSERT_EQUAL_UINT32(next++, share.nonce);
+    share.nonce = SHARE_RING_SIZE;
+    TEST_ASSERT_TRUE(share_ring_push(&ring, &share));
+    TEST_ASSERT_FALSE(share_ring_push(&ring, &share));
+    while (share_ring_pop(&ring, &share)) {
+        TEST_ASSERT_EQUAL_UINT32(next++, share.nonce);
+    }
+    TEST_ASSERT_EQUAL_UINT32(SHARE_RING_SIZE + 1, next);
+    TEST_ASSERT_EQUAL_UINT32(0, share_ring_count(&ring));
+
+    // Indices are free-running: crossing 2^32 changes nothing
+    ring.head = ring.tail = 0xfffffffeu;
+    for (uint32_t i = 0; i < 4; i++) {
+        share.nonce = 100 + i;
+        TEST_ASSERT_TRUE(share_ring_push(&ring, &share));
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, share_ring_count(&ring));
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(share_ring_pop(&ring, &share));
+        TEST_ASSERT_EQUAL_UINT32(100 + i, share.nonce);
+    }
+    TEST_ASSERT_FALSE(share_ring_pop(&ring, &share));
+}
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t full;
+} producer_log_t;
+
+// Producer thread: every share carries its sequence number in two fields,
+// so a torn copy shows up as a mismatch
+static void ring_producer(void *arg)
+{
+    producer_log_t *log = (producer_log_t *)arg;
+    miner_share_t share;
+
+    memset(&share, 0, sizeof(share));
+    while (log->pushed < RING_TEST_SHARES) {
+        share.nonce = log->pushed;
+        share.extranonce2 = ~(uint64_t)log->pushed;
+        if (share_ring_push(&ring, &share)) {
+            log->pushed++;
+        } else {
+            log->full++;
+            miner_yield();
+        }
+    }
+}
+
+// Test that a producer and a consumer on two threads lose and reorder nothing
+void test_share_ring_threads(void)
+{
+    miner_thread_t thread;
+    producer_log_t log = { 0, 0 };
+    miner_share_t share;
+    uint32_t next = 0;
+
+    share_ring_init(&ring);
+    TEST_ASSERT_TRUE(miner_thread_start(&thread, ring_producer, &log, "ring_test", 1));
+    while (next < RING_TEST_SHARES) {
+        if (!share_ring_pop(&ring, &share)) {
+            miner_yield();
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT32(next, share.nonce);
+        TEST_ASSERT_TRUE(share.extranonce2 == ~(uint64_t)next);
+        next++;
+    }
+    miner_thread_join(&thread);
+    TEST_ASSERT_EQUAL_UINT32(RING_TEST_SHARES, log.pushed);
+    TEST_ASSERT_FALSE(share_ring_pop(&ring, &share));
+}
+
+// Register tests with Unity
+void test_share_ring_functions(void)
+{
+    RUN_TEST(test_share_ring_fifo);
+    RUN_TEST(test_share_ring_threads);
+}
@@ -0,0 +1,204 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+#include "mock_pool.h"
+#include "pool_harness.h"
+
+// Host only: the pool is a child process on a loopback socket
+
+static mock_pool_t pool;
+static stratum_client_t client;
+static stratum_config_t config;
+static bool pool_started;
+
+static void start(double difficulty, const char *user)
+{
+    TEST_ASSERT_TRUE(mock_pool_start(&pool, difficulty));
+    pool_started = true;
+    config.host = "127.0.0.1";
+    config.port = pool.port;
+    config.user = user;
+    config.password = "x";
+    config.version_mask = VERSION_ROLLING_BIP320_MASK;
+    stratum_client_init(&client, &config);
+}
+
+void setUp(void)
+{
+    pool_started = false;
+}
+
+void tearDown(void)
+{
+    if (pool_started) {
+        stratum_client_close(&client);
+        TEST_ASSERT_EQUAL_INT(0, mock_pool_finish(&pool));
+    }
+}
+
+// Test the pipelined handshake and turning mining.notify into work
+void test_stratum_handshake_job(void)
+{
+    stratum_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+    uint8_t header[80];
+
+    start(1.0, MOCK_POOL_USER);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, STRATUM_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+
+    stratum_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_HEX32(VERSION_ROLLING_BIP320_MASK, status.version_mask);
+    TEST_ASSERT_DOUBLE_WITHIN(0, 1.0, status.conn.difficulty);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.jobs);
+
+    TEST_ASSERT_EQUAL_UINT32(1, seq);
+    TEST_ASSERT_EQUAL_STRING("1", job.id);
+    TEST_ASSERT_FALSE(job.clean);
+    TEST_ASSERT_DOUBLE_WITHIN(0, 1.0, job.difficulty);
+    TEST_ASSERT_EQUAL_HEX32(VERSION_ROLLING_BIP320_MASK, job.work.version_mask);
+    TEST_ASSERT_EQUAL_UINT32(WORK_NTIME_ROLL_DEFAULT, job.work.ntime_roll);
+    TEST_ASSERT_EQUAL_size_t(204, job.work.coinbase_len);
+    TEST_ASSERT_EQUAL_size_t(4, job.work.extranonce2_size);
+    TEST_ASSERT_EQUAL_size_t(0, job.work.merkle_count);
+
+    // The genesis extranonce2 rebuilds the genesis header
+    job.work.extranonce2 = MOCK_POOL_GENESIS_EXTRANONCE2;
+    work_header(&job.work, 0, header);
+    TEST_ASSERT_EQUAL_MEMORY(mock_pool_genesis_header, header, 76);
+
+    // Nothing newer yet
+    TEST_ASSERT_FALSE(stratum_client_take_job(&client, &seq, &job));
+}
+
+// Test share submission, the pool's verdicts and the job that follows
+void test_stratum_submit(void)
+{
+    stratum_status_t status;
+    stratum_share_t share;
+    stratum_job_t job;
+    uint32_t seq = 0;
+
+    start(1.0, MOCK_POOL_USER);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, STRATUM_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+
+    pool_harness_genesis_share(&job, &share);
+    TEST_ASSERT_TRUE(stratum_client_submit(&client, &share));
+    share.nonce++;
+    TEST_ASSERT_TRUE(stratum_client_submit(&client, &share));
+    TEST_ASSERT_TRUE(pool_harness_poll_answers(&client.conn));
+    stratum_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(2, status.conn.submitted);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.accepted);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, status.pending);
+    // The response to an id we never sent is not a verdict on either share
+    TEST_ASSERT_EQUAL_UINT32(1, status.unmatched);
+    TEST_ASSERT_GREATER_THAN(0, status.response_us_max);
+
+    // The accepted share prompts a clean job on top of the genesis block
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+    TEST_ASSERT_EQUAL_STRING("2", job.id);
+    TEST_ASSERT_TRUE(job.clean);
+    TEST_ASSERT_EQUAL_MEMORY(mock_pool_genesis_hash, job.work.header.prev_hash, 32);
+    TEST_ASSERT_EQUAL_size_t(1, job.work.merkle_count);
+    TEST_ASSERT_EQUAL_MEMORY(mock_pool_branch, job.work.merkle_branch[0], 32);
+}
+
+// Test that a refused worker disconnects and that shares are not queued then
+void test_stratum_unauthorized(void)
+{
+    stratum_status_t status;
+    stratum_share_t share;
+
+    memset(&share, 0, sizeof(share));
+    start(1.0, "intruder");
+    TEST_ASSERT_TRUE(pool_harness_poll_failure(&client.conn));
+    stratum_client_status(&client, &status);
+
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.reconnects);
+    TEST_ASSERT_EQUAL_INT(STRATUM_DISCONNECTED, status.conn.state);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.jobs);
+    TEST_ASSERT_FALSE(stratum_client_submit(&client, &share));
+    stratum_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.dropped);
+}
+
+// Drain the workers' share rings into the client, as the firmware's pool
+// task does; returns the number of shares queued
+static uint32_t submit_shares(miner_ctx_t *miner, const stratum_job_t *job)
+{
+    miner_share_t found;
+    uint32_t count = 0;
+
+    while (miner_ctx_take_share(miner, &found)) {
+        stratum_share_t share;
+
+        if (!found.meets_share) {
+            continue;
+        }
+        strcpy(share.job_id, job->id);
+        share.extranonce2 = found.extranonce2;
+        share.ntime = found.ntime;
+        share.nonce = found.nonce;
+        share.version = found.version;
+        TEST_ASSERT_TRUE(stratum_client_submit(&client, &share));
+        count++;
+    }
+    return count;
+}
+
+// Test mining a pool job with two workers: every share found in rolled
+// variants (version, ntime and extranonce2) goes through the share rings
+// and the pipelined requests, and must be accepted by the pool
+void test_stratum_mining(void)
+{
+    static miner_ctx_t miner;
+    stratum_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+    uint32_t found = 0;
+    // Variant with version index 5, ntime + 1 and extranonce2 + 1
+    uint64_t roll = (uint64_t)65536 * (WORK_NTIME_ROLL_DEFAULT + 1) + 65536 + 5;
+
+    // About one share per 4096 hashes
+    start(1.0 / 1048576, MOCK_POOL_USER);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, STRATUM_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+
+    miner_ctx_init(&miner, hash_backend_get(0), 2);
+    miner_ctx_set_share_difficulty(&miner, job.difficulty);
+    miner_ctx_set_work(&miner, &job.work);
+    miner_ctx_set_range(&miner, roll << 32, 24000, 1000);
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    while (miner_ctx_running(&miner)) {
+        found += submit_shares(&miner, &job);
+        stratum_client_poll(&client, 1);
+    }
+    miner_ctx_wait(&miner);
+    found += submit_shares(&miner, &job);
+    miner_ctx_collect(&miner);
+
+    TEST_ASSERT_TRUE(pool_harness_poll_answers(&client.conn));
+    stratum_client_status(&client, &status);
+    TEST_ASSERT_GREATER_THAN(0, found);
+    TEST_ASSERT_EQUAL_UINT32(0, miner.stats.shares_dropped);
+    TEST_ASSERT_EQUAL_UINT32(found, status.conn.submitted);
+    TEST_ASSERT_EQUAL_UINT32(found, status.conn.accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, status.pending);
+    TEST_ASSERT_EQUAL_UINT32(0, status.unmatched);
+}
+
+// Register tests with Unity
+void test_stratum_functions(void)
+{
+    RUN_TEST(test_stratum_handshake_job);
+    RUN_TEST(test_stratum_submit);
+    RUN_TEST(test_stratum_unauthorized);
+    RUN_TEST(test_stratum_mining);
+}
@@ -0,0 +1,274 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Genesis coinbase split around extranonce1 "54686520" and a 4-byte extranonce2
+#define COINBASE1 "01000000010000000000000000000000000000000000000000000000000000000000000000" \
+                  "ffffffff4d04ffff001d010445"
+#define COINBASE2 "732030332f4a616e2f32303039204368616e63656c6c6f72206f6e206272696e6b206f66207365" \
+                  "636f6e64206261696c6f757420666f722062616e6b73ffffffff0100f2052a010000004341046" \
+                  "78afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4" \
+                  "f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000"
+#define PREVHASH  "0a8ce26f72b3f1b646a2a6c14ff763ae65831e939c085ae10019d66800000000"
+#define BRANCH    "00112233445566778899aabbccddeeff0123456789abcdeffedcba9876543210"
+
+// Genesis block hash (internal byte order), as PREVHASH decodes
+static const uint8_t genesis_hash[32] = {
+    0x6f, 0xe2, 0x8c, 0x0a, 0xb6, 0xf1, 0xb3, 0x72, 0xc1, 0xa6, 0xa2, 0x46, 0xae, 0x63, 0xf7, 0x4f,
+    0x93, 0x1e, 0x83, 0x65, 0xe1, 0x5a, 0x08, 0x9c, 0x68, 0xd6, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// Genesis merkle root (internal byte order)
+static const uint8_t genesis_root[32] = {
+    0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e, 0x67, 0x76, 0x8f, 0x61,
+    0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa, 0x4b, 0x1e, 0x5e, 0x4a
+};
+
+static const char notify[] =
+    "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"job-7\",\"" PREVHASH "\",\"" COINBASE1 "\",\""
+    COINBASE2 "\",[\"" BRANCH "\",\"" BRANCH "\"],\"20000000\",\"1d00ffff\",\"495fab29\",true]}\n";
+
+// ckpool order: params before method, no id
+static const char notify_genesis[] =
+    "{\"params\": [\"1\", \"0000000000000000000000000000000000000000000000000000000000000000\", \""
+    COINBASE1 "\", \"" COINBASE2 "\", [], \"00000001\", \"1d00ffff\", \"495fab29\", false], "
+    "\"method\": \"mining.notify\"}\n";
+
+static stratum_parser_t parser;
+
+static void subscribed(void)
+{
+    static const uint8_t extranonce1[4] = { 0x54, 0x68, 0x65, 0x20 };
+
+    stratum_parser_init(&parser);
+    stratum_parser_set_extranonce(&parser, extranonce1, sizeof(extranonce1), 4);
+}
+
+// Feed a string in pieces of `chunk` bytes; returns the last message and counts them
+static const stratum_msg_t *feed(const char *s, size_t chunk, int *count)
+{
+    const stratum_msg_t *last = NULL;
+    size_t len = strlen(s);
+
+    *count = 0;
+    for (size_t at = 0; at < len; at += chunk) {
+        size_t n = len - at < chunk ? len - at : chunk;
+        size_t done = 0;
+        while (done < n) {
+            const stratum_msg_t *msg;
+            done += stratum_parser_feed(&parser, s + at + done, n - done, &msg);
+            if (msg != NULL) {
+                last = msg;
+                (*count)++;
+            }
+        }
+    }
+    return last;
+}
+
+// Test decoding mining.notify into a template, whatever the chunking
+void test_stratum_parser_notify(void)
+{
+    static const size_t chunks[] = { 1, 7, 64, sizeof(notify) };
+    uint8_t root[32];
+    int count;
+
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        subscribed();
+        const stratum_msg_t *msg = feed(notify, chunks[i], &count);
+        TEST_ASSERT_EQUAL_INT(1, count);
+        TEST_ASSERT_EQUAL_INT(STRATUM_MSG_NOTIFY, msg->type);
+        TEST_ASSERT_EQUAL_STRING("job-7", msg->job.id);
+        TEST_ASSERT_TRUE(msg->job.clean);
+        TEST_ASSERT_EQUAL_HEX32(0x20000000, msg->job.work.header.version);
+        TEST_ASSERT_EQUAL_HEX32(0x1d00ffff, msg->job.work.header.bits);
+        TEST_ASSERT_EQUAL_HEX32(0x495fab29, msg->job.work.header.timestamp);
+        TEST_ASSERT_EQUAL_MEMORY(genesis_hash, msg->job.work.header.prev_hash, 32);
+        TEST_ASSERT_EQUAL_size_t(2, msg->job.work.merkle_count);
+        TEST_ASSERT_EQUAL_HEX8(0x00, msg->job.work.merkle_branch[1][0]);
+        TEST_ASSERT_EQUAL_HEX8(0x10, msg->job.work.merkle_branch[1][31]);
+        TEST_ASSERT_EQUAL_size_t(204, msg->job.work.coinbase_len);
+        TEST_ASSERT_EQUAL_size_t(54, msg->job.work.extranonce2_offset);
+        TEST_ASSERT_EQUAL_size_t(4, msg->job.work.extranonce2_size);
+        TEST_ASSERT_EQUAL_UINT32(WORK_NTIME_ROLL_DEFAULT, msg->job.work.ntime_roll);
+    }
+
+    // Key order does not matter; the genesis extranonce2 rebuilds the genesis coinbase
+    subscribed();
+    const stratum_msg_t *msg = feed(notify_genesis, 13, &count);
+    TEST_ASSERT_EQUAL_INT(1, count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_NOTIFY, msg->type);
+    TEST_ASSERT_EQUAL_STRING("1", msg->job.id);
+    TEST_ASSERT_FALSE(msg->job.clean);
+    TEST_ASSERT_EQUAL_size_t(0, msg->job.work.merkle_count);
+    work_merkle_root(&msg->job.work, 0x656d6954, root);
+    TEST_ASSERT_EQUAL_MEMORY(genesis_root, root, 32);
+}
+
+// Test the responses of the handshake and share submissions
+void test_stratum_parser_responses(void)
+{
+    static const char lines[] =
+        "{\"id\":1,\"result\":{\"version-rolling\":true,\"version-rolling.mask\":\"1fffe000\"},\"error\":null}\n"
+        "{\"id\":2,\"result\":[[[\"mining.set_difficulty\",\"1\"],[\"mining.notify\",\"1\"]],\"54686520\",4],"
+        "\"error\":null}\n"
+        "{\"error\":null,\"id\":3,\"result\":true}\r\n"
+        "\n"
+        "{\"id\":4,\"result\":null,\"error\":[23,\"Low difficulty share\",null]}\n";
+    const stratum_msg_t *msg;
+    size_t at = 0;
+
+    stratum_parser_init(&parser);
+
+    at += stratum_parser_feed(&parser, lines + at, strlen(lines + at), &msg);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_EQUAL_UINT32(1, msg->id);
+    TEST_ASSERT_TRUE(msg->version_rolling);
+    TEST_ASSERT_EQUAL_HEX32(0x1fffe000, msg->version_mask);
+    TEST_ASSERT_FALSE(msg->error);
+
+    at += stratum_parser_feed(&parser, lines + at, strlen(lines + at), &msg);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_EQUAL_UINT32(2, msg->id);
+    TEST_ASSERT_EQUAL_size_t(4, msg->extranonce1_len);
+    TEST_ASSERT_EQUAL_HEX8(0x54, msg->extranonce1[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x20, msg->extranonce1[3]);
+    TEST_ASSERT_EQUAL_UINT32(4, msg->extranonce2_size);
+
+    at += stratum_parser_feed(&parser, lines + at, strlen(lines + at), &msg);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_UINT32(3, msg->id);
+    TEST_ASSERT_TRUE(msg->result);
+    TEST_ASSERT_FALSE(msg->error);
+
+    // The blank line is skipped
+    at += stratum_parser_feed(&parser, lines + at, strlen(lines + at), &msg);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_UINT32(4, msg->id);
+    TEST_ASSERT_FALSE(msg->result);
+    TEST_ASSERT_TRUE(msg->error);
+    TEST_ASSERT_EQUAL_size_t(strlen(lines), at);
+}
+
+// Test the mining.configure results the client turns into a version mask
+void test_stratum_parser_configure(void)
+{
+    const stratum_msg_t *msg;
+    int count;
+
+    stratum_parser_init(&parser);
+
+    // The pool may grant other bits than we asked for; the client intersects them
+    msg = feed("{\"result\": {\"version-rolling\" : true, \"version-rolling.mask\" : \"00ffe000\"},\"id\":1}\n",
+               7, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_TRUE(msg->version_rolling);
+    TEST_ASSERT_EQUAL_HEX32(0x00ffe000, msg->version_mask);
+
+    // Refused, unknown method, missing or malformed mask
+    msg = feed("{\"id\":1,\"result\":{\"version-rolling\":false}}\n", 64, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_FALSE(msg->version_rolling);
+    msg = feed("{\"id\":1,\"result\":null,\"error\":[20,\"Unknown method\",null]}\n", 64, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_FALSE(msg->version_rolling);
+    TEST_ASSERT_TRUE(msg->error);
+    msg = feed("{\"id\":1,\"result\":{\"version-rolling\":true}}\n", 64, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_EQUAL_HEX32(0, msg->version_mask);
+    msg = feed("{\"id\":1,\"result\":{\"version-rolling\":true,\"version-rolling.mask\":\"zz\"}}\n", 64, &count);
+    TEST_ASSERT_EQUAL_INT(1, count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_RESPONSE, msg->type);
+    TEST_ASSERT_FALSE(msg->version_rolling);
+}
+
+// Test the pool's notifications other than jobs
+void test_stratum_parser_methods(void)
+{
+    const stratum_msg_t *msg;
+    int count;
+
+    stratum_parser_init(&parser);
+    msg = feed("{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[0.0009765625]}\n", 5, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_SET_DIFFICULTY, msg->type);
+    TEST_ASSERT_DOUBLE_WITHIN(0, 1.0 / 1024, msg->difficulty);
+
+    msg = feed("{\"params\":[\"00ffe000\"],\"id\":null,\"method\":\"mining.set_version_mask\"}\n", 3, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_SET_VERSION_MASK, msg->type);
+    TEST_ASSERT_EQUAL_HEX32(0x00ffe000, msg->version_mask);
+
+    msg = feed("{\"id\":null,\"method\":\"client.show_message\",\"params\":[\"hello \\\"miner\\\"\"]}\n", 64, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_OTHER, msg->type);
+
+    // A difficulty must be a positive number
+    msg = feed("{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[\"8\"]}\n", 64, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_INVALID, msg->type);
+}
+
+// Test that malformed or oversized messages are rejected without
+// disturbing the messages that follow
+void test_stratum_parser_invalid(void)
+{
+    static const char *bad[] = {
+        "garbage\n",
+        "{\"id\":1,\"result\":true\n",                                  // Unterminated
+        "{\"id\":1,,\"result\":true}\n",
+        "{\"id\":1}{\"id\":2}\n",
+        "[[[[[[[[[1]]]]]]]]]\n",                                        // Too deep
+        // Odd digit count, non-hex digit, prevhash too long
+        "{\"method\":\"mining.notify\",\"params\":[\"1\",\"0\",\"00\",\"00\",[],\"00000001\",\"1d00ffff\","
+        "\"495fab29\",true]}\n",
+        "{\"method\":\"mining.notify\",\"params\":[\"1\",\"" PREVHASH "\",\"0g\",\"00\",[],\"00000001\","
+        "\"1d00ffff\",\"495fab29\",true]}\n",
+        "{\"method\":\"mining.notify\",\"params\":[\"1\",\"" PREVHASH "00\",\"00\",\"00\",[],\"00000001\","
+        "\"1d00ffff\",\"495fab29\",true]}\n",
+        // Short header word, branch hash too short, missing fields
+        "{\"method\":\"mining.notify\",\"params\":[\"1\",\"" PREVHASH "\",\"00\",\"00\",[],\"0001\","
+        "\"1d00ffff\",\"495fab29\",true]}\n",
+        "{\"method\":\"mining.notify\",\"params\":[\"1\",\"" PREVHASH "\",\"00\",\"00\",[\"00\"],\"00000001\","
+        "\"1d00ffff\",\"495fab29\",true]}\n",
+        "{\"method\":\"mining.notify\",\"params\":[\"1\",\"" PREVHASH "\",\"00\",\"00\",[]]}\n",
+        // Job id too long for STRATUM_JOB_ID_MAX
+        "{\"method\":\"mining.notify\",\"params\":[\"0123456789012345678901234567890123456789012345678901234567890123\",\""
+        PREVHASH "\",\"00\",\"00\",[],\"00000001\",\"1d00ffff\",\"495fab29\",true]}\n",
+    };
+    uint8_t coinbase1[WORK_COINBASE_MAX * 2 + 256];
+    int count;
+
+    subscribed();
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        const stratum_msg_t *msg = feed(bad[i], 5, &count);
+        TEST_ASSERT_EQUAL_INT(1, count);
+        TEST_ASSERT_EQUAL_INT(STRATUM_MSG_INVALID, msg->type);
+        msg = feed(notify, 64, &count);
+        TEST_ASSERT_EQUAL_INT(1, count);
+        TEST_ASSERT_EQUAL_INT(STRATUM_MSG_NOTIFY, msg->type);
+        TEST_ASSERT_EQUAL_size_t(2, msg->job.work.merkle_count);
+    }
+
+    // A coinbase that would not fit the template
+    memset(coinbase1, 'a', sizeof(coinbase1));
+    const char *head = "{\"method\":\"mining.notify\",\"params\":[\"1\",\"" PREVHASH "\",\"";
+    memcpy(coinbase1, head, strlen(head));
+    strcpy((char *)coinbase1 + sizeof(coinbase1) - 60, "\",\"00\",[],\"00000001\",\"1d00ffff\",\"495fab29\",1]}\n");
+    const stratum_msg_t *msg = feed((const char *)coinbase1, 100, &count);
+    TEST_ASSERT_EQUAL_INT(1, count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_INVALID, msg->type);
+
+    // A notify before the subscription is known cannot be assembled
+    stratum_parser_init(&parser);
+    msg = feed(notify, 64, &count);
+    TEST_ASSERT_EQUAL_INT(STRATUM_MSG_INVALID, msg->type);
+}
+
+// Register tests with Unity
+void test_stratum_parser_functions(void)
+{
+    RUN_TEST(test_stratum_parser_notify);
+    RUN_TEST(test_stratum_parser_responses);
+    RUN_TEST(test_stratum_parser_configure);
+    RUN_TEST(test_stratum_parser_methods);
+    RUN_TEST(test_stratum_parser_invalid);
+}
@@ -0,0 +1,234 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+#include "mock_sv2_pool.h"
+#include "pool_harness.h"
+
+// Host only: the pool is a child process on a loopback socket
+
+static mock_sv2_pool_t pool;
+static sv2_client_t client;
+static sv2_config_t config;
+static bool pool_started;
+
+static void start(double difficulty, const char *user, uint32_t setup_flags)
+{
+    TEST_ASSERT_TRUE(mock_sv2_pool_start(&pool, difficulty, setup_flags));
+    pool_started = true;
+    config.host = "127.0.0.1";
+    config.port = pool.port;
+    config.user = user;
+    config.hashrate = 500000.0f;
+    config.version_mask = VERSION_ROLLING_BIP320_MASK;
+    sv2_client_init(&client, &config);
+}
+
+void setUp(void)
+{
+    pool_started = false;
+}
+
+void tearDown(void)
+{
+    if (pool_started) {
+        sv2_client_close(&client);
+        TEST_ASSERT_EQUAL_INT(0, mock_sv2_pool_finish(&pool));
+    }
+}
+
+// Test the setup, the channel and a future job activated by SetNewPrevHash
+void test_sv2_handshake_job(void)
+{
+    sv2_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+    uint8_t header[80];
+
+    start(1.0, MOCK_POOL_USER, 0);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, SV2_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+
+    sv2_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(MOCK_SV2_CHANNEL_ID, status.channel_id);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 1.0, status.conn.difficulty);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.jobs);
+    TEST_ASSERT_GREATER_THAN(0, status.conn.tx_bytes);
+    TEST_ASSERT_GREATER_THAN(0, status.conn.rx_bytes);
+
+    TEST_ASSERT_EQUAL_UINT32(1, seq);
+    TEST_ASSERT_EQUAL_STRING("1", job.id);
+    TEST_ASSERT_TRUE(job.clean);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 1.0, job.difficulty);
+    TEST_ASSERT_EQUAL_HEX32(VERSION_ROLLING_BIP320_MASK, job.work.version_mask);
+    TEST_ASSERT_EQUAL_UINT32(WORK_NTIME_ROLL_DEFAULT, job.work.ntime_roll);
+    // Header-only work: nothing to hash but the header
+    TEST_ASSERT_EQUAL_size_t(0, job.work.coinbase_len);
+    TEST_ASSERT_EQUAL_size_t(0, job.work.merkle_count);
+
+    work_header(&job.work, 0, header);
+    TEST_ASSERT_EQUAL_MEMORY(mock_pool_genesis_header, header, 76);
+
+    // Nothing newer yet
+    TEST_ASSERT_FALSE(sv2_client_take_job(&client, &seq, &job));
+}
+
+// Test share submission, the pool's verdicts and the jobs that follow
+void test_sv2_submit(void)
+{
+    sv2_status_t status;
+    stratum_share_t share;
+    stratum_job_t job;
+    uint32_t seq = 0;
+
+    start(1.0, MOCK_POOL_USER, 0);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, SV2_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+
+    pool_harness_genesis_share(&job, &share);
+    TEST_ASSERT_TRUE(sv2_client_submit(&client, &share));
+    share.nonce++;
+    TEST_ASSERT_TRUE(sv2_client_submit(&client, &share));
+    TEST_ASSERT_TRUE(pool_harness_poll_answers(&client.conn));
+    sv2_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(2, status.conn.submitted);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.accepted);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.dropped);
+
+    // The accepted share prompts job 2 on the same previous block...
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+    if (strcmp(job.id, "2") == 0) {
+        TEST_ASSERT_FALSE(job.clean);
+        TEST_ASSERT_EQUAL_HEX32(MOCK_SV2_JOB2_VERSION, job.work.header.version);
+        TEST_ASSERT_EQUAL_MEMORY(mock_pool_branch, job.work.header.merkle_root, 32);
+        TEST_ASSERT_EQUAL_MEMORY(mock_pool_genesis_header + 4, job.work.header.prev_hash, 32);
+        TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+    }
+
+    // ...then job 3 on top of the genesis block, which retires the others
+    TEST_ASSERT_EQUAL_STRING("3", job.id);
+    TEST_ASSERT_TRUE(job.clean);
+    TEST_ASSERT_EQUAL_MEMORY(mock_pool_genesis_hash, job.work.header.prev_hash, 32);
+    TEST_ASSERT_EQUAL_UINT32(0x495fab29 + WORK_NTIME_ROLL_DEFAULT, job.work.header.timestamp);
+    TEST_ASSERT_EQUAL_HEX32(0x1d00ffff, job.work.header.bits);
+    sv2_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(3, status.conn.jobs);
+}
+
+// Test that a refused channel disconnects and that shares are not queued then
+void test_sv2_unauthorized(void)
+{
+    sv2_status_t status;
+    stratum_share_t share;
+
+    memset(&share, 0, sizeof(share));
+    start(1.0, "intruder", 0);
+    TEST_ASSERT_TRUE(pool_harness_poll_failure(&client.conn));
+    sv2_client_status(&client, &status);
+
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.reconnects);
+    TEST_ASSERT_EQUAL_INT(SV2_DISCONNECTED, status.conn.state);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.jobs);
+    TEST_ASSERT_FALSE(sv2_client_submit(&client, &share));
+    sv2_client_status(&client, &status);
+    TEST_ASSERT_EQUAL_UINT32(1, status.conn.dropped);
+}
+
+typedef struct {
+    sv2_client_t *client;
+    const stratum_job_t *job;
+    uint32_t found;
+} submit_arg_t;
+
+static void submit_share(miner_ctx_t *miner, const miner_share_t *found, void *arg)
+{
+    submit_arg_t *submit = (submit_arg_t *)arg;
+    stratum_share_t share;
+
+    (void)miner;
+    if (!found->meets_share) {
+        return;
+    }
+    strcpy(share.job_id, submit->job->id);
+    share.extranonce2 = 0;
+    share.ntime = found->ntime;
+    share.nonce = found->nonce;
+    share.version = found->version;
+    // Runs on a worker thread: failures are checked through the drop count
+    sv2_client_submit(submit->client, &share);
+    __atomic_fetch_add(&submit->found, 1, __ATOMIC_RELAXED);
+}
+
+// Mine count header-only variants from roll << 32 with two workers and
+// wait for the pool's answers
+static void mine(stratum_job_t *job, uint64_t roll, uint32_t count, submit_arg_t *arg, sv2_status_t *status)
+{
+    static miner_ctx_t miner;
+
+    miner_ctx_init(&miner, hash_backend_get(0), 2);
+    miner_ctx_set_share_callback(&miner, submit_share, arg);
+    miner_ctx_set_share_difficulty(&miner, job->difficulty);
+    miner_ctx_set_work(&miner, &job->work);
+    miner_ctx_set_range(&miner, roll << 32, count, 1000);
+    TEST_ASSERT_TRUE(miner_ctx_start(&miner));
+    while (miner_ctx_running(&miner)) {
+        sv2_client_poll(&client, 1);
+    }
+    miner_ctx_wait(&miner);
+    TEST_ASSERT_TRUE(pool_harness_poll_answers(&client.conn));
+    sv2_client_status(&client, status);
+}
+
+// Test mining header-only work with two workers: every share found in
+// rolled variants (version and ntime) must be accepted by the pool
+void test_sv2_mining(void)
+{
+    sv2_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+    submit_arg_t arg = { &client, &job, 0 };
+
+    // About one share per 4096 hashes
+    start(1.0 / 1048576, MOCK_POOL_USER, 0);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, SV2_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+
+    // Variant with version index 5 and ntime + 1
+    mine(&job, 65536 + 5, 24000, &arg, &status);
+    TEST_ASSERT_GREATER_THAN(0, arg.found);
+    TEST_ASSERT_EQUAL_UINT32(arg.found, status.conn.submitted);
+    TEST_ASSERT_EQUAL_UINT32(arg.found, status.conn.accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.dropped);
+}
+
+// Test that a pool requiring a fixed version gets jobs without version
+// rolling: the variants only roll ntime, and the pool accepts every share
+void test_sv2_fixed_version(void)
+{
+    sv2_status_t status;
+    stratum_job_t job;
+    uint32_t seq = 0;
+    submit_arg_t arg = { &client, &job, 0 };
+
+    start(1.0 / 1048576, MOCK_POOL_USER, SV2_REQUIRES_FIXED_VERSION);
+    TEST_ASSERT_TRUE(pool_harness_poll_state(&client.conn, SV2_MINING));
+    TEST_ASSERT_TRUE(pool_harness_poll_job(&client.conn, &seq, &job));
+    TEST_ASSERT_EQUAL_HEX32(0, job.work.version_mask);
+
+    // With the BIP320 mask this would be version index 1, not ntime + 1
+    mine(&job, 1, 24000, &arg, &status);
+    TEST_ASSERT_GREATER_THAN(0, arg.found);
+    TEST_ASSERT_EQUAL_UINT32(arg.found, status.conn.accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, status.conn.rejected);
+}
+
+// Register tests with Unity
+void test_sv2_functions(void)
+{
+    RUN_TEST(test_sv2_handshake_job);
+    RUN_TEST(test_sv2_submit);
+    RUN_TEST(test_sv2_unauthorized);
+    RUN_TEST(test_sv2_mining);
+    RUN_TEST(test_sv2_fixed_version);
+}
@@ -0,0 +1,254 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+static sv2_decoder_t decoder;
+
+// Feed a buffer in pieces of step bytes; returns the number of messages and the last one
+static int feed(const uint8_t *data, size_t len, size_t step, sv2_msg_t *last)
+{
+    int count = 0;
+    size_t done = 0;
+
+    while (done < len) {
+        const sv2_msg_t *msg;
+        size_t piece = len - done < step ? len - done : step;
+        size_t used = 0;
+
+        while (used < piece) {
+            used += sv2_decoder_feed(&decoder, data + done + used, piece - used, &msg);
+            if (msg != NULL) {
+                *last = *msg;
+                count++;
+            }
+        }
+        done += piece;
+    }
+    return count;
+}
+
+// Test the exact bytes of a channel message and decoding it back in pieces
+void test_sv2_codec_frame(void)
+{
+    static const uint8_t expect[] = {
+        0x00, 0x80, 0x1a, 0x18, 0x00, 0x00,                 // channel_msg, SubmitSharesStandard, 24 bytes
+        0x07, 0x00, 0x00, 0x00, 0x2a, 0x00, 0x00, 0x00,     // channel 7, sequence 42
+        0x03, 0x00, 0x00, 0x00, 0x1d, 0xac, 0x2b, 0x7c,     // job 3, nonce
+        0x29, 0xab, 0x5f, 0x49, 0x00, 0xe0, 0xff, 0x3f,     // ntime, version
+    };
+    uint8_t frame[64];
+    sv2_msg_t msg;
+    sv2_msg_t out;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SUBMIT_SHARES_STANDARD;
+    msg.channel_id = 7;
+    msg.sequence = 42;
+    msg.job_id = 3;
+    msg.nonce = 0x7c2bac1d;
+    msg.ntime = 0x495fab29;
+    msg.version = 0x3fffe000;
+    TEST_ASSERT_EQUAL_size_t(sizeof(expect), sv2_encode(&msg, frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_MEMORY(expect, frame, sizeof(expect));
+
+    for (size_t step = 1; step <= sizeof(expect); step++) {
+        sv2_decoder_init(&decoder);
+        memset(&out, 0, sizeof(out));
+        TEST_ASSERT_EQUAL_INT(1, feed(frame, sizeof(expect), step, &out));
+        TEST_ASSERT_TRUE(out.decoded);
+        TEST_ASSERT_EQUAL_UINT8(SV2_SUBMIT_SHARES_STANDARD, out.type);
+        TEST_ASSERT_EQUAL_UINT32(7, out.channel_id);
+        TEST_ASSERT_EQUAL_UINT32(42, out.sequence);
+        TEST_ASSERT_EQUAL_UINT32(3, out.job_id);
+        TEST_ASSERT_EQUAL_HEX32(0x7c2bac1d, out.nonce);
+        TEST_ASSERT_EQUAL_HEX32(0x495fab29, out.ntime);
+        TEST_ASSERT_EQUAL_HEX32(0x3fffe000, out.version);
+    }
+}
+
+// Test a session's messages back to back through one decoder
+void test_sv2_codec_session(void)
+{
+    static uint8_t stream[1024];
+    sv2_msg_t msg;
+    sv2_msg_t out;
+    size_t len = 0;
+    size_t at;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SETUP_CONNECTION;
+    msg.protocol = SV2_PROTOCOL_MINING;
+    msg.min_version = 2;
+    msg.max_version = 2;
+    msg.flags = SV2_REQUIRES_STANDARD_JOBS;
+    strcpy(msg.text, "10.0.0.2");
+    msg.port = 34255;
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS;
+    msg.request_id = 1;
+    msg.channel_id = 9;
+    memset(msg.hash, 0xee, 32);
+    msg.hash[31] = 0;
+    memcpy(msg.extranonce_prefix, "\x01\x02\x03", 3);
+    msg.extranonce_prefix_len = 3;
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_NEW_MINING_JOB;
+    msg.channel_id = 9;
+    msg.job_id = 5;
+    msg.future = true;
+    msg.version = 0x20000000;
+    memset(msg.hash, 0x5a, 32);
+    at = len;
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+    // Without min_ntime: no OPTION value
+    TEST_ASSERT_EQUAL_size_t(SV2_HEADER_SIZE + 46, len - at);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SET_NEW_PREV_HASH;
+    msg.channel_id = 9;
+    msg.job_id = 5;
+    memset(msg.hash, 0x11, 32);
+    msg.ntime = 1700000000;
+    msg.nbits = 0x17034219;
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SUBMIT_SHARES_SUCCESS;
+    msg.channel_id = 9;
+    msg.sequence = 12;
+    msg.count = 3;
+    msg.shares_sum = 0x100000003ull;
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SUBMIT_SHARES_ERROR;
+    msg.channel_id = 9;
+    msg.sequence = 13;
+    strcpy(msg.text, "stale-share");
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+
+    sv2_decoder_init(&decoder);
+    at = 0;
+    for (int i = 0; i < 6; i++) {
+        const sv2_msg_t *next = NULL;
+        while (next == NULL && at < len) {
+            at += sv2_decoder_feed(&decoder, stream + at, len - at, &next);
+        }
+        TEST_ASSERT_NOT_NULL(next);
+        TEST_ASSERT_TRUE(next->decoded);
+        out = *next;
+        switch (i) {
+        case 0:
+            TEST_ASSERT_EQUAL_UINT8(SV2_SETUP_CONNECTION, out.type);
+            TEST_ASSERT_EQUAL_UINT16(2, out.max_version);
+            TEST_ASSERT_EQUAL_UINT32(SV2_REQUIRES_STANDARD_JOBS, out.flags);
+            TEST_ASSERT_EQUAL_STRING("10.0.0.2", out.text);
+            TEST_ASSERT_EQUAL_UINT16(34255, out.port);
+            break;
+        case 1:
+            TEST_ASSERT_EQUAL_UINT8(SV2_OPEN_STANDARD_MINING_CHANNEL_SUCCESS, out.type);
+            TEST_ASSERT_EQUAL_UINT32(9, out.channel_id);
+            TEST_ASSERT_EQUAL_UINT8(0xee, out.hash[30]);
+            TEST_ASSERT_EQUAL_UINT8(0, out.hash[31]);
+            TEST_ASSERT_EQUAL_UINT8(3, out.extranonce_prefix_len);
+            TEST_ASSERT_EQUAL_MEMORY("\x01\x02\x03", out.extranonce_prefix, 3);
+            break;
+        case 2:
+            TEST_ASSERT_EQUAL_UINT8(SV2_NEW_MINING_JOB, out.type);
+            TEST_ASSERT_TRUE(out.future);
+            TEST_ASSERT_EQUAL_UINT32(5, out.job_id);
+            TEST_ASSERT_EQUAL_HEX32(0x20000000, out.version);
+            TEST_ASSERT_EQUAL_UINT8(0x5a, out.hash[31]);
+            break;
+        case 3:
+            TEST_ASSERT_EQUAL_UINT8(SV2_SET_NEW_PREV_HASH, out.type);
+            TEST_ASSERT_EQUAL_UINT32(1700000000, out.ntime);
+            TEST_ASSERT_EQUAL_HEX32(0x17034219, out.nbits);
+            TEST_ASSERT_EQUAL_UINT8(0x11, out.hash[0]);
+            break;
+        case 4:
+            TEST_ASSERT_EQUAL_UINT8(SV2_SUBMIT_SHARES_SUCCESS, out.type);
+            TEST_ASSERT_EQUAL_UINT32(12, out.sequence);
+            TEST_ASSERT_EQUAL_UINT32(3, out.count);
+            TEST_ASSERT_TRUE(out.shares_sum == 0x100000003ull);
+            break;
+        default:
+            TEST_ASSERT_EQUAL_UINT8(SV2_SUBMIT_SHARES_ERROR, out.type);
+            TEST_ASSERT_EQUAL_UINT32(13, out.sequence);
+            TEST_ASSERT_EQUAL_STRING("stale-share", out.text);
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(len, at);
+}
+
+// Test frames that are skipped or do not decode, and encoder limits
+void test_sv2_codec_invalid(void)
+{
+    static uint8_t stream[SV2_PAYLOAD_MAX + 64];
+    uint8_t frame[64];
+    sv2_msg_t msg;
+    sv2_msg_t out;
+    size_t len;
+
+    memset(&out, 0, sizeof(out));
+    // A frame larger than the payload buffer is skipped, the next one decodes
+    memset(stream, 0, sizeof(stream));
+    stream[2] = 0x7f;
+    stream[3] = (uint8_t)(SV2_PAYLOAD_MAX + 10);
+    stream[4] = (uint8_t)((SV2_PAYLOAD_MAX + 10) >> 8);
+    len = SV2_HEADER_SIZE + SV2_PAYLOAD_MAX + 10;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SET_TARGET;
+    msg.channel_id = 4;
+    len += sv2_encode(&msg, stream + len, sizeof(stream) - len);
+    sv2_decoder_init(&decoder);
+    TEST_ASSERT_EQUAL_INT(2, feed(stream, len, 100, &out));
+    TEST_ASSERT_TRUE(out.decoded);
+    TEST_ASSERT_EQUAL_UINT8(SV2_SET_TARGET, out.type);
+    TEST_ASSERT_EQUAL_UINT32(4, out.channel_id);
+
+    // Truncated payload
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_SET_NEW_PREV_HASH;
+    len = sv2_encode(&msg, frame, sizeof(frame));
+    frame[3] -= 1;
+    sv2_decoder_init(&decoder);
+    TEST_ASSERT_EQUAL_INT(1, feed(frame, len - 1, len, &out));
+    TEST_ASSERT_FALSE(out.decoded);
+
+    // NewMiningJob whose merkle root is not 32 bytes
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SV2_NEW_MINING_JOB;
+    len = sv2_encode(&msg, frame, sizeof(frame));
+    frame[len - 33] = 31;
+    sv2_decoder_init(&decoder);
+    TEST_ASSERT_EQUAL_INT(1, feed(frame, len, len, &out));
+    TEST_ASSERT_FALSE(out.decoded);
+
+    // Extension messages are not ours
+    len = sv2_encode(&msg, frame, sizeof(frame));
+    frame[0] = 0x01;
+    sv2_decoder_init(&decoder);
+    TEST_ASSERT_EQUAL_INT(1, feed(frame, len, len, &out));
+    TEST_ASSERT_FALSE(out.decoded);
+    TEST_ASSERT_EQUAL_UINT16(1, out.extension);
+
+    // Buffer too small, unknown type
+    TEST_ASSERT_EQUAL_size_t(0, sv2_encode(&msg, frame, len - 1));
+    TEST_ASSERT_EQUAL_size_t(0, sv2_encode(&msg, frame, 3));
+    msg.type = 0x7f;
+    TEST_ASSERT_EQUAL_size_t(0, sv2_encode(&msg, frame, sizeof(frame)));
+}
+
+// Register tests with Unity
+void test_sv2_codec_functions(void)
+{
+    RUN_TEST(test_sv2_codec_frame);
+    RUN_TEST(test_sv2_codec_session);
+    RUN_TEST(test_sv2_codec_invalid);
+}
@@ -0,0 +1,156 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Genesis block hash, little-endian as produced by double_sha256()
+static const uint8_t genesis_hash[32] = {
+    0x6f, 0xe2, 0x8c, 0x0a, 0xb6, 0xf1, 0xb3, 0x72, 0xc1, 0xa6, 0xa2, 0x46, 0xae, 0x63, 0xf7, 0x4f,
+    0x93, 0x1e, 0x83, 0x65, 0xe1, 0x5a, 0x08, 0x9c, 0x68, 0xd6, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// Test expanding the difficulty-1 nBits
+void test_target_from_bits_diff1(void)
+{
+    const uint32_t expected[8] = { 0, 0xFFFF0000, 0, 0, 0, 0, 0, 0 };
+    target_t target;
+
+    TEST_ASSERT_TRUE(target_from_bits(TARGET_DIFF1_BITS, &target));
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, target.words, 8);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 1.0, target_difficulty(&target));
+}
+
+// Test a known mainnet nBits and its difficulty
+void test_target_from_bits_difficulty(void)
+{
+    const uint32_t expected[8] = { 0, 0x000404CB, 0, 0, 0, 0, 0, 0 };
+    target_t target;
+
+    TEST_ASSERT_TRUE(target_from_bits(0x1b0404cb, &target));
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, target.words, 8);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 16307.420938523983, target_difficulty(&target));
+}
+
+// Test nBits whose mantissa straddles a word boundary
+void test_target_from_bits_straddle(void)
+{
+    const uint32_t expected[8] = { 0, 0x00001234, 0x56000000, 0, 0, 0, 0, 0 };
+    target_t target;
+
+    TEST_ASSERT_TRUE(target_from_bits(0x1a123456, &target));
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, target.words, 8);
+}
+
+// Test small exponents and rejected encodings
+void test_target_from_bits_edge_cases(void)
+{
+    target_t target;
+
+    TEST_ASSERT_TRUE(target_from_bits(0x03123456, &target));
+    TEST_ASSERT_EQUAL_HEX32(0x00123456, target.words[7]);
+    TEST_ASSERT_TRUE(target_from_bits(0x02123400, &target));
+    TEST_ASSERT_EQUAL_HEX32(0x00001234, target.words[7]);
+    TEST_ASSERT_TRUE(target_from_bits(0x207fffff, &target));
+    TEST_ASSERT_EQUAL_HEX32(0x7FFFFF00, target.words[0]);
+
+    TEST_ASSERT_FALSE(target_from_bits(0x1d000000, &target));   // zero
+    TEST_ASSERT_FALSE(target_from_bits(0x1d800001, &target));   // negative
+    TEST_ASSERT_FALSE(target_from_bits(0x23000100, &target));   // overflow
+    TEST_ASSERT_EQUAL_HEX32(0, target.words[0]);
+}
+
+// Test pool difficulties against diff1 / difficulty
+void test_target_from_difficulty(void)
+{
+    target_t target;
+    target_t diff1;
+
+    target_from_difficulty(1.0, &target);
+    target_from_bits(TARGET_DIFF1_BITS, &diff1);
+    TEST_ASSERT_EQUAL_INT(0, target_compare(&target, &diff1));
+
+    // 0xFFFF * 2^208 / 1000 = 0x4188F5C28F5C28 * 2^160
+    target_from_difficulty(1000.0, &target);
+    TEST_ASSERT_EQUAL_HEX32(0, target.words[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x004188F5, target.words[1]);
+    TEST_ASSERT_EQUAL_HEX32(0xC28F5C28, target.words[2]);
+    TEST_ASSERT_EQUAL_HEX32(0, target.words[3]);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1000.0, target_difficulty(&target));
+
+    target_from_difficulty(1.0 / 65536, &target);
+    TEST_ASSERT_EQUAL_HEX32(0x0000FFFF, target.words[0]);
+
+    target_from_difficulty(0.0, &target);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, target.words[0]);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, target.words[7]);
+}
+
+// Test the share difficulty of the genesis hash
+void test_target_hash_difficulty(void)
+{
+    target_t value;
+
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 2536.4262984453103, target_hash_difficulty(genesis_hash));
+    target_from_hash(genesis_hash, &value);
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, value.words[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x0019D668, value.words[1]);
+    TEST_ASSERT_EQUAL_HEX32(0x0A8CE26F, value.words[7]);
+}
+
+// Test hash <= target at the boundary and in every word position
+void test_target_hash_meets(void)
+{
+    target_t target;
+    target_t value;
+    uint8_t hash[32];
+
+    target_from_bits(TARGET_DIFF1_BITS, &target);
+    TEST_ASSERT_TRUE(target_hash_meets(genesis_hash, &target));
+    target_from_bits(0x1b0404cb, &target);
+    TEST_ASSERT_FALSE(target_hash_meets(genesis_hash, &target));
+
+    // Equal meets; one less in any word fails, one more passes
+    for (int i = 0; i < 32; i++) {
+        hash[i] = (uint8_t)(i * 7 + 1);
+    }
+    target_from_hash(hash, &target);
+    TEST_ASSERT_TRUE(target_hash_meets(hash, &target));
+    for (int i = 0; i < 8; i++) {
+        value = target;
+        value.words[i]--;
+        TEST_ASSERT_FALSE(target_hash_meets(hash, &value));
+        TEST_ASSERT_LESS_THAN(0, target_compare(&value, &target));
+        value.words[i] += 2;
+        TEST_ASSERT_TRUE(target_hash_meets(hash, &value));
+        TEST_ASSERT_GREATER_THAN(0, target_compare(&value, &target));
+    }
+}
+
+// Test that the top word bounds every hash meeting the target
+void test_target_top_word(void)
+{
+    target_t target;
+    uint8_t hash[32];
+
+    target_from_difficulty(1.0 / 256, &target);
+    TEST_ASSERT_EQUAL_HEX32(0x000000FF, target_top_word(&target));
+
+    memset(hash, 0, sizeof(hash));
+    hash[28] = 0xFF;
+    TEST_ASSERT_TRUE(target_hash_meets(hash, &target));
+    hash[28] = 0x00;
+    hash[29] = 0x01;
+    TEST_ASSERT_FALSE(target_hash_meets(hash, &target));
+}
+
+// Register tests with Unity
+void test_target_functions(void)
+{
+    RUN_TEST(test_target_from_bits_diff1);
+    RUN_TEST(test_target_from_bits_difficulty);
+    RUN_TEST(test_target_from_bits_straddle);
+    RUN_TEST(test_target_from_bits_edge_cases);
+    RUN_TEST(test_target_from_difficulty);
+    RUN_TEST(test_target_hash_difficulty);
+    RUN_TEST(test_target_hash_meets);
+    RUN_TEST(test_target_top_word);
+}
@@ -0,0 +1,49 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Test the number of versions a mask allows
+void test_version_rolling_count(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(1, version_rolling_count(0));
+    TEST_ASSERT_EQUAL_UINT32(2, version_rolling_count(0x00002000));
+    TEST_ASSERT_EQUAL_UINT32(65536, version_rolling_count(VERSION_ROLLING_BIP320_MASK));
+    TEST_ASSERT_EQUAL_UINT32(1u << 31, version_rolling_count(0xFFFFFFFF));
+}
+
+// Test depositing an index into the mask bits
+void test_version_rolling_apply(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(0x20000000, version_rolling_apply(0x20000000, VERSION_ROLLING_BIP320_MASK, 0));
+    TEST_ASSERT_EQUAL_HEX32(0x20002000, version_rolling_apply(0x20000000, VERSION_ROLLING_BIP320_MASK, 1));
+    TEST_ASSERT_EQUAL_HEX32(0x3fffe000, version_rolling_apply(0x20000000, VERSION_ROLLING_BIP320_MASK, 0xFFFF));
+    // Bits under the mask in the base are replaced, others kept
+    TEST_ASSERT_EQUAL_HEX32(0x20000004, version_rolling_apply(0x20004004, VERSION_ROLLING_BIP320_MASK, 0));
+    // Non-contiguous mask: index bits 0, 1, 2 land on bits 4, 8, 31
+    TEST_ASSERT_EQUAL_HEX32(0x80000110, version_rolling_apply(0, 0x80000110, 7));
+    TEST_ASSERT_EQUAL_HEX32(0x80000010, version_rolling_apply(0, 0x80000110, 5));
+    // Indices beyond the mask are ignored
+    TEST_ASSERT_EQUAL_HEX32(0x00000010, version_rolling_apply(0, 0x00000010, 0x11));
+}
+
+// Test the mining.configure request line
+void test_version_rolling_configure_request(void)
+{
+    char buf[256];
+    const char *expected =
+        "{\"id\":3,\"method\":\"mining.configure\",\"params\":[[\"version-rolling\"],"
+        "{\"version-rolling.mask\":\"1fffe000\",\"version-rolling.min-bit-count\":2}]}\n";
+
+    TEST_ASSERT_EQUAL_size_t(strlen(expected),
+                             version_rolling_configure_request(buf, sizeof(buf), 3, VERSION_ROLLING_BIP320_MASK));
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+    TEST_ASSERT_EQUAL_size_t(0, version_rolling_configure_request(buf, 32, 3, VERSION_ROLLING_BIP320_MASK));
+}
+
+// Register tests with Unity
+void test_version_rolling_functions(void)
+{
+    RUN_TEST(test_version_rolling_count);
+    RUN_TEST(test_version_rolling_apply);
+    RUN_TEST(test_version_rolling_configure_request);
+}
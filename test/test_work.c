@@ -0,0 +1,293 @@
+#include <string.h>
+#include "unity.h"
+#include "mining/miner_core.h"
+
+// Bitcoin genesis block header (block 0)
+static const uint8_t genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+// Genesis coinbase transaction; its hash is the genesis merkle root
+static const uint8_t genesis_coinbase[204] = {
+    0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x4d, 0x04, 0xff, 0xff, 0x00, 0x1d, 0x01,
+    0x04, 0x45, 0x54, 0x68, 0x65, 0x20, 0x54, 0x69, 0x6d, 0x65, 0x73, 0x20, 0x30, 0x33, 0x2f, 0x4a,
+    0x61, 0x6e, 0x2f, 0x32, 0x30, 0x30, 0x39, 0x20, 0x43, 0x68, 0x61, 0x6e, 0x63, 0x65, 0x6c, 0x6c,
+    0x6f, 0x72, 0x20, 0x6f, 0x6e, 0x20, 0x62, 0x72, 0x69, 0x6e, 0x6b, 0x20, 0x6f, 0x66, 0x20, 0x73,
+    0x65, 0x63, 0x6f, 0x6e, 0x64, 0x20, 0x62, 0x61, 0x69, 0x6c, 0x6f, 0x75, 0x74, 0x20, 0x66, 0x6f,
+    0x72, 0x20, 0x62, 0x61, 0x6e, 0x6b, 0x73, 0xff, 0xff, 0xff, 0xff, 0x01, 0x00, 0xf2, 0x05, 0x2a,
+    0x01, 0x00, 0x00, 0x00, 0x43, 0x41, 0x04, 0x67, 0x8a, 0xfd, 0xb0, 0xfe, 0x55, 0x48, 0x27, 0x19,
+    0x67, 0xf1, 0xa6, 0x71, 0x30, 0xb7, 0x10, 0x5c, 0xd6, 0xa8, 0x28, 0xe0, 0x39, 0x09, 0xa6, 0x79,
+    0x62, 0xe0, 0xea, 0x1f, 0x61, 0xde, 0xb6, 0x49, 0xf6, 0xbc, 0x3f, 0x4c, 0xef, 0x38, 0xc4, 0xf3,
+    0x55, 0x04, 0xe5, 0x1e, 0xc1, 0x12, 0xde, 0x5c, 0x38, 0x4d, 0xf7, 0xba, 0x0b, 0x8d, 0x57, 0x8a,
+    0x4c, 0x70, 0x2b, 0x6b, 0xf1, 0x1d, 0x5f, 0xac, 0x00, 0x00, 0x00, 0x00
+};
+
+// Genesis work with the coinbase split as coinbase1 | extranonce1 (4) | extranonce2 (4) | coinbase2
+static void genesis_work(work_template_t *work, uint32_t ntime_roll)
+{
+    block_header_t fields;
+
+    block_header_parse(genesis_header, &fields);
+    work_init(work, &fields, ntime_roll);
+    TEST_ASSERT_TRUE(work_set_coinbase(work, genesis_coinbase, 50, genesis_coinbase + 50, 4, 4,
+                                       genesis_coinbase + 58, sizeof(genesis_coinbase) - 58));
+    // "Time" as a little-endian extranonce2 reproduces the original coinbase
+    work->extranonce2 = 0x656d6954;
+}
+
+// Test that header-only work only rolls ntime
+void test_work_header_only(void)
+{
+    work_template_t work;
+    block_header_t fields;
+    work_roll_t roll;
+    uint8_t header[80];
+
+    block_header_parse(genesis_header, &fields);
+    work_init(&work, &fields, 10);
+    TEST_ASSERT_EQUAL_UINT32(11, work_rolls(&work));
+
+    work_roll(&work, 7, &roll);
+    TEST_ASSERT_EQUAL_UINT32(fields.timestamp + 7, roll.ntime);
+    TEST_ASSERT_EQUAL_UINT32(0, roll.extranonce_step);
+
+    work_header(&work, 0, header);
+    TEST_ASSERT_EQUAL_MEMORY(genesis_header, header, 76);
+    TEST_ASSERT_EQUAL_HEX32(0, block_header_read_le32(&header[76]));
+    work_header(&work, 7, header);
+    TEST_ASSERT_EQUAL_HEX32(fields.timestamp + 7, block_header_read_le32(&header[68]));
+}
+
+// Test rebuilding the genesis merkle root from a split coinbase
+void test_work_merkle_root_genesis(void)
+{
+    work_template_t work;
+    uint8_t root[32];
+    uint8_t header[80];
+
+    genesis_work(&work, 0);
+    TEST_ASSERT_EQUAL_size_t(sizeof(genesis_coinbase), work.coinbase_len);
+    work_merkle_root(&work, work.extranonce2, root);
+    TEST_ASSERT_EQUAL_MEMORY(&genesis_header[36], root, 32);
+
+    work_header(&work, 0, header);
+    TEST_ASSERT_EQUAL_MEMORY(genesis_header, header, 76);
+
+    work_merkle_root(&work, work.extranonce2 + 1, root);
+    TEST_ASSERT_NOT_EQUAL(0, memcmp(&genesis_header[36], root, 32));
+}
+
+// Test folding a merkle branch on the right of the coinbase hash
+void test_work_merkle_branch(void)
+{
+    work_template_t work;
+    uint8_t branch[32];
+    uint8_t pair[64];
+    uint8_t expected[32];
+    uint8_t root[32];
+
+    genesis_work(&work, 0);
+    for (int i = 0; i < 32; i++) {
+        branch[i] = (uint8_t)(0xA0 + i);
+    }
+    TEST_ASSERT_TRUE(work_add_branch(&work, branch));
+    work_merkle_root(&work, work.extranonce2, root);
+
+    memcpy(pair, &genesis_header[36], 32);
+    memcpy(pair + 32, branch, 32);
+    double_sha256(pair, sizeof(pair), expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, root, 32);
+
+    for (int i = 1; i < WORK_MERKLE_MAX; i++) {
+        TEST_ASSERT_TRUE(work_add_branch(&work, branch));
+    }
+    TEST_ASSERT_FALSE(work_add_branch(&work, branch));
+}
+
+// Test that the cached coinbase prefix gives the genesis root wherever
+// the pool splits the coinbase, including splits past whole blocks
+void test_work_coinbase_prefix(void)
+{
+    static const size_t splits[] = { 0, 50, 60, 64, 100, 124, 128, 190 };
+    work_template_t work;
+    block_header_t fields;
+    uint8_t root[32];
+
+    block_header_parse(genesis_header, &fields);
+    for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); i++) {
+        size_t c1 = splits[i];
+
+        work_init(&work, &fields, 0);
+        TEST_ASSERT_TRUE(work_set_coinbase(&work, genesis_coinbase, c1, genesis_coinbase + c1, 4, 4,
+                                           genesis_coinbase + c1 + 8, sizeof(genesis_coinbase) - c1 - 8));
+        TEST_ASSERT_EQUAL_UINT64((c1 + 4) & ~(size_t)63, work.coinbase_prefix.length);
+
+        // Extranonce2 is the four coinbase bytes it replaced, little-endian
+        uint64_t extranonce2 = block_header_read_le32(genesis_coinbase + c1 + 4);
+        work_merkle_root(&work, extranonce2, root);
+        TEST_ASSERT_EQUAL_MEMORY(&genesis_header[36], root, 32);
+    }
+}
+
+// Test a deep branch against hashing the whole coinbase and every level
+// from scratch, with and without the cached prefix
+void test_work_merkle_reference(void)
+{
+    static uint8_t coinbase[WORK_COINBASE_MAX];
+    work_template_t work;
+    work_template_t uncached;
+    block_header_t fields;
+    uint8_t branch[32];
+    uint8_t pair[64];
+    uint8_t root[32];
+
+    block_header_parse(genesis_header, &fields);
+    work_init(&work, &fields, 0);
+    TEST_ASSERT_TRUE(work_set_coinbase(&work, genesis_coinbase, 150, genesis_coinbase + 150, 8, 8,
+                                       genesis_coinbase + 158, sizeof(genesis_coinbase) - 158));
+    for (int level = 0; level < 12; level++) {
+        for (int i = 0; i < 32; i++) {
+            branch[i] = (uint8_t)(level * 37 + i);
+        }
+        TEST_ASSERT_TRUE(work_add_branch(&work, branch));
+    }
+    uncached = work;
+    memset(&uncached.coinbase_prefix, 0, sizeof(uncached.coinbase_prefix));
+
+    for (uint64_t extranonce2 = 0; extranonce2 < 0x30000000000ull; extranonce2 += 0x0F0F0F0F0F1ull) {
+        memcpy(coinbase, work.coinbase, work.coinbase_len);
+        for (size_t i = 0; i < 8; i++) {
+            coinbase[work.extranonce2_offset + i] = (uint8_t)(extranonce2 >> (8 * i));
+        }
+        double_sha256(coinbase, work.coinbase_len, pair);
+        for (size_t level = 0; level < work.merkle_count; level++) {
+            memcpy(pair + 32, work.merkle_branch[level], 32);
+            double_sha256(pair, sizeof(pair), pair);
+        }
+
+        work_merkle_root(&work, extranonce2, root);
+        TEST_ASSERT_EQUAL_MEMORY(pair, root, 32);
+        work_merkle_root(&uncached, extranonce2, root);
+        TEST_ASSERT_EQUAL_MEMORY(pair, root, 32);
+    }
+}
+
+// Test the roll order: ntime first, then extranonce2
+void test_work_roll_order(void)
+{
+    work_template_t work;
+    work_roll_t roll;
+
+    genesis_work(&work, 2);
+    work.extranonce2 = 0xFFFFFFFE;
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, work_rolls(&work));
+
+    work_roll(&work, 2, &roll);
+    TEST_ASSERT_EQUAL_UINT32(0x495fab29 + 2, roll.ntime);
+    TEST_ASSERT_EQUAL_HEX64(0xFFFFFFFE, roll.extranonce2);
+    work_roll(&work, 3, &roll);
+    TEST_ASSERT_EQUAL_UINT32(0x495fab29, roll.ntime);
+    TEST_ASSERT_EQUAL_HEX64(0xFFFFFFFF, roll.extranonce2);
+    TEST_ASSERT_EQUAL_UINT32(1, roll.extranonce_step);
+    // Extranonce2 wraps within its size
+    work_roll(&work, 7, &roll);
+    TEST_ASSERT_EQUAL_HEX64(0, roll.extranonce2);
+
+    work.extranonce2_size = 1;
+    TEST_ASSERT_EQUAL_UINT32(3 * 256, work_rolls(&work));
+}
+
+// Test that version bits are the innermost roll
+void test_work_roll_versions(void)
+{
+    work_template_t work;
+    work_roll_t roll;
+
+    genesis_work(&work, 1);
+    work.extranonce2_size = 1;
+    work.version_mask = VERSION_ROLLING_BIP320_MASK;
+    TEST_ASSERT_EQUAL_UINT32(65536u * 2 * 256, work_rolls(&work));
+
+    work_roll(&work, 0, &roll);
+    TEST_ASSERT_EQUAL_HEX32(0x00000001, roll.version);
+    work_roll(&work, 1, &roll);
+    TEST_ASSERT_EQUAL_HEX32(0x00002001, roll.version);
+    TEST_ASSERT_EQUAL_UINT32(0x495fab29, roll.ntime);
+    work_roll(&work, 65535, &roll);
+    TEST_ASSERT_EQUAL_HEX32(0x1fffe001, roll.version);
+    TEST_ASSERT_EQUAL_UINT32(0, roll.extranonce_step);
+    work_roll(&work, 65536, &roll);
+    TEST_ASSERT_EQUAL_HEX32(0x00000001, roll.version);
+    TEST_ASSERT_EQUAL_UINT32(0x495fab29 + 1, roll.ntime);
+    work_roll(&work, 2 * 65536 + 3, &roll);
+    TEST_ASSERT_EQUAL_HEX32(0x00006001, roll.version);
+    TEST_ASSERT_EQUAL_UINT32(0x495fab29, roll.ntime);
+    TEST_ASSERT_EQUAL_UINT32(1, roll.extranonce_step);
+}
+
+// Test that switching rolls in place matches a freshly loaded header
+void test_work_apply_roll(void)
+{
+    static const uint32_t rolls[] = { 1, 2, 0, 4, 5, 3, 9, 9, 0, 13, 12, 24, 0 };
+    work_template_t work;
+    sha256d_ctx_t ctx;
+    sha256d_ctx_t expected;
+    uint8_t header[80];
+    uint32_t from = 0;
+
+    genesis_work(&work, 2);
+    work.version_mask = 0x00006000;
+    work_header(&work, 0, header);
+    sha256d_init(&ctx, header);
+
+    for (size_t i = 0; i < sizeof(rolls) / sizeof(rolls[0]); i++) {
+        work_roll_t a;
+        work_roll_t b;
+
+        work_roll(&work, from, &a);
+        work_roll(&work, rolls[i], &b);
+        work_switch_t kind = a.extranonce_step != b.extranonce_step ? WORK_SWITCH_EXTRANONCE :
+                             a.version != b.version ? WORK_SWITCH_VERSION : WORK_SWITCH_NTIME;
+        TEST_ASSERT_EQUAL(kind, work_apply_roll(&work, &ctx, from, rolls[i]));
+        work_header(&work, rolls[i], header);
+        sha256d_init(&expected, header);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &ctx, sizeof(ctx));
+        from = rolls[i];
+    }
+}
+
+// Test coinbase size limits
+void test_work_coinbase_limits(void)
+{
+    static uint8_t big[WORK_COINBASE_MAX];
+    work_template_t work;
+    block_header_t fields;
+
+    block_header_parse(genesis_header, &fields);
+    work_init(&work, &fields, 0);
+    TEST_ASSERT_FALSE(work_set_coinbase(&work, big, 10, big, 4, 0, big, 10));
+    TEST_ASSERT_FALSE(work_set_coinbase(&work, big, 10, big, 4, 9, big, 10));
+    TEST_ASSERT_FALSE(work_set_coinbase(&work, big, WORK_COINBASE_MAX - 8, big, 4, 8, big, 0));
+    TEST_ASSERT_TRUE(work_set_coinbase(&work, big, WORK_COINBASE_MAX - 12, big, 4, 8, big, 0));
+    TEST_ASSERT_EQUAL_size_t(WORK_COINBASE_MAX, work.coinbase_len);
+}
+
+// Register tests with Unity
+void test_work_functions(void)
+{
+    RUN_TEST(test_work_header_only);
+    RUN_TEST(test_work_merkle_root_genesis);
+    RUN_TEST(test_work_merkle_branch);
+    RUN_TEST(test_work_coinbase_prefix);
+    RUN_TEST(test_work_merkle_reference);
+    RUN_TEST(test_work_roll_order);
+    RUN_TEST(test_work_roll_versions);
+    RUN_TEST(test_work_apply_roll);
+    RUN_TEST(test_work_coinbase_limits);
+}